@@ -0,0 +1,270 @@
+/**
+ * This file contains benchmark harness that measures overhead of NetCalcCore without sockets.
+ *
+ * NetCalcCore is started in this process with LoopbackTransport, so requests go through the real
+ * handle_receive -> parse_result -> handle_send path of event loop threads, but the kernel is not involved.
+ *
+ * Each connection is a closed loop driven by handler of its responses:
+ *   - it writes 'depth' expressions by one write;
+ *   - when all their results are received, it writes the next batch from the handler (in event loop thread).
+ * Program prints throughput (expressions per second), time per expression and latency percentiles of batches.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <LoopbackTransport.h>
+#include <NetCalcCore.h>
+
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig
+{
+    //Number of event loop threads of NetCalcCore.
+    unsigned int threads;
+
+    //Number of simultaneous connections.
+    unsigned int connections;
+
+    //Number of expressions per connection.
+    unsigned int requests;
+
+    //Number of expressions in one write.
+    unsigned int depth;
+
+    //Expression (without '\n').
+    std::string expression;
+
+    //Numeric type of NetCalcCore.
+    NumericType type;
+};
+
+boost::optional<BenchConfig> get_bench_config(int argc, const char* const* argv)
+{
+    BenchConfig cfg{1, 1, 1000000, 1, "(2 + 3) * 7 / 11 - 53 * (17 - 19)", NumericType::int32};
+
+    po::options_description desc("NetCalculator in-process benchmark options");
+    desc.add_options()
+        ("help,h", "Show help")
+        ("threads,t",     po::value<unsigned int>(&cfg.threads),     "Number of event loop threads of server (default value is 1)")
+        ("connections,c", po::value<unsigned int>(&cfg.connections), "Number of simultaneous connections (default value is 1)")
+        ("requests,n",    po::value<unsigned int>(&cfg.requests),    "Number of expressions per connection (default value is 1000000)")
+        ("depth,d",       po::value<unsigned int>(&cfg.depth),       "Number of expressions in one write (default value is 1)")
+        ("expression,e",  po::value<std::string>(&cfg.expression),   "Expression (default value is '(2 + 3) * 7 / 11 - 53 * (17 - 19)')")
+        ("type",          po::value<NumericType>(&cfg.type),         "Numeric type of server: int32, int64, checked_int64, bigint, float64 (default value is int32)");
+
+    po::variables_map vm;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (...)
+    {
+        std::cout << "Invalid parameters." << std::endl << desc << std::endl;
+        return boost::none;
+    }
+
+    if (vm.count("help") || !cfg.threads || !cfg.connections || !cfg.requests || !cfg.depth || cfg.type == NumericType::mod64)
+    {
+        std::cout << desc << std::endl;
+        return boost::none;
+    }
+
+    return cfg;
+}
+
+/**
+ * State of one closed-loop connection.
+ * It is changed by handler of responses only (after the first write), handlers of one connection are serialized.
+ */
+struct BenchConnection
+{
+    std::shared_ptr<LoopbackTransport::Connection> connection;
+
+    //Expressions that are not written yet.
+    unsigned int left = 0;
+
+    //Results of current batch that are not received yet.
+    unsigned int waiting = 0;
+
+    //Time of write of current batch.
+    Clock::time_point sent;
+
+    //Latency of each batch in nanoseconds.
+    std::vector<std::uint64_t> latencies;
+
+    //Server closed connection before all results were received.
+    bool failed = false;
+};
+
+/**
+ * This class runs closed-loop connections and waits for their end.
+ */
+class Bench
+{
+public:
+    Bench(const BenchConfig& cfg_, LoopbackTransport& transport)
+        : cfg(cfg_), connections(cfg.connections)
+    {
+        for (unsigned int i = 0; i < cfg.depth; ++i)
+        {
+            batch += cfg.expression + "\n";
+        }
+
+        for (BenchConnection& c : connections)
+        {
+            c.left = cfg.requests;
+            c.latencies.reserve(cfg.requests / cfg.depth + 1);
+            c.connection = transport.connect([this, &c](LoopbackTransport::Connection&, const char* data, std::size_t size)
+                {
+                    on_response(c, data, size);
+                });
+        }
+    }
+
+    /** Writes the first batch of each connection and waits until all connections are done. */
+    void run()
+    {
+        for (BenchConnection& c : connections)
+        {
+            write(c);
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this]() { return done == connections.size(); });
+    }
+
+    std::vector<BenchConnection>& get_connections() { return connections; }
+
+private:
+    /** Writes the next batch of connection (the last batch can be shorter). */
+    void write(BenchConnection& c)
+    {
+        unsigned int n = std::min(c.left, cfg.depth);
+        c.left -= n;
+        c.waiting = n;
+        c.sent = Clock::now();
+        c.connection->write(batch.data(), n == cfg.depth ? batch.size() : n * (cfg.expression.size() + 1));
+    }
+
+    void on_response(BenchConnection& c, const char* data, std::size_t size)
+    {
+        if (!size)
+        {
+            //Server closes connection after processing error or when it is stopped.
+            if (c.waiting || c.left)
+            {
+                c.failed = true;
+                finish();
+            }
+            return;
+        }
+
+        c.waiting -= static_cast<unsigned int>(std::count(data, data + size, '\n'));
+        if (c.waiting)
+        {
+            return;
+        }
+
+        c.latencies.push_back(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - c.sent).count()));
+        if (c.left)
+        {
+            write(c);
+        }
+        else
+        {
+            finish();
+        }
+    }
+
+    void finish()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++done;
+        condition.notify_one();
+    }
+
+private:
+    const BenchConfig& cfg;
+    std::vector<BenchConnection> connections;
+    std::string batch;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::size_t done = 0;
+};
+
+/**
+ * This function returns percentile of sorted values.
+ */
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, double p)
+{
+    std::size_t index = static_cast<std::size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, const char* argv[])
+{
+    boost::optional<BenchConfig> cfg = get_bench_config(argc, argv);
+    if (!cfg)
+    {
+        return 1;
+    }
+
+    //One client slot per connection, other parameters are defaults of NetCalculatorApp.
+    Config config{"127.0.0.1", 0, cfg->connections, std::min(cfg->threads, cfg->connections)};
+    config.type = cfg->type;
+
+    //Connections wait in backlog of transport until NetCalcCore is started, they outlive NetCalcCore.
+    LoopbackTransport transport(config.clients);
+    Bench bench(cfg.get(), transport);
+    NetCalcCore core(config, &transport);
+    core.start();
+
+    const Clock::time_point start = Clock::now();
+    bench.run();
+    const Clock::time_point end = Clock::now();
+    core.stop();
+
+    std::vector<std::uint64_t> all;
+    bool failed = false;
+    for (BenchConnection& c : bench.get_connections())
+    {
+        all.insert(all.end(), c.latencies.begin(), c.latencies.end());
+        failed = failed || c.failed;
+    }
+
+    if (failed)
+    {
+        std::cerr << "Server closed connection, check the expression." << std::endl;
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    const double expressions = static_cast<double>(cfg->requests) * cfg->connections;
+    std::cout << "Expressions: " << static_cast<unsigned long long>(cfg->requests) * cfg->connections << ", time: " << seconds * 1000.0 << " milliseconds, throughput: "
+              << expressions / seconds << " expressions/s, " << seconds * 1e9 / expressions << " ns per expression" << std::endl
+              << "Batch latency (microseconds): p50 " << percentile(all, 50) / 1000.0
+              << ", p90 " << percentile(all, 90) / 1000.0
+              << ", p99 " << percentile(all, 99) / 1000.0
+              << ", p99.9 " << percentile(all, 99.9) / 1000.0
+              << ", max " << all.back() / 1000.0 << std::endl;
+
+    return 0;
+}
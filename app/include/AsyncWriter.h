@@ -0,0 +1,350 @@
+#pragma once
+
+#include <AlignedPtr.h>
+#include <SpscRing.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * This class keeps one ring buffer per producing thread.
+ *
+ * Ring must have member 'std::thread::id owner'.
+ * Ring buffers are never removed, so a thread looks for its ring buffer once (under mutex),
+ * then it is taken from thread local cache.
+ *
+ * How to use it?
+ * ThreadRings<Ring> rings;
+ * Ring& ring = rings.get();                   //Producing thread.
+ * for (Ring* ring : rings.snapshot()) { ... } //Consuming thread.
+ */
+template <class Ring>
+class ThreadRings
+{
+public:
+    ThreadRings() : id(++counter) {}
+
+    ThreadRings(const ThreadRings&) = delete;
+    ThreadRings& operator=(const ThreadRings&) = delete;
+
+    /** Returns ring buffer of current thread (registers it at the first call). */
+    Ring& get();
+
+    /** Returns ring buffers of all threads in order of registration. */
+    std::vector<Ring*> snapshot();
+
+private:
+    /**
+     * Thread local cache of the last used ring buffer.
+     * It lets producer avoid locking the mutex after the first call in a thread.
+     */
+    struct Cache
+    {
+        unsigned long long id;
+        Ring* ring;
+    };
+
+    static thread_local Cache cache;
+
+    //Source of unique identifiers of ThreadRings objects.
+    static std::atomic<unsigned long long> counter;
+
+    //Unique identifier of this object (cache uses it).
+    const unsigned long long id;
+
+    //Registration is guarded by mutex, rings are over-aligned (see make_aligned()).
+    std::mutex mutex;
+    std::vector<AlignedPtr<Ring>> rings;
+};
+
+/**
+ * This class moves records from ring buffers of producing threads to a file in a background writer thread.
+ *
+ * Each producing thread has its own SpscRing of 'Capacity' records (power of two), so producers don't lock
+ * and don't share cache lines. Entry is dropped (and counted) instead of blocking if the ring is full.
+ *
+ * Owner supplies the record type and formatting, it must have methods:
+ *   - void format(const Record* records, std::size_t n, std::string& output) appends n records to output;
+ *   - void format_dropped(std::uint64_t dropped, std::string& output) appends a record about dropped entries;
+ *   - bool format_pending(std::string& output) appends records that don't go through ring buffers,
+ *     it returns true if anything was appended.
+ * They are called from writer thread only.
+ *
+ * Writer thread drains ring buffers every 10 ms, by flush() and before it stops, output is written with
+ * large buffered writes.
+ *
+ * How to use it?
+ * AsyncWriter<Record, 4096, Logger> writer(*this);
+ * writer.start(file);
+ * writer.push(&record, 1);   //Any thread.
+ * writer.flush();
+ * writer.stop();
+ */
+template <class Record, std::size_t Capacity, class Owner>
+class AsyncWriter
+{
+public:
+    explicit AsyncWriter(Owner& owner_) : owner(owner_) {}
+
+    /**
+     * @brief This method writes all buffered records and stops writer thread.
+     */
+    ~AsyncWriter() { stop(); }
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    /**
+     * @brief This method starts writer thread.
+     * @param file_[in] output file (it is not closed by AsyncWriter).
+     */
+    void start(std::FILE* file_);
+
+    /**
+     * @brief This method writes all buffered records and stops writer thread (owner calls it before it closes file).
+     */
+    void stop();
+
+    /**
+     * @brief This method puts one entry of n1 + n2 records (e.g. header and data) to the ring buffer of current thread.
+     * It doesn't block and doesn't allocate memory (except the first call in a thread).
+     * Entry is never split: it is dropped as a whole if the ring buffer is full.
+     * @return false if entry was dropped.
+     */
+    bool push(const Record* p1, std::size_t n1, const Record* p2 = nullptr, std::size_t n2 = 0);
+
+    /**
+     * @brief This method blocks until all records written before this call are passed to output file.
+     */
+    void flush();
+
+private:
+    struct Ring
+    {
+        Ring() : records(Capacity) {}
+
+        SpscRing<Record> records;
+        //Number of entries that were dropped because the ring was full.
+        std::atomic<std::uint64_t> dropped{0};
+        //Thread that writes records to this ring.
+        std::thread::id owner;
+    };
+
+    //Records are moved from a ring by batches of about 64 KiB.
+    static const std::size_t batch_size = sizeof(Record) < 64 * 1024 ? 64 * 1024 / sizeof(Record) : 1;
+
+private:
+    /** Body of writer thread. */
+    void run();
+
+    /** Moves records from all ring buffers to output file. Returns true if any record was moved. */
+    bool drain();
+
+private:
+    Owner& owner;
+    std::FILE* file = nullptr;
+
+    ThreadRings<Ring> rings;
+
+    //Records popped from a ring (it is used by writer thread only).
+    std::vector<Record> batch;
+
+    //Writer thread is woken up periodically or by flush()/stop().
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopped = false;
+    unsigned long long flush_requested = 0;
+    unsigned long long flush_done = 0;
+    std::condition_variable flush_condition;
+    std::thread writer;
+};
+
+template <class Ring>
+thread_local typename ThreadRings<Ring>::Cache ThreadRings<Ring>::cache{0, nullptr};
+
+template <class Ring>
+std::atomic<unsigned long long> ThreadRings<Ring>::counter{0};
+
+template <class Ring>
+Ring& ThreadRings<Ring>::get()
+{
+    Cache& c = cache;
+    if (c.id == id)
+    {
+        return *c.ring;
+    }
+
+    std::thread::id current_thread_id = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(mutex);
+    Ring* ring = nullptr;
+
+    //Thread could use another object, look for its ring buffer.
+    for (auto& r : rings)
+    {
+        if (r->owner == current_thread_id)
+        {
+            ring = r.get();
+            break;
+        }
+    }
+
+    if (!ring)
+    {
+        rings.push_back(make_aligned<Ring>());
+        ring = rings.back().get();
+        ring->owner = current_thread_id;
+    }
+
+    c = Cache{id, ring};
+    return *ring;
+}
+
+template <class Ring>
+std::vector<Ring*> ThreadRings<Ring>::snapshot()
+{
+    //Ring buffers are never removed, so it is enough to copy pointers under the mutex.
+    std::vector<Ring*> result;
+    std::lock_guard<std::mutex> lock(mutex);
+    result.reserve(rings.size());
+    for (auto& r : rings)
+    {
+        result.push_back(r.get());
+    }
+    return result;
+}
+
+template <class Record, std::size_t Capacity, class Owner>
+bool AsyncWriter<Record, Capacity, Owner>::push(const Record* p1, std::size_t n1, const Record* p2 /*= nullptr*/, std::size_t n2 /*= 0*/)
+{
+    Ring& ring = rings.get();
+    if (ring.records.free_space() < n1 + n2)
+    {
+        //Writer thread can't keep up, drop the entry instead of blocking an event loop.
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    //Only this thread pushes to the ring, so both parts fit.
+    ring.records.push(p1, n1);
+    ring.records.push(p2, n2);
+    return true;
+}
+
+template <class Record, std::size_t Capacity, class Owner>
+void AsyncWriter<Record, Capacity, Owner>::start(std::FILE* file_)
+{
+    file = file_;
+    batch.resize(batch_size);
+    writer = std::thread([this]() { run(); });
+}
+
+template <class Record, std::size_t Capacity, class Owner>
+void AsyncWriter<Record, Capacity, Owner>::stop()
+{
+    if (!writer.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    condition.notify_one();
+    writer.join();
+}
+
+template <class Record, std::size_t Capacity, class Owner>
+void AsyncWriter<Record, Capacity, Owner>::flush()
+{
+    if (!writer.joinable())
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    unsigned long long request = ++flush_requested;
+    condition.notify_one();
+    flush_condition.wait(lock, [this, request]() { return flush_done >= request; });
+}
+
+template <class Record, std::size_t Capacity, class Owner>
+void AsyncWriter<Record, Capacity, Owner>::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        condition.wait_for(lock, std::chrono::milliseconds(10),
+            [this]() { return stopped || flush_requested != flush_done; });
+
+        bool stop = stopped;
+        unsigned long long request = flush_requested;
+
+        lock.unlock();
+        while (drain()) {}
+        lock.lock();
+
+        if (flush_done != request)
+        {
+            flush_done = request;
+            flush_condition.notify_all();
+        }
+
+        if (stop)
+        {
+            break;
+        }
+    }
+}
+
+template <class Record, std::size_t Capacity, class Owner>
+bool AsyncWriter<Record, Capacity, Owner>::drain()
+{
+    static const std::size_t output_size = 64 * 1024;
+
+    std::string output;
+    output.reserve(output_size);
+    bool moved = owner.format_pending(output);
+
+    for (Ring* ring : rings.snapshot())
+    {
+        //At most one ring of records is moved per drain(), so a busy producer doesn't hold writer on its ring.
+        std::size_t n = 0;
+        for (std::size_t total = 0; total < Capacity && (n = ring->records.pop(batch.data(), batch.size())) != 0; total += n)
+        {
+            owner.format(batch.data(), n, output);
+            moved = true;
+
+            if (output.size() >= output_size)
+            {
+                std::fwrite(output.data(), 1, output.size(), file);
+                output.clear();
+            }
+        }
+
+        std::uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped)
+        {
+            owner.format_dropped(dropped, output);
+        }
+    }
+
+    if (!output.empty())
+    {
+        std::fwrite(output.data(), 1, output.size(), file);
+    }
+    if (moved || !output.empty())
+    {
+        std::fflush(file);
+    }
+
+    return moved;
+}
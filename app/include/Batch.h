@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Evaluator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * This file contains offline batch evaluation of expressions stored in a file.
+ *
+ * Input file contains newline-separated infix expressions (the last one can be without '\n').
+ * Output file gets one line per input line in input order:
+ *   - a result of expression;
+ *   - "Division by zero", "Invalid expression" or "Overflow" if it happens (next expressions are evaluated anyway).
+ *
+ * How does it work?
+ *   - input file is memory-mapped and is split into chunks at '\n' boundaries;
+ *   - worker threads take chunks one by one and evaluate them with their own ShuntingYard objects
+ *     (or Evaluator objects of numeric type other than int32);
+ *   - current thread writes results of chunks in input order (one large write per chunk);
+ *   - a few chunks are evaluated ahead of the written one, so memory usage doesn't depend on size of file.
+ */
+
+/**
+ * Statistics of batch evaluation.
+ */
+struct BatchStats
+{
+    //Number of evaluated expressions (lines of input file).
+    unsigned long long expressions = 0;
+
+    //Number of expressions that produce processing error (division by zero/invalid expression).
+    unsigned long long errors = 0;
+
+    //Time of evaluation (including reading and writing files) in seconds.
+    double seconds = 0.0;
+
+    //Description of error if evaluation failed.
+    std::string error;
+};
+
+/**
+ * This function evaluates expressions from input file and writes results to output file.
+ * @param input_file[in] name of input file.
+ * @param output_file[in] name of output file (it is truncated).
+ * @param threads[in] number of worker threads (0 is considered as 1).
+ * @param type[in] numeric type of expressions.
+ * @param modulus[in] modulus of mod64 type.
+ * @param stats[out] statistics of evaluation.
+ * @param chunk_size[in] approximate size of input chunk in bytes.
+ * @return true if all expressions were evaluated and written.
+ */
+bool evaluate_batch(const std::string& input_file, const std::string& output_file, unsigned int threads,
+    NumericType type, std::uint64_t modulus, BatchStats& stats, std::size_t chunk_size = 4 * 1024 * 1024);
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "AsyncWriter.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * Kind of capture record.
+ */
+enum class CaptureKind : unsigned char
+{
+    open,   //connection was accepted;
+    data,   //chunk of data was received by connection (one record per receive operation);
+    close,  //connection was closed;
+    lost    //records were dropped because ring buffer of a thread was full (value is number of records).
+};
+
+/**
+ * Record of capture file (see Capture::read()).
+ */
+struct CaptureRecord
+{
+    CaptureKind kind;
+    //Time in microseconds since start of capture.
+    std::uint64_t time;
+    //Identifier of connection (it is unique in capture file).
+    std::uint64_t connection;
+    //Number of lost records (lost records only).
+    std::uint64_t value;
+    //Received chunk (data records only).
+    std::string data;
+};
+
+/**
+ * This class captures received traffic of connections to a compact binary file.
+ *
+ * This class:
+ *   - keeps one lock-free single-producer/single-consumer byte ring buffer per capturing thread (see AsyncWriter.h);
+ *   - encodes a record in capturing thread (a few varints and chunk), so writer thread copies bytes to file as is;
+ *   - writes records in a background writer thread with large buffered writes;
+ *   - drops records if a ring buffer is full and writes 'lost' record with their number.
+ *
+ * Format of file: magic "NCCAP001" and then records:
+ *   - kind (1 byte, see CaptureKind);
+ *   - time in microseconds since start of capture (LEB128 varint);
+ *   - identifier of connection (varint);
+ *   - size of chunk (data record) or number of lost records (lost record), it is 0 for other records (varint);
+ *   - bytes of chunk (data record only).
+ * Records of different threads are not ordered by time in file, reader sorts them (see read()).
+ *
+ * How to use it?
+ * Capture capture("traffic.cap");
+ * std::uint64_t connection = capture.open();
+ * capture.data(connection, buffer, bytes_transferred);
+ * capture.close(connection);
+ */
+class Capture
+{
+public:
+    /**
+     * @brief This method constructs Capture and starts writer thread (if filename is not empty).
+     * @param filename[in] name of capture file (empty string means capture is disabled).
+     */
+    explicit Capture(const std::string& filename);
+
+    /**
+     * @brief This method writes all buffered records and stops writer thread.
+     */
+    ~Capture();
+
+    Capture(const Capture&) = delete;
+    Capture& operator=(const Capture&) = delete;
+
+    /** Is capture enabled? */
+    bool is_enabled() const { return file != nullptr; }
+
+    /**
+     * @brief This method writes 'open' record of new connection.
+     * @return identifier of connection.
+     */
+    std::uint64_t open();
+
+    /**
+     * @brief This method writes received chunk of connection.
+     * It doesn't block and doesn't allocate memory (except the first call in a thread).
+     * @param connection[in] identifier of connection (see open()).
+     * @param data[in] received chunk.
+     * @param size[in] size of chunk.
+     */
+    void data(std::uint64_t connection, const char* data, std::size_t size);
+
+    /**
+     * @brief This method writes 'close' record of connection.
+     * @param connection[in] identifier of connection (see open()).
+     */
+    void close(std::uint64_t connection);
+
+    /**
+     * @brief This method blocks until all records written before this call are passed to capture file.
+     */
+    void flush();
+
+    /**
+     * @brief This method reads capture file and sorts its records by time (records of one connection keep their order).
+     * @param filename[in] name of capture file.
+     * @param records[out] records of capture.
+     * @param error[out] error message.
+     * @return false if file could not be read or it is not a capture file.
+     */
+    static bool read(const std::string& filename, std::vector<CaptureRecord>& records, std::string& error);
+
+private:
+    //Bytes of ring buffer of encoded records of each capturing thread.
+    static const std::size_t ring_capacity = 4 * 1024 * 1024;
+
+    //Writer calls formatting methods.
+    friend class AsyncWriter<char, ring_capacity, Capture>;
+
+private:
+    /** Encodes record and puts it to the ring buffer of current thread. */
+    void write(CaptureKind kind, std::uint64_t connection, const char* data, std::size_t size);
+
+    /** Encoded records are the format of file, they are appended to output as is. */
+    void format(const char* bytes, std::size_t n, std::string& output);
+
+    /** Appends 'lost' record to output. */
+    void format_dropped(std::uint64_t dropped, std::string& output);
+
+    /** Capture has no records besides ring buffers, it returns false. */
+    bool format_pending(std::string& output);
+
+    /** Time in microseconds since start of capture. */
+    std::uint64_t now() const;
+
+private:
+    //Start of capture.
+    const std::chrono::steady_clock::time_point start;
+
+    //Source of identifiers of connections.
+    std::atomic<std::uint64_t> connections{0};
+
+    //Capture file (it is null if capture is disabled).
+    std::FILE* file;
+
+    //Ring buffers of capturing threads and writer thread.
+    AsyncWriter<char, ring_capacity, Capture> writer;
+};
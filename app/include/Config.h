@@ -1,5 +1,9 @@
 #pragma once
 
+#include "Evaluator.h"
+#include "Logger.h"
+
+#include <cstdint>
 #include <string>
 #include <boost/optional.hpp>
 
@@ -16,6 +20,127 @@ struct Config
 
     //Number of threads (can't exceed 'clients' field).
     unsigned int threads;
+
+    //Maximum level of log records.
+    LogLevel log_level = LogLevel::error;
+
+    //Each log_sample connection writes connection-level records (errors are always written).
+    unsigned int log_sample = 1;
+
+    //Log file (empty string means stderr).
+    std::string log_file;
+
+    //Each trace_sample connection is traced (0 means tracing is disabled).
+    unsigned int trace_sample = 0;
+
+    //File for Chrome trace_event JSON.
+    std::string trace_file = "NetCalculatorTrace.json";
+
+    //CPUs of event loop threads: "none" (threads are not pinned), "auto" or CPU list (e.g. "0-3,8").
+    std::string cpus = "none";
+
+    //Event loop threads spin up to busy_poll microseconds before blocking (0 means they block at once).
+    unsigned int busy_poll = 0;
+
+    //Value of SO_BUSY_POLL socket option in microseconds for accepted connections (0 means it is not set).
+    unsigned int so_busy_poll = 0;
+
+    //Number of threads that parse expressions of heavy connections (0 means heavy connections are not isolated).
+    unsigned int bulk_threads = 0;
+
+    //Connection becomes heavy if its current expression is longer than heavy_bytes (0 means size is not checked).
+    unsigned long long heavy_bytes = 64 * 1024;
+
+    //Connection becomes heavy if one parse call takes more than heavy_parse_time microseconds (0 means time is not checked).
+    unsigned int heavy_parse_time = 1000;
+
+    //Heavy connection parses at most bulk_budget bytes per turn of bulk thread (0 means whole received data).
+    unsigned int bulk_budget = 4096;
+
+    //Connection evaluates at most turn_expressions expressions per turn, then it yields thread (0 means no limit).
+    unsigned int turn_expressions = 16;
+
+    //Connection parses at most turn_bytes bytes per turn, then it yields thread (0 means no limit).
+    unsigned int turn_bytes = 4096;
+
+    //Path of Unix domain stream socket to listen (empty string means it is not used).
+    //TCP port is optional if it is set (port 0 means TCP is not used).
+    std::string unix_socket;
+
+    //Name of shared-memory segment for same-host clients (empty string means shared-memory transport is not used).
+    std::string shm_name;
+
+    //Number of shared-memory sessions (simultaneous shared-memory clients).
+    unsigned int shm_sessions = 4;
+
+    //Size of each shared-memory ring in bytes (power of two).
+    unsigned int shm_ring_size = 64 * 1024;
+
+    //Connection that waits for a new expression (or for reading of results by client) longer than idle_timeout milliseconds
+    //is closed (0 means no timeout).
+    unsigned int idle_timeout = 0;
+
+    //Expression must be received within expression_timeout milliseconds after its first byte (0 means no timeout).
+    unsigned int expression_timeout = 0;
+
+    //Incomplete expression must be received at least with min_receive_rate bytes per second after the first second
+    //(0 means rate is not checked).
+    unsigned int min_receive_rate = 0;
+
+    //Connection evaluates at most rate_expressions expressions per second, then it waits (0 means no limit).
+    unsigned int rate_expressions = 0;
+
+    //Connection receives at most rate_bytes bytes per second, then it waits (0 means no limit).
+    unsigned int rate_bytes = 0;
+
+    //New expressions get "Server busy" reply while event loop lag exceeds shed_lag microseconds (0 means no load shedding).
+    unsigned int shed_lag = 0;
+
+    //Number of threads that evaluate complete lines of one receive in parallel (0 means lines are evaluated sequentially).
+    unsigned int parallel_threads = 0;
+
+    //Complete lines of one receive are split into chunks of at least parallel_chunk bytes (one chunk is evaluated sequentially).
+    unsigned int parallel_chunk = 1024;
+
+    //Number of pipelines where bulk thread tokenizes expression of heavy connection and own thread of pipeline evaluates it
+    //(0 means heavy connections are parsed by bulk threads only).
+    unsigned int pipelines = 0;
+
+    //Numeric type of expressions of connections and shared-memory sessions (sessions don't support bigint).
+    NumericType type = NumericType::int32;
+
+    //Modulus of expressions of mod64 type (the greatest 64-bit prime by default).
+    std::uint64_t modulus = 18446744073709551557ull;
+
+    //Expressions that take at least slow_expression microseconds of wall time are logged with level info
+    //(0 means slow expressions are not measured).
+    unsigned int slow_expression = 0;
+
+    //At most slow_log_rate records of slow expressions are written per second.
+    unsigned int slow_log_rate = 10;
+
+    //File where received chunks of TCP and Unix domain socket connections are captured (empty string means no capture),
+    //see Capture and NetCalculatorAppReplay.
+    std::string capture_file;
+
+    //Maximum number of resumable sessions of connections ('#session' and '#resume' commands), 0 means sessions are disabled.
+    unsigned int sessions = 0;
+
+    //Session that has no connection longer than session_timeout milliseconds is dropped.
+    unsigned int session_timeout = 60000;
+
+    //Unix domain socket of hot restart: a new process takes over listening sockets and idle connections of the process
+    //that listens on it (empty string means hot restart is disabled).
+    std::string handoff_socket;
+
+    //Process that has handed over its listening sockets exits after drain_timeout milliseconds at most.
+    unsigned int drain_timeout = 30000;
+
+    //Input file of batch mode (empty string means server mode).
+    std::string batch_input;
+
+    //Output file of batch mode.
+    std::string batch_output;
 };
 
 /**
@@ -34,9 +159,61 @@ struct Config
  * -p or --port means 'Listen port' (mandatory parameter);
  * -c or --clients means 'Listen address' (mandatory parameter);
  * -t or --threads means 'Number of threads' (optional parameter);
+ * --log-level means 'Log level: none, error, info or debug' (optional parameter);
+ * --log-sample means 'Log each N-th connection' (optional parameter);
+ * --log-file means 'Log file' (optional parameter);
+ * --trace-sample means 'Trace each N-th connection' (optional parameter);
+ * --trace-file means 'File for Chrome trace' (optional parameter);
+ * --cpus means 'CPUs of event loop threads' (optional parameter);
+ * --busy-poll means 'Spin budget of event loop threads in microseconds' (optional parameter);
+ * --so-busy-poll means 'SO_BUSY_POLL value in microseconds' (optional parameter);
+ * --bulk-threads means 'Number of threads that parse expressions of heavy connections' (optional parameter);
+ * --heavy-bytes means 'Size of expression that makes connection heavy' (optional parameter);
+ * --heavy-parse-time means 'Parse time in microseconds that makes connection heavy' (optional parameter);
+ * --bulk-budget means 'Bytes parsed per turn of bulk thread' (optional parameter);
+ * --turn-expressions means 'Expressions evaluated per turn of connection' (optional parameter);
+ * --turn-bytes means 'Bytes parsed per turn of connection' (optional parameter);
+ * --unix-socket means 'Path of Unix domain socket to listen' (optional parameter, port is optional with it);
+ * --shm-name means 'Name of shared-memory segment' (optional parameter);
+ * --shm-sessions means 'Number of shared-memory sessions' (optional parameter);
+ * --shm-ring-size means 'Size of shared-memory ring' (optional parameter);
+ * --idle-timeout means 'Idle timeout of connection in milliseconds' (optional parameter);
+ * --expression-timeout means 'Time limit of one expression in milliseconds' (optional parameter);
+ * --min-receive-rate means 'Minimal receive rate of incomplete expression in bytes per second' (optional parameter);
+ * --rate-expressions means 'Expressions per second of one connection' (optional parameter);
+ * --rate-bytes means 'Bytes per second of one connection' (optional parameter);
+ * --shed-lag means 'Event loop lag in microseconds that starts load shedding' (optional parameter);
+ * --parallel-threads means 'Number of threads that evaluate pipelined expressions of one connection' (optional parameter);
+ * --parallel-chunk means 'Minimal size of chunk of parallel evaluation' (optional parameter);
+ * --pipelines means 'Number of tokenize/evaluate pipelines of heavy connections' (optional parameter);
+ * --type means 'Numeric type of expressions: int32, int64, checked_int64, bigint, float64 or mod64' (optional parameter);
+ * --modulus means 'Modulus of expressions of mod64 type' (optional parameter);
+ * --slow-expression means 'Wall time of expression in microseconds that makes it logged' (optional parameter);
+ * --slow-log-rate means 'Records of slow expressions per second' (optional parameter);
+ * --capture-file means 'File for captured traffic' (optional parameter);
+ * --sessions means 'Maximum number of resumable sessions' (optional parameter);
+ * --session-timeout means 'Lifetime of session without connection in milliseconds' (optional parameter);
+ * --handoff-socket means 'Unix domain socket of hot restart' (optional parameter);
+ * --drain-timeout means 'Time limit of draining of connections after hot restart in milliseconds' (optional parameter);
+ * --batch <input> <output> means 'Evaluate input file to output file instead of serving connections' (optional parameter,
+ *   port and clients are not needed in this mode, threads means number of worker threads);
  *
  * Default value for address is '127.0.0.1'.
  * Default value for threads is std::thread::hardware_concurrency() or 1 (if value is not computable).
+ * Default value for log-level is 'error', for log-sample is 1, for log-file is '' (stderr).
+ * Default value for trace-sample is 0 (tracing is disabled), for trace-file is 'NetCalculatorTrace.json'.
+ * Default value for cpus is 'none'.
+ * Default value for busy-poll and so-busy-poll is 0 (disabled).
+ * Default value for bulk-threads is 0 (disabled), for heavy-bytes is 65536, for heavy-parse-time is 1000, for bulk-budget is 4096.
+ * Default value for turn-expressions is 16, for turn-bytes is 4096.
+ * Default value for shm-name is '' (disabled), for shm-sessions is 4, for shm-ring-size is 65536.
+ * Default value for idle-timeout, expression-timeout, min-receive-rate, rate-expressions, rate-bytes and shed-lag is 0 (disabled).
+ * Default value for parallel-threads is 0 (disabled), for parallel-chunk is 1024, for pipelines is 0 (disabled).
+ * Default value for type is 'int32', for modulus is 18446744073709551557.
+ * Default value for slow-expression is 0 (disabled), for slow-log-rate is 10.
+ * Default value for capture-file is '' (disabled).
+ * Default value for sessions is 0 (disabled), for session-timeout is 60000.
+ * Default value for handoff-socket is '' (disabled), for drain-timeout is 30000.
  *
  * @param argc[in] argc argument from main;
  * @param argv[in] argv argument from mian;
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <BigInt.h>
+#include <DecimalFloat.h>
+#include <ModInt.h>
+#include <ShuntingYard.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+/**
+ * Numeric type of expressions of server (or of connection, see '#type' command of NetCalcCore).
+ */
+enum class NumericType : unsigned int
+{
+    int32,          //int, overflow is reported as "Overflow";
+    int64,          //long long, overflowed result is replaced by the nearest limit (ShuntingYardSaturating);
+    checked_int64,  //long long, overflow is reported as "Overflow";
+    bigint,         //arbitrary-precision integer (see BigInt), it never overflows;
+    float64,        //double, numbers can have decimal point and exponent, infinite result is reported as "Overflow";
+    mod64           //integer modulo 64-bit modulus (see ModInt), division by number without inverse is "Division by zero".
+};
+
+/** Reads NumericType from its name (int32, int64, checked_int64, bigint, float64, mod64). It is used by boost::program_options. */
+std::istream& operator>>(std::istream& s, NumericType& type);
+
+/** Writes name of NumericType. */
+std::ostream& operator<<(std::ostream& s, NumericType type);
+
+/**
+ * Appends decimal representation of number to response.
+ */
+inline void append_number(std::string& response, int value)
+{
+    response += std::to_string(value);
+}
+
+inline void append_number(std::string& response, long long value)
+{
+    response += std::to_string(value);
+}
+
+inline void append_number(std::string& response, const BigInt& value)
+{
+    value.append_decimal(response);
+}
+
+inline void append_number(std::string& response, double value)
+{
+    DecimalFloat::append(response, value);
+}
+
+inline void append_number(std::string& response, const ModInt& value)
+{
+    value.append_decimal(response);
+}
+
+/**
+ * Status of evaluation of received data.
+ */
+enum class EvaluationStatus
+{
+    Success,      //expression was evaluated, its result was appended to response;
+    Incomplete,   //end of expression was not met;
+    Error         //error message was appended to response.
+};
+
+/**
+ * @brief Appends line with result of ShuntingYard (or its error) to response.
+ * @param r[in] result of ShuntingYard::parse() (or ShuntingYardPipeline::parse()).
+ * @param response[in,out] response of connection.
+ */
+template <class Result>
+EvaluationStatus append_result(const Result& r, std::string& response)
+{
+    using ParseResult = decltype(r.first);
+
+    switch (r.first)
+    {
+        case ParseResult::Success:
+            append_number(response, r.second);
+            response += '\n';
+            return EvaluationStatus::Success;
+        case ParseResult::Incomplete:
+            return EvaluationStatus::Incomplete;
+        case ParseResult::DivisionByZero:
+            response += "Division by zero\n";
+            break;
+        case ParseResult::Overflow:
+            response += "Overflow\n";
+            break;
+        case ParseResult::InvalidExpression:
+            response += "Invalid expression\n";
+            break;
+    }
+
+    return EvaluationStatus::Error;
+}
+
+/**
+ * This class evaluates expressions of one connection with ShuntingYard of some numeric type.
+ *
+ * Each numeric type has its own compiled ShuntingYard (see ShuntingYardEvaluator), the only virtual call is
+ * parse() per received part of data, so tokens are evaluated without virtual calls.
+ *
+ * How to use it?
+ * std::unique_ptr<Evaluator> evaluator = make_evaluator(NumericType::bigint);
+ * std::string response;
+ * evaluator->parse("99999999999 * 99999999999\n", 26, response);   //response is "9999999999800000000001\n".
+ */
+class Evaluator
+{
+public:
+    virtual ~Evaluator() = default;
+
+    /**
+     * @brief Parses partial expression (see ShuntingYard::parse()) and appends its result to response.
+     * @param s[in] partial expression.
+     * @param len[in] length of partial expression.
+     * @param response[in,out] response of connection.
+     */
+    virtual EvaluationStatus parse(const char* s, std::size_t len, std::string& response) = 0;
+
+    /** Clear evaluator to further processing. */
+    virtual void clear() = 0;
+
+    /** Statistics of the last finished expression (see ShuntingYardLexer). */
+    virtual ShuntingYardStatistics statistics() const = 0;
+};
+
+template <class Parser>
+class ShuntingYardEvaluator : public Evaluator
+{
+public:
+    EvaluationStatus parse(const char* s, std::size_t len, std::string& response) override
+    {
+        return append_result(parser.parse(s, len), response);
+    }
+
+    void clear() override
+    {
+        parser.clear();
+    }
+
+    ShuntingYardStatistics statistics() const override
+    {
+        return parser.statistics();
+    }
+
+private:
+    Parser parser;
+};
+
+/**
+ * @brief Makes evaluator of numeric type.
+ * @param type[in] numeric type of expressions.
+ * @param modulus[in] modulus of mod64 type (>= 2), it is ignored by other types.
+ */
+std::unique_ptr<Evaluator> make_evaluator(NumericType type, std::uint64_t modulus = 0);
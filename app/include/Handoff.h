@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Kind of descriptor that is handed over by hot restart.
+ */
+enum class HandoffKind : char
+{
+    tcp_listener = 'T',     //listening TCP socket;
+    unix_listener = 'U',    //listening Unix domain socket;
+    tcp_client = 'C',       //idle TCP connection (it waits for a new expression);
+    unix_client = 'L',      //idle Unix domain socket connection;
+    end = 'E'               //old process has finished draining, it has no descriptor.
+};
+
+/**
+ * Descriptor and its kind.
+ */
+struct HandoffDescriptor
+{
+    HandoffKind kind;
+    //File descriptor (it is -1 for 'end').
+    int fd;
+};
+
+/**
+ * Functions of this file implement the channel of hot restart: a new process connects to a Unix domain socket
+ * of the running process and receives its descriptors with SCM_RIGHTS (see NetCalcCore).
+ *
+ * The channel is a SOCK_SEQPACKET socket, so each message keeps its boundaries: kinds of descriptors (1 byte per
+ * descriptor) are data of message, their descriptors are its ancillary data in the same order.
+ * Received descriptors are new descriptors of the same sockets, so both processes can use them until one of them
+ * closes its own descriptor.
+ *
+ * How to use it?
+ * Old process:                                     New process:
+ * int listener = handoff_listen(path);             int peer = handoff_connect(path);
+ * int peer = ::accept(listener, nullptr, nullptr); handoff_receive(peer, descriptors, 5000);
+ * handoff_send(peer, {{HandoffKind::tcp_listener, fd}});
+ */
+
+//Maximum number of descriptors of one message.
+const std::size_t handoff_max_descriptors = 64;
+
+/**
+ * @brief Binds and listens on Unix domain socket of hot restart (socket file of previous run is removed).
+ * @param path[in] path of socket.
+ * @return listening socket or -1 (errno is set).
+ */
+int handoff_listen(const std::string& path);
+
+/**
+ * @brief Connects to Unix domain socket of hot restart.
+ * @param path[in] path of socket.
+ * @return connected socket or -1 if no process listens on path.
+ */
+int handoff_connect(const std::string& path);
+
+/**
+ * @brief Checks that peer of connected socket runs as the same user as current process.
+ * @param socket[in] connected socket.
+ * @return false if peer runs as another user.
+ */
+bool handoff_trusted(int socket);
+
+/**
+ * @brief Sends descriptors by one message (the caller keeps its descriptors open).
+ * @param socket[in] connected socket.
+ * @param descriptors[in] at most handoff_max_descriptors descriptors.
+ * @return false if message is not sent.
+ */
+bool handoff_send(int socket, const std::vector<HandoffDescriptor>& descriptors);
+
+/**
+ * @brief Receives one message.
+ * @param socket[in] connected socket.
+ * @param descriptors[out] received descriptors (the caller owns them).
+ * @param timeout[in] time limit in milliseconds (-1 means no limit).
+ * @return false on error, timeout or end of connection.
+ */
+bool handoff_receive(int socket, std::vector<HandoffDescriptor>& descriptors, int timeout);
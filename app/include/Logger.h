@@ -0,0 +1,157 @@
+#pragma once
+
+#include "AsyncWriter.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Severity of a log record.
+ * A record is written if its level is less than or equal to the level of Logger.
+ */
+enum class LogLevel : unsigned int
+{
+    none,
+    error,
+    info,
+    debug
+};
+
+/** Reads LogLevel from its name (none, error, info, debug). It is used by boost::program_options. */
+std::istream& operator>>(std::istream& s, LogLevel& level);
+
+/** Writes name of LogLevel. */
+std::ostream& operator<<(std::ostream& s, LogLevel level);
+
+/**
+ * This class implements asynchronous logging.
+ *
+ * This class:
+ *   - keeps one lock-free single-producer/single-consumer ring buffer per producing thread (see AsyncWriter.h);
+ *   - doesn't format records in producing threads (a record keeps pointer to a format literal and two arguments);
+ *   - formats and writes records in a background writer thread with large buffered writes;
+ *   - drops records if a ring buffer is full and reports number of dropped records;
+ *   - accepts rare preformatted records (write_text()) through a queue guarded by mutex;
+ *   - supports sampling of connection-level records (only each 'sample_rate' connection is logged).
+ *
+ * How to use it?
+ * Logger logger(LogLevel::info, 1, "");
+ * if (logger.is_enabled(LogLevel::info))
+ * {
+ *     logger.write(LogLevel::info, "Client: %u, received: %lld bytes", client_index, bytes_transferred);
+ * }
+ *
+ * Format literal must have static storage duration.
+ * Format literal may use the first argument (%u) and then the second argument (%lld).
+ */
+class Logger
+{
+public:
+    /**
+     * @brief This method constructs Logger and starts writer thread (if level is not LogLevel::none).
+     * @param level_[in] maximum level of written records.
+     * @param sample_rate_[in] each sample_rate_ connection is logged (0 and 1 mean each connection).
+     * @param filename[in] name of output file (empty string means stderr).
+     */
+    Logger(LogLevel level_, unsigned int sample_rate_, const std::string& filename);
+
+    /**
+     * @brief This method writes all buffered records and stops writer thread.
+     */
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /** Is record of this level written? It is cheap, so call it before collecting arguments of record. */
+    bool is_enabled(LogLevel record_level) const { return record_level <= level; }
+
+    /** Should next connection be logged? */
+    bool sample() { return sample_rate <= 1 || sample_counter.fetch_add(1, std::memory_order_relaxed) % sample_rate == 0; }
+
+    /**
+     * @brief This method puts a record to the ring buffer of current thread.
+     * It doesn't block and doesn't allocate memory (except the first call in a thread).
+     * @param record_level[in] level of record.
+     * @param format[in] printf-like format literal.
+     * @param client_index[in] the first argument of format.
+     * @param value[in] the second argument of format.
+     */
+    void write(LogLevel record_level, const char* format, unsigned int client_index, long long value = 0);
+
+    /**
+     * @brief This method puts a preformatted record to the text queue.
+     * It locks a mutex and copies text, so it is for rare records only (e.g. rate-limited records of slow expressions).
+     * @param record_level[in] level of record.
+     * @param text[in] text of record without '\n'.
+     */
+    void write_text(LogLevel record_level, const std::string& text);
+
+    /**
+     * @brief This method blocks until all records written before this call are passed to output file.
+     */
+    void flush();
+
+private:
+    struct Record
+    {
+        std::chrono::system_clock::time_point time;
+        LogLevel level;
+        const char* format;
+        unsigned int client_index;
+        long long value;
+    };
+
+    struct TextRecord
+    {
+        std::chrono::system_clock::time_point time;
+        LogLevel level;
+        std::string text;
+    };
+
+    //Records of ring buffer of each producing thread.
+    static const std::size_t ring_capacity = 4096;
+
+    //Writer calls formatting methods.
+    friend class AsyncWriter<Record, ring_capacity, Logger>;
+
+private:
+    /** Formats records of a ring buffer and appends them to output. */
+    void format(const Record* records, std::size_t n, std::string& output);
+
+    /** Appends a record about dropped records of a ring buffer to output. */
+    void format_dropped(std::uint64_t dropped, std::string& output);
+
+    /** Appends preformatted records to output. Returns true if there were any records. */
+    bool format_pending(std::string& output);
+
+    /** Formats a record and appends it to output. */
+    static void format_record(const Record& record, std::string& output);
+
+    /** Appends time and level of a record to output. */
+    static void format_header(std::chrono::system_clock::time_point time, LogLevel level, std::string& output);
+
+private:
+    const LogLevel level;
+    const unsigned int sample_rate;
+    std::atomic<unsigned long long> sample_counter{0};
+
+    //Output file.
+    std::FILE* file;
+    bool own_file;
+
+    //Preformatted records (they are guarded by text_mutex), records are dropped above text_capacity.
+    static const std::size_t text_capacity = 1024;
+    std::mutex text_mutex;
+    std::vector<TextRecord> texts;
+    std::size_t texts_dropped;
+
+    //Ring buffers of producing threads and writer thread.
+    AsyncWriter<Record, ring_capacity, Logger> writer;
+};
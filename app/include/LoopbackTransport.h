@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Transport.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * This class implements in-process transport of NetCalcCore (see Transport): connections are pairs of memory queues,
+ * so NetCalcCore can be driven by real traffic without sockets and kernel (e.g. by a benchmark harness or a test).
+ *
+ * This class:
+ *   - pairs a new connection (see connect()) with a client slot that waits in accept, or queues it until a slot is free;
+ *   - copies data written by peer into receive buffer of connection (one receive gets all written data that fits buffer);
+ *   - passes sent data to handler of peer at once in event loop thread of connection (it must not block),
+ *     so a closed-loop client can write its next request from the handler;
+ *   - calls handler of peer with empty data when server closes connection;
+ *   - locks a mutex of connection per operation, a common mutex is locked on accept and close only.
+ *
+ * Transport must outlive NetCalcCore, and peers must not write after NetCalcCore is stopped.
+ *
+ * How to use it?
+ * LoopbackTransport transport(config.clients);
+ * NetCalcCore core(config, &transport);
+ * core.start();
+ * auto connection = transport.connect([](LoopbackTransport::Connection& c, const char* data, std::size_t size) {...});
+ * connection->write("1 + 2\n", 6);   //Handler gets "3\n".
+ * connection->shutdown();            //Server gets end of data.
+ */
+class LoopbackTransport : public Transport
+{
+public:
+    class Connection;
+
+    //Handler of data sent by server to connection (empty data means server closed connection).
+    using ResponseHandler = std::function<void(Connection& connection, const char* data, std::size_t size)>;
+
+    /**
+     * Peer side of in-process connection.
+     */
+    class Connection
+    {
+    public:
+        /**
+         * @brief Passes data to server (it can be called from any thread).
+         * @param data[in] data to send.
+         * @param size[in] size of data.
+         * @return false if server has closed connection.
+         */
+        bool write(const char* data, std::size_t size);
+
+        /**
+         * @brief Ends data of connection: server receives end of file after written data.
+         */
+        void shutdown();
+
+        /** Has server closed connection? */
+        bool is_closed() const;
+
+    private:
+        friend class LoopbackTransport;
+
+        /** Completes pending receive with available data or end of file. It must be called under mutex. */
+        void complete_receive();
+
+    private:
+        mutable std::mutex mutex;
+
+        //Handler of data sent by server.
+        ResponseHandler handler;
+
+        //Written data that is not received by server yet: input[input_begin...].
+        std::string input;
+        std::size_t input_begin = 0;
+
+        //Peer ended its data.
+        bool eof = false;
+
+        //Connection is shut down (see Transport::shutdown()).
+        bool aborted = false;
+
+        //Server closed connection.
+        bool closed = false;
+
+        //Pending receive operation of server.
+        bool receiving = false;
+        char* buffer = nullptr;
+        std::size_t size = 0;
+        boost::asio::io_service* service = nullptr;
+        Handler receive_handler;
+    };
+
+    /**
+     * @brief This method constructs transport for NetCalcCore.
+     * @param clients[in] number of client slots of NetCalcCore (see Config::clients).
+     */
+    explicit LoopbackTransport(unsigned int clients);
+
+    LoopbackTransport(const LoopbackTransport&) = delete;
+    LoopbackTransport& operator=(const LoopbackTransport&) = delete;
+
+    /**
+     * @brief Opens a new connection to NetCalcCore (it can be called from any thread).
+     * @param handler[in] handler of data sent by server.
+     * @return peer side of connection.
+     */
+    std::shared_ptr<Connection> connect(ResponseHandler handler);
+
+    void async_accept(unsigned int client_index, boost::asio::io_service& service, Handler handler) override;
+
+    void async_receive(unsigned int client_index, char* buffer, std::size_t size, boost::asio::io_service& service, Handler handler) override;
+
+    void async_send(unsigned int client_index, const char* data, std::size_t size, boost::asio::io_service& service, Handler handler) override;
+
+    void shutdown(unsigned int client_index) override;
+
+    void close(unsigned int client_index) override;
+
+private:
+    /**
+     * Client slot that waits for a new connection.
+     */
+    struct pending_accept
+    {
+        unsigned int client_index;
+        boost::asio::io_service* service;
+        Handler handler;
+    };
+
+private:
+    //Guards slots, accepts and backlog.
+    std::mutex mutex;
+
+    //Connection of each client slot (it is null if slot waits in accept).
+    //Event loop reads slot of its connection without mutex: slot is set before accept handler is posted.
+    std::vector<std::shared_ptr<Connection>> slots;
+
+    //Client slots that wait for connections.
+    std::deque<pending_accept> accepts;
+
+    //Connections that wait for free client slots.
+    std::deque<std::shared_ptr<Connection>> backlog;
+};
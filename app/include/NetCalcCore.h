@@ -1,29 +1,125 @@
 #pragma once
 
+#include "Capture.h"
 #include "Config.h"
+#include "Evaluator.h"
+#include "Handoff.h"
+#include "Logger.h"
+#include "ShmServer.h"
+#include "TimerWheel.h"
+#include "Tracer.h"
+#include "Transport.h"
+#include <AlignedPtr.h>
 #include <ShuntingYard.h>
+#include <ShuntingYardPipeline.h>
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <boost/asio.hpp>
 
+/**
+ * Counters of NetCalcCore (they are cumulative since start).
+ */
+struct NetCalcStats
+{
+    //Number of connections closed by idle timeout.
+    unsigned long long idle_timeouts;
+
+    //Number of connections closed because expression was not completed in time.
+    unsigned long long expression_timeouts;
+
+    //Number of connections closed because expression was received too slowly.
+    unsigned long long slow_receives;
+
+    //Number of pauses of connections that exceeded their rate limits.
+    unsigned long long throttles;
+
+    //Number of expressions rejected with "Server busy" reply.
+    unsigned long long shed_expressions;
+
+    //Number of expressions that took at least cfg.slow_expression microseconds (logged or not because of rate limit).
+    unsigned long long slow_expressions;
+
+    //Number of sessions that were resumed by '#resume' command.
+    unsigned long long resumed_sessions;
+
+    //Number of idle connections that were handed over to a new process by hot restart.
+    unsigned long long handed_over_connections;
+
+    //Number of idle connections that were taken over from the old process by hot restart.
+    unsigned long long adopted_connections;
+
+    //Current event loop lag in microseconds (maximum of io_service objects).
+    unsigned long long event_loop_lag;
+};
+
 /**
  * This class implements net part (server part) of NetCalculator.
  *
  *  This class:
  *   - supports TCP/IPv4-connections;
+ *   - can listen on Unix domain stream socket in addition to or instead of TCP (depend on cfg_.unix_socket parameter),
+ *     client slots are assigned to listeners in turn;
  *   - calculates arithmetic expressions that receives from socket, calculates result and sends it back;
  *   - considers '\n' as end of expression;
  *   - can receive unified expression during several receive operations;
  *   - doesn't close connection after sending correct result;
  *   - sends string "Division by zero\n" if it happens and closes a connection;
  *   - sends string "Invalid expression\n" if it happens and closes a connection;
+ *   - sends string "Overflow\n" if result of an operation doesn't fit int and closes a connection;
+ *   - can evaluate expressions of TCP and Unix domain socket connections with arbitrary-precision integers, doubles
+ *     or integers modulo cfg_.modulus (depend on cfg_.type parameter, see Evaluator), pipelines and parallel threads are used for int32 only;
+ *   - lets a connection select its numeric type by line '#type <name> [<modulus>]' between expressions (it replies "OK\n"
+ *     or "Invalid command\n" and closes connection), so each connection has its own compiled ShuntingYard;
  *   - can process several simultaneous connections (depend on cfg_.clients parameter);
  *   - can start several threads (depend on cfg_.threads parameter and 'block' arguments of 'start' method);
+ *   - can pin threads to CPUs and keep clients of each NUMA node in its own event loop (depend on cfg_.cpus parameter);
+ *   - can spin in event loops before blocking to cut wake-up latency (depend on cfg_.busy_poll and cfg_.so_busy_poll parameters);
+ *   - moves parsing of heavy connections (huge expressions or slow parsing) to a separate pool of bulk threads
+ *     with per-turn budget, so they don't delay short expressions (depend on cfg_.bulk_* and cfg_.heavy_* parameters);
+ *   - keeps resumable sessions: connection that started a session by line '#session' (reply "OK <token>\n") leaves
+ *     the state of its parser in session table when it is closed, a new connection continues it by '#resume <token>'
+ *     (reply "OK <offset> <results>\n"), so a dropped huge expression is resent from offset, not from its beginning
+ *     (depend on cfg_.sessions and cfg_.session_timeout parameters);
+ *   - supports hot restart: a new process connects to cfg_.handoff_socket of the running one and receives its listening
+ *     sockets and idle connections by SCM_RIGHTS (see Handoff.h), the old process stops accepting, hands over each
+ *     connection when it is between expressions and exits when all connections are gone or after cfg_.drain_timeout
+ *     (see set_handoff_handler()), so a restart doesn't drop connections;
+ *   - can split parsing of heavy expression between bulk thread (tokenizer) and own thread of a pipeline (evaluator),
+ *     so tokenizing of received data overlaps evaluation (depend on cfg_.pipelines parameter, see ShuntingYardPipeline);
+ *   - can start accept, receive and send operations through another transport instead of sockets (e.g. in-process
+ *     LoopbackTransport), so the same handle_receive -> parse_result -> handle_send path is driven without kernel
+ *     (depend on transport_ argument of constructor);
+ *   - can serve same-host clients through shared-memory ring pairs in a separate worker thread
+ *     (depend on cfg_.shm_* parameters, see ShmServer);
+ *   - evaluates pipelined expressions in batches: a connection parses at most cfg_.turn_expressions expressions
+ *     (cfg_.turn_bytes bytes) per turn, sends their results by one write and then yields thread to other connections;
+ *   - can split complete lines of one receive into chunks, evaluate them in parallel by a pool of threads and send
+ *     their results in request order, so one pipelining client uses several cores (depend on cfg_.parallel_* parameters);
+ *   - closes idle connections, connections that don't complete expression in time and connections that send
+ *     expression too slowly, so their slots are reused (depend on cfg_.idle_timeout, cfg_.expression_timeout and
+ *     cfg_.min_receive_rate parameters); deadlines are kept in one timer wheel, see get_stats();
+ *   - limits rate of each connection by token buckets of expressions and bytes: connection that exceeds its limit
+ *     stops parsing and receiving until tokens are refilled (depend on cfg_.rate_expressions and cfg_.rate_bytes parameters);
+ *   - measures lag of event loops and replies "Server busy\n" to new expressions while lag is too high, so queues
+ *     don't grow under overload (depend on cfg_.shed_lag parameter);
  *   - implements event-driven approach (asynchronous model);
+ *   - writes log records asynchronously (depend on cfg_.log_level and cfg_.log_sample parameters);
+ *   - records spans (accept, receive, parse, send) of sampled connections (depend on cfg_.trace_sample parameter);
+ *   - can capture received chunks of connections with timestamps to a binary file by a background writer, so traffic
+ *     can be replayed with the same chunks by NetCalculatorAppReplay (depend on cfg_.capture_file parameter, see Capture);
+ *   - measures wall time and thread CPU time of expressions that are long or split between parse calls and logs slow ones
+ *     with their size, tokens, depth of brackets and prefix (depend on cfg_.slow_expression and cfg_.slow_log_rate parameters);
  *   - uses boost::asio.
  *
  * How to use it?
@@ -44,8 +140,10 @@ public:
     /**
      * @brief This method constructs NetCalcCore object but doesn't start it.
      * @param cfg_[in] server configuration.
+     * @param transport_[in] transport of connections (nullptr means TCP and Unix domain socket listeners of cfg_ are used).
+     * Transport must outlive NetCalcCore, listeners are not opened if it is passed.
      */
-    NetCalcCore(const Config& cfg_);
+    NetCalcCore(const Config& cfg_, Transport* transport_ = nullptr);
 
     /**
      * @brief This method joins started threads and closes open sockets.
@@ -65,8 +163,31 @@ public:
      */
     void stop();
 
+    /**
+     * @brief This method writes recorded spans to cfg.trace_file as Chrome trace_event JSON.
+     * It can be called from any thread while NetCalcCore works.
+     * @return true if tracing is enabled and file was written.
+     */
+    bool dump_trace();
+
+    /**
+     * @brief Returns counters of reclaimed connections.
+     * It can be called from any thread while NetCalcCore works.
+     */
+    NetCalcStats get_stats() const;
+
+    /**
+     * @brief Sets handler that is called when this process has handed over its listeners and has drained connections
+     * (see cfg.handoff_socket), the process is expected to stop NetCalcCore and exit.
+     * It must be called before start(), handler is called from the handoff thread.
+     * @param handler[in] handler of the end of draining.
+     */
+    void set_handoff_handler(std::function<void()> handler);
+
 private:
-    using ShuntingYardInt = ShuntingYard<int>;
+    //Overflow of int is reported to client instead of wrong result.
+    using ShuntingYardInt = ShuntingYard<int, ShuntingYardSyntax, ShuntingYardChecked>;
+    using ShuntingYardPipelineInt = ShuntingYardPipeline<int, ShuntingYardSyntax, ShuntingYardChecked>;
 
     /**
      * @brief This enum is used in unit-test mode to represent last async operation.
@@ -76,7 +197,116 @@ private:
         none,
         async_accept,
         async_receive,
-        async_send
+        async_send,
+        bulk_parse,
+        throttle,
+        parallel_parse
+    };
+
+    /**
+     * @brief This enum represents the deadline that is checked by timer wheel for waiting connection.
+     */
+    enum class timeout_reason : unsigned char
+    {
+        none,
+        idle,
+        expression,
+        slow_receive
+    };
+
+    /**
+     * @brief This enum represents timeout state of connection.
+     * Event loop thread of connection changes waiting <-> active, timer thread changes waiting -> cancelling -> expired.
+     */
+    enum class timeout_state : unsigned char
+    {
+        //Connection doesn't wait for client (it parses data or has no socket).
+        active,
+        //Connection waits for received data or for end of send operation.
+        waiting,
+        //Timer thread shuts down socket of connection.
+        cancelling,
+        //Socket is shut down by timer thread, connection must be closed by its handler.
+        expired
+    };
+
+    /**
+     * @brief This enum represents hot restart state of connection that waits for a new expression.
+     * Event loop thread of connection changes active -> arming -> parked -> active, a thread that starts draining
+     * changes parked -> cancelling -> parked (it cancels receive of parked connection, so the connection is handed over).
+     */
+    enum class handoff_state : unsigned char
+    {
+        //Connection is processed by its handler or it waits in the middle of expression.
+        active,
+        //Event loop thread starts receive of idle connection.
+        arming,
+        //Idle connection waits for received data.
+        parked,
+        //Receive of idle connection is being cancelled.
+        cancelling
+    };
+
+    /**
+     * This struct contains hot restart state of connection that is shared with the handoff thread.
+     * It is kept outside of client struct because atomics are not movable.
+     */
+    struct client_handoff
+    {
+        std::atomic<handoff_state> state{handoff_state::active};
+    };
+
+    /**
+     * This struct measures lag of one io_service: its timer expires every lag_probe_interval,
+     * lag is the delay between expiration and handler call (it is smoothed).
+     */
+    struct lag_probe
+    {
+        explicit lag_probe(boost::asio::io_service& s) : timer(s) {}
+
+        boost::asio::steady_timer timer;
+        //Smoothed lag in microseconds.
+        std::atomic<std::uint64_t> lag{0};
+    };
+
+    /**
+     * This struct represents complete lines of received data that are evaluated by one parallel thread.
+     */
+    struct parallel_chunk
+    {
+        //Lines of chunk, each of them ends with '\n'.
+        const char* begin;
+        std::size_t size;
+        //Results of lines (evaluation stops after the first processing error).
+        std::string results;
+        //Has processing error happened?
+        bool error;
+    };
+
+    /**
+     * This struct is a reorder buffer of one parallel evaluation: chunks are evaluated in any order,
+     * their results are sent in request order when the last chunk is evaluated.
+     */
+    struct parallel_batch
+    {
+        std::vector<parallel_chunk> chunks;
+        //Number of chunks that are not evaluated yet.
+        std::atomic<unsigned int> left{0};
+    };
+
+    /**
+     * This struct contains timeout data of connection that is shared with timer thread.
+     * It is kept outside of client struct because atomics are not movable.
+     */
+    struct client_timeout
+    {
+        //Time (see now_ms()) when waiting connection expires (0 means it doesn't expire).
+        std::atomic<std::uint64_t> deadline{0};
+        //See timeout_state.
+        std::atomic<timeout_state> state{timeout_state::active};
+        //Deadline of the entry of timer wheel that is responsible for connection (0 means connection is not in wheel).
+        //Other entries of connection are stale, they are dropped when they are visited.
+        std::atomic<std::uint64_t> wheel_deadline{0};
     };
 
     /**
@@ -84,17 +314,140 @@ private:
      */
     struct client
     {
-        //Socket object.
-        boost::asio::ip::tcp::socket socket;
-        //Buffer for sending/receiving data.
+        client(boost::asio::generic::stream_protocol::socket socket_, boost::asio::steady_timer throttle_timer_,
+               unsigned int service_index_, std::unique_ptr<Evaluator> evaluator_)
+            : socket(std::move(socket_)), service_index(service_index_), throttle_timer(std::move(throttle_timer_)),
+              evaluator(std::move(evaluator_))
+        {
+        }
+
+        //Socket object (TCP or Unix domain stream socket).
+        boost::asio::generic::stream_protocol::socket socket;
+        //Buffer for receiving data.
         char buffer[8192];
+        //Received data in buffer that is not parsed yet: [pending_begin, pending_end).
+        std::size_t pending_begin = 0;
+        std::size_t pending_end = 0;
+        //Data to send.
+        std::string response;
         //Object to compute a receiving expression.
         ShuntingYardInt shunting_yard;
         //Last async operation in unit-test mode.
-        client_unit_test_mode unit_test_mode;
+        client_unit_test_mode unit_test_mode = client_unit_test_mode::none;
+        //Does current connection write connection-level log records?
+        bool log_sampled = false;
+        //Is current connection traced?
+        bool trace_sampled = false;
+        //Start time of current traced async operation.
+        std::uint64_t trace_start = 0;
+        //Index of io_service that processes this client (see get_service()).
+        unsigned int service_index;
+        //Number of parsed bytes of current expression.
+        unsigned long long expression_bytes = 0;
+        //Is current expression parsed by bulk threads?
+        bool heavy = false;
+        //Is current connection accepted by Unix domain socket listener (unix_acceptor)?
+        bool local = false;
+        //Time (see now_ms()) when the first byte of current expression was parsed (it is valid if expression_bytes is not 0).
+        std::uint64_t expression_start = 0;
+        //Deadline that is armed for current async operation.
+        timeout_reason reason = timeout_reason::none;
+        //Tokens of rate limits (see cfg.rate_expressions and cfg.rate_bytes), bytes can be in debt.
+        double expression_tokens = 0;
+        double byte_tokens = 0;
+        //Time when tokens were refilled last time.
+        std::chrono::steady_clock::time_point refill_time;
+        //Is current expression rejected because of overload (its bytes are skipped up to '\n')?
+        bool shed = false;
+        //Timer that resumes throttled connection.
+        boost::asio::steady_timer throttle_timer;
+        //Reorder buffer of parallel evaluation (it is created on the first parallel evaluation).
+        std::unique_ptr<parallel_batch> parallel;
+        //Pipeline that continues expression of heavy connection (it is null if connection is not heavy or all pipelines are busy).
+        ShuntingYardPipelineInt* pipeline = nullptr;
+        //Evaluator of expressions of other numeric type than int32 (see cfg.type), it is used instead of shunting_yard.
+        std::unique_ptr<Evaluator> evaluator;
+        //Received part of '#type' command (it is not empty while the line of command is incomplete).
+        std::string command;
+        //Was numeric type selected by '#type' command (evaluator is restored to cfg.type on close)?
+        bool negotiated = false;
+        //Is current expression measured for slow-expression log (see cfg.slow_expression)?
+        bool slow_measured = false;
+        //Time when parsing of measured expression started and thread CPU time of its parse calls in nanoseconds.
+        std::chrono::steady_clock::time_point slow_start;
+        std::uint64_t slow_cpu = 0;
+        //Beginning of measured expression (its length is limited by slow_prefix_size).
+        std::string slow_prefix;
+        //Identifier of connection in capture file (see cfg.capture_file).
+        std::uint64_t capture_id = 0;
+        //Token of session of connection (0 means connection has no session).
+        std::uint64_t session_token = 0;
+        //Number of bytes of session that are parsed (they are counted from the end of '#session' line).
+        std::uint64_t session_offset = 0;
+        //Number of result lines of session.
+        unsigned long long session_results = 0;
+    };
+
+    /**
+     * This struct keeps state of connection between connections of one session (see execute_session_command()).
+     * Parser state is moved here when connection is closed and moved back on resume, so it is never copied.
+     */
+    struct session
+    {
+        //Parser of int32 expressions and evaluator of other types (see client).
+        ShuntingYardInt shunting_yard;
+        std::unique_ptr<Evaluator> evaluator;
+        bool negotiated = false;
+        //Number of parsed bytes of current expression and its shed flag (see client).
+        unsigned long long expression_bytes = 0;
+        bool shed = false;
+        //Parsed bytes and result lines of session.
+        std::uint64_t offset = 0;
+        unsigned long long results = 0;
+        //Does a connection use session now?
+        bool attached = true;
+        //Time in milliseconds since start_time when session lost its connection.
+        std::uint64_t detach_time = 0;
     };
 
 private:
+    /**
+     * @brief Returns io_service with index service_index (0 means 'service', it also processes accept operations).
+     * @param service_index[in] index of io_service.
+     */
+    boost::asio::io_service& get_service(unsigned int service_index)
+    {
+        return service_index ? node_services[service_index - 1] : service;
+    }
+
+    /**
+     * @brief Opens TCP and/or Unix domain socket listeners.
+     * TCP listener is opened if cfg.port is not 0 or cfg.unix_socket is empty.
+     * Stale socket file is removed before binding of Unix domain socket.
+     */
+    void init_listeners();
+
+    /**
+     * @brief Resolves cfg.cpus to CPU and io_service of each event loop thread.
+     * Threads pinned to CPUs of different NUMA nodes get different io_service objects (one per node),
+     * so a client is processed by threads of one node only.
+     */
+    void init_placement();
+
+    /**
+     * @brief Body of event loop thread: pins thread (if it is needed) and runs its io_service.
+     * @param thread_index[in] index of event loop thread.
+     */
+    void run_event_loop(unsigned int thread_index);
+
+    /**
+     * @brief Runs io_service in busy-poll mode.
+     * Thread polls ready handlers and spins (with growing pauses) up to cfg.busy_poll microseconds
+     * after the last handler, then it blocks until the next handler.
+     * @param s[in] io_service to run.
+     */
+    void run_busy_poll(boost::asio::io_service& s);
+
     /**
      * @brief Handle of 'async accept' operation.
      * It calls dispatch_async_receive() for successful result.
@@ -137,10 +490,32 @@ private:
 
     /**
      * @brief Starts async accept operation (waits incomming connection).
+     * Free slot takes a connection that waits for a slot or it waits for a connection of any listener.
      * @param client_index[in] index of client, point at clients[client_index] object.
      */
     void dispatch_async_accept(unsigned int client_index);
 
+    /**
+     * @brief Starts async accept of listener if there are free slots (accept_mutex is locked by the caller).
+     * @param listener_index[in] index of listener, point at listeners[listener_index] object.
+     */
+    void dispatch_listener_accept(unsigned int listener_index);
+
+    /**
+     * @brief Handle of 'async accept' operation of listener.
+     * Accepted connection is moved to the first free slot or it waits for a slot (see dispatch_async_accept()).
+     * @param listener_index[in] index of listener, point at listeners[listener_index] object.
+     * @param error[in] represents operating system-specific errors.
+     */
+    void handle_listener_accept(unsigned int listener_index, const boost::system::error_code& error);
+
+    /**
+     * @brief Moves accepted connection of listener to free slot (accept_mutex is locked by the caller).
+     * @param listener_index[in] index of listener, point at listeners[listener_index] object.
+     * @param client_index[in] index of free client.
+     */
+    void take_accepted(unsigned int listener_index, unsigned int client_index);
+
     /**
      * @brief Starts async receive operation (waits incomming data).
      * @param client_index[in] index of client, point at clients[client_index] object.
@@ -150,34 +525,501 @@ private:
     /**
      * @brief Starts async send operation (uses composed operation 'async_write).
      * @param client_index[in] index of client, point at clients[client_index] object.
-     * @param bytes_to_write[in] how many bytes from clients[client_index].buffer need to send.
      * @param processing_error[in] pass true if server need to close connection after send data and do async accept.
      */
-    void dispatch_async_send(unsigned int client_index, std::size_t bytes_to_write, bool processing_error);
+    void dispatch_async_send(unsigned int client_index, bool processing_error);
+
+    /**
+     * @brief Continues processing of connection: parses pending data or starts async receive operation.
+     * Connection that has exceeded its rate limit waits for tokens first (see dispatch_throttle()).
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void dispatch_continue(unsigned int client_index);
+
+    /**
+     * @brief Starts async wait of throttled connection, then it calls dispatch_continue().
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @param delay[in] time until tokens are refilled in microseconds.
+     */
+    void dispatch_throttle(unsigned int client_index, std::uint64_t delay);
+
+    /**
+     * @brief Refills tokens of connection and returns time until it can continue.
+     * Pending data needs one expression token, receive operation needs non-negative byte tokens.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @return delay in microseconds (0 means connection can continue).
+     */
+    std::uint64_t get_throttle_delay(unsigned int client_index);
+
+    /**
+     * @brief Starts async wait of the next lag measurement of io_service.
+     * @param service_index[in] index of io_service (see get_service()).
+     */
+    void dispatch_lag_probe(unsigned int service_index);
+
+    /**
+     * @brief Is io_service overloaded (its lag exceeds cfg.shed_lag)?
+     * @param service_index[in] index of io_service (see get_service()).
+     */
+    bool is_overloaded(unsigned int service_index) const
+    {
+        return cfg.shed_lag && lag_probes[service_index].lag.load(std::memory_order_relaxed) > cfg.shed_lag;
+    }
+
+    /**
+     * @brief Posts parse_result() of heavy connection to bulk threads.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void dispatch_bulk_parse(unsigned int client_index);
 
     /**
-     * @brief Parses received data and dispatch next async operation.
+     * @brief Calls parse_result() in current thread or in bulk threads (for heavy connection).
      * @param client_index[in] index of client, point at clients[client_index] object.
-     * @param bytes_transferred[in] number of received bytes.
      */
-    void parse_result(unsigned int client_index, std::size_t bytes_transferred);
+    void dispatch_parse(unsigned int client_index);
+
+    /**
+     * @brief Moves current expression of connection that became heavy to a free pipeline (if there is one).
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void acquire_pipeline(unsigned int client_index);
+
+    /**
+     * @brief Returns pipeline of connection to free pipelines (pipeline must be empty).
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void release_pipeline(unsigned int client_index);
+
+    /**
+     * @brief Starts parallel evaluation of complete lines of pending data if they are large enough.
+     * Lines are split into at most cfg.parallel_threads chunks of at least cfg.parallel_chunk bytes.
+     * The rest of pending data (incomplete expression) is parsed after results are sent.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @return true if parallel evaluation is started.
+     */
+    bool dispatch_parallel_parse(unsigned int client_index);
+
+    /**
+     * @brief Evaluates one chunk of parallel evaluation (it is called by parallel threads).
+     * The last evaluated chunk posts finish_parallel_parse() to io_service of connection.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @param chunk_index[in] index of chunk in clients[client_index].parallel->chunks.
+     */
+    void parallel_parse(unsigned int client_index, std::size_t chunk_index);
+
+    /**
+     * @brief Collects results of chunks in request order and sends them.
+     * Results after the first processing error are dropped, connection is closed after send.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void finish_parallel_parse(unsigned int client_index);
+
+    /**
+     * @brief Parses pending received data and dispatch next async operation.
+     * It evaluates pipelined expressions until cfg.turn_expressions or cfg.turn_bytes budget is exhausted
+     * and puts their results into one response.
+     * Heavy connection parses at most cfg.bulk_budget bytes per call.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void parse_result(unsigned int client_index);
+
+    /**
+     * @brief Makes evaluator of numeric type for client (int32 is evaluated by client::shunting_yard, so it is null).
+     * @param type[in] numeric type of expressions.
+     * @param modulus[in] modulus of mod64 type.
+     */
+    static std::unique_ptr<Evaluator> make_client_evaluator(NumericType type, std::uint64_t modulus);
+
+    /**
+     * @brief Executes '#type <name> [<modulus>]' command of clients[client_index].command and appends its reply.
+     * Numeric type is switched once per command, evaluator of type is used for all next expressions of connection.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @return false if command is invalid ("Invalid command\n" is appended).
+     */
+    bool execute_command(unsigned int client_index);
+
+    /**
+     * @brief Executes '#session' or '#resume <token>' command of clients[client_index] and appends its reply.
+     * '#session' starts a new session of connection, '#resume' moves state of detached session to connection.
+     * Detached sessions that are older than cfg.session_timeout are dropped, the oldest detached session is dropped
+     * if there are cfg.sessions sessions.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @param name[in] name of command.
+     * @param command[in] the rest of command line.
+     * @return false if command is invalid or there is no free session ("Invalid command\n" is appended).
+     */
+    bool execute_session_command(unsigned int client_index, const std::string& name, std::istream& command);
+
+    /**
+     * @brief Moves parser state of connection to its session (or drops session) when connection is closed.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @param keep[in] false if session is dropped (processing error finished it).
+     */
+    void detach_session(unsigned int client_index, bool keep);
+
+    /**
+     * @brief Drops detached sessions that are older than cfg.session_timeout (sessions_mutex must be locked).
+     * @param now[in] time in milliseconds since construction.
+     */
+    void drop_expired_sessions(std::uint64_t now);
+
+    /**
+     * @brief Starts async wait of the next check of expired sessions, so their parsers don't stay in memory
+     * until the next session command.
+     */
+    void dispatch_session_check();
+
+    /**
+     * @brief Is hot restart enabled (see cfg.handoff_socket)?
+     */
+    bool handoff_enabled() const
+    {
+        return !cfg.handoff_socket.empty() && !transport;
+    }
+
+    /**
+     * @brief Connects to cfg.handoff_socket and takes over listening sockets of the running process (if it exists).
+     * Listeners that are not received are opened by init_listeners(), then this process listens on cfg.handoff_socket.
+     */
+    void take_over();
+
+    /**
+     * @brief Body of the handoff thread: adopts idle connections of the old process until it ends draining,
+     * then accepts the next new process and hands this process over to it.
+     */
+    void run_handoff();
+
+    /**
+     * @brief Sends listeners to the new process, starts draining and waits until connections are gone.
+     * @param peer[in] connected socket of the new process.
+     * @return false if listeners are not sent (this process continues as usual).
+     */
+    bool hand_over(int peer);
+
+    /**
+     * @brief Is clients[client_index] between expressions, so its socket can be handed over?
+     * Connections with a session or a negotiated type are not idle, their state is kept by this process only.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    bool is_idle(unsigned int client_index) const;
+
+    /**
+     * @brief Sends socket of idle connection to the new process and closes it here (it is called while draining).
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @return false if connection is not idle or socket is not sent (connection continues here).
+     */
+    bool hand_over_client(unsigned int client_index);
+
+    /**
+     * @brief Hands over connections that wait for a free slot while this process is draining (they are idle).
+     */
+    void hand_over_held();
+
+    /**
+     * @brief Cancels accepts of listeners (it can be called from any thread).
+     * Acceptors are not thread-safe, so cancel is posted to their event loop and done under accept_mutex.
+     */
+    void cancel_listeners();
+
+    /**
+     * @brief Assigns a socket taken over from the old process to clients[client_index] and posts its accept handler.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @return false if there is no such socket.
+     */
+    bool adopt_client(unsigned int client_index);
+
+    /**
+     * @brief Cancels receive of parked connection (see handoff_state), it can be called from any thread.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void cancel_parked(unsigned int client_index);
+
+    /**
+     * @brief Marks connection as active at the beginning of receive handler.
+     * It waits if receive is being started or cancelled by another thread right now.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void leave_parked(unsigned int client_index);
+
+    /**
+     * @brief Writes record of slow expression of clients[client_index] if rate limit allows it.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @param wall[in] wall time of expression in microseconds (from the first parsed byte to result).
+     * @param bytes[in] size of expression.
+     * It must be called before evaluator (or pipeline) of connection starts the next expression.
+     */
+    void log_slow_expression(unsigned int client_index, std::uint64_t wall, unsigned long long bytes);
+
+    /**
+     * @brief Are idle/expression/receive rate timeouts enabled?
+     */
+    bool timeouts_enabled() const
+    {
+        return cfg.idle_timeout || cfg.expression_timeout || cfg.min_receive_rate;
+    }
+
+    /**
+     * @brief Returns coarse time in milliseconds since construction (it is updated by timer every tick).
+     */
+    std::uint64_t now_ms() const
+    {
+        return coarse_now.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Computes deadline of async operation and puts connection into timer wheel (if it is not there yet).
+     * Idle timeout is used for send operation and for receive operation without incomplete expression,
+     * incomplete expression is also limited by cfg.expression_timeout and cfg.min_receive_rate.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @param sending[in] true for send operation.
+     */
+    void arm_timeout(unsigned int client_index, bool sending);
+
+    /**
+     * @brief Marks connection as active at the beginning of async operation handler.
+     * It waits if timer thread is shutting down socket of connection right now.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @return true if connection is expired (handler must close it).
+     */
+    bool disarm_timeout(unsigned int client_index);
+
+    /**
+     * @brief Closes expired connection, updates counters and dispatches async accept.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void on_timeout(unsigned int client_index);
+
+    /**
+     * @brief Starts async wait of the next tick of timer wheel.
+     */
+    void dispatch_timeout_check();
+
+    /**
+     * @brief Updates coarse time and visits connections whose deadlines passed.
+     * Socket of expired waiting connection is shut down, so its pending async operation completes at once.
+     * @param now[in] time in milliseconds since construction.
+     */
+    void check_timeouts(std::uint64_t now);
+
+    /**
+     * @brief Clears client object and closes connection.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void close_client(unsigned int client_index);
+
+    /**
+     * @brief Writes connection-level log record if log level is enabled and connection is sampled.
+     * Error records are written for each connection.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @param level[in] level of record.
+     * @param format[in] printf-like format literal (see Logger::write).
+     * @param value[in] the second argument of format.
+     */
+    void log(unsigned int client_index, LogLevel level, const char* format, long long value = 0)
+    {
+        if (logger.is_enabled(level) && (level == LogLevel::error || clients[client_index].log_sampled))
+        {
+            logger.write(level, format, client_index, value);
+        }
+    }
+
+    /**
+     * @brief Records span of traced connection that has been started at clients[client_index].trace_start.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     * @param phase[in] phase of client processing.
+     * @param value[in] additional value of span (e.g. number of bytes).
+     */
+    void trace(unsigned int client_index, TracePhase phase, long long value = 0)
+    {
+        client& c = clients[client_index];
+        if (c.trace_sampled)
+        {
+            tracer.record(phase, client_index, c.trace_start, Tracer::now(), value);
+        }
+    }
+
+    /**
+     * @brief Remembers start time of async operation for traced connection.
+     * @param client_index[in] index of client, point at clients[client_index] object.
+     */
+    void trace_start(unsigned int client_index)
+    {
+        client& c = clients[client_index];
+        if (c.trace_sampled)
+        {
+            c.trace_start = Tracer::now();
+        }
+    }
 
 private:
     //Provided server configuration (listen address, listen port, maximum number of NetCalcCore, number of threads).
     Config cfg;
 
+    //Asynchronous logger (it is declared before other members to outlive them).
+    Logger logger;
+
+    //Sampled tracer of client processing.
+    Tracer tracer;
+
+    //Capture of received chunks (it is disabled if cfg.capture_file is empty).
+    Capture capture;
+
+    //Transport of connections (it is null if sockets are used).
+    Transport* transport;
+
     //Main boost::asio object.
     boost::asio::io_service service;
 
-    //Object to accept incoming connections.
+    //boost::asio objects of NUMA nodes except the first one (they are used if threads are pinned to several nodes).
+    std::deque<boost::asio::io_service> node_services;
+
+    //Keep node_services running while they don't have async operations.
+    std::vector<boost::asio::io_service::work> node_works;
+
+    //Keep service running while operations of transport are pending (they are not async operations of io_service).
+    std::unique_ptr<boost::asio::io_service::work> transport_work;
+
+    //CPU of each event loop thread (empty if threads are not pinned).
+    std::vector<unsigned int> thread_cpus;
+
+    //Index of io_service of each event loop thread.
+    std::vector<unsigned int> thread_services;
+
+    //NUMA node of each io_service.
+    std::vector<unsigned int> service_nodes;
+
+    //boost::asio object of bulk threads (they parse expressions of heavy connections).
+    boost::asio::io_service bulk_service;
+
+    //Keep bulk_service running while it doesn't have handlers.
+    boost::asio::io_service::work bulk_work;
+
+    //Container of objects of started bulk threads (can be empty).
+    std::vector<std::thread> bulk_threads;
+
+    //boost::asio object of parallel threads (they evaluate chunks of pipelined expressions).
+    boost::asio::io_service parallel_service;
+
+    //Keep parallel_service running while it doesn't have handlers.
+    boost::asio::io_service::work parallel_work;
+
+    //Container of objects of started parallel threads (can be empty).
+    std::vector<std::thread> parallel_threads;
+
+    //Pipelines of heavy connections (each of them has its own evaluator thread, rings of pipeline are over-aligned).
+    std::vector<AlignedPtr<ShuntingYardPipelineInt>> pipelines;
+
+    //Pipelines that are not used by connections.
+    std::vector<ShuntingYardPipelineInt*> free_pipelines;
+    std::mutex pipelines_mutex;
+
+    //Object to accept incoming TCP connections (it is closed if only Unix domain socket is used).
     boost::asio::ip::tcp::acceptor acceptor;
 
+    //Object to accept incoming Unix domain socket connections (it is closed if cfg.unix_socket is empty).
+    boost::asio::local::stream_protocol::acceptor unix_acceptor;
+
+    /**
+     * Open acceptor and its accepted connection.
+     * Free slots of both listeners are kept in one queue, so any slot serves connections of any listener.
+     */
+    struct listener
+    {
+        //Socket of accepted connection (it is open while connection waits for a free slot).
+        boost::asio::generic::stream_protocol::socket socket;
+        //Protocol of accepted connections.
+        boost::asio::generic::stream_protocol protocol;
+        //Is it Unix domain socket listener (unix_acceptor)?
+        bool local;
+        //Is async accept in progress?
+        bool accepting;
+        //Does accepted connection wait for a free slot?
+        bool held;
+    };
+
+    //Listeners of acceptor and unix_acceptor (transport and unit tests don't use them).
+    std::vector<listener> listeners;
+    //Free slots that wait for connections of listeners.
+    std::deque<unsigned int> free_clients;
+    std::mutex accept_mutex;
+
+    //Server of shared-memory transport (it is null if cfg.shm_name is empty).
+    std::unique_ptr<ShmServer> shm_server;
+
     //Container of objects to process multiple simultaneous connections (can't be empty).
     std::vector<client> clients;
 
     //Container of objects of started threads (can be empty).
     std::vector<std::thread> threads;
 
+    //Timeout data of each client (clients[i] -> timeouts[i]).
+    std::vector<client_timeout> timeouts;
+
+    //Deadlines of waiting connections.
+    TimerWheel timer_wheel;
+
+    //Timer that advances timer_wheel every tick (it is used if timeouts are enabled).
+    boost::asio::steady_timer timeout_timer;
+
+    //Construction time of NetCalcCore.
+    std::chrono::steady_clock::time_point start_time;
+
+    //Coarse time in milliseconds since start_time (see now_ms()).
+    std::atomic<std::uint64_t> coarse_now{0};
+
+    //Counters of reclaimed connections (see NetCalcStats).
+    std::atomic<unsigned long long> idle_timeouts{0};
+    std::atomic<unsigned long long> expression_timeouts{0};
+    std::atomic<unsigned long long> slow_receives{0};
+
+    //Lag of each io_service (lag_probes[i] measures get_service(i)).
+    std::deque<lag_probe> lag_probes;
+
+    //Counters of rate limiting and load shedding (see NetCalcStats).
+    std::atomic<unsigned long long> throttles{0};
+    std::atomic<unsigned long long> shed_expressions{0};
+
+    //Counter of slow expressions (see NetCalcStats) and rate limit of their records: second since start_time and
+    //number of records written in it.
+    std::atomic<unsigned long long> slow_expressions{0};
+    std::atomic<std::uint64_t> slow_log_second{0};
+    std::atomic<unsigned int> slow_log_records{0};
+
+    //Resumable sessions by token, timer of expired sessions and counter of resumed sessions (see NetCalcStats).
+    std::unordered_map<std::uint64_t, session> sessions;
+    boost::asio::steady_timer session_timer;
+    std::mutex sessions_mutex;
+    std::atomic<unsigned long long> resumed_sessions{0};
+
+    //Hot restart (see cfg.handoff_socket): listening socket of this process, connection to the other process
+    //(-1 if there is no one), thread that serves them and handler of the end of draining.
+    int handoff_listener = -1;
+    int handoff_peer = -1;
+    std::thread handoff_thread;
+    std::function<void()> handoff_handler;
+
+    //Guards handoff_peer, adopted and handoff_stopped, handoff_condition wakes up draining.
+    std::mutex handoff_mutex;
+    std::condition_variable handoff_condition;
+    bool handoff_stopped = false;
+
+    //This process has handed over its listeners: it doesn't accept connections and hands over idle ones.
+    std::atomic<bool> draining{false};
+
+    //Hot restart state of each client (clients[i] -> handoffs[i]).
+    std::vector<client_handoff> handoffs;
+
+    //Sockets taken over from the old process that wait for free client slots.
+    std::deque<HandoffDescriptor> adopted;
+    std::atomic<unsigned int> adopted_size{0};
+
+    //Number of accepted connections (it is counted if hot restart is enabled).
+    std::atomic<unsigned int> active_connections{0};
+
+    //Counters of hot restart (see NetCalcStats).
+    std::atomic<unsigned long long> handed_over_connections{0};
+    std::atomic<unsigned long long> adopted_connections{0};
+
     /**
      * Flag of unit-test mode.
      * In this mode:
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "ShmTransport.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/**
+ * This class implements client library of shared-memory transport (see ShmTransport.h).
+ * One object is one session. It can be used by one thread or by two threads: one calls write() and another one calls read().
+ *
+ * How to use it?
+ * ShmClient client;
+ * std::string error;
+ * if (!client.attach("netcalc", error)) ...        //Server was started with --shm-name netcalc.
+ * std::string result;
+ * client.evaluate("(1 + 2) * 3", result);          //result is "9".
+ * client.write("1 + 2\n3 * 4\n", 12);              //Pipelined expressions.
+ * char buffer[64];
+ * std::size_t n = client.read(buffer, sizeof(buffer)); //"3\n12\n" (maybe by several calls).
+ * client.detach();
+ */
+class ShmClient
+{
+public:
+    /**
+     * @brief This method constructs detached client.
+     * @param spin_[in] spin time in microseconds before sleeping on futex.
+     */
+    explicit ShmClient(unsigned int spin_ = 50);
+
+    /**
+     * @brief This method detaches client.
+     */
+    ~ShmClient();
+
+    ShmClient(const ShmClient&) = delete;
+    ShmClient& operator=(const ShmClient&) = delete;
+
+    /**
+     * @brief Opens segment and claims a free session.
+     * @param name[in] name of segment (--shm-name of server).
+     * @param error[out] description of error.
+     * @return true if session was claimed and reset by server.
+     */
+    bool attach(const std::string& name, std::string& error);
+
+    /**
+     * @brief Releases session.
+     */
+    void detach();
+
+    /**
+     * @brief Writes all data to request ring (it waits for free space if it is needed).
+     * @param data[in] expressions ('\n' is the end of expression).
+     * @param size[in] size of data.
+     * @return false if server is stopped.
+     */
+    bool write(const char* data, std::size_t size);
+
+    /**
+     * @brief Reads available results (it waits for at least one byte).
+     * @param buffer[out] buffer for results.
+     * @param size[in] size of buffer.
+     * @return number of read bytes (0 if server is stopped).
+     */
+    std::size_t read(char* buffer, std::size_t size);
+
+    /**
+     * @brief Evaluates one expression.
+     * @param expression[in] expression without '\n'.
+     * @param result[out] result without '\n' (or error message).
+     * @return false if server is stopped.
+     */
+    bool evaluate(const std::string& expression, std::string& result);
+
+private:
+    /**
+     * @brief Spins and then sleeps until ready() is true.
+     * @return false if server is stopped.
+     */
+    template <class Ready>
+    bool wait(Ready ready);
+
+    /** Is server alive and ready? */
+    bool is_server_ready();
+
+private:
+    const unsigned int spin;
+    std::unique_ptr<ShmSegment> segment;
+    ShmSessionHeader* session = nullptr;
+    unsigned int session_index = 0;
+
+    //Read but not returned results of evaluate().
+    std::string results;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Evaluator.h"
+#include "ShmTransport.h"
+#include <ShuntingYard.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * This class implements server side of shared-memory transport (see ShmTransport.h).
+ *
+ * This class:
+ *   - creates named segment with 'sessions' ring pairs;
+ *   - evaluates expressions of all sessions in one worker thread with one ShuntingYard (or Evaluator of numeric type)
+ *     per session;
+ *   - parses expressions directly in request ring and writes results directly to response ring;
+ *   - evaluates at most 'turn_expressions' expressions of a session per turn, then it serves the next session;
+ *   - doesn't close session on processing error (division by zero/invalid expression), the error message is
+ *     the result of expression and the rest of its line is skipped;
+ *   - spins up to 'spin' microseconds without work before it sleeps on futex.
+ *
+ * How to use it?
+ * ShmServer server("netcalc", 4, 65536, 16, 50); //It throws boost::system::system_error if segment can't be created.
+ * server.start();
+ * ...
+ * server.stop();
+ */
+class ShmServer
+{
+public:
+    /**
+     * @brief This method creates segment but doesn't start worker thread.
+     * @param name[in] name of segment.
+     * @param sessions[in] number of sessions.
+     * @param ring_size[in] size of each ring (power of two).
+     * @param turn_expressions_[in] expressions of a session per turn (0 means no limit).
+     * @param spin_[in] spin time in microseconds before sleeping.
+     * @param type[in] numeric type of expressions (bigint is not supported, its results have no size limit).
+     * @param modulus[in] modulus of mod64 type.
+     */
+    ShmServer(const std::string& name, unsigned int sessions, unsigned int ring_size, unsigned int turn_expressions_, unsigned int spin_,
+              NumericType type = NumericType::int32, std::uint64_t modulus = 0);
+
+    /**
+     * @brief This method stops worker thread and removes segment name.
+     */
+    ~ShmServer();
+
+    ShmServer(const ShmServer&) = delete;
+    ShmServer& operator=(const ShmServer&) = delete;
+
+    /** Starts worker thread. */
+    void start();
+
+    /** Stops worker thread (it can be called from any thread). */
+    void stop();
+
+private:
+    using ShuntingYardInt = ShuntingYard<int, ShuntingYardSyntax, ShuntingYardChecked>;
+
+    /** Body of worker thread. */
+    void run();
+
+    /**
+     * @brief Evaluates expressions of session.
+     * @param index[in] index of session.
+     * @return true if something was done.
+     */
+    bool serve(unsigned int index);
+
+    /** Has session work that can be done now? */
+    bool has_work(unsigned int index);
+
+private:
+    ShmSegment segment;
+    const unsigned int turn_expressions;
+    const unsigned int spin;
+
+    //ShuntingYard of each session (it is used for int32 type).
+    std::vector<ShuntingYardInt> shunting_yards;
+
+    //Evaluator of each session (it is used for other types).
+    std::vector<std::unique_ptr<Evaluator>> evaluators;
+
+    //Does session skip the rest of line after processing error?
+    std::vector<bool> skipping;
+
+    //Result of the last expression.
+    std::string result;
+
+    std::atomic<bool> stopped{false};
+    std::thread worker;
+};
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * This file contains layout of shared-memory transport and helpers that are used by server (ShmServer)
+ * and client library (ShmClient).
+ *
+ * Named segment (shm_open(name)) contains a header and a fixed number of sessions.
+ * Each session is a pair of single-producer/single-consumer byte rings:
+ *   - request ring: client writes expressions, server reads them;
+ *   - response ring: server writes results, client reads them.
+ * Data format is the same as in TCP connection ('\n' is the end of expression and of result).
+ *
+ * Side that has nothing to do spins for a while and then sleeps on a futex ('doorbell').
+ * Side that produces data or frees space rings the doorbell only if the other side sleeps ('waiting' flag),
+ * so a busy pair of client and server doesn't make syscalls at all.
+ *
+ * Session life cycle:
+ *   - client claims a free session (owner is 0 or its process is dead) by CAS of its pid to 'owner';
+ *   - client increments 'generation' and waits until server resets the session and sets 'acked_generation';
+ *   - client detaches by storing 0 to 'owner'.
+ */
+
+/**
+ * Header of byte ring: head and tail are monotonic counters of read and written bytes.
+ */
+struct ShmRingHeader
+{
+    //Read bytes (consumer changes it).
+    alignas(64) std::atomic<std::uint64_t> head;
+
+    //Written bytes (producer changes it).
+    alignas(64) std::atomic<std::uint64_t> tail;
+};
+
+/**
+ * Header of session.
+ */
+struct ShmSessionHeader
+{
+    //Process identifier of attached client (0 means session is free).
+    alignas(64) std::atomic<std::int32_t> owner;
+
+    //Client increments it on attach.
+    std::atomic<std::uint32_t> generation;
+
+    //Server sets it to 'generation' after reset of session.
+    std::atomic<std::uint32_t> acked_generation;
+
+    //Client sleeps on this futex.
+    alignas(64) std::atomic<std::uint32_t> client_doorbell;
+
+    //Number of client threads that sleep (or are going to sleep).
+    std::atomic<std::uint32_t> client_waiting;
+
+    ShmRingHeader request;
+    ShmRingHeader response;
+};
+
+/**
+ * Header of segment.
+ */
+struct ShmHeader
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t sessions;
+    std::uint32_t ring_size;
+    std::int32_t server_pid;
+
+    //Server sets it after initialization and clears it on shutdown.
+    std::atomic<std::uint32_t> ready;
+
+    //Server sleeps on this futex.
+    alignas(64) std::atomic<std::uint32_t> server_doorbell;
+
+    //Number of server threads that sleep (or are going to sleep).
+    std::atomic<std::uint32_t> server_waiting;
+};
+
+/**
+ * View of byte ring that is placed in shared memory.
+ * Methods for consumer: readable(), peek(), consume(), reset().
+ * Methods for producer: writable(), write().
+ */
+class ShmRing
+{
+public:
+    ShmRing(ShmRingHeader& header_, char* data_, std::size_t size_)
+        : header(header_), data(data_), mask(size_ - 1) {}
+
+    /** Number of bytes that can be read. */
+    std::size_t readable() const
+    {
+        return static_cast<std::size_t>(header.tail.load(std::memory_order_acquire) - header.head.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Returns pointer to readable bytes that are placed contiguously (data is not copied).
+     * @param size[out] number of contiguous readable bytes (0 if ring is empty).
+     */
+    const char* peek(std::size_t& size) const;
+
+    /** Marks n read bytes as free. */
+    void consume(std::size_t n)
+    {
+        header.head.store(header.head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    /** Drops all readable bytes (producer must not write at the same time). */
+    void reset()
+    {
+        header.head.store(header.tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    /** Number of bytes that can be written. */
+    std::size_t writable() const
+    {
+        return mask + 1 - static_cast<std::size_t>(header.tail.load(std::memory_order_relaxed) - header.head.load(std::memory_order_acquire));
+    }
+
+    /**
+     * @brief Writes as many bytes as fit into ring.
+     * @return number of written bytes.
+     */
+    std::size_t write(const char* s, std::size_t size);
+
+private:
+    ShmRingHeader& header;
+    char* const data;
+    const std::size_t mask;
+};
+
+/**
+ * Memory mapping of shared-memory segment.
+ * Server creates segment (and removes its name in destructor), client opens existing one.
+ */
+class ShmSegment
+{
+public:
+    ShmSegment() = default;
+    ShmSegment(const ShmSegment&) = delete;
+    ShmSegment& operator=(const ShmSegment&) = delete;
+    ~ShmSegment();
+
+    /**
+     * @brief Creates and initializes segment (existing segment with the same name is replaced).
+     * @param name_[in] name of segment (without '/').
+     * @param sessions[in] number of sessions.
+     * @param ring_size[in] size of each ring (power of two).
+     * @param error[out] description of error.
+     * @return true if segment was created.
+     */
+    bool create(const std::string& name_, unsigned int sessions, unsigned int ring_size, std::string& error);
+
+    /**
+     * @brief Opens segment that was created by server.
+     * @param name_[in] name of segment (without '/').
+     * @param error[out] description of error.
+     * @return true if segment was opened and server is ready.
+     */
+    bool open(const std::string& name_, std::string& error);
+
+    ShmHeader& get_header() { return *static_cast<ShmHeader*>(address); }
+    ShmSessionHeader& get_session(unsigned int index);
+    ShmRing get_request_ring(unsigned int index);
+    ShmRing get_response_ring(unsigned int index);
+
+private:
+    char* get_session_address(unsigned int index);
+    bool map(int fd, std::size_t size_, std::string& error);
+
+private:
+    void* address = nullptr;
+    std::size_t size = 0;
+    std::string name;
+    bool owner = false;
+};
+
+/**
+ * @brief Wakes the other side if it sleeps on doorbell.
+ * Call it after data was written or space was freed.
+ * @param doorbell[in] futex of the other side.
+ * @param waiting[in] 'waiting' flag of the other side.
+ */
+void shm_notify(std::atomic<std::uint32_t>& doorbell, std::atomic<std::uint32_t>& waiting);
+
+/**
+ * @brief Sleeps on doorbell unless ready() is true.
+ * @param doorbell[in] futex of current side.
+ * @param waiting[in] 'waiting' flag of current side.
+ * @param ready[in] function that checks whether there is work (it is called after 'waiting' flag is set).
+ * @param timeout_ms[in] maximum time of sleeping in milliseconds.
+ */
+template <class Ready>
+void shm_wait(std::atomic<std::uint32_t>& doorbell, std::atomic<std::uint32_t>& waiting, Ready ready, unsigned int timeout_ms);
+
+/** Sleeps on futex while its value is expected (or until timeout). */
+void shm_futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, unsigned int timeout_ms);
+
+/** Wakes all threads that sleep on futex. */
+void shm_futex_wake(std::atomic<std::uint32_t>& word);
+
+/** Is process alive? */
+bool shm_is_alive(std::int32_t pid);
+
+template <class Ready>
+void shm_wait(std::atomic<std::uint32_t>& doorbell, std::atomic<std::uint32_t>& waiting, Ready ready, unsigned int timeout_ms)
+{
+    std::uint32_t value = doorbell.load(std::memory_order_relaxed);
+    waiting.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    //The other side could produce data before it saw 'waiting' flag.
+    if (!ready())
+    {
+        shm_futex_wait(doorbell, value, timeout_ms);
+    }
+
+    waiting.fetch_sub(1, std::memory_order_relaxed);
+}
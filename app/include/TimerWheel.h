@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * This class implements hashed timer wheel of integer identifiers (e.g. client indexes).
+ *
+ * Wheel has 'slots' slots, each slot covers 'tick' milliseconds.
+ * Identifier with deadline D is placed into slot (D / tick) % slots, so insertion is O(1)
+ * and one advance() visits only entries of passed slots.
+ * Deadlines that are later than one round of wheel are visited earlier and are re-inserted by visit function.
+ *
+ * Wheel doesn't support removal: visit function gets identifier with deadline of its entry, checks actual deadline
+ * of identifier and returns it (identifier stays in wheel) or 0 (entry is removed).
+ * So owner of identifier can move its deadline forward without touching the wheel
+ * and can insert one more entry to move it backward (visit function drops stale entry).
+ *
+ * How to use it?
+ * TimerWheel wheel(1024, 10);
+ * wheel.insert(client_index, now + 5000);              //Any thread.
+ * wheel.advance(now, [](unsigned int id, std::uint64_t deadline, std::uint64_t now) -> std::uint64_t { ... });  //Timer thread.
+ */
+class TimerWheel
+{
+public:
+    /**
+     * @brief This method constructs empty wheel.
+     * @param slots_[in] number of slots (power of two).
+     * @param tick_[in] duration of one slot in milliseconds.
+     */
+    TimerWheel(unsigned int slots_, std::uint64_t tick_);
+
+    /**
+     * @brief Schedules identifier (it can be called from any thread).
+     * Identifier with passed deadline is visited by the next advance().
+     * @param id[in] identifier.
+     * @param deadline[in] time in milliseconds.
+     */
+    void insert(unsigned int id, std::uint64_t deadline);
+
+    /**
+     * @brief Visits identifiers of slots up to time 'now' (it must be called from one thread at a time).
+     * @param now[in] current time in milliseconds.
+     * @param visit[in] function (id, deadline of entry, now) that returns new deadline of id (0 means entry is removed).
+     */
+    template <class Visit>
+    void advance(std::uint64_t now, Visit visit);
+
+    /** Duration of one slot in milliseconds. */
+    std::uint64_t get_tick() const { return tick; }
+
+private:
+    struct entry
+    {
+        unsigned int id;
+        std::uint64_t deadline;
+    };
+
+private:
+    std::mutex mutex;
+    std::vector<std::vector<entry>> slots;
+    const std::uint64_t mask;
+    const std::uint64_t tick;
+
+    //The next tick to visit.
+    std::uint64_t current = 0;
+
+    //Entries of visited slot (it is reused to avoid allocations).
+    std::vector<entry> due;
+};
+
+template <class Visit>
+void TimerWheel::advance(std::uint64_t now, Visit visit)
+{
+    const std::uint64_t target = now / tick;
+
+    //One round visits all slots, so older ticks can be skipped.
+    if (target >= current + slots.size())
+    {
+        current = target - slots.size() + 1;
+    }
+
+    while (current <= target)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            due.swap(slots[current & mask]);
+            ++current;
+        }
+
+        for (const entry& e : due)
+        {
+            std::uint64_t deadline = visit(e.id, e.deadline, now);
+            if (deadline)
+            {
+                insert(e.id, deadline);
+            }
+        }
+        due.clear();
+    }
+}
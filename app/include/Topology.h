@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/optional.hpp>
+
+/**
+ * This file contains functions to place threads and memory on CPUs and NUMA nodes.
+ * They use Linux interfaces (sysfs, sched affinity and mbind syscall) and do nothing on other platforms.
+ * Machine without NUMA is considered as machine with one node 0.
+ */
+
+/**
+ * This function parses CPU list in Linux cpulist format (e.g. "0-3,8,10-11").
+ * @param list[in] CPU list.
+ * @return CPU numbers in order of appearance or not inited value if list is invalid or empty.
+ */
+boost::optional<std::vector<unsigned int>> parse_cpu_list(const std::string& list);
+
+/**
+ * This function returns online CPUs ordered so that neighbouring items are placed on different NUMA nodes
+ * (node 0 CPU 0, node 1 CPU 0, node 0 CPU 1, ...).
+ * The first N items are the default placement of N event loop threads: they use all nodes evenly.
+ * @return online CPUs (it is not empty).
+ */
+std::vector<unsigned int> get_default_cpus();
+
+/**
+ * This function returns NUMA node of CPU.
+ * @param cpu[in] CPU number.
+ * @return node number (0 if it is unknown).
+ */
+unsigned int get_cpu_node(unsigned int cpu);
+
+/**
+ * This function pins current thread to one CPU.
+ * @param cpu[in] CPU number.
+ * @return true if thread was pinned.
+ */
+bool pin_current_thread(unsigned int cpu);
+
+/**
+ * This function moves memory pages that are completely inside [address, address + size) to NUMA node.
+ * Pages that will be allocated later in this range are placed on the same node.
+ * @param address[in] start of memory range.
+ * @param size[in] size of memory range.
+ * @param node[in] node number.
+ * @return true if memory policy was applied.
+ */
+bool bind_memory(void* address, std::size_t size, unsigned int node);
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "AsyncWriter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <thread>
+
+/**
+ * Phase of client processing that is recorded as a span.
+ */
+enum class TracePhase : unsigned int
+{
+    accept,   //from async_accept dispatch to accepted connection;
+    receive,  //from async_receive dispatch to received data;
+    parse,    //ShuntingYard::parse call;
+    send      //from async_write dispatch to sent data.
+};
+
+/**
+ * This class implements lightweight sampled tracing of client processing.
+ *
+ * This class:
+ *   - keeps one ring buffer of spans per recording thread (the oldest spans are overwritten, see ThreadRings);
+ *   - doesn't lock or allocate memory in record() (except the first call in a thread);
+ *   - lets another thread read ring buffers while they are written (each span is guarded by a sequence number);
+ *   - dumps recorded spans as Chrome trace_event JSON (chrome://tracing, Perfetto).
+ *
+ * How to use it?
+ * Tracer tracer(100); //Trace each 100-th connection.
+ * bool sampled = tracer.sample();
+ * std::uint64_t start = Tracer::now();
+ * ... //do something
+ * if (sampled) tracer.record(TracePhase::parse, client_index, start, Tracer::now(), bytes);
+ * tracer.dump("trace.json");
+ */
+class Tracer
+{
+public:
+    /**
+     * @brief This method constructs Tracer.
+     * @param sample_rate_[in] each sample_rate_ connection is traced (0 means tracing is disabled).
+     */
+    explicit Tracer(unsigned int sample_rate_);
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    /** Is tracing enabled? */
+    bool is_enabled() const { return sample_rate != 0; }
+
+    /** Should next connection be traced? */
+    bool sample() { return is_enabled() && sample_counter.fetch_add(1, std::memory_order_relaxed) % sample_rate == 0; }
+
+    /** Current time in nanoseconds (steady clock). */
+    static std::uint64_t now();
+
+    /**
+     * @brief This method puts a span to the ring buffer of current thread.
+     * @param phase[in] phase of client processing.
+     * @param client_index[in] index of client.
+     * @param start[in] start time of span (Tracer::now()).
+     * @param end[in] end time of span (Tracer::now()).
+     * @param value[in] additional value of span (e.g. number of bytes).
+     */
+    void record(TracePhase phase, unsigned int client_index, std::uint64_t start, std::uint64_t end, long long value = 0);
+
+    /**
+     * @brief This method writes all recorded spans as Chrome trace_event JSON.
+     * It can be called while other threads record spans.
+     * @param s[in] output stream.
+     */
+    void dump(std::ostream& s);
+
+    /**
+     * @brief This method writes all recorded spans as Chrome trace_event JSON to a file.
+     * @param filename[in] name of output file.
+     * @return true if file was written.
+     */
+    bool dump(const std::string& filename);
+
+private:
+    /**
+     * Span is written by one thread and can be read by another one.
+     * 'sequence' is odd while span is written (seqlock), so reader can skip torn spans.
+     */
+    struct Span
+    {
+        std::atomic<std::uint64_t> sequence{0};
+        std::atomic<std::uint64_t> start{0};
+        std::atomic<std::uint64_t> end{0};
+        std::atomic<unsigned int> phase{0};
+        std::atomic<unsigned int> client_index{0};
+        std::atomic<long long> value{0};
+    };
+
+    struct RingBuffer
+    {
+        static const std::size_t capacity = 8192;
+
+        //Number of written spans (is changed by owner thread only).
+        std::atomic<std::uint64_t> head{0};
+        //Thread that writes spans to this buffer.
+        std::thread::id owner;
+        Span spans[capacity];
+    };
+
+private:
+    const unsigned int sample_rate;
+    std::atomic<unsigned long long> sample_counter{0};
+
+    //Ring buffers of recording threads.
+    ThreadRings<RingBuffer> ring_buffers;
+};
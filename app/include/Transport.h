@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <boost/asio.hpp>
+
+/**
+ * This class is an interface of transport of NetCalcCore connections.
+ *
+ * By default NetCalcCore uses sockets of its TCP and Unix domain socket listeners. If a transport is passed to
+ * NetCalcCore constructor, its dispatch methods start accept, receive and send operations of client slots through it,
+ * so handle_accept(), handle_receive(), parse_result() and handle_send() process the same way as for sockets.
+ *
+ * Transport must:
+ *   - call a handler once per operation and never inline: it is posted to io_service that is passed with operation;
+ *   - complete send operation after all data is transferred (like boost::asio::async_write);
+ *   - be thread-safe: operations of different client slots can be started by different threads.
+ */
+class Transport
+{
+public:
+    //Handler of async operation: error and number of transferred bytes (it is 0 for accept).
+    using Handler = std::function<void(const boost::system::error_code&, std::size_t)>;
+
+    virtual ~Transport() = default;
+
+    /**
+     * @brief Waits for a new connection of client slot.
+     * @param client_index[in] index of client slot of NetCalcCore.
+     * @param service[in] io_service of client slot (handler is posted to it).
+     * @param handler[in] handler of operation.
+     */
+    virtual void async_accept(unsigned int client_index, boost::asio::io_service& service, Handler handler) = 0;
+
+    /**
+     * @brief Receives at least one byte of connection of client slot.
+     * @param client_index[in] index of client slot of NetCalcCore.
+     * @param buffer[in] buffer for received data (it is valid until handler is called).
+     * @param size[in] size of buffer.
+     * @param service[in] io_service of client slot (handler is posted to it).
+     * @param handler[in] handler of operation.
+     */
+    virtual void async_receive(unsigned int client_index, char* buffer, std::size_t size, boost::asio::io_service& service, Handler handler) = 0;
+
+    /**
+     * @brief Sends all data to connection of client slot.
+     * @param client_index[in] index of client slot of NetCalcCore.
+     * @param data[in] data to send (it is valid until handler is called).
+     * @param size[in] size of data.
+     * @param service[in] io_service of client slot (handler is posted to it).
+     * @param handler[in] handler of operation.
+     */
+    virtual void async_send(unsigned int client_index, const char* data, std::size_t size, boost::asio::io_service& service, Handler handler) = 0;
+
+    /**
+     * @brief Shuts down connection of client slot: pending and next operations complete with error.
+     * It is called by timer thread for expired connection (see NetCalcCore::check_timeouts()).
+     * @param client_index[in] index of client slot of NetCalcCore.
+     */
+    virtual void shutdown(unsigned int client_index) = 0;
+
+    /**
+     * @brief Closes connection of client slot (it does nothing if slot has no connection).
+     * @param client_index[in] index of client slot of NetCalcCore.
+     */
+    virtual void close(unsigned int client_index) = 0;
+};
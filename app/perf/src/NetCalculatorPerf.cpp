@@ -0,0 +1,432 @@
+/**
+ * This file contains load generator that measures throughput and latency of NetCalculator application.
+ * Start NetCalculator application before this program.
+ *
+ * Each connection is served by its own thread:
+ *   - it sends an expression and waits for the result (closed loop);
+ *   - it measures time between sending of an expression and receiving of the result.
+ * Program prints throughput (requests per second) and latency percentiles.
+ *
+ * Optional bulk connections make a mixed workload: while latency is measured they stream huge expressions
+ * (one expression of 'bulk-size' KB after another) and their throughput is printed too.
+ * Optional pipeline connections send 'pipeline-depth' expressions by one write and then read all results.
+ * Connections use TCP, Unix domain socket or shared-memory sessions (ShmClient).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ShmClient.h>
+
+#include <boost/asio.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+struct PerfConfig
+{
+    //Server address.
+    std::string address;
+
+    //Server port.
+    unsigned short port;
+
+    //Path of server Unix domain socket (empty string means TCP is used).
+    std::string unix_socket;
+
+    //Name of server shared-memory segment (empty string means sockets are used).
+    std::string shm_name;
+
+    //Number of simultaneous connections.
+    unsigned int connections;
+
+    //Number of requests per connection.
+    unsigned int requests;
+
+    //Expression (without '\n').
+    std::string expression;
+
+    //Number of connections that stream huge expressions.
+    unsigned int bulk_connections;
+
+    //Size of one huge expression in KB.
+    unsigned int bulk_size;
+
+    //Number of connections that pipeline expressions.
+    unsigned int pipeline_connections;
+
+    //Number of expressions in one write of pipeline connection.
+    unsigned int pipeline_depth;
+};
+
+boost::optional<PerfConfig> get_perf_config(int argc, const char* const* argv)
+{
+    PerfConfig cfg{"127.0.0.1", 0, "", "", 1, 10000, "(2 + 3) * 7 / 11 - 53 * (17 - 19)", 0, 65536, 0, 1000};
+
+    po::options_description desc("NetCalculator load generator options");
+    desc.add_options()
+        ("help,h", "Show help")
+        ("address,a",     po::value<std::string>(&cfg.address),        "Server address (default value is 127.0.0.1)")
+        ("port,p",        po::value<unsigned short>(&cfg.port),        "Server port")
+        ("unix-socket,u", po::value<std::string>(&cfg.unix_socket),    "Path of server Unix domain socket (it is used instead of address and port)")
+        ("shm",           po::value<std::string>(&cfg.shm_name),       "Name of server shared-memory segment (it is used instead of sockets)")
+        ("connections,c", po::value<unsigned int>(&cfg.connections),   "Number of simultaneous connections (default value is 1)")
+        ("requests,n",    po::value<unsigned int>(&cfg.requests),      "Number of requests per connection (default value is 10000)")
+        ("expression,e",  po::value<std::string>(&cfg.expression),     "Expression (default value is '(2 + 3) * 7 / 11 - 53 * (17 - 19)')")
+        ("bulk-connections", po::value<unsigned int>(&cfg.bulk_connections), "Number of connections that stream huge expressions (default value is 0)")
+        ("bulk-size",        po::value<unsigned int>(&cfg.bulk_size),        "Size of huge expression in KB (default value is 65536)")
+        ("pipeline-connections", po::value<unsigned int>(&cfg.pipeline_connections), "Number of connections that pipeline expressions (default value is 0)")
+        ("pipeline-depth",       po::value<unsigned int>(&cfg.pipeline_depth),       "Number of expressions in one write of pipeline connection (default value is 1000)");
+
+    po::variables_map vm;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (...)
+    {
+        std::cout << "Invalid parameters." << std::endl << desc << std::endl;
+        return boost::none;
+    }
+
+    if (argc < 2 || vm.count("help") || (!vm.count("port") && cfg.unix_socket.empty() && cfg.shm_name.empty()) || !cfg.connections || !cfg.requests || !cfg.bulk_size || !cfg.pipeline_depth)
+    {
+        std::cout << desc << std::endl;
+        return boost::none;
+    }
+
+    return cfg;
+}
+
+/**
+ * This function connects socket to the server by TCP or Unix domain socket.
+ * @param cfg[in] configuration.
+ * @param socket[in] socket to connect.
+ * @return true if socket was connected.
+ */
+bool connect(const PerfConfig& cfg, boost::asio::generic::stream_protocol::socket& socket)
+{
+    boost::system::error_code ec;
+    if (cfg.unix_socket.empty())
+    {
+        socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(cfg.address), cfg.port), ec);
+        if (!ec)
+        {
+            socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+        }
+    }
+    else
+    {
+        socket.connect(boost::asio::local::stream_protocol::endpoint(cfg.unix_socket), ec);
+    }
+
+    if (ec)
+    {
+        std::cerr << "Could not connect to host: " << ec.message() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * This function sends cfg.requests expressions through one shared-memory session and stores latency of each one.
+ * @param cfg[in] configuration.
+ * @param latencies[out] latency of each request in nanoseconds.
+ * @return true if all requests were processed.
+ */
+bool run_shm_connection(const PerfConfig& cfg, std::vector<std::uint64_t>& latencies)
+{
+    ShmClient client(std::thread::hardware_concurrency() > 1 ? 50 : 0);
+    std::string error;
+    if (!client.attach(cfg.shm_name, error))
+    {
+        std::cerr << error << std::endl;
+        return false;
+    }
+
+    std::string result;
+    latencies.reserve(cfg.requests);
+    for (unsigned int i = 0; i < cfg.requests; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (!client.evaluate(cfg.expression, result))
+        {
+            std::cerr << "Request failed: server is stopped" << std::endl;
+            return false;
+        }
+
+        latencies.push_back(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+
+    return true;
+}
+
+/**
+ * This function sends cfg.requests expressions through one connection and stores latency of each one.
+ * @param cfg[in] configuration.
+ * @param latencies[out] latency of each request in nanoseconds.
+ * @return true if all requests were processed.
+ */
+bool run_connection(const PerfConfig& cfg, std::vector<std::uint64_t>& latencies)
+{
+    if (!cfg.shm_name.empty())
+    {
+        return run_shm_connection(cfg, latencies);
+    }
+
+    boost::asio::io_service service;
+    boost::asio::generic::stream_protocol::socket socket(service);
+    boost::system::error_code ec;
+
+    if (!connect(cfg, socket))
+    {
+        return false;
+    }
+
+    const std::string request = cfg.expression + "\n";
+    boost::asio::streambuf response;
+    latencies.reserve(cfg.requests);
+
+    for (unsigned int i = 0; i < cfg.requests; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        boost::asio::write(socket, boost::asio::buffer(request), ec);
+        if (!ec)
+        {
+            std::size_t n = boost::asio::read_until(socket, response, '\n', ec);
+            response.consume(n);
+        }
+
+        if (ec)
+        {
+            std::cerr << "Request failed: " << ec.message() << std::endl;
+            return false;
+        }
+
+        latencies.push_back(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+
+    return true;
+}
+
+/**
+ * This function streams huge expressions through one connection while 'done' is false.
+ * @param cfg[in] configuration.
+ * @param done[in] flag to stop.
+ * @param bytes[out] number of sent bytes of completed expressions.
+ * @return true if no error happened.
+ */
+bool run_bulk_connection(const PerfConfig& cfg, const std::atomic<bool>& done, std::atomic<unsigned long long>& bytes)
+{
+    boost::asio::io_service service;
+    boost::asio::generic::stream_protocol::socket socket(service);
+    boost::system::error_code ec;
+
+    if (!connect(cfg, socket))
+    {
+        return false;
+    }
+
+    //Chunk of expression: each term adds 1 to result.
+    const std::string term = "(2 * 3 - 5) + ";
+    std::string chunk;
+    while (chunk.size() + term.size() <= 64 * 1024)
+    {
+        chunk += term;
+    }
+
+    const unsigned long long expression_size = static_cast<unsigned long long>(cfg.bulk_size) * 1024;
+    boost::asio::streambuf response;
+    while (!done)
+    {
+        unsigned long long sent = 0;
+        while (!ec && !done && sent < expression_size)
+        {
+            sent += boost::asio::write(socket, boost::asio::buffer(chunk), ec);
+        }
+
+        if (done)
+        {
+            break;
+        }
+
+        boost::asio::write(socket, boost::asio::buffer("0\n", 2), ec);
+        if (!ec)
+        {
+            std::size_t n = boost::asio::read_until(socket, response, '\n', ec);
+            response.consume(n);
+        }
+
+        if (ec)
+        {
+            std::cerr << "Bulk request failed: " << ec.message() << std::endl;
+            return false;
+        }
+
+        bytes += sent + 2;
+    }
+
+    return true;
+}
+
+/**
+ * This function pipelines expressions through one connection while 'done' is false.
+ * @param cfg[in] configuration.
+ * @param done[in] flag to stop.
+ * @param expressions[out] number of evaluated expressions.
+ * @return true if no error happened.
+ */
+bool run_pipeline_connection(const PerfConfig& cfg, const std::atomic<bool>& done, std::atomic<unsigned long long>& expressions)
+{
+    boost::asio::io_service service;
+    boost::asio::generic::stream_protocol::socket socket(service);
+    boost::system::error_code ec;
+
+    if (!connect(cfg, socket))
+    {
+        return false;
+    }
+
+    std::string request;
+    for (unsigned int i = 0; i < cfg.pipeline_depth; ++i)
+    {
+        request += cfg.expression + "\n";
+    }
+
+    boost::asio::streambuf response;
+    while (!done)
+    {
+        boost::asio::write(socket, boost::asio::buffer(request), ec);
+        for (unsigned int i = 0; !ec && i < cfg.pipeline_depth; ++i)
+        {
+            std::size_t n = boost::asio::read_until(socket, response, '\n', ec);
+            response.consume(n);
+        }
+
+        if (ec)
+        {
+            std::cerr << "Pipeline request failed: " << ec.message() << std::endl;
+            return false;
+        }
+
+        expressions += cfg.pipeline_depth;
+    }
+
+    return true;
+}
+
+/**
+ * This function returns percentile of sorted values.
+ */
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, double p)
+{
+    std::size_t index = static_cast<std::size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, const char* argv[])
+{
+    boost::optional<PerfConfig> cfg = get_perf_config(argc, argv);
+    if (!cfg)
+    {
+        return 1;
+    }
+
+    std::vector<std::vector<std::uint64_t>> latencies(cfg->connections);
+    std::vector<char> results(cfg->connections, 0);
+    std::vector<std::thread> threads;
+
+    std::atomic<bool> done{false};
+    std::atomic<unsigned long long> bulk_bytes{0};
+    std::vector<std::thread> bulk_threads;
+    for (unsigned int i = 0; i < cfg->bulk_connections; ++i)
+    {
+        bulk_threads.push_back(std::thread([&cfg, &done, &bulk_bytes]()
+        {
+            run_bulk_connection(cfg.get(), done, bulk_bytes);
+        }));
+    }
+
+    std::atomic<unsigned long long> pipeline_expressions{0};
+    for (unsigned int i = 0; i < cfg->pipeline_connections; ++i)
+    {
+        bulk_threads.push_back(std::thread([&cfg, &done, &pipeline_expressions]()
+        {
+            run_pipeline_connection(cfg.get(), done, pipeline_expressions);
+        }));
+    }
+
+    //Let bulk and pipeline connections start streaming.
+    if (cfg->bulk_connections || cfg->pipeline_connections)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < cfg->connections; ++i)
+    {
+        threads.push_back(std::thread([&cfg, &latencies, &results, i]()
+        {
+            results[i] = run_connection(cfg.get(), latencies[i]) ? 1 : 0;
+        }));
+    }
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    //Bulk and pipeline connections are closed in the middle of a request.
+    done = true;
+    for (auto& t : bulk_threads)
+    {
+        t.join();
+    }
+
+    if (std::find(results.begin(), results.end(), 0) != results.end())
+    {
+        return 1;
+    }
+
+    std::vector<std::uint64_t> all;
+    for (auto& l : latencies)
+    {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << "Requests: " << all.size() << ", time: " << seconds * 1000.0 << " milliseconds, throughput: "
+              << static_cast<double>(all.size()) / seconds << " requests/s" << std::endl
+              << "Latency (microseconds): p50 " << percentile(all, 50) / 1000.0
+              << ", p90 " << percentile(all, 90) / 1000.0
+              << ", p99 " << percentile(all, 99) / 1000.0
+              << ", p99.9 " << percentile(all, 99.9) / 1000.0
+              << ", max " << all.back() / 1000.0 << std::endl;
+
+    if (cfg->bulk_connections)
+    {
+        std::cout << "Bulk connections: " << cfg->bulk_connections << ", completed expressions throughput: "
+                  << static_cast<double>(bulk_bytes) / seconds / 1024.0 / 1024.0 << " MB/s" << std::endl;
+    }
+
+    if (cfg->pipeline_connections)
+    {
+        std::cout << "Pipeline connections: " << cfg->pipeline_connections << ", throughput: "
+                  << static_cast<double>(pipeline_expressions) / seconds << " expressions/s" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,424 @@
+/**
+ * This file contains replay tool that pushes traffic captured by NetCalculator (see Capture, option --capture-file)
+ * into a running NetCalculator application.
+ *
+ * Each captured connection is opened, gets its chunks and is closed at captured times (divided by 'speed'),
+ * each chunk is sent by one write, so the server gets the same chunk boundaries (TCP_NODELAY is set).
+ * All connections are served by one thread with asynchronous operations.
+ *
+ * Latency of an expression is time between sending of chunk with its '\n' and receiving of its result line.
+ * Program prints number of replayed connections/chunks, chunks that were sent late (server didn't read data in time)
+ * and latency percentiles.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Capture.h>
+
+#include <boost/asio.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+using Clock = std::chrono::steady_clock;
+
+struct ReplayConfig
+{
+    //Server address.
+    std::string address;
+
+    //Server port.
+    unsigned short port;
+
+    //Path of server Unix domain socket (empty string means TCP is used).
+    std::string unix_socket;
+
+    //Capture file.
+    std::string capture_file;
+
+    //Captured times are divided by speed (0 means chunks are sent as fast as possible).
+    double speed;
+};
+
+boost::optional<ReplayConfig> get_replay_config(int argc, const char* const* argv)
+{
+    ReplayConfig cfg{"127.0.0.1", 0, "", "", 1.0};
+
+    po::options_description desc("NetCalculator replay options");
+    desc.add_options()
+        ("help,h", "Show help")
+        ("address,a",     po::value<std::string>(&cfg.address),      "Server address (default value is 127.0.0.1)")
+        ("port,p",        po::value<unsigned short>(&cfg.port),      "Server port")
+        ("unix-socket,u", po::value<std::string>(&cfg.unix_socket),  "Path of server Unix domain socket (it is used instead of address and port)")
+        ("capture,f",     po::value<std::string>(&cfg.capture_file), "Capture file (see --capture-file of NetCalculatorApp)")
+        ("speed,s",       po::value<double>(&cfg.speed),             "Replay speed: 1 is original speed, 10 is 10 times faster, 0 is as fast as possible (default value is 1)");
+
+    po::variables_map vm;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    }
+    catch (...)
+    {
+        std::cout << "Invalid parameters." << std::endl << desc << std::endl;
+        return boost::none;
+    }
+
+    if (argc < 2 || vm.count("help") || (!vm.count("port") && cfg.unix_socket.empty()) || cfg.capture_file.empty() || cfg.speed < 0)
+    {
+        std::cout << desc << std::endl;
+        return boost::none;
+    }
+
+    return cfg;
+}
+
+/**
+ * Counters of replay.
+ */
+struct ReplayStats
+{
+    unsigned long long connections = 0;
+    unsigned long long chunks = 0;
+    unsigned long long bytes = 0;
+    //Chunks that were sent more than 1 millisecond after their time.
+    unsigned long long late_chunks = 0;
+    //Expressions without result (server closed connection or replay failed).
+    unsigned long long unanswered = 0;
+    //Connections that were closed by server before the end of captured traffic (e.g. after error result).
+    unsigned long long closed_by_server = 0;
+    //Connections that could not be connected.
+    unsigned long long failed = 0;
+    //Latency of each result in nanoseconds.
+    std::vector<std::uint64_t> latencies;
+};
+
+/**
+ * This class replays records of one captured connection.
+ * Records are processed one after another: timer waits for time of record, chunk is written,
+ * then timer waits for the next record. Results are read all the time.
+ */
+class Session : public std::enable_shared_from_this<Session>
+{
+public:
+    Session(boost::asio::io_service& service, const ReplayConfig& cfg_, ReplayStats& stats_, Clock::time_point start_)
+        : cfg(cfg_), stats(stats_), start(start_), socket(service), timer(service)
+    {
+    }
+
+    /** Captured records of connection (data and close), they are owned by caller. */
+    std::vector<const CaptureRecord*> records;
+
+    /** Captured time of connection in microseconds since start of capture. */
+    std::uint64_t open_time = 0;
+
+    /** Starts replay: waits for time of connection. */
+    void run()
+    {
+        auto self = shared_from_this();
+        timer.expires_at(due(open_time));
+        timer.async_wait([self](const boost::system::error_code& error)
+        {
+            if (!error)
+            {
+                self->connect();
+            }
+        });
+    }
+
+private:
+    /** Converts captured time to time of replay. */
+    Clock::time_point due(std::uint64_t time) const
+    {
+        if (cfg.speed == 0)
+        {
+            return start;
+        }
+        return start + std::chrono::microseconds(static_cast<std::uint64_t>(static_cast<double>(time) / cfg.speed));
+    }
+
+    void connect()
+    {
+        boost::system::error_code ec;
+        if (cfg.unix_socket.empty())
+        {
+            socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(cfg.address), cfg.port), ec);
+            if (!ec)
+            {
+                socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+            }
+        }
+        else
+        {
+            socket.connect(boost::asio::local::stream_protocol::endpoint(cfg.unix_socket), ec);
+        }
+
+        if (ec)
+        {
+            std::cerr << "Could not connect to host: " << ec.message() << std::endl;
+            ++stats.failed;
+            stop();
+            return;
+        }
+
+        ++stats.connections;
+        read();
+        next();
+    }
+
+    /** Waits for time of the next record. */
+    void next()
+    {
+        if (index == records.size())
+        {
+            //Capture ends without 'close' record (server was stopped), connection is closed after results.
+            closing = true;
+            finish();
+            return;
+        }
+
+        auto self = shared_from_this();
+        timer.expires_at(due(records[index]->time));
+        timer.async_wait([self](const boost::system::error_code& error)
+        {
+            if (!error && !self->done)
+            {
+                self->process();
+            }
+        });
+    }
+
+    /** Processes record whose time has come. */
+    void process()
+    {
+        const CaptureRecord& record = *records[index++];
+        if (record.kind == CaptureKind::close)
+        {
+            closing = true;
+            finish();
+            return;
+        }
+
+        const Clock::time_point now = Clock::now();
+        if (now - due(record.time) > std::chrono::milliseconds(1) && cfg.speed != 0)
+        {
+            ++stats.late_chunks;
+        }
+
+        ++stats.chunks;
+        stats.bytes += record.data.size();
+        for (std::size_t i = std::count(record.data.begin(), record.data.end(), '\n'); i; --i)
+        {
+            sent.push_back(now);
+        }
+
+        auto self = shared_from_this();
+        boost::asio::async_write(socket, boost::asio::buffer(record.data),
+            [self](const boost::system::error_code& error, std::size_t)
+            {
+                if (error)
+                {
+                    self->close_by_server();
+                    return;
+                }
+                self->next();
+            });
+    }
+
+    /** Reads results and matches them with sent expressions. */
+    void read()
+    {
+        auto self = shared_from_this();
+        socket.async_read_some(boost::asio::buffer(buffer),
+            [self](const boost::system::error_code& error, std::size_t bytes_transferred)
+            {
+                if (error)
+                {
+                    //Server closes connection after error result (or replay closed it).
+                    self->close_by_server();
+                    return;
+                }
+
+                const Clock::time_point now = Clock::now();
+                for (std::size_t i = 0; i < bytes_transferred; ++i)
+                {
+                    if (self->buffer[i] == '\n' && !self->sent.empty())
+                    {
+                        self->stats.latencies.push_back(static_cast<std::uint64_t>(
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(now - self->sent.front()).count()));
+                        self->sent.pop_front();
+                    }
+                }
+
+                self->finish();
+                if (!self->done)
+                {
+                    self->read();
+                }
+            });
+    }
+
+    /** Closes connection after 'close' record when all results are received. */
+    void finish()
+    {
+        if (closing && sent.empty() && !done)
+        {
+            done = true;
+            boost::system::error_code ec;
+            socket.close(ec);
+        }
+    }
+
+    /** Counts connection that was closed by server before the end of its records. */
+    void close_by_server()
+    {
+        if (!done && (!closing || !sent.empty()))
+        {
+            ++stats.closed_by_server;
+        }
+        stop();
+    }
+
+    /** Stops replay of connection, its expressions without results are counted. */
+    void stop()
+    {
+        if (done)
+        {
+            return;
+        }
+
+        done = true;
+        stats.unanswered += sent.size();
+        for (; index != records.size(); ++index)
+        {
+            const std::string& data = records[index]->data;
+            stats.unanswered += static_cast<unsigned long long>(std::count(data.begin(), data.end(), '\n'));
+        }
+
+        boost::system::error_code ec;
+        timer.cancel(ec);
+        socket.close(ec);
+    }
+
+private:
+    const ReplayConfig& cfg;
+    ReplayStats& stats;
+    const Clock::time_point start;
+
+    boost::asio::generic::stream_protocol::socket socket;
+    boost::asio::steady_timer timer;
+    char buffer[8192];
+
+    //Index of the next record.
+    std::size_t index = 0;
+
+    //Send times of expressions that wait for results.
+    std::deque<Clock::time_point> sent;
+
+    //'close' record was processed.
+    bool closing = false;
+
+    //Connection is closed.
+    bool done = false;
+};
+
+/**
+ * This function returns percentile of sorted values.
+ */
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, double p)
+{
+    std::size_t index = static_cast<std::size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, const char* argv[])
+{
+    boost::optional<ReplayConfig> cfg = get_replay_config(argc, argv);
+    if (!cfg)
+    {
+        return 1;
+    }
+
+    std::vector<CaptureRecord> records;
+    std::string error;
+    if (!Capture::read(cfg->capture_file, records, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (!error.empty())
+    {
+        std::cerr << error << ", the rest of records are replayed." << std::endl;
+    }
+
+    boost::asio::io_service service;
+    ReplayStats stats;
+    const Clock::time_point start = Clock::now();
+
+    //Records are sorted by time, so each session gets its records in captured order.
+    std::map<std::uint64_t, std::shared_ptr<Session>> sessions;
+    unsigned long long lost = 0;
+    for (const CaptureRecord& record : records)
+    {
+        if (record.kind == CaptureKind::lost)
+        {
+            lost += record.value;
+            continue;
+        }
+
+        std::shared_ptr<Session>& session = sessions[record.connection];
+        if (!session)
+        {
+            session = std::make_shared<Session>(service, cfg.get(), stats, start);
+            session->open_time = record.time;
+        }
+        if (record.kind != CaptureKind::open)
+        {
+            session->records.push_back(&record);
+        }
+    }
+
+    if (lost)
+    {
+        std::cerr << lost << " records were lost by capture, affected connections can get other results." << std::endl;
+    }
+
+    for (auto& session : sessions)
+    {
+        session.second->run();
+    }
+    sessions.clear();
+    service.run();
+    const Clock::time_point end = Clock::now();
+
+    const double capture_seconds = records.empty() ? 0.0 : static_cast<double>(records.back().time - records.front().time) / 1e6;
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << "Connections: " << stats.connections << ", chunks: " << stats.chunks << ", bytes: " << stats.bytes
+              << ", late chunks: " << stats.late_chunks << ", closed by server: " << stats.closed_by_server
+              << ", failed connections: " << stats.failed << std::endl
+              << "Time: " << seconds * 1000.0 << " milliseconds (captured " << capture_seconds * 1000.0 << " milliseconds)"
+              << ", results: " << stats.latencies.size() << ", unanswered expressions: " << stats.unanswered << std::endl;
+
+    std::vector<std::uint64_t>& all = stats.latencies;
+    if (!all.empty())
+    {
+        std::sort(all.begin(), all.end());
+        std::cout << "Latency (microseconds): p50 " << percentile(all, 50) / 1000.0
+                  << ", p90 " << percentile(all, 90) / 1000.0
+                  << ", p99 " << percentile(all, 99) / 1000.0
+                  << ", p99.9 " << percentile(all, 99.9) / 1000.0
+                  << ", max " << all.back() / 1000.0 << std::endl;
+    }
+
+    return stats.failed ? 1 : 0;
+}
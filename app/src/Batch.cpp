@@ -0,0 +1,276 @@
+#include "Batch.h"
+
+#include <ShuntingYard.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+using ShuntingYardInt = ShuntingYard<int, ShuntingYardSyntax, ShuntingYardChecked>;
+
+/**
+ * Read-only memory mapping of a file (it is unmapped in destructor).
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        if (data)
+        {
+            munmap(const_cast<char*>(data), size);
+        }
+    }
+
+    /**
+     * @brief Maps whole file into memory.
+     * @param filename[in] name of file.
+     * @param error[out] description of error.
+     * @return true if file was mapped (empty file is not mapped, but it is not an error).
+     */
+    bool open(const std::string& filename, std::string& error)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            error = "Could not open input file '" + filename + "': " + std::strerror(errno);
+            return false;
+        }
+
+        struct stat st;
+        bool result = fstat(fd, &st) == 0;
+        if (result && st.st_size > 0)
+        {
+            void* address = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            result = address != MAP_FAILED;
+            if (result)
+            {
+                data = static_cast<const char*>(address);
+                size = static_cast<std::size_t>(st.st_size);
+                madvise(address, size, MADV_SEQUENTIAL);
+            }
+        }
+
+        if (!result)
+        {
+            error = "Could not map input file '" + filename + "': " + std::strerror(errno);
+        }
+
+        ::close(fd);
+        return result;
+    }
+
+    const char* data = nullptr;
+    std::size_t size = 0;
+};
+
+/**
+ * Part of input file [begin, end) that ends with '\n' (except the last one) and its results.
+ */
+struct Chunk
+{
+    const char* begin;
+    const char* end;
+    std::string results;
+    unsigned long long expressions;
+    unsigned long long errors;
+    bool ready;
+};
+
+/**
+ * This function splits data into chunks of about chunk_size bytes at '\n' boundaries.
+ */
+std::vector<Chunk> split(const char* data, std::size_t size, std::size_t chunk_size)
+{
+    std::vector<Chunk> chunks;
+    const char* end = data + size;
+    const char* begin = data;
+    while (begin != end)
+    {
+        const char* chunk_end = begin + std::min(chunk_size ? chunk_size : 1, static_cast<std::size_t>(end - begin));
+        if (chunk_end != end && chunk_end[-1] != '\n')
+        {
+            const char* eol = static_cast<const char*>(std::memchr(chunk_end, '\n', static_cast<std::size_t>(end - chunk_end)));
+            chunk_end = eol ? eol + 1 : end;
+        }
+
+        chunks.push_back(Chunk{begin, chunk_end, {}, 0, 0, false});
+        begin = chunk_end;
+    }
+
+    return chunks;
+}
+
+/**
+ * This function evaluates expressions of chunk (one per line) and puts their results to chunk.results.
+ * int32 expressions are evaluated by shunting_yard, other types by evaluator (it is null for int32).
+ */
+void evaluate_chunk(ShuntingYardInt& shunting_yard, Evaluator* evaluator, Chunk& chunk)
+{
+    auto parse = [&shunting_yard, evaluator, &chunk](const char* s, std::size_t len)
+    {
+        return evaluator ? evaluator->parse(s, len, chunk.results) : append_result(shunting_yard.parse(s, len), chunk.results);
+    };
+
+    //Result is rarely longer than expression, so reserve size of input.
+    chunk.results.reserve(static_cast<std::size_t>(chunk.end - chunk.begin));
+
+    const char* begin = chunk.begin;
+    while (begin != chunk.end)
+    {
+        const char* eol = static_cast<const char*>(std::memchr(begin, '\n', static_cast<std::size_t>(chunk.end - begin)));
+        const char* end = eol ? eol + 1 : chunk.end;
+
+        EvaluationStatus status = parse(begin, static_cast<std::size_t>(end - begin));
+        if (!eol && status == EvaluationStatus::Incomplete)
+        {
+            //The last expression of file doesn't have '\n'.
+            status = parse("\n", 1);
+        }
+
+        switch (status)
+        {
+            case EvaluationStatus::Success:
+                break;
+            case EvaluationStatus::Incomplete:
+                //'\n' always finishes an expression, it can't happen.
+                if (evaluator)
+                {
+                    evaluator->clear();
+                }
+                shunting_yard.clear();
+                chunk.results += "Invalid expression\n";
+                ++chunk.errors;
+                break;
+            case EvaluationStatus::Error:
+                ++chunk.errors;
+                break;
+        }
+
+        ++chunk.expressions;
+        begin = end;
+    }
+}
+} //nameless namespace
+
+bool evaluate_batch(const std::string& input_file, const std::string& output_file, unsigned int threads,
+    NumericType type, std::uint64_t modulus, BatchStats& stats, std::size_t chunk_size /*= 4 * 1024 * 1024*/)
+{
+    auto start = std::chrono::steady_clock::now();
+    stats = BatchStats();
+
+    MappedFile input;
+    if (!input.open(input_file, stats.error))
+    {
+        return false;
+    }
+
+    std::FILE* output = std::fopen(output_file.c_str(), "wb");
+    if (!output)
+    {
+        stats.error = "Could not open output file '" + output_file + "': " + std::strerror(errno);
+        return false;
+    }
+
+    std::vector<Chunk> chunks = split(input.data, input.size, chunk_size);
+    threads = std::max(1u, std::min(threads, static_cast<unsigned int>(chunks.size())));
+
+    //Workers evaluate at most 'window' chunks ahead of the written one.
+    const std::size_t window = 2 * static_cast<std::size_t>(threads);
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t written = 0;
+    bool stopped = false;
+    std::atomic<std::size_t> next_chunk{0};
+
+    auto worker = [&]()
+    {
+        ShuntingYardInt shunting_yard;
+        std::unique_ptr<Evaluator> evaluator = type == NumericType::int32 ? nullptr : make_evaluator(type, modulus);
+        for (std::size_t i = next_chunk++; i < chunks.size(); i = next_chunk++)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return stopped || i < written + window; });
+                if (stopped)
+                {
+                    return;
+                }
+            }
+
+            evaluate_chunk(shunting_yard, evaluator.get(), chunks[i]);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            chunks[i].ready = true;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads && !chunks.empty(); ++i)
+    {
+        workers.push_back(std::thread(worker));
+    }
+
+    //Write results in input order.
+    bool result = true;
+    for (Chunk& chunk : chunks)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&chunk]() { return chunk.ready; });
+        }
+
+        if (std::fwrite(chunk.results.data(), 1, chunk.results.size(), output) != chunk.results.size())
+        {
+            stats.error = "Could not write output file '" + output_file + "': " + std::strerror(errno);
+            result = false;
+        }
+
+        stats.expressions += chunk.expressions;
+        stats.errors += chunk.errors;
+        std::string().swap(chunk.results);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ++written;
+        stopped = !result;
+        cv.notify_all();
+        if (stopped)
+        {
+            break;
+        }
+    }
+
+    for (auto& t : workers)
+    {
+        t.join();
+    }
+
+    if (std::fclose(output) != 0 && result)
+    {
+        stats.error = "Could not write output file '" + output_file + "': " + std::strerror(errno);
+        result = false;
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
@@ -0,0 +1,196 @@
+#include "Capture.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+const char magic[8] = {'N', 'C', 'C', 'A', 'P', '0', '0', '1'};
+
+//Kind, time, connection and size: 1 + 3 varints of at most 10 bytes.
+const std::size_t max_header_size = 31;
+
+/** Appends LEB128 varint to buffer and returns its end. */
+char* put_varint(char* it, std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *it++ = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    *it++ = static_cast<char>(value);
+    return it;
+}
+
+/** Reads LEB128 varint, returns false if data ends before it. */
+bool get_varint(const char*& it, const char* end, std::uint64_t& value)
+{
+    value = 0;
+    for (unsigned int shift = 0; it != end && shift < 64; shift += 7)
+    {
+        const unsigned char byte = static_cast<unsigned char>(*it++);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+} //nameless namespace
+
+Capture::Capture(const std::string& filename)
+    : start(std::chrono::steady_clock::now()),
+      file(nullptr),
+      writer(*this)
+{
+    if (filename.empty())
+    {
+        return;
+    }
+
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file)
+    {
+        std::fprintf(stderr, "Could not open capture file '%s', capture is disabled.\n", filename.c_str());
+        return;
+    }
+
+    std::fwrite(magic, 1, sizeof(magic), file);
+    writer.start(file);
+}
+
+Capture::~Capture()
+{
+    writer.stop();
+
+    if (file)
+    {
+        std::fclose(file);
+    }
+}
+
+std::uint64_t Capture::open()
+{
+    std::uint64_t connection = ++connections;
+    write(CaptureKind::open, connection, nullptr, 0);
+    return connection;
+}
+
+void Capture::data(std::uint64_t connection, const char* data, std::size_t size)
+{
+    write(CaptureKind::data, connection, data, size);
+}
+
+void Capture::close(std::uint64_t connection)
+{
+    write(CaptureKind::close, connection, nullptr, 0);
+}
+
+void Capture::write(CaptureKind kind, std::uint64_t connection, const char* data, std::size_t size)
+{
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    char header[max_header_size];
+    char* header_end = header;
+    *header_end++ = static_cast<char>(kind);
+    header_end = put_varint(header_end, now());
+    header_end = put_varint(header_end, connection);
+    header_end = put_varint(header_end, size);
+    const std::size_t header_size = static_cast<std::size_t>(header_end - header);
+
+    writer.push(header, header_size, data, size);
+}
+
+void Capture::flush()
+{
+    writer.flush();
+}
+
+void Capture::format(const char* bytes, std::size_t n, std::string& output)
+{
+    output.append(bytes, n);
+}
+
+void Capture::format_dropped(std::uint64_t dropped, std::string& output)
+{
+    char record[max_header_size];
+    char* end = record;
+    *end++ = static_cast<char>(CaptureKind::lost);
+    end = put_varint(end, now());
+    end = put_varint(end, 0);
+    end = put_varint(end, dropped);
+    output.append(record, static_cast<std::size_t>(end - record));
+}
+
+bool Capture::format_pending(std::string& /*output*/)
+{
+    return false;
+}
+
+std::uint64_t Capture::now() const
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+bool Capture::read(const std::string& filename, std::vector<CaptureRecord>& records, std::string& error)
+{
+    std::FILE* f = std::fopen(filename.c_str(), "rb");
+    if (!f)
+    {
+        error = "Could not open capture file '" + filename + "'";
+        return false;
+    }
+
+    std::string content;
+    char buffer[64 * 1024];
+    for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), f)) != 0;)
+    {
+        content.append(buffer, n);
+    }
+    std::fclose(f);
+
+    if (content.size() < sizeof(magic) || std::memcmp(content.data(), magic, sizeof(magic)) != 0)
+    {
+        error = "File '" + filename + "' is not a capture file";
+        return false;
+    }
+
+    records.clear();
+    const char* it = content.data() + sizeof(magic);
+    const char* end = content.data() + content.size();
+    while (it != end)
+    {
+        CaptureRecord record{static_cast<CaptureKind>(*it++), 0, 0, 0, {}};
+        std::uint64_t size = 0;
+        if (static_cast<unsigned char>(record.kind) > static_cast<unsigned char>(CaptureKind::lost) ||
+            !get_varint(it, end, record.time) || !get_varint(it, end, record.connection) || !get_varint(it, end, size) ||
+            (record.kind == CaptureKind::data && size > static_cast<std::uint64_t>(end - it)))
+        {
+            //The last record can be incomplete if server was killed, previous records are valid.
+            error = "Capture file '" + filename + "' is truncated";
+            break;
+        }
+
+        if (record.kind == CaptureKind::data)
+        {
+            record.data.assign(it, static_cast<std::size_t>(size));
+            it += size;
+        }
+        else
+        {
+            record.value = size;
+        }
+        records.push_back(std::move(record));
+    }
+
+    //Handlers of one connection are serialized, so its records have increasing times (stable sort keeps order of
+    //records with equal time).
+    std::stable_sort(records.begin(), records.end(),
+        [](const CaptureRecord& a, const CaptureRecord& b) { return a.time < b.time; });
+    return true;
+}
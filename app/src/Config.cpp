@@ -1,18 +1,56 @@
 #include "Config.h"
+#include "Topology.h"
 
 #include <functional>
 #include <iostream>
 #include <thread>
+#include <vector>
 
 #include <boost/program_options.hpp>
 #include <boost/asio.hpp>
 
+#include <sys/un.h>
+
 namespace
 {
 using Address = decltype(Config::address);
 using Port    = decltype(Config::port);
 using Clients = decltype(Config::clients);
 using Threads = decltype(Config::threads);
+using LogLevelType  = decltype(Config::log_level);
+using LogSample     = decltype(Config::log_sample);
+using LogFile       = decltype(Config::log_file);
+using TraceSample   = decltype(Config::trace_sample);
+using TraceFile     = decltype(Config::trace_file);
+using Cpus          = decltype(Config::cpus);
+using BusyPoll      = decltype(Config::busy_poll);
+using BulkThreads   = decltype(Config::bulk_threads);
+using HeavyBytes    = decltype(Config::heavy_bytes);
+using HeavyTime     = decltype(Config::heavy_parse_time);
+using BulkBudget    = decltype(Config::bulk_budget);
+using TurnExpressions = decltype(Config::turn_expressions);
+using TurnBytes       = decltype(Config::turn_bytes);
+using UnixSocket      = decltype(Config::unix_socket);
+using ShmName         = decltype(Config::shm_name);
+using ShmSessions     = decltype(Config::shm_sessions);
+using ShmRingSize     = decltype(Config::shm_ring_size);
+using Timeout         = decltype(Config::idle_timeout);
+using ReceiveRate     = decltype(Config::min_receive_rate);
+using RateLimit       = decltype(Config::rate_expressions);
+using ShedLag         = decltype(Config::shed_lag);
+using ParallelThreads = decltype(Config::parallel_threads);
+using ParallelChunk   = decltype(Config::parallel_chunk);
+using Pipelines       = decltype(Config::pipelines);
+using Type            = decltype(Config::type);
+using Modulus         = decltype(Config::modulus);
+using SlowExpression  = decltype(Config::slow_expression);
+using SlowLogRate     = decltype(Config::slow_log_rate);
+using CaptureFile     = decltype(Config::capture_file);
+using Sessions        = decltype(Config::sessions);
+using SessionTimeout  = decltype(Config::session_timeout);
+using HandoffSocket   = decltype(Config::handoff_socket);
+using DrainTimeout    = decltype(Config::drain_timeout);
+using BatchFiles      = std::vector<std::string>;
 namespace po = boost::program_options;
 
 /**
@@ -29,7 +67,44 @@ po::options_description make_description(Config& default_config)
         ("address,a", po::value<Address>(&default_config.address), "Listen address (default value is 127.0.0.1)")
         ("port,p",    po::value<Port>   (&default_config.port),    "Listen port")
         ("clients,c", po::value<Clients>(&default_config.clients), "Maximum number of simultaneous clients")
-        ("threads,t", po::value<Threads>(&default_config.threads), "Number of threads (default value is hardware_concurrency() (1 if not computable))");
+        ("threads,t", po::value<Threads>(&default_config.threads), "Number of threads (default value is hardware_concurrency() (1 if not computable))")
+        ("log-level",  po::value<LogLevelType>(&default_config.log_level),  "Log level: none, error, info or debug (default value is error)")
+        ("log-sample", po::value<LogSample>   (&default_config.log_sample), "Log connection-level records of each N-th connection (default value is 1)")
+        ("log-file",   po::value<LogFile>     (&default_config.log_file),   "Log file (default value is stderr)")
+        ("trace-sample", po::value<TraceSample>(&default_config.trace_sample), "Trace each N-th connection, SIGUSR1 dumps trace (default value is 0, tracing is disabled)")
+        ("trace-file",   po::value<TraceFile>  (&default_config.trace_file),   "File for Chrome trace (default value is NetCalculatorTrace.json)")
+        ("cpus",         po::value<Cpus>       (&default_config.cpus),         "Pin event loop threads to CPUs: none, auto (spread over NUMA nodes) or CPU list like 0-3,8 (default value is none)")
+        ("busy-poll",    po::value<BusyPoll>   (&default_config.busy_poll),    "Event loop threads spin up to N microseconds before blocking (default value is 0, disabled)")
+        ("so-busy-poll", po::value<BusyPoll>   (&default_config.so_busy_poll), "Set SO_BUSY_POLL to N microseconds for accepted connections (default value is 0, disabled)")
+        ("bulk-threads",     po::value<BulkThreads>(&default_config.bulk_threads),     "Number of threads that parse expressions of heavy connections (default value is 0, heavy connections are not isolated)")
+        ("heavy-bytes",      po::value<HeavyBytes> (&default_config.heavy_bytes),      "Connection is heavy if its expression is longer than N bytes (default value is 65536, 0 disables check)")
+        ("heavy-parse-time", po::value<HeavyTime>  (&default_config.heavy_parse_time), "Connection is heavy if one parse takes more than N microseconds (default value is 1000, 0 disables check)")
+        ("bulk-budget",      po::value<BulkBudget> (&default_config.bulk_budget),      "Heavy connection parses at most N bytes per turn (default value is 4096, 0 means no limit)")
+        ("turn-expressions", po::value<TurnExpressions>(&default_config.turn_expressions), "Connection evaluates at most N pipelined expressions per turn (default value is 16, 0 means no limit)")
+        ("turn-bytes",       po::value<TurnBytes>      (&default_config.turn_bytes),       "Connection parses at most N bytes of pipelined expressions per turn (default value is 4096, 0 means no limit)")
+        ("unix-socket", po::value<UnixSocket>(&default_config.unix_socket), "Also listen on Unix domain socket with this path (port is optional with it, default value is '', disabled)")
+        ("shm-name",      po::value<ShmName>    (&default_config.shm_name),      "Serve same-host clients through shared-memory segment with this name (default value is '', disabled)")
+        ("shm-sessions",  po::value<ShmSessions>(&default_config.shm_sessions),  "Number of shared-memory sessions (default value is 4)")
+        ("shm-ring-size", po::value<ShmRingSize>(&default_config.shm_ring_size), "Size of shared-memory ring in bytes, power of two >= 4096 (default value is 65536)")
+        ("idle-timeout",       po::value<Timeout>    (&default_config.idle_timeout),       "Close connection that is idle for N milliseconds (default value is 0, disabled)")
+        ("expression-timeout", po::value<Timeout>    (&default_config.expression_timeout), "Close connection that doesn't complete expression within N milliseconds (default value is 0, disabled)")
+        ("min-receive-rate",   po::value<ReceiveRate>(&default_config.min_receive_rate),   "Close connection that sends incomplete expression slower than N bytes per second (default value is 0, disabled)")
+        ("rate-expressions", po::value<RateLimit>(&default_config.rate_expressions), "Connection evaluates at most N expressions per second (default value is 0, no limit)")
+        ("rate-bytes",       po::value<RateLimit>(&default_config.rate_bytes),       "Connection receives at most N bytes per second (default value is 0, no limit)")
+        ("shed-lag",         po::value<ShedLag>  (&default_config.shed_lag),         "Reply 'Server busy' to new expressions while event loop lag exceeds N microseconds (default value is 0, disabled)")
+        ("parallel-threads", po::value<ParallelThreads>(&default_config.parallel_threads), "Number of threads that evaluate pipelined expressions of one connection in parallel (default value is 0, disabled)")
+        ("parallel-chunk",   po::value<ParallelChunk>  (&default_config.parallel_chunk),   "Minimum size of pipelined expressions evaluated by one parallel thread in bytes (default value is 1024)")
+        ("pipelines",        po::value<Pipelines>      (&default_config.pipelines),        "Number of pipelines that evaluate expressions of heavy connections while bulk threads tokenize them (default value is 0, disabled)")
+        ("type",             po::value<Type>           (&default_config.type),             "Numeric type of expressions of connections (a connection can select its own by #type command): int32, int64, checked_int64, bigint, float64 or mod64 (default value is int32)")
+        ("modulus",          po::value<Modulus>        (&default_config.modulus),          "Modulus of expressions of mod64 type (default value is 18446744073709551557)")
+        ("slow-expression",  po::value<SlowExpression> (&default_config.slow_expression),  "Log expressions that take at least N microseconds with level info (default value is 0, disabled)")
+        ("slow-log-rate",    po::value<SlowLogRate>    (&default_config.slow_log_rate),    "Log at most N slow expressions per second (default value is 10)")
+        ("capture-file",     po::value<CaptureFile>    (&default_config.capture_file),     "Capture received chunks of connections with timestamps to this file for NetCalculatorAppReplay (default value is '', disabled)")
+        ("sessions",         po::value<Sessions>       (&default_config.sessions),         "Maximum number of resumable sessions of huge streamed expressions (default value is 0, disabled)")
+        ("session-timeout",  po::value<SessionTimeout> (&default_config.session_timeout),  "Drop session that has no connection for N milliseconds (default value is 60000)")
+        ("handoff-socket",   po::value<HandoffSocket>  (&default_config.handoff_socket),   "Unix domain socket of hot restart: take over listening sockets and idle connections of the process that listens on it, then listen on it for the next restart (default value is '', disabled)")
+        ("drain-timeout",    po::value<DrainTimeout>   (&default_config.drain_timeout),    "Exit after N milliseconds at most when connections are handed over to a new process (default value is 30000)")
+        ("batch", po::value<BatchFiles>()->multitoken(), "Evaluate expressions of input file to output file by 'threads' threads and exit: --batch <input> <output>");
 
     return desc;
 }
@@ -100,26 +175,70 @@ boost::optional<Config> get_config(int argc, const char* const* argv)
         return empty_result;
     }
 
+    //Batch mode doesn't serve connections, so it doesn't need port and clients.
+    if (vm.get().count("batch"))
+    {
+        const BatchFiles& files = vm.get()["batch"].as<BatchFiles>();
+        if (files.size() != 2)
+        {
+            std::cout << "Parameter 'batch' needs input and output files." << std::endl;
+            return empty_result;
+        }
+
+        default_config.batch_input = files[0];
+        default_config.batch_output = files[1];
+    }
+    const bool server_mode = default_config.batch_input.empty();
+    const bool port_needed = server_mode && default_config.unix_socket.empty();
+    const bool port_provided = vm.get().count("port") != 0;
+
     //Check correctness of provided parameters and print error message for incorrect arguments.
     bool incomplete = !check_param<Address>("address", default_config.address, false, vm.get(),
         [](Address value) { return check_ipv4_address(value.c_str()); }, "Parameter 'address' is invalid");
-    incomplete = incomplete || !check_param<Port>("port", default_config.port, true, vm.get(),
-        [](Port value) { return value >= 1024; }, "Parameter 'port' must be >= 1024.");
-    incomplete = incomplete || !check_param<Clients>("clients", default_config.clients, true, vm.get(),
-        [](Clients value) { return value > 0; }, "Parameter 'clients' must be positive.");
+    incomplete = incomplete || !check_param<Port>("port", default_config.port, port_needed, vm.get(),
+        [port_provided](Port value) { return value >= 1024 || !port_provided; }, "Parameter 'port' must be >= 1024.");
+    incomplete = incomplete || !check_param<Clients>("clients", default_config.clients, server_mode, vm.get(),
+        [server_mode](Clients value) { return value > 0 || !server_mode; }, "Parameter 'clients' must be positive.");
     incomplete = incomplete || !check_param<Threads>("threads", default_config.threads, false, vm.get(),
         [](Threads value) { return value > 0; }, "Parameter 'threads' must be positive.");
+    incomplete = incomplete || !check_param<LogSample>("log-sample", default_config.log_sample, false, vm.get(),
+        [](LogSample value) { return value > 0; }, "Parameter 'log-sample' must be positive.");
+    incomplete = incomplete || !check_param<UnixSocket>("unix-socket", default_config.unix_socket, false, vm.get(),
+        [](UnixSocket value) { return value.size() < sizeof(sockaddr_un::sun_path); }, "Parameter 'unix-socket' is too long.");
+    incomplete = incomplete || !check_param<ShmName>("shm-name", default_config.shm_name, false, vm.get(),
+        [](ShmName value) { return value.find('/') == std::string::npos && value.size() < 200; }, "Parameter 'shm-name' is invalid.");
+    incomplete = incomplete || !check_param<ShmSessions>("shm-sessions", default_config.shm_sessions, false, vm.get(),
+        [](ShmSessions value) { return value > 0; }, "Parameter 'shm-sessions' must be positive.");
+    incomplete = incomplete || !check_param<ShmRingSize>("shm-ring-size", default_config.shm_ring_size, false, vm.get(),
+        [](ShmRingSize value) { return value >= 4096 && !(value & (value - 1)); }, "Parameter 'shm-ring-size' must be power of two >= 4096.");
+    incomplete = incomplete || !check_param<ParallelChunk>("parallel-chunk", default_config.parallel_chunk, false, vm.get(),
+        [](ParallelChunk value) { return value > 0; }, "Parameter 'parallel-chunk' must be positive.");
+    incomplete = incomplete || !check_param<Modulus>("modulus", default_config.modulus, false, vm.get(),
+        [](Modulus value) { return value >= 2; }, "Parameter 'modulus' must be >= 2.");
+    incomplete = incomplete || !check_param<SlowLogRate>("slow-log-rate", default_config.slow_log_rate, false, vm.get(),
+        [](SlowLogRate value) { return value > 0; }, "Parameter 'slow-log-rate' must be positive.");
+    incomplete = incomplete || !check_param<SessionTimeout>("session-timeout", default_config.session_timeout, false, vm.get(),
+        [](SessionTimeout value) { return value > 0; }, "Parameter 'session-timeout' must be positive.");
+    incomplete = incomplete || !check_param<HandoffSocket>("handoff-socket", default_config.handoff_socket, false, vm.get(),
+        [](HandoffSocket value) { return value.size() < sizeof(sockaddr_un::sun_path); }, "Parameter 'handoff-socket' is too long.");
+    incomplete = incomplete || !check_param<Cpus>("cpus", default_config.cpus, false, vm.get(),
+        [](Cpus value) { return value == "none" || value == "auto" || parse_cpu_list(value); }, "Parameter 'cpus' is invalid.");
 
     if (incomplete)
     {
         return empty_result;
     }
-    else if (default_config.clients < default_config.threads)
+    else if (server_mode && default_config.clients < default_config.threads)
     {
         std::cout << "Number of threads(" << default_config.threads
             << ") can't exceed number of clients(" << default_config.clients << ")." << std::endl;
         return empty_result;
     }
+    else if (server_mode && !default_config.shm_name.empty() && default_config.type == NumericType::bigint)
+    {
+        std::cout << "Shared-memory transport doesn't support 'bigint' type." << std::endl;
+        return empty_result;
+    }
 
     //Correct arguments are provided, return inited config.
     return default_config;
@@ -0,0 +1,90 @@
+#include "Evaluator.h"
+
+#include <istream>
+#include <ostream>
+
+namespace
+{
+const char* const type_names[] = {"int32", "int64", "checked_int64", "bigint", "float64", "mod64"};
+
+using ShuntingYardInt = ShuntingYard<int, ShuntingYardSyntax, ShuntingYardChecked>;
+using ShuntingYardInt64 = ShuntingYard<long long, ShuntingYardSyntax, ShuntingYardSaturating>;
+using ShuntingYardCheckedInt64 = ShuntingYard<long long, ShuntingYardSyntax, ShuntingYardChecked>;
+using ShuntingYardBigInt = ShuntingYard<BigInt>;
+using ShuntingYardFloat = ShuntingYard<double, ShuntingYardFloatSyntax, ShuntingYardChecked>;
+using ShuntingYardMod = ShuntingYard<ModInt>;
+
+/**
+ * ModInt numbers take modulus from context of thread, so evaluator sets its context for each part of data
+ * (a connection can be served by different threads of pool between parts).
+ */
+class ModIntEvaluator : public Evaluator
+{
+public:
+    explicit ModIntEvaluator(std::uint64_t modulus) : context(modulus) {}
+
+    EvaluationStatus parse(const char* s, std::size_t len, std::string& response) override
+    {
+        ModInt::Scope scope(context);
+        return append_result(parser.parse(s, len), response);
+    }
+
+    void clear() override
+    {
+        parser.clear();
+    }
+
+    ShuntingYardStatistics statistics() const override
+    {
+        return parser.statistics();
+    }
+
+private:
+    ModContext context;
+    ShuntingYardMod parser;
+};
+} //nameless namespace
+
+std::istream& operator>>(std::istream& s, NumericType& type)
+{
+    std::string name;
+    s >> name;
+
+    for (unsigned int i = 0; i < sizeof(type_names) / sizeof(type_names[0]); ++i)
+    {
+        if (name == type_names[i])
+        {
+            type = static_cast<NumericType>(i);
+            return s;
+        }
+    }
+
+    s.setstate(std::ios_base::failbit);
+    return s;
+}
+
+std::ostream& operator<<(std::ostream& s, NumericType type)
+{
+    return s << type_names[static_cast<unsigned int>(type)];
+}
+
+std::unique_ptr<Evaluator> make_evaluator(NumericType type, std::uint64_t modulus)
+{
+    switch (type)
+    {
+        case NumericType::int64:
+            return std::unique_ptr<Evaluator>(new ShuntingYardEvaluator<ShuntingYardInt64>());
+        case NumericType::checked_int64:
+            return std::unique_ptr<Evaluator>(new ShuntingYardEvaluator<ShuntingYardCheckedInt64>());
+        case NumericType::bigint:
+            return std::unique_ptr<Evaluator>(new ShuntingYardEvaluator<ShuntingYardBigInt>());
+        case NumericType::float64:
+            return std::unique_ptr<Evaluator>(new ShuntingYardEvaluator<ShuntingYardFloat>());
+        case NumericType::mod64:
+            return std::unique_ptr<Evaluator>(new ModIntEvaluator(modulus));
+        case NumericType::int32:
+            break;
+    }
+
+    return std::unique_ptr<Evaluator>(new ShuntingYardEvaluator<ShuntingYardInt>());
+}
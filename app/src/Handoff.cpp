@@ -0,0 +1,228 @@
+#include "Handoff.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+/** Fills address of Unix domain socket, returns false if path is too long. */
+bool make_address(const std::string& path, sockaddr_un& address)
+{
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+/** Is descriptor kind known? */
+bool is_valid(char kind)
+{
+    switch (static_cast<HandoffKind>(kind))
+    {
+        case HandoffKind::tcp_listener:
+        case HandoffKind::unix_listener:
+        case HandoffKind::tcp_client:
+        case HandoffKind::unix_client:
+        case HandoffKind::end:
+            return true;
+    }
+    return false;
+}
+} //nameless namespace
+
+int handoff_listen(const std::string& path)
+{
+    sockaddr_un address;
+    if (!make_address(path, address))
+    {
+        return -1;
+    }
+
+    int s = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (s < 0)
+    {
+        return -1;
+    }
+
+    //Socket file of previous run prevents binding (other files are not removed).
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        ::unlink(path.c_str());
+    }
+
+    if (::bind(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(s, 1) != 0)
+    {
+        int error = errno;
+        ::close(s);
+        errno = error;
+        return -1;
+    }
+    return s;
+}
+
+int handoff_connect(const std::string& path)
+{
+    sockaddr_un address;
+    if (!make_address(path, address))
+    {
+        return -1;
+    }
+
+    int s = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (s < 0)
+    {
+        return -1;
+    }
+
+    if (::connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        ::close(s);
+        return -1;
+    }
+    return s;
+}
+
+bool handoff_trusted(int socket)
+{
+    ucred credentials;
+    socklen_t size = sizeof(credentials);
+    return ::getsockopt(socket, SOL_SOCKET, SO_PEERCRED, &credentials, &size) == 0 && credentials.uid == ::getuid();
+}
+
+bool handoff_send(int socket, const std::vector<HandoffDescriptor>& descriptors)
+{
+    if (descriptors.empty() || descriptors.size() > handoff_max_descriptors)
+    {
+        return false;
+    }
+
+    char kinds[handoff_max_descriptors];
+    int fds[handoff_max_descriptors];
+    std::size_t fd_count = 0;
+    for (std::size_t i = 0; i < descriptors.size(); ++i)
+    {
+        kinds[i] = static_cast<char>(descriptors[i].kind);
+        if (descriptors[i].kind != HandoffKind::end)
+        {
+            fds[fd_count++] = descriptors[i].fd;
+        }
+    }
+
+    iovec data{kinds, descriptors.size()};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+    if (fd_count)
+    {
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(fd_count * sizeof(int));
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(fd_count * sizeof(int));
+        std::memcpy(CMSG_DATA(header), fds, fd_count * sizeof(int));
+    }
+
+    ssize_t n;
+    do
+    {
+        n = ::sendmsg(socket, &message, MSG_NOSIGNAL);
+    }
+    while (n < 0 && errno == EINTR);
+    return n == static_cast<ssize_t>(descriptors.size());
+}
+
+bool handoff_receive(int socket, std::vector<HandoffDescriptor>& descriptors, int timeout)
+{
+    descriptors.clear();
+
+    pollfd p{socket, POLLIN, 0};
+    int ready;
+    do
+    {
+        ready = ::poll(&p, 1, timeout);
+    }
+    while (ready < 0 && errno == EINTR);
+    if (ready <= 0)
+    {
+        return false;
+    }
+
+    char kinds[handoff_max_descriptors];
+    iovec data{kinds, sizeof(kinds)};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(handoff_max_descriptors * sizeof(int))];
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    do
+    {
+        n = ::recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+    }
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+    {
+        return false;
+    }
+
+    //Received descriptors are taken even if message is invalid, so they are not leaked.
+    std::vector<int> fds;
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header))
+    {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+        {
+            std::size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int* begin = reinterpret_cast<const int*>(CMSG_DATA(header));
+            fds.insert(fds.end(), begin, begin + count);
+        }
+    }
+
+    std::size_t fd_index = 0;
+    bool valid = !(message.msg_flags & (MSG_TRUNC | MSG_CTRUNC));
+    for (ssize_t i = 0; i < n && valid; ++i)
+    {
+        valid = is_valid(kinds[i]);
+        HandoffKind kind = static_cast<HandoffKind>(kinds[i]);
+        if (valid && kind == HandoffKind::end)
+        {
+            descriptors.push_back(HandoffDescriptor{kind, -1});
+        }
+        else if (valid && fd_index < fds.size())
+        {
+            descriptors.push_back(HandoffDescriptor{kind, fds[fd_index++]});
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    if (!valid || fd_index != fds.size())
+    {
+        for (int fd : fds)
+        {
+            ::close(fd);
+        }
+        descriptors.clear();
+        return false;
+    }
+    return true;
+}
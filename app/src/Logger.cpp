@@ -0,0 +1,183 @@
+#include "Logger.h"
+
+#include <algorithm>
+#include <ctime>
+#include <istream>
+#include <ostream>
+
+namespace
+{
+const char* const level_names[] = {"none", "error", "info", "debug"};
+} //nameless namespace
+
+std::istream& operator>>(std::istream& s, LogLevel& level)
+{
+    std::string name;
+    s >> name;
+
+    for (unsigned int i = 0; i < sizeof(level_names) / sizeof(level_names[0]); ++i)
+    {
+        if (name == level_names[i])
+        {
+            level = static_cast<LogLevel>(i);
+            return s;
+        }
+    }
+
+    s.setstate(std::ios_base::failbit);
+    return s;
+}
+
+std::ostream& operator<<(std::ostream& s, LogLevel level)
+{
+    return s << level_names[static_cast<unsigned int>(level)];
+}
+
+Logger::Logger(LogLevel level_, unsigned int sample_rate_, const std::string& filename)
+    : level(level_),
+      sample_rate(sample_rate_),
+      file(stderr),
+      own_file(false),
+      texts_dropped(0),
+      writer(*this)
+{
+    if (level == LogLevel::none)
+    {
+        //Records are never written, writer thread is not needed.
+        return;
+    }
+
+    if (!filename.empty())
+    {
+        std::FILE* f = std::fopen(filename.c_str(), "a");
+        if (f)
+        {
+            file = f;
+            own_file = true;
+        }
+        else
+        {
+            std::fprintf(stderr, "Could not open log file '%s', stderr is used.\n", filename.c_str());
+        }
+    }
+
+    writer.start(file);
+}
+
+Logger::~Logger()
+{
+    writer.stop();
+
+    if (own_file)
+    {
+        std::fclose(file);
+    }
+}
+
+void Logger::write(LogLevel record_level, const char* format, unsigned int client_index, long long value /*= 0*/)
+{
+    if (!is_enabled(record_level))
+    {
+        return;
+    }
+
+    const Record record{std::chrono::system_clock::now(), record_level, format, client_index, value};
+    writer.push(&record, 1);
+}
+
+void Logger::write_text(LogLevel record_level, const std::string& text)
+{
+    if (!is_enabled(record_level))
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(text_mutex);
+    if (texts.size() == text_capacity)
+    {
+        ++texts_dropped;
+        return;
+    }
+    texts.push_back(TextRecord{std::chrono::system_clock::now(), record_level, text});
+}
+
+void Logger::flush()
+{
+    writer.flush();
+}
+
+void Logger::format(const Record* records, std::size_t n, std::string& output)
+{
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        format_record(records[i], output);
+    }
+}
+
+void Logger::format_dropped(std::uint64_t dropped, std::string& output)
+{
+    Record record{std::chrono::system_clock::now(), LogLevel::error,
+        "Logger: %u records were dropped", static_cast<unsigned int>(dropped), 0};
+    format_record(record, output);
+}
+
+bool Logger::format_pending(std::string& output)
+{
+    std::vector<TextRecord> text_records;
+    std::size_t text_dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(text_mutex);
+        text_records.swap(texts);
+        std::swap(text_dropped, texts_dropped);
+    }
+
+    for (const TextRecord& record : text_records)
+    {
+        format_header(record.time, record.level, output);
+        output += record.text;
+        output += '\n';
+    }
+
+    if (text_dropped)
+    {
+        Record record{std::chrono::system_clock::now(), LogLevel::error,
+            "Logger: %u text records were dropped", static_cast<unsigned int>(text_dropped), 0};
+        format_record(record, output);
+    }
+
+    return !text_records.empty();
+}
+
+void Logger::format_record(const Record& record, std::string& output)
+{
+    char buffer[512];
+
+    format_header(record.time, record.level, output);
+
+    int rc = std::snprintf(buffer, sizeof(buffer), record.format, record.client_index, record.value);
+    if (rc > 0)
+    {
+        output.append(buffer, std::min(static_cast<std::size_t>(rc), sizeof(buffer) - 1));
+    }
+    output += '\n';
+}
+
+void Logger::format_header(std::chrono::system_clock::time_point time, LogLevel level, std::string& output)
+{
+    char buffer[64];
+
+    std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+    auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+        time - std::chrono::system_clock::from_time_t(seconds)).count();
+    std::tm tm{};
+    localtime_r(&seconds, &tm);
+
+    std::size_t n = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+    int rc = std::snprintf(buffer + n, sizeof(buffer) - n, ".%06lld %-5s ",
+        static_cast<long long>(microseconds), level_names[static_cast<unsigned int>(level)]);
+    if (rc > 0)
+    {
+        n += std::min(static_cast<std::size_t>(rc), sizeof(buffer) - n - 1);
+    }
+    output.append(buffer, n);
+}
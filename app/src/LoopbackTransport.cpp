@@ -0,0 +1,197 @@
+#include "LoopbackTransport.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+/** Posts handler of operation to io_service. */
+void post(boost::asio::io_service& service, Transport::Handler handler, const boost::system::error_code& error, std::size_t bytes_transferred)
+{
+    service.post([handler = std::move(handler), error, bytes_transferred]()
+        {
+            handler(error, bytes_transferred);
+        });
+}
+} //nameless namespace
+
+bool LoopbackTransport::Connection::write(const char* data, std::size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (closed || aborted || eof)
+    {
+        return false;
+    }
+
+    //Received part of input is dropped before it outgrows the rest.
+    if (input_begin && input_begin >= input.size() / 2)
+    {
+        input.erase(0, input_begin);
+        input_begin = 0;
+    }
+
+    input.append(data, size);
+    complete_receive();
+    return true;
+}
+
+void LoopbackTransport::Connection::shutdown()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    eof = true;
+    complete_receive();
+}
+
+bool LoopbackTransport::Connection::is_closed() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return closed;
+}
+
+void LoopbackTransport::Connection::complete_receive()
+{
+    if (!receiving)
+    {
+        return;
+    }
+
+    std::size_t available = input.size() - input_begin;
+    if (aborted)
+    {
+        post(*service, std::move(receive_handler), boost::asio::error::shut_down, 0);
+    }
+    else if (available)
+    {
+        std::size_t n = std::min(size, available);
+        std::memcpy(buffer, input.data() + input_begin, n);
+        input_begin += n;
+        if (input_begin == input.size())
+        {
+            input.clear();
+            input_begin = 0;
+        }
+        post(*service, std::move(receive_handler), boost::system::error_code(), n);
+    }
+    else if (eof)
+    {
+        post(*service, std::move(receive_handler), boost::asio::error::eof, 0);
+    }
+    else
+    {
+        return;
+    }
+
+    receiving = false;
+    receive_handler = nullptr;
+}
+
+LoopbackTransport::LoopbackTransport(unsigned int clients)
+    : slots(clients)
+{
+}
+
+std::shared_ptr<LoopbackTransport::Connection> LoopbackTransport::connect(ResponseHandler handler)
+{
+    std::shared_ptr<Connection> connection = std::make_shared<Connection>();
+    connection->handler = std::move(handler);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (accepts.empty())
+    {
+        backlog.push_back(connection);
+        return connection;
+    }
+
+    pending_accept& accept = accepts.front();
+    slots[accept.client_index] = connection;
+    post(*accept.service, std::move(accept.handler), boost::system::error_code(), 0);
+    accepts.pop_front();
+    return connection;
+}
+
+void LoopbackTransport::async_accept(unsigned int client_index, boost::asio::io_service& service, Handler handler)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (backlog.empty())
+    {
+        accepts.push_back(pending_accept{client_index, &service, std::move(handler)});
+        return;
+    }
+
+    slots[client_index] = std::move(backlog.front());
+    backlog.pop_front();
+    post(service, std::move(handler), boost::system::error_code(), 0);
+}
+
+void LoopbackTransport::async_receive(unsigned int client_index, char* buffer, std::size_t size, boost::asio::io_service& service, Handler handler)
+{
+    Connection* connection = slots[client_index].get();
+    if (!connection)
+    {
+        post(service, std::move(handler), boost::asio::error::not_connected, 0);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(connection->mutex);
+    connection->receiving = true;
+    connection->buffer = buffer;
+    connection->size = size;
+    connection->service = &service;
+    connection->receive_handler = std::move(handler);
+    connection->complete_receive();
+}
+
+void LoopbackTransport::async_send(unsigned int client_index, const char* data, std::size_t size, boost::asio::io_service& service, Handler handler)
+{
+    Connection* connection = slots[client_index].get();
+    bool aborted = true;
+    if (connection)
+    {
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        aborted = connection->aborted;
+    }
+
+    if (aborted)
+    {
+        post(service, std::move(handler), boost::asio::error::broken_pipe, 0);
+        return;
+    }
+
+    //Handler of peer is not changed after connect(), it is called without mutex, so it can write to connection.
+    connection->handler(*connection, data, size);
+    post(service, std::move(handler), boost::system::error_code(), size);
+}
+
+void LoopbackTransport::shutdown(unsigned int client_index)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Connection* connection = slots[client_index].get();
+    if (connection)
+    {
+        std::lock_guard<std::mutex> connection_lock(connection->mutex);
+        connection->aborted = true;
+        connection->complete_receive();
+    }
+}
+
+void LoopbackTransport::close(unsigned int client_index)
+{
+    std::shared_ptr<Connection> connection;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        connection = std::move(slots[client_index]);
+    }
+
+    if (!connection)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        connection->closed = true;
+        connection->receiving = false;
+        connection->receive_handler = nullptr;
+    }
+    connection->handler(*connection, nullptr, 0);
+}
@@ -1,18 +1,247 @@
 #include "NetCalcCore.h"
+#include "Topology.h"
 
-#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sstream>
 
-NetCalcCore::NetCalcCore(const Config& cfg_)
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+/** Tells CPU that current thread is spinning. */
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/** Removes file of Unix domain socket (other files are not removed). */
+void remove_socket_file(const std::string& path)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        ::unlink(path.c_str());
+    }
+}
+
+//Timer wheel covers timeout_wheel_slots * timeout_tick_ms milliseconds per round.
+const unsigned int timeout_wheel_slots = 1024;
+const std::uint64_t timeout_tick_ms = 10;
+
+//Lag of event loops is measured so often.
+const unsigned int lag_probe_interval_ms = 10;
+
+//New process waits for listeners of the old one so long (the old process sends them at once).
+const int handoff_timeout_ms = 5000;
+
+//Line that starts with command_prefix is a command (e.g. '#type int64'), longer commands are invalid.
+const char command_prefix = '#';
+const std::size_t max_command_size = 64;
+
+//Expression is measured for slow-expression log if it is split between parse calls or its parse call has at least
+//slow_measure_bytes bytes. Shorter expressions are parsed in a few microseconds, they cost no clock reads
+//(a read of thread CPU clock is a system call of about 0.4 microseconds).
+const std::size_t slow_measure_bytes = 4096;
+//Record of slow expression shows at most slow_prefix_size bytes of expression.
+const std::size_t slow_prefix_size = 48;
+
+/** Returns CPU time of current thread in nanoseconds. */
+std::uint64_t thread_cpu_time()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+/** Reads random token from the kernel CSPRNG (getrandom(2)), returns false if it fails. */
+bool random_token(std::uint64_t& token)
+{
+    ssize_t rc;
+    do
+    {
+        rc = ::getrandom(&token, sizeof(token), 0);
+    }
+    while (rc < 0 && errno == EINTR);
+
+    //Request of 8 bytes is never short once the pool is initialized.
+    return rc == static_cast<ssize_t>(sizeof(token));
+}
+
+/** Returns address family of socket (AF_UNSPEC if it can't be read). */
+int socket_family(int fd)
+{
+    sockaddr_storage address{};
+    socklen_t size = sizeof(address);
+    return ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &size) == 0 ? address.ss_family : AF_UNSPEC;
+}
+
+/**
+ * Integer socket option that boost::asio does not provide (it meets SettableSocketOption requirements).
+ */
+template <int Level, int Name>
+class integer_option
+{
+public:
+    explicit integer_option(int value_) : value(value_) {}
+
+    template <typename Protocol> int level(const Protocol&) const { return Level; }
+    template <typename Protocol> int name(const Protocol&) const { return Name; }
+    template <typename Protocol> const int* data(const Protocol&) const { return &value; }
+    template <typename Protocol> std::size_t size(const Protocol&) const { return sizeof(value); }
+
+private:
+    int value;
+};
+
+#ifdef SO_BUSY_POLL
+using so_busy_poll_option = integer_option<SOL_SOCKET, SO_BUSY_POLL>;
+#endif
+} //nameless namespace
+
+NetCalcCore::NetCalcCore(const Config& cfg_, Transport* transport_)
     : cfg(cfg_),
-      acceptor(service, boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(cfg.address), cfg.port)),
+      logger(cfg.log_level, cfg.log_sample, cfg.log_file),
+      tracer(cfg.trace_sample),
+      capture(cfg.capture_file),
+      transport(transport_),
+      bulk_work(bulk_service),
+      parallel_work(parallel_service),
+      acceptor(service),
+      unix_acceptor(service),
+      timeouts(cfg.clients),
+      timer_wheel(timeout_wheel_slots, timeout_tick_ms),
+      timeout_timer(service),
+      start_time(std::chrono::steady_clock::now()),
+      session_timer(service),
+      handoffs(cfg.clients),
       unit_test_mode(false)
 {
+    if (transport)
+    {
+        transport_work.reset(new boost::asio::io_service::work(service));
+    }
+    else if (handoff_enabled())
+    {
+        take_over();
+    }
+    else
+    {
+        init_listeners();
+    }
+    init_placement();
+
+    //Free slots wait for connections of both listeners (see dispatch_async_accept()).
+    listeners.reserve(2);
+    if (acceptor.is_open())
+    {
+        listeners.push_back(listener{boost::asio::generic::stream_protocol::socket(service),
+            acceptor.local_endpoint().protocol(), false, false, false});
+    }
+    if (unix_acceptor.is_open())
+    {
+        listeners.push_back(listener{boost::asio::generic::stream_protocol::socket(service),
+            boost::asio::local::stream_protocol(), true, false, false});
+    }
+
+    if (!cfg.shm_name.empty())
+    {
+        shm_server.reset(new ShmServer(cfg.shm_name, cfg.shm_sessions, cfg.shm_ring_size, cfg.turn_expressions, cfg.busy_poll,
+            cfg.type, cfg.modulus));
+    }
+
+    //Each io_service gets a contiguous range of clients proportional to number of its threads.
+    std::vector<unsigned int> service_threads(service_nodes.size(), 0);
+    for (unsigned int service_index : thread_services)
+    {
+        ++service_threads[service_index];
+    }
+
+    std::vector<unsigned int> first_clients(service_nodes.size() + 1, cfg.clients);
+    first_clients[0] = 0;
+
     //Init clients.
     clients.reserve(cfg.clients);
 
+    unsigned int service_index = 0;
+    unsigned int service_last_thread = service_threads[0];
     for (unsigned int i = 0; i < cfg.clients; ++i)
     {
-        clients.push_back(client{boost::asio::ip::tcp::socket(service), {}, {}, {}});
+        unsigned int thread_index = thread_services.empty() ? 0 :
+            static_cast<unsigned int>(static_cast<unsigned long long>(i) * thread_services.size() / cfg.clients);
+        while (thread_index >= service_last_thread && service_index + 1 < service_nodes.size())
+        {
+            service_last_thread += service_threads[++service_index];
+            first_clients[service_index] = i;
+        }
+
+        clients.push_back(client(boost::asio::generic::stream_protocol::socket(get_service(service_index)),
+            boost::asio::steady_timer(get_service(service_index)), service_index, make_client_evaluator(cfg.type, cfg.modulus)));
+    }
+
+    //Init pipelines of heavy connections.
+    for (unsigned int i = 0; i < cfg.pipelines; ++i)
+    {
+        pipelines.push_back(make_aligned<ShuntingYardPipelineInt>());
+        free_pipelines.push_back(pipelines.back().get());
+    }
+
+    for (unsigned int i = 0; i < service_nodes.size(); ++i)
+    {
+        lag_probes.emplace_back(get_service(i));
+    }
+
+    //Move memory of clients to NUMA nodes of their threads.
+    if (service_nodes.size() > 1)
+    {
+        for (unsigned int i = 0; i < service_nodes.size(); ++i)
+        {
+            if (first_clients[i] < first_clients[i + 1])
+            {
+                bind_memory(&clients[first_clients[i]], (first_clients[i + 1] - first_clients[i]) * sizeof(client), service_nodes[i]);
+            }
+        }
+
+        //Heap memory of clients is placed by first touch: parser stacks and evaluators are allocated again
+        //by a thread that is pinned to a CPU of their node (strings grow later in threads of the node).
+        std::vector<std::thread> placers;
+        unsigned int first_thread = 0;
+        for (unsigned int i = 0; i < service_nodes.size(); ++i)
+        {
+            unsigned int cpu = thread_cpus[first_thread];
+            first_thread += service_threads[i];
+            placers.push_back(std::thread([this, cpu, begin = first_clients[i], end = first_clients[i + 1]]()
+                {
+                    pin_current_thread(cpu);
+                    for (unsigned int j = begin; j < end; ++j)
+                    {
+                        client& c = clients[j];
+                        c.shunting_yard = ShuntingYardInt();
+                        c.evaluator = make_client_evaluator(cfg.type, cfg.modulus);
+                    }
+                }));
+        }
+        for (auto& t : placers)
+        {
+            t.join();
+        }
     }
 }
 
@@ -29,6 +258,45 @@ NetCalcCore::~NetCalcCore()
         }
     }
 
+    //Bulk and parallel threads are needed while event loops work only.
+    bulk_service.stop();
+    for (auto& t : bulk_threads)
+    {
+        if (t.joinable())
+        {
+            t.join();
+        }
+    }
+
+    parallel_service.stop();
+    for (auto& t : parallel_threads)
+    {
+        if (t.joinable())
+        {
+            t.join();
+        }
+    }
+
+    //Handoff thread is woken up by stop().
+    if (handoff_thread.joinable())
+    {
+        handoff_thread.join();
+    }
+
+    //Socket files belong to the new process if this process has handed them over.
+    if (handoff_listener >= 0)
+    {
+        ::close(handoff_listener);
+        if (!draining)
+        {
+            remove_socket_file(cfg.handoff_socket);
+        }
+    }
+    if (handoff_peer >= 0)
+    {
+        ::close(handoff_peer);
+    }
+
     //Close all sockets.
     for (unsigned int i = 0; i < cfg.clients; ++i)
     {
@@ -38,6 +306,15 @@ NetCalcCore::~NetCalcCore()
             c.socket.close();
         }
     }
+
+    if (unix_acceptor.is_open())
+    {
+        unix_acceptor.close();
+        if (!draining)
+        {
+            remove_socket_file(cfg.unix_socket);
+        }
+    }
 }
 
 void NetCalcCore::start(bool block /*= false*/)
@@ -48,19 +325,63 @@ void NetCalcCore::start(bool block /*= false*/)
         dispatch_async_accept(i);
     }
 
+    //Start timer of timeouts.
+    if (timeouts_enabled() && !unit_test_mode)
+    {
+        dispatch_timeout_check();
+    }
+
+    //Start timer of expired sessions.
+    if (cfg.sessions && !unit_test_mode)
+    {
+        dispatch_session_check();
+    }
+
+    //Start measurement of event loop lag.
+    for (unsigned int i = 0; i < lag_probes.size() && cfg.shed_lag && !unit_test_mode; ++i)
+    {
+        dispatch_lag_probe(i);
+    }
+
+    //Start shared-memory worker.
+    if (shm_server && !unit_test_mode)
+    {
+        shm_server->start();
+    }
+
+    //Start bulk threads.
+    bulk_threads.reserve(cfg.bulk_threads);
+    for (unsigned int i = 0; i < cfg.bulk_threads && !unit_test_mode; ++i)
+    {
+        bulk_threads.push_back(std::thread([&self = *this](){ self.bulk_service.run();}));
+    }
+
+    //Start parallel threads.
+    parallel_threads.reserve(cfg.parallel_threads);
+    for (unsigned int i = 0; i < cfg.parallel_threads && !unit_test_mode; ++i)
+    {
+        parallel_threads.push_back(std::thread([&self = *this](){ self.parallel_service.run();}));
+    }
+
+    //Start handoff thread.
+    if (handoff_enabled() && !unit_test_mode)
+    {
+        handoff_thread = std::thread([&self = *this](){ self.run_handoff();});
+    }
+
     //Start cfg.threads or cfg.threads - 1 threads.
     //Each started thread will be 'event loop'.
     unsigned int threads_count = block ? cfg.threads - 1 : cfg.threads;
     threads.reserve(threads_count);
     for (unsigned int i = 0; i < threads_count; ++i)
     {
-        threads.push_back(std::thread([&self = *this](){ self.service.run();}));
+        threads.push_back(std::thread([i, &self = *this](){ self.run_event_loop(i);}));
     }
 
     //Current thread will be 'event loop' if block is true.
     if (block)
     {
-        service.run();
+        run_event_loop(threads_count);
     }
 }
 
@@ -68,178 +389,1862 @@ void NetCalcCore::stop()
 {
     //Stop all event loop.
     service.stop();
-}
+    for (auto& node_service : node_services)
+    {
+        node_service.stop();
+    }
+    bulk_service.stop();
+    parallel_service.stop();
 
-void NetCalcCore::handle_accept(unsigned int client_index, const boost::system::error_code& error)
-{
-    if (error)
+    if (shm_server)
     {
-#ifndef NDEBUG
-        std::cerr << "Error " << error.value() << " on async_accept happens" << std::endl;
-#endif
-        return;
+        shm_server->stop();
     }
 
-#ifndef NDEBUG
-    std::cout << "Client: " << client_index << " accepted" << std::endl;
-#endif
+    //Wake up handoff thread (it waits for connections of handoff socket, for messages or for the end of draining).
+    if (handoff_enabled())
+    {
+        std::lock_guard<std::mutex> lock(handoff_mutex);
+        handoff_stopped = true;
+        handoff_condition.notify_all();
+        if (handoff_listener >= 0)
+        {
+            ::shutdown(handoff_listener, SHUT_RDWR);
+        }
+        if (handoff_peer >= 0)
+        {
+            ::shutdown(handoff_peer, SHUT_RDWR);
+        }
+    }
+}
 
-    //Dispatch async receive for successful accept.
-    dispatch_async_receive(client_index);
+void NetCalcCore::set_handoff_handler(std::function<void()> handler)
+{
+    handoff_handler = std::move(handler);
 }
 
-void NetCalcCore::handle_receive(unsigned int client_index, const boost::system::error_code& error, std::size_t bytes_transferred)
+void NetCalcCore::init_listeners()
 {
-    if (error)
+    //Listeners taken over from the old process are not opened again (see take_over()).
+    if (!acceptor.is_open() && (cfg.port || cfg.unix_socket.empty()))
     {
-        on_receive_error(client_index, error);
-        return;
+        //The same options as acceptor(service, endpoint) constructor uses.
+        boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(cfg.address), cfg.port);
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+        acceptor.bind(endpoint);
+        acceptor.listen();
     }
 
-#ifndef NDEBUG
-    std::cout << "Client: " << client_index << ", received: " << bytes_transferred << " bytes" << std::endl;
-#endif
-
-    //Parse received data and dispatch next async operation.
-    parse_result(client_index, bytes_transferred);
+    if (!unix_acceptor.is_open() && !cfg.unix_socket.empty())
+    {
+        //Socket file of previous run prevents binding.
+        remove_socket_file(cfg.unix_socket);
+        boost::asio::local::stream_protocol::endpoint endpoint(cfg.unix_socket);
+        unix_acceptor.open(endpoint.protocol());
+        unix_acceptor.bind(endpoint);
+        unix_acceptor.listen();
+    }
 }
 
-void NetCalcCore::on_receive_error(unsigned int client_index, const boost::system::error_code& error)
+void NetCalcCore::init_placement()
 {
-    //Clear client object, close connection and dispatch async accept.
-    client& c = clients[client_index];
-    c.shunting_yard.clear();
-    c.socket.close();
-
-#ifndef NDEBUG
-    std::cerr << "Error " << error.value()
-              << " on async_receive happens for client: " << client_index << std::endl;
-#endif
+    service_nodes.assign(1, 0);
+    thread_services.assign(cfg.threads, 0);
 
-    dispatch_async_accept(client_index);
-}
+    boost::optional<std::vector<unsigned int>> cpus;
+    if (cfg.cpus == "auto")
+    {
+        cpus = get_default_cpus();
+    }
+    else if (cfg.cpus != "none")
+    {
+        cpus = parse_cpu_list(cfg.cpus);
+    }
 
-void NetCalcCore::handle_send(unsigned int client_index, bool processing_error, const boost::system::error_code& error, std::size_t bytes_transferred)
-{
-    if (error || processing_error)
+    if (!cpus || !cfg.threads)
     {
-        on_send_error(client_index, processing_error, error);
         return;
     }
 
-#ifndef NDEBUG
-    std::cout << "Client: " << client_index << ", writen: " << bytes_transferred << " bytes" << std::endl;
-#endif
+    //Thread 'i' is pinned to cpus[i % cpus.size()], io_service of the first thread is 'service' (it accepts connections).
+    service_nodes.clear();
+    for (unsigned int i = 0; i < cfg.threads; ++i)
+    {
+        unsigned int cpu = cpus.get()[i % cpus->size()];
+        unsigned int node = get_cpu_node(cpu);
+        auto it = std::find(service_nodes.begin(), service_nodes.end(), node);
+        if (it == service_nodes.end())
+        {
+            it = service_nodes.insert(service_nodes.end(), node);
+        }
+
+        thread_cpus.push_back(cpu);
+        thread_services[i] = static_cast<unsigned int>(it - service_nodes.begin());
+    }
 
-    if (!clients[client_index].shunting_yard.is_empty())
+    //Keep threads sorted by io_service, so each io_service gets contiguous ranges of threads and clients.
+    std::vector<unsigned int> order(cfg.threads);
+    for (unsigned int i = 0; i < cfg.threads; ++i)
     {
-        //Long expression like: '1 + 2\n3 - 4\n5 * 6\n7 / 8\n' was received.
-        parse_result(client_index, 0ul);
+        order[i] = i;
     }
-    else
+    std::stable_sort(order.begin(), order.end(),
+        [this](unsigned int lhs, unsigned int rhs) { return thread_services[lhs] < thread_services[rhs]; });
+
+    std::vector<unsigned int> sorted_cpus(cfg.threads);
+    std::vector<unsigned int> sorted_services(cfg.threads);
+    for (unsigned int i = 0; i < cfg.threads; ++i)
     {
-        //Dispatch async receive to receive next arithmetic expression.
-        dispatch_async_receive(client_index);
+        sorted_cpus[i] = thread_cpus[order[i]];
+        sorted_services[i] = thread_services[order[i]];
+    }
+    thread_cpus.swap(sorted_cpus);
+    thread_services.swap(sorted_services);
+
+    for (std::size_t i = 1; i < service_nodes.size(); ++i)
+    {
+        node_services.emplace_back();
+        node_works.emplace_back(node_services.back());
     }
 }
 
-void NetCalcCore::on_send_error(unsigned int client_index, bool processing_error, const boost::system::error_code& error)
+void NetCalcCore::run_event_loop(unsigned int thread_index)
 {
-    //Clear client object, close connection and dispatch async accept.
-    client& c = clients[client_index];
-    c.shunting_yard.clear();
-    c.socket.close();
+    if (thread_index < thread_cpus.size())
+    {
+        if (pin_current_thread(thread_cpus[thread_index]))
+        {
+            logger.write(LogLevel::info, "Thread: %u is pinned to CPU %lld", thread_index, thread_cpus[thread_index]);
+        }
+        else
+        {
+            logger.write(LogLevel::error, "Thread: %u could not be pinned to CPU %lld", thread_index, thread_cpus[thread_index]);
+        }
+    }
 
-#ifndef NDEBUG
-    if (processing_error)
+    boost::asio::io_service& s = get_service(thread_index < thread_services.size() ? thread_services[thread_index] : 0);
+    if (cfg.busy_poll)
     {
-        std::cerr << "Processing error happens for client: " << client_index << std::endl;
+        run_busy_poll(s);
     }
     else
     {
-        std::cerr << "Error " << error.value()
-                  << " on async_write happens for client: " << client_index << std::endl;
+        s.run();
     }
-#endif
-
-    dispatch_async_accept(client_index);
 }
 
-void NetCalcCore::dispatch_async_accept(unsigned int client_index)
+void NetCalcCore::run_busy_poll(boost::asio::io_service& s)
 {
-    auto l = [client_index, &self = *this](const boost::system::error_code& error)
+    const auto budget = std::chrono::microseconds(cfg.busy_poll);
+    const unsigned int max_pause = 64;
+
+    while (!s.stopped())
     {
-        self.handle_accept(client_index, error);
-    };
+        if (s.poll())
+        {
+            continue;
+        }
 
-    client& c = clients[client_index];
-    if (unit_test_mode)
-        c.unit_test_mode = client_unit_test_mode::async_accept;
-    else
-        acceptor.async_accept(c.socket, l);
+        //There are no ready handlers, spin with adaptive back-off.
+        bool ready = false;
+        unsigned int pause = 1;
+        auto deadline = std::chrono::steady_clock::now() + budget;
+        while (!ready && std::chrono::steady_clock::now() < deadline)
+        {
+            for (unsigned int i = 0; i < pause; ++i)
+            {
+                cpu_relax();
+            }
+            pause = std::min(pause * 2, max_pause);
+            ready = s.poll_one() != 0;
+        }
+
+        //Budget is spent, block until the next handler.
+        if (!ready && !s.run_one())
+        {
+            break;
+        }
+    }
 }
 
-void NetCalcCore::dispatch_async_receive(unsigned int client_index)
+bool NetCalcCore::dump_trace()
 {
-    auto l = [client_index, &self = *this](const boost::system::error_code& error, std::size_t bytes_transferred)
+    if (!tracer.is_enabled())
     {
-        self.handle_receive(client_index, error, bytes_transferred);
-    };
+        return false;
+    }
 
-    client& c = clients[client_index];
-    if (unit_test_mode)
-        c.unit_test_mode = client_unit_test_mode::async_receive;
-    else
-        c.socket.async_receive(boost::asio::buffer(c.buffer), l);
+    bool result = tracer.dump(cfg.trace_file);
+    if (!result)
+    {
+        logger.write_text(LogLevel::error, "Could not write trace file '" + cfg.trace_file + "'");
+    }
+
+    return result;
 }
 
-void NetCalcCore::dispatch_async_send(unsigned int client_index, std::size_t bytes_to_write, bool processing_error)
+NetCalcStats NetCalcCore::get_stats() const
 {
-    auto l = [client_index, processing_error, &self = *this](const boost::system::error_code& error, std::size_t bytes_transferred)
+    std::uint64_t lag = 0;
+    for (const lag_probe& probe : lag_probes)
     {
-        self.handle_send(client_index, processing_error, error, bytes_transferred);
-    };
+        lag = std::max(lag, probe.lag.load(std::memory_order_relaxed));
+    }
 
-    client& c = clients[client_index];
-    if (unit_test_mode)
-        c.unit_test_mode = client_unit_test_mode::async_send;
-    else
-        boost::asio::async_write(c.socket, boost::asio::buffer(c.buffer, bytes_to_write), l);
+    return NetCalcStats{idle_timeouts.load(std::memory_order_relaxed), expression_timeouts.load(std::memory_order_relaxed),
+        slow_receives.load(std::memory_order_relaxed), throttles.load(std::memory_order_relaxed),
+        shed_expressions.load(std::memory_order_relaxed), slow_expressions.load(std::memory_order_relaxed),
+        resumed_sessions.load(std::memory_order_relaxed), handed_over_connections.load(std::memory_order_relaxed),
+        adopted_connections.load(std::memory_order_relaxed), lag};
 }
 
-void NetCalcCore::parse_result(unsigned int client_index, std::size_t bytes_transferred)
+void NetCalcCore::handle_accept(unsigned int client_index, const boost::system::error_code& error)
 {
-    //bytes_transferred == 0 means that long expression like: '1 + 2\n3 - 4\n5 * 6\n7 / 8\n' was received.
-    //It is need to calculate next result.
-    std::string str;
-    bool processing_error = false;
-    client& c = clients[client_index];
-    ShuntingYardInt::Result parse_result = c.shunting_yard.parse(bytes_transferred ? c.buffer : nullptr, bytes_transferred);
-
-    switch (parse_result.first)
+    if (error)
     {
-        case ShuntingYardInt::ParseResult::Success:
-            str = std::to_string(parse_result.second) + "\n";
-            break;
-        case ShuntingYardInt::ParseResult::Incomplete:
-            break;
-        case ShuntingYardInt::ParseResult::DivisionByZero:
-            str = "Division by zero\n";
-            processing_error = true;
-            break;
-        case ShuntingYardInt::ParseResult::InvalidExpression:
-            str = "Invalid expression\n";
-            processing_error = true;
-            break;
+        log(client_index, LogLevel::error, "Client: %u, error %lld on async_accept happens", error.value());
+        return;
     }
 
-    if (str.empty())
+    if (handoff_enabled())
     {
-        dispatch_async_receive(client_index);
+        active_connections.fetch_add(1);
     }
-    else
+
+    client& c = clients[client_index];
+#ifdef SO_BUSY_POLL
+    if (cfg.so_busy_poll && !c.local && c.socket.is_open())
     {
-        memcpy(c.buffer, str.data(), str.size());
-        dispatch_async_send(client_index, str.size(), processing_error);
+        boost::system::error_code ec;
+        c.socket.set_option(so_busy_poll_option(static_cast<int>(cfg.so_busy_poll)), ec);
+        if (ec)
+        {
+            log(client_index, LogLevel::error, "Client: %u, error %lld on setting SO_BUSY_POLL happens", ec.value());
+        }
     }
+#endif
+
+    //Connection starts with full token buckets.
+    c.expression_tokens = cfg.rate_expressions;
+    c.byte_tokens = cfg.rate_bytes;
+    if (cfg.rate_expressions || cfg.rate_bytes)
+    {
+        c.refill_time = std::chrono::steady_clock::now();
+    }
+
+    c.log_sampled = logger.is_enabled(LogLevel::info) && logger.sample();
+    c.trace_sampled = tracer.sample();
+    if (capture.is_enabled())
+    {
+        c.capture_id = capture.open();
+    }
+    trace(client_index, TracePhase::accept);
+    log(client_index, LogLevel::info, "Client: %u accepted");
+
+    //Dispatch async receive for successful accept.
+    dispatch_async_receive(client_index);
+}
+
+void NetCalcCore::handle_receive(unsigned int client_index, const boost::system::error_code& error, std::size_t bytes_transferred)
+{
+    trace(client_index, TracePhase::receive, static_cast<long long>(bytes_transferred));
+
+    if (handoff_enabled())
+    {
+        leave_parked(client_index);
+    }
+
+    if (disarm_timeout(client_index))
+    {
+        on_timeout(client_index);
+        return;
+    }
+
+    //Receive of idle connection is cancelled by draining, no data is received.
+    if (error == boost::asio::error::operation_aborted && draining.load() && hand_over_client(client_index))
+    {
+        return;
+    }
+
+    if (error)
+    {
+        on_receive_error(client_index, error);
+        return;
+    }
+
+    log(client_index, LogLevel::debug, "Client: %u, received: %lld bytes", static_cast<long long>(bytes_transferred));
+
+    //Parse received data and dispatch next async operation.
+    client& c = clients[client_index];
+    if (capture.is_enabled())
+    {
+        capture.data(c.capture_id, c.buffer, bytes_transferred);
+    }
+    c.pending_begin = 0;
+    c.pending_end = bytes_transferred;
+    c.byte_tokens -= cfg.rate_bytes ? static_cast<double>(bytes_transferred) : 0.0;
+    dispatch_continue(client_index);
+}
+
+void NetCalcCore::on_receive_error(unsigned int client_index, const boost::system::error_code& error)
+{
+    //Clear client object, close connection and dispatch async accept.
+    close_client(client_index);
+
+    if (error == boost::asio::error::eof)
+    {
+        log(client_index, LogLevel::info, "Client: %u disconnected");
+    }
+    else
+    {
+        log(client_index, LogLevel::error, "Client: %u, error %lld on async_receive happens", error.value());
+    }
+
+    dispatch_async_accept(client_index);
+}
+
+void NetCalcCore::handle_send(unsigned int client_index, bool processing_error, const boost::system::error_code& error, std::size_t bytes_transferred)
+{
+    trace(client_index, TracePhase::send, static_cast<long long>(bytes_transferred));
+
+    if (disarm_timeout(client_index))
+    {
+        on_timeout(client_index);
+        return;
+    }
+
+    if (error || processing_error)
+    {
+        on_send_error(client_index, processing_error, error);
+        return;
+    }
+
+    log(client_index, LogLevel::debug, "Client: %u, written: %lld bytes", static_cast<long long>(bytes_transferred));
+
+    //Turn budget was exhausted on pipelined expressions like: '1 + 2\n3 - 4\n5 * 6\n7 / 8\n'.
+    //Parsing continues in a new handler, so other connections were served in between.
+    //Otherwise next arithmetic expression is received.
+    dispatch_continue(client_index);
+}
+
+void NetCalcCore::on_send_error(unsigned int client_index, bool processing_error, const boost::system::error_code& error)
+{
+    //Session ends with processing error, otherwise it is kept until the client resumes it.
+    if (processing_error)
+    {
+        detach_session(client_index, false);
+    }
+
+    //Clear client object, close connection and dispatch async accept.
+    close_client(client_index);
+
+    if (processing_error)
+    {
+        log(client_index, LogLevel::info, "Client: %u, processing error happens");
+    }
+    else
+    {
+        log(client_index, LogLevel::error, "Client: %u, error %lld on async_write happens", error.value());
+    }
+
+    dispatch_async_accept(client_index);
+}
+
+void NetCalcCore::dispatch_async_accept(unsigned int client_index)
+{
+    auto l = [client_index, &self = *this](const boost::system::error_code& error)
+    {
+        self.handle_accept(client_index, error);
+    };
+
+    if (draining.load(std::memory_order_relaxed))
+    {
+        //Listeners are handed over to the new process, the slot is not used anymore.
+        return;
+    }
+
+    if (adopted_size.load(std::memory_order_relaxed) && adopt_client(client_index))
+    {
+        return;
+    }
+
+    client& c = clients[client_index];
+    c.trace_sampled = false;
+    if (tracer.is_enabled())
+    {
+        //Accept span of a traced connection is measured from here, sampling is decided on accept.
+        c.trace_start = Tracer::now();
+    }
+
+    if (unit_test_mode)
+    {
+        c.unit_test_mode = client_unit_test_mode::async_accept;
+        return;
+    }
+    else if (transport)
+    {
+        transport->async_accept(client_index, get_service(c.service_index),
+            [l](const boost::system::error_code& error, std::size_t) { l(error); });
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(accept_mutex);
+    for (unsigned int i = 0; i < listeners.size(); ++i)
+    {
+        if (listeners[i].held)
+        {
+            take_accepted(i, client_index);
+            dispatch_listener_accept(i);
+            return;
+        }
+    }
+
+    free_clients.push_back(client_index);
+    for (unsigned int i = 0; i < listeners.size(); ++i)
+    {
+        dispatch_listener_accept(i);
+    }
+}
+
+void NetCalcCore::dispatch_listener_accept(unsigned int listener_index)
+{
+    listener& l = listeners[listener_index];
+    if (l.accepting || l.held || free_clients.empty())
+    {
+        return;
+    }
+
+    auto h = [listener_index, &self = *this](const boost::system::error_code& error)
+    {
+        self.handle_listener_accept(listener_index, error);
+    };
+
+    l.accepting = true;
+    if (l.local)
+        unix_acceptor.async_accept(l.socket, h);
+    else
+        acceptor.async_accept(l.socket, h);
+}
+
+void NetCalcCore::handle_listener_accept(unsigned int listener_index, const boost::system::error_code& error)
+{
+    std::deque<unsigned int> cancelled;
+    bool held = false;
+    {
+        std::lock_guard<std::mutex> lock(accept_mutex);
+        listener& l = listeners[listener_index];
+        l.accepting = false;
+
+        if (error == boost::asio::error::operation_aborted)
+        {
+            //Accepts are cancelled when listeners are handed over (free slots are released) or when sockets are
+            //taken over (free slots take them or wait again).
+            cancelled.swap(free_clients);
+        }
+        else if (error)
+        {
+            //Listener accepts again when a slot is freed.
+            logger.write(LogLevel::error, "Listener: %u, error %lld on async_accept happens", listener_index, error.value());
+        }
+        else if (free_clients.empty())
+        {
+            l.held = true;
+            held = true;
+        }
+        else
+        {
+            unsigned int client_index = free_clients.front();
+            free_clients.pop_front();
+            take_accepted(listener_index, client_index);
+            dispatch_listener_accept(listener_index);
+        }
+    }
+
+    for (unsigned int client_index : cancelled)
+    {
+        dispatch_async_accept(client_index);
+    }
+
+    //Slots are not freed while draining, so waiting connection is handed over at once.
+    if (held && draining.load())
+    {
+        hand_over_held();
+    }
+}
+
+void NetCalcCore::take_accepted(unsigned int listener_index, unsigned int client_index)
+{
+    listener& l = listeners[listener_index];
+    l.held = false;
+
+    //Socket is moved by its descriptor, so the socket of slot keeps io_service of slot.
+    client& c = clients[client_index];
+    boost::system::error_code ec;
+    int fd = l.socket.release(ec);
+    if (ec)
+    {
+        boost::system::error_code ignored;
+        l.socket.close(ignored);
+    }
+    else
+    {
+        c.socket.assign(l.protocol, fd, ec);
+        if (ec)
+        {
+            ::close(fd);
+        }
+    }
+    c.local = l.local;
+
+    if (ec)
+    {
+        log(client_index, LogLevel::error, "Client: %u, error %lld on async_accept happens", ec.value());
+        free_clients.push_front(client_index);
+        return;
+    }
+
+    get_service(c.service_index).post([client_index, &self = *this]()
+        {
+            self.handle_accept(client_index, boost::system::error_code());
+        });
+}
+
+void NetCalcCore::dispatch_async_receive(unsigned int client_index)
+{
+    auto l = [client_index, &self = *this](const boost::system::error_code& error, std::size_t bytes_transferred)
+    {
+        self.handle_receive(client_index, error, bytes_transferred);
+    };
+
+    if (draining.load(std::memory_order_relaxed) && hand_over_client(client_index))
+    {
+        return;
+    }
+
+    client& c = clients[client_index];
+    trace_start(client_index);
+    arm_timeout(client_index, false);
+    if (unit_test_mode)
+        c.unit_test_mode = client_unit_test_mode::async_receive;
+    else if (transport)
+        transport->async_receive(client_index, c.buffer, sizeof(c.buffer), get_service(c.service_index), l);
+    else if (handoff_enabled() && is_idle(client_index))
+    {
+        //Idle connection is parked, so draining can cancel its receive and hand it over.
+        client_handoff& h = handoffs[client_index];
+        h.state.store(handoff_state::arming);
+        c.socket.async_receive(boost::asio::buffer(c.buffer), l);
+        h.state.store(handoff_state::parked);
+        if (draining.load())
+        {
+            cancel_parked(client_index);
+        }
+    }
+    else
+        c.socket.async_receive(boost::asio::buffer(c.buffer), l);
+}
+
+void NetCalcCore::dispatch_async_send(unsigned int client_index, bool processing_error)
+{
+    auto l = [client_index, processing_error, &self = *this](const boost::system::error_code& error, std::size_t bytes_transferred)
+    {
+        self.handle_send(client_index, processing_error, error, bytes_transferred);
+    };
+
+    client& c = clients[client_index];
+    trace_start(client_index);
+    arm_timeout(client_index, true);
+    if (unit_test_mode)
+        c.unit_test_mode = client_unit_test_mode::async_send;
+    else if (transport)
+        transport->async_send(client_index, c.response.data(), c.response.size(), get_service(c.service_index), l);
+    else
+        boost::asio::async_write(c.socket, boost::asio::buffer(c.response), l);
+}
+
+void NetCalcCore::dispatch_continue(unsigned int client_index)
+{
+    std::uint64_t delay = get_throttle_delay(client_index);
+    if (delay)
+    {
+        dispatch_throttle(client_index, delay);
+    }
+    else if (clients[client_index].pending_begin != clients[client_index].pending_end)
+    {
+        dispatch_parse(client_index);
+    }
+    else
+    {
+        dispatch_async_receive(client_index);
+    }
+}
+
+void NetCalcCore::dispatch_throttle(unsigned int client_index, std::uint64_t delay)
+{
+    auto l = [client_index, &self = *this](const boost::system::error_code& error)
+    {
+        //Timer is cancelled only when NetCalcCore is destroyed.
+        if (!error)
+        {
+            self.dispatch_continue(client_index);
+        }
+    };
+
+    throttles.fetch_add(1, std::memory_order_relaxed);
+    log(client_index, LogLevel::debug, "Client: %u is throttled for %lld microseconds", static_cast<long long>(delay));
+
+    client& c = clients[client_index];
+    if (unit_test_mode)
+    {
+        c.unit_test_mode = client_unit_test_mode::throttle;
+    }
+    else
+    {
+        c.throttle_timer.expires_from_now(std::chrono::microseconds(delay));
+        c.throttle_timer.async_wait(l);
+    }
+}
+
+std::uint64_t NetCalcCore::get_throttle_delay(unsigned int client_index)
+{
+    if (!cfg.rate_expressions && !cfg.rate_bytes)
+    {
+        return 0;
+    }
+
+    //Buckets hold tokens of one second.
+    client& c = clients[client_index];
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - c.refill_time).count();
+    c.refill_time = now;
+    c.expression_tokens = std::min(c.expression_tokens + seconds * cfg.rate_expressions, static_cast<double>(cfg.rate_expressions));
+    c.byte_tokens = std::min(c.byte_tokens + seconds * cfg.rate_bytes, static_cast<double>(cfg.rate_bytes));
+
+    double wait = 0.0;
+    if (c.pending_begin != c.pending_end)
+    {
+        if (cfg.rate_expressions && c.expression_tokens < 1.0)
+        {
+            wait = (1.0 - c.expression_tokens) / cfg.rate_expressions;
+        }
+    }
+    else if (cfg.rate_bytes && c.byte_tokens < 0.0)
+    {
+        wait = -c.byte_tokens / cfg.rate_bytes;
+    }
+
+    return static_cast<std::uint64_t>(std::ceil(wait * 1000000.0));
+}
+
+void NetCalcCore::dispatch_lag_probe(unsigned int service_index)
+{
+    lag_probe& probe = lag_probes[service_index];
+    probe.timer.expires_from_now(std::chrono::milliseconds(lag_probe_interval_ms));
+    probe.timer.async_wait([service_index, &self = *this](const boost::system::error_code& error)
+        {
+            if (error)
+            {
+                return;
+            }
+
+            //Handler is called after handlers that were queued before expiration of timer.
+            lag_probe& probe = self.lag_probes[service_index];
+            std::chrono::steady_clock::duration delay = std::chrono::steady_clock::now() - probe.timer.expires_at();
+            std::uint64_t sample = static_cast<std::uint64_t>(std::max<long long>(0,
+                std::chrono::duration_cast<std::chrono::microseconds>(delay).count()));
+            probe.lag.store((probe.lag.load(std::memory_order_relaxed) * 7 + sample) / 8, std::memory_order_relaxed);
+
+            self.dispatch_lag_probe(service_index);
+        });
+}
+
+void NetCalcCore::dispatch_bulk_parse(unsigned int client_index)
+{
+    auto l = [client_index, &self = *this]()
+    {
+        self.parse_result(client_index);
+    };
+
+    client& c = clients[client_index];
+    if (unit_test_mode)
+        c.unit_test_mode = client_unit_test_mode::bulk_parse;
+    else
+        bulk_service.post(l);
+}
+
+void NetCalcCore::dispatch_parse(unsigned int client_index)
+{
+    if (clients[client_index].heavy)
+    {
+        dispatch_bulk_parse(client_index);
+    }
+    else
+    {
+        parse_result(client_index);
+    }
+}
+
+void NetCalcCore::acquire_pipeline(unsigned int client_index)
+{
+    client& c = clients[client_index];
+    if (c.evaluator || c.session_token)
+    {
+        //Pipelines evaluate int32 expressions only, state of session is kept by connection itself.
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pipelines_mutex);
+        if (free_pipelines.empty())
+        {
+            return;
+        }
+        c.pipeline = free_pipelines.back();
+        free_pipelines.pop_back();
+    }
+
+    //Pipeline continues expression from the current state of ShuntingYard.
+    c.pipeline->resume(c.shunting_yard);
+}
+
+void NetCalcCore::release_pipeline(unsigned int client_index)
+{
+    client& c = clients[client_index];
+    std::lock_guard<std::mutex> lock(pipelines_mutex);
+    free_pipelines.push_back(c.pipeline);
+    c.pipeline = nullptr;
+}
+
+bool NetCalcCore::dispatch_parallel_parse(unsigned int client_index)
+{
+    client& c = clients[client_index];
+    if (!cfg.parallel_threads || c.evaluator || cfg.rate_expressions || c.heavy || c.expression_bytes || c.shed ||
+        !c.command.empty() || is_overloaded(c.service_index))
+    {
+        return false;
+    }
+
+    //Complete lines end with the last '\n' of pending data.
+    const char* begin = c.buffer + c.pending_begin;
+    std::size_t size = c.pending_end - c.pending_begin;
+    while (size && begin[size - 1] != '\n')
+    {
+        --size;
+    }
+
+    //Commands change numeric type of the next lines, so lines with command are parsed sequentially.
+    if (std::memchr(begin, command_prefix, size))
+    {
+        return false;
+    }
+
+    unsigned int chunks = std::min(cfg.parallel_threads, static_cast<unsigned int>(size / cfg.parallel_chunk));
+    if (chunks < 2)
+    {
+        return false;
+    }
+
+    if (!c.parallel)
+    {
+        c.parallel.reset(new parallel_batch());
+    }
+
+    //Chunks have about equal size and end at '\n' (a long line makes fewer chunks).
+    parallel_batch& batch = *c.parallel;
+    batch.chunks.resize(chunks);
+    const char* end = begin + size;
+    const char* chunk_begin = begin;
+    unsigned int count = 0;
+    while (chunk_begin != end)
+    {
+        const char* chunk_end = count + 1 == chunks ? end : std::min(end, chunk_begin + size / chunks);
+        chunk_end = static_cast<const char*>(std::memchr(chunk_end - 1, '\n', static_cast<std::size_t>(end - chunk_end + 1))) + 1;
+
+        parallel_chunk& chunk = batch.chunks[count++];
+        chunk.begin = chunk_begin;
+        chunk.size = static_cast<std::size_t>(chunk_end - chunk_begin);
+        chunk_begin = chunk_end;
+    }
+    batch.chunks.resize(count);
+    batch.left.store(count);
+    c.pending_begin += size;
+    c.session_offset += size;
+
+    log(client_index, LogLevel::debug, "Client: %u, %lld bytes are evaluated in parallel", static_cast<long long>(size));
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto l = [client_index, i, &self = *this]()
+        {
+            self.parallel_parse(client_index, i);
+        };
+
+        if (unit_test_mode)
+            c.unit_test_mode = client_unit_test_mode::parallel_parse;
+        else
+            parallel_service.post(l);
+    }
+
+    return true;
+}
+
+void NetCalcCore::parallel_parse(unsigned int client_index, std::size_t chunk_index)
+{
+    //Each parallel thread has its own ShuntingYard, it is clean after each complete line.
+    static thread_local ShuntingYardInt shunting_yard;
+
+    client& c = clients[client_index];
+    parallel_batch& batch = *c.parallel;
+    parallel_chunk& chunk = batch.chunks[chunk_index];
+    chunk.results.clear();
+    chunk.error = false;
+
+    const char* begin = chunk.begin;
+    const char* end = chunk.begin + chunk.size;
+    while (begin != end && !chunk.error)
+    {
+        const char* end_of_expression = static_cast<const char*>(std::memchr(begin, '\n', static_cast<std::size_t>(end - begin)));
+        ShuntingYardInt::Result parse_result = shunting_yard.parse(begin, static_cast<std::size_t>(end_of_expression - begin) + 1);
+        begin = end_of_expression + 1;
+
+        chunk.error = append_result(parse_result, chunk.results) != EvaluationStatus::Success;
+    }
+
+    if (chunk.error)
+    {
+        shunting_yard.clear();
+    }
+
+    //The last evaluated chunk continues processing of connection in its event loop.
+    if (batch.left.fetch_sub(1) == 1)
+    {
+        if (unit_test_mode)
+        {
+            finish_parallel_parse(client_index);
+        }
+        else
+        {
+            get_service(c.service_index).post([client_index, &self = *this]() { self.finish_parallel_parse(client_index); });
+        }
+    }
+}
+
+void NetCalcCore::finish_parallel_parse(unsigned int client_index)
+{
+    client& c = clients[client_index];
+    bool processing_error = false;
+
+    c.response.clear();
+    for (const parallel_chunk& chunk : c.parallel->chunks)
+    {
+        c.response += chunk.results;
+        c.session_results += static_cast<unsigned long long>(std::count(chunk.results.begin(), chunk.results.end(), '\n'));
+        if (chunk.error)
+        {
+            processing_error = true;
+            break;
+        }
+    }
+
+    dispatch_async_send(client_index, processing_error);
+}
+
+void NetCalcCore::parse_result(unsigned int client_index)
+{
+    if (dispatch_parallel_parse(client_index))
+    {
+        return;
+    }
+
+    //Pending data can contain many expressions like: '1 + 2\n3 - 4\n5 * 6\n7 / 8\n'.
+    //Results are collected into one response until the end of data or the end of turn budget.
+    bool processing_error = false;
+    client& c = clients[client_index];
+    unsigned int expressions = 0;
+    std::size_t bytes = 0;
+
+    c.response.clear();
+    do
+    {
+        //ShuntingYard gets one expression per call, so it doesn't copy the rest of data to its remainder.
+        std::size_t size = c.pending_end - c.pending_begin;
+        const char* data = size ? c.buffer + c.pending_begin : nullptr;
+        const char* end_of_expression = data ? static_cast<const char*>(std::memchr(data, '\n', size)) : nullptr;
+        if (end_of_expression)
+        {
+            size = static_cast<std::size_t>(end_of_expression - data) + 1;
+        }
+
+        //Command line is collected up to '\n' (it can be split between receives) and executed between expressions.
+        if (!c.command.empty() || (data && *data == command_prefix && !c.expression_bytes && !c.shed))
+        {
+            c.pending_begin += size;
+            c.session_offset += size;
+            bytes += size;
+            c.command.append(data, size);
+            if (end_of_expression)
+            {
+                ++c.session_results;
+                processing_error = !execute_command(client_index);
+                c.command.clear();
+                ++expressions;
+            }
+            else if (c.command.size() > max_command_size)
+            {
+                c.response += "Invalid command\n";
+                processing_error = true;
+            }
+            continue;
+        }
+
+        //New expression of overloaded event loop is rejected, its bytes are skipped without parsing.
+        c.shed = c.shed || (!c.expression_bytes && is_overloaded(c.service_index));
+        if (c.shed)
+        {
+            c.pending_begin += size;
+            c.session_offset += size;
+            bytes += size;
+            if (end_of_expression)
+            {
+                c.response += "Server busy\n";
+                c.shed = false;
+                ++expressions;
+                ++c.session_results;
+                shed_expressions.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+
+        if (c.heavy && cfg.bulk_budget && size > cfg.bulk_budget)
+        {
+            //Heavy connection yields bulk thread to other heavy connections after cfg.bulk_budget bytes.
+            size = cfg.bulk_budget;
+        }
+        c.pending_begin += size;
+        c.session_offset += size;
+        bytes += size;
+
+        //Parse time is measured only if it can make connection heavy.
+        bool measure = cfg.bulk_threads && cfg.heavy_parse_time && !c.heavy;
+        std::chrono::steady_clock::time_point start = measure ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+        //Slow-expression log measures expressions that are long or split between parse calls (see slow_measure_bytes).
+        bool slow_measure = cfg.slow_expression && size && (size >= slow_measure_bytes || !end_of_expression || c.expression_bytes);
+        std::uint64_t cpu_start = 0;
+        if (slow_measure)
+        {
+            if (!c.slow_measured)
+            {
+                c.slow_measured = true;
+                c.slow_start = std::chrono::steady_clock::now();
+                c.slow_cpu = 0;
+                c.slow_prefix.assign(data, std::min(size, slow_prefix_size));
+            }
+            cpu_start = thread_cpu_time();
+        }
+
+        trace_start(client_index);
+        EvaluationStatus status = c.evaluator ? c.evaluator->parse(data, size, c.response) :
+            append_result(c.pipeline ? c.pipeline->parse(data, size) : c.shunting_yard.parse(data, size), c.response);
+        trace(client_index, TracePhase::parse, static_cast<long long>(size));
+
+        if (slow_measure)
+        {
+            c.slow_cpu += thread_cpu_time() - cpu_start;
+        }
+
+        switch (status)
+        {
+            case EvaluationStatus::Success:
+                ++expressions;
+                ++c.session_results;
+                c.expression_tokens -= 1.0;
+                break;
+            case EvaluationStatus::Incomplete:
+                break;
+            case EvaluationStatus::Error:
+                processing_error = true;
+                break;
+        }
+
+        if (status != EvaluationStatus::Incomplete)
+        {
+            if (c.slow_measured)
+            {
+                c.slow_measured = false;
+                std::uint64_t wall = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - c.slow_start).count());
+                if (wall >= cfg.slow_expression)
+                {
+                    log_slow_expression(client_index, wall, c.expression_bytes + size);
+                }
+            }
+
+            c.expression_bytes = 0;
+            c.heavy = false;
+            if (c.pipeline)
+            {
+                release_pipeline(client_index);
+            }
+        }
+        else
+        {
+            if (!c.expression_bytes)
+            {
+                c.expression_start = now_ms();
+            }
+            c.expression_bytes += size;
+
+            if (cfg.bulk_threads && !c.heavy && (
+                (cfg.heavy_bytes && c.expression_bytes >= cfg.heavy_bytes) ||
+                (measure && std::chrono::steady_clock::now() - start >= std::chrono::microseconds(cfg.heavy_parse_time))))
+            {
+                c.heavy = true;
+                log(client_index, LogLevel::info, "Client: %u is heavy, its expression is parsed by bulk threads (%lld bytes)",
+                    static_cast<long long>(c.expression_bytes));
+                acquire_pipeline(client_index);
+            }
+        }
+    }
+    while (!processing_error && !c.heavy && c.pending_begin != c.pending_end &&
+           (!cfg.turn_expressions || expressions < cfg.turn_expressions) &&
+           (!cfg.turn_bytes || bytes < cfg.turn_bytes) &&
+           (!cfg.rate_expressions || c.expression_tokens >= 1.0));
+
+    if (!c.response.empty())
+    {
+        //The rest of pending data is parsed after the response is sent (see handle_send()).
+        dispatch_async_send(client_index, processing_error);
+    }
+    else
+    {
+        //Heavy connection has not parsed data yet or all data is parsed.
+        dispatch_continue(client_index);
+    }
+}
+
+void NetCalcCore::log_slow_expression(unsigned int client_index, std::uint64_t wall, unsigned long long bytes)
+{
+    slow_expressions.fetch_add(1, std::memory_order_relaxed);
+    if (!logger.is_enabled(LogLevel::info))
+    {
+        return;
+    }
+
+    //At most cfg.slow_log_rate records per second: the first record of a new second resets the counter.
+    std::uint64_t second = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - start_time).count());
+    std::uint64_t current = slow_log_second.load(std::memory_order_relaxed);
+    if (current < second && slow_log_second.compare_exchange_strong(current, second, std::memory_order_relaxed))
+    {
+        slow_log_records.store(0, std::memory_order_relaxed);
+    }
+    if (slow_log_records.fetch_add(1, std::memory_order_relaxed) >= cfg.slow_log_rate)
+    {
+        return;
+    }
+
+    client& c = clients[client_index];
+    const ShuntingYardStatistics statistics = c.evaluator ? c.evaluator->statistics() :
+        c.pipeline ? c.pipeline->statistics() : c.shunting_yard.statistics();
+
+    char buffer[256];
+    int n = std::snprintf(buffer, sizeof(buffer),
+        "Client: %u, slow expression: wall %llu us, CPU %llu us, %llu bytes, %llu tokens, depth %u, prefix '",
+        client_index, static_cast<unsigned long long>(wall), static_cast<unsigned long long>(c.slow_cpu / 1000), bytes,
+        static_cast<unsigned long long>(statistics.tokens), statistics.depth);
+    std::string text(buffer, n > 0 ? std::min(static_cast<std::size_t>(n), sizeof(buffer) - 1) : 0);
+
+    //Prefix is printable: control characters are replaced by '.', it ends at the end of expression.
+    for (char ch : c.slow_prefix)
+    {
+        if (ch == '\n')
+        {
+            break;
+        }
+        text += ch >= ' ' && ch <= '~' ? ch : '.';
+    }
+    text += bytes > c.slow_prefix.size() ? "...'" : "'";
+
+    logger.write_text(LogLevel::info, text);
+}
+
+std::unique_ptr<Evaluator> NetCalcCore::make_client_evaluator(NumericType type, std::uint64_t modulus)
+{
+    return type != NumericType::int32 ? make_evaluator(type, modulus) : nullptr;
+}
+
+bool NetCalcCore::execute_command(unsigned int client_index)
+{
+    client& c = clients[client_index];
+    std::istringstream command(c.command);
+    std::string name;
+    NumericType type = NumericType::int32;
+    std::uint64_t modulus = cfg.modulus;
+    std::string rest;
+
+    command >> name;
+    if (name == "#session" || name == "#resume")
+    {
+        return execute_session_command(client_index, name, command);
+    }
+
+    //Modulus is optional, it is accepted by mod64 type only.
+    command >> type;
+    bool valid = name == "#type" && command;
+    if (valid && type == NumericType::mod64 && command >> rest)
+    {
+        valid = rest.find_first_not_of("0123456789") == std::string::npos && rest.size() <= 20;
+        modulus = valid ? std::strtoull(rest.c_str(), nullptr, 10) : 0;
+        valid = valid && modulus >= 2 && rest == std::to_string(modulus);
+    }
+    valid = valid && !(command >> rest);
+
+    if (!valid)
+    {
+        c.response += "Invalid command\n";
+        log(client_index, LogLevel::error, "Client: %u sent invalid command (%lld bytes)", static_cast<long long>(c.command.size()));
+        return false;
+    }
+
+    c.evaluator = make_client_evaluator(type, modulus);
+    c.negotiated = true;
+    c.response += "OK\n";
+    log(client_index, LogLevel::debug, "Client: %u selected numeric type %lld", static_cast<long long>(type));
+    return true;
+}
+
+bool NetCalcCore::execute_session_command(unsigned int client_index, const std::string& name, std::istream& command)
+{
+    client& c = clients[client_index];
+    const bool resume = name == "#resume";
+    std::string token_text;
+    std::string rest;
+
+    //Token is 16 hexadecimal digits (see reply of '#session').
+    bool valid = cfg.sessions && !c.session_token &&
+        (!resume || (command >> token_text && token_text.size() == 16 &&
+                     token_text.find_first_not_of("0123456789abcdef") == std::string::npos)) &&
+        !(command >> rest);
+    std::uint64_t token = valid && resume ? std::strtoull(token_text.c_str(), nullptr, 16) : 0;
+
+    if (valid)
+    {
+        std::uint64_t now = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count());
+
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+
+        //Session timer runs once per cfg.session_timeout, so a session can expire between its checks.
+        drop_expired_sessions(now);
+
+        if (resume)
+        {
+            auto it = sessions.find(token);
+            valid = it != sessions.end() && !it->second.attached;
+            if (valid)
+            {
+                //Connection is between expressions, so its parser is empty and it can be swapped with state of session.
+                session& s = it->second;
+                s.attached = true;
+                std::swap(c.shunting_yard, s.shunting_yard);
+                std::swap(c.evaluator, s.evaluator);
+                c.negotiated = s.negotiated;
+                c.expression_bytes = s.expression_bytes;
+                c.expression_start = now_ms();
+                c.shed = s.shed;
+                c.session_offset = s.offset;
+                c.session_results = s.results;
+                resumed_sessions.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            if (sessions.size() >= cfg.sessions)
+            {
+                auto oldest = sessions.end();
+                for (auto it = sessions.begin(); it != sessions.end(); ++it)
+                {
+                    if (!it->second.attached && (oldest == sessions.end() || it->second.detach_time < oldest->second.detach_time))
+                    {
+                        oldest = it;
+                    }
+                }
+                if (oldest != sessions.end())
+                {
+                    sessions.erase(oldest);
+                }
+            }
+
+            //Token is the only secret of session, so it is taken from the kernel CSPRNG.
+            valid = sessions.size() < cfg.sessions;
+            while (valid && (!token || sessions.count(token)))
+            {
+                valid = random_token(token);
+            }
+            if (valid)
+            {
+                sessions[token];
+                c.session_offset = 0;
+                c.session_results = 0;
+            }
+        }
+    }
+
+    if (!valid)
+    {
+        c.response += "Invalid command\n";
+        log(client_index, LogLevel::error, "Client: %u sent invalid session command (%lld bytes)", static_cast<long long>(c.command.size()));
+        return false;
+    }
+
+    c.session_token = token;
+    char reply[64];
+    int n = resume ?
+        std::snprintf(reply, sizeof(reply), "OK %llu %llu\n", static_cast<unsigned long long>(c.session_offset), c.session_results) :
+        std::snprintf(reply, sizeof(reply), "OK %016llx\n", static_cast<unsigned long long>(token));
+    c.response.append(reply, static_cast<std::size_t>(n));
+    log(client_index, LogLevel::info, resume ? "Client: %u resumed session at offset %lld" : "Client: %u started session",
+        static_cast<long long>(c.session_offset));
+    return true;
+}
+
+void NetCalcCore::detach_session(unsigned int client_index, bool keep)
+{
+    client& c = clients[client_index];
+    if (!c.session_token)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        auto it = sessions.find(c.session_token);
+        if (it != sessions.end() && !keep)
+        {
+            sessions.erase(it);
+        }
+        else if (it != sessions.end())
+        {
+            //Pending data is empty or it is not counted in session_offset, so state matches session_offset exactly.
+            session& s = it->second;
+            std::swap(c.shunting_yard, s.shunting_yard);
+            std::swap(c.evaluator, s.evaluator);
+            s.negotiated = c.negotiated;
+            s.expression_bytes = c.expression_bytes;
+            s.shed = c.shed;
+            s.offset = c.session_offset;
+            s.results = c.session_results;
+            s.attached = false;
+            s.detach_time = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start_time).count());
+        }
+    }
+
+    //Connection gets parser of session that was swapped on resume (it is empty) or a new evaluator of cfg.type.
+    c.negotiated = true;
+    c.session_token = 0;
+}
+
+void NetCalcCore::drop_expired_sessions(std::uint64_t now)
+{
+    for (auto it = sessions.begin(); it != sessions.end();)
+    {
+        if (!it->second.attached && now - it->second.detach_time >= cfg.session_timeout)
+        {
+            it = sessions.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void NetCalcCore::dispatch_session_check()
+{
+    session_timer.expires_from_now(std::chrono::milliseconds(std::max(cfg.session_timeout, 1u)));
+    session_timer.async_wait([&self = *this](const boost::system::error_code& error)
+        {
+            if (!error)
+            {
+                std::uint64_t now = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - self.start_time).count());
+                {
+                    std::lock_guard<std::mutex> lock(self.sessions_mutex);
+                    self.drop_expired_sessions(now);
+                }
+                self.dispatch_session_check();
+            }
+        });
+}
+
+void NetCalcCore::close_client(unsigned int client_index)
+{
+    client& c = clients[client_index];
+    detach_session(client_index, true);
+    c.shunting_yard.clear();
+    c.command.clear();
+    if (c.negotiated)
+    {
+        c.evaluator = make_client_evaluator(cfg.type, cfg.modulus);
+        c.negotiated = false;
+    }
+    if (c.evaluator)
+    {
+        c.evaluator->clear();
+    }
+    if (c.pipeline)
+    {
+        c.pipeline->clear();
+        release_pipeline(client_index);
+    }
+    if (capture.is_enabled())
+    {
+        capture.close(c.capture_id);
+    }
+    if (transport)
+    {
+        transport->close(client_index);
+    }
+    c.socket.close();
+    c.pending_begin = 0;
+    c.pending_end = 0;
+    c.expression_bytes = 0;
+    c.heavy = false;
+    c.shed = false;
+    c.slow_measured = false;
+
+    if (handoff_enabled() && active_connections.fetch_sub(1) == 1 && draining.load())
+    {
+        std::lock_guard<std::mutex> lock(handoff_mutex);
+        handoff_condition.notify_all();
+    }
+}
+
+void NetCalcCore::take_over()
+{
+    int peer = handoff_connect(cfg.handoff_socket);
+    std::vector<HandoffDescriptor> descriptors;
+    if (peer >= 0 && handoff_receive(peer, descriptors, handoff_timeout_ms))
+    {
+        for (const HandoffDescriptor& d : descriptors)
+        {
+            boost::system::error_code ec;
+            if (d.kind == HandoffKind::tcp_listener && !acceptor.is_open())
+            {
+                //Listener of the old process can be bound to IPv6 address.
+                const boost::asio::ip::tcp protocol =
+                    socket_family(d.fd) == AF_INET6 ? boost::asio::ip::tcp::v6() : boost::asio::ip::tcp::v4();
+                acceptor.assign(protocol, d.fd, ec);
+            }
+            else if (d.kind == HandoffKind::unix_listener && !unix_acceptor.is_open())
+            {
+                unix_acceptor.assign(boost::asio::local::stream_protocol(), d.fd, ec);
+            }
+            else
+            {
+                ec = boost::asio::error::invalid_argument;
+            }
+
+            if (ec)
+            {
+                ::close(d.fd);
+            }
+        }
+
+        handoff_peer = peer;
+        logger.write(LogLevel::info, "Hot restart: %u listeners are taken over",
+            static_cast<unsigned int>(acceptor.is_open()) + static_cast<unsigned int>(unix_acceptor.is_open()));
+    }
+    else if (peer >= 0)
+    {
+        ::close(peer);
+    }
+
+    init_listeners();
+
+    //The old process keeps its listening socket of handoff, it is not reachable by path anymore.
+    handoff_listener = handoff_listen(cfg.handoff_socket);
+    if (handoff_listener < 0)
+    {
+        int error = errno;
+        if (handoff_peer >= 0)
+        {
+            ::close(handoff_peer);
+        }
+        throw boost::system::system_error(error, boost::system::system_category(), "handoff socket");
+    }
+}
+
+void NetCalcCore::run_handoff()
+{
+    //The old process sends idle connections while it drains and 'end' when it has finished.
+    std::vector<HandoffDescriptor> descriptors;
+    while (handoff_peer >= 0 && handoff_receive(handoff_peer, descriptors, -1))
+    {
+        bool end = false;
+        std::size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(handoff_mutex);
+            for (const HandoffDescriptor& d : descriptors)
+            {
+                if (d.kind == HandoffKind::tcp_client || d.kind == HandoffKind::unix_client)
+                {
+                    adopted.push_back(d);
+                    ++count;
+                }
+                else if (d.kind == HandoffKind::end)
+                {
+                    end = true;
+                }
+                else
+                {
+                    ::close(d.fd);
+                }
+            }
+            adopted_size.store(static_cast<unsigned int>(adopted.size()));
+        }
+
+        if (count)
+        {
+            //Free slots take sockets when accepts of listeners are cancelled (see handle_listener_accept()),
+            //busy slots take them when their connections are closed.
+            cancel_listeners();
+        }
+
+        if (end)
+        {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(handoff_mutex);
+        if (handoff_peer >= 0)
+        {
+            ::close(handoff_peer);
+            handoff_peer = -1;
+        }
+    }
+
+    //Wait for the next new process.
+    for (;;)
+    {
+        int peer = ::accept4(handoff_listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (peer < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+
+            //Listener is shut down by stop().
+            return;
+        }
+
+        if (!handoff_trusted(peer))
+        {
+            logger.write_text(LogLevel::error, "Hot restart: process of another user is rejected");
+            ::close(peer);
+            continue;
+        }
+
+        if (hand_over(peer))
+        {
+            return;
+        }
+    }
+}
+
+bool NetCalcCore::hand_over(int peer)
+{
+    std::vector<HandoffDescriptor> descriptors;
+    if (acceptor.is_open())
+    {
+        descriptors.push_back(HandoffDescriptor{HandoffKind::tcp_listener, acceptor.native_handle()});
+    }
+    if (unix_acceptor.is_open())
+    {
+        descriptors.push_back(HandoffDescriptor{HandoffKind::unix_listener, unix_acceptor.native_handle()});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(handoff_mutex);
+        if (handoff_stopped || !handoff_send(peer, descriptors))
+        {
+            ::close(peer);
+            return false;
+        }
+        handoff_peer = peer;
+    }
+
+    draining.store(true);
+    logger.write(LogLevel::info, "Hot restart: listeners are handed over, %u connections are drained",
+        active_connections.load());
+
+    //Free slots are released (see handle_listener_accept()), parked connections and connections that wait for a slot
+    //are handed over at once, other connections are handed over when they finish their expressions
+    //(see dispatch_async_receive()).
+    cancel_listeners();
+    hand_over_held();
+    for (unsigned int i = 0; i < cfg.clients; ++i)
+    {
+        cancel_parked(i);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(handoff_mutex);
+        handoff_condition.wait_for(lock, std::chrono::milliseconds(cfg.drain_timeout),
+            [this]() { return !active_connections.load() || handoff_stopped; });
+
+        handoff_send(peer, {HandoffDescriptor{HandoffKind::end, -1}});
+        ::close(peer);
+        handoff_peer = -1;
+    }
+
+    logger.write(LogLevel::info, "Hot restart: draining is finished, %u connections are left", active_connections.load());
+    if (handoff_handler)
+    {
+        handoff_handler();
+    }
+    return true;
+}
+
+bool NetCalcCore::is_idle(unsigned int client_index) const
+{
+    const client& c = clients[client_index];
+    return !c.expression_bytes && !c.shed && !c.heavy && c.command.empty() && c.pending_begin >= c.pending_end &&
+        !c.session_token && !c.negotiated;
+}
+
+bool NetCalcCore::hand_over_client(unsigned int client_index)
+{
+    client& c = clients[client_index];
+    boost::system::error_code ec;
+    if (!is_idle(client_index) || !c.socket.is_open())
+    {
+        return false;
+    }
+
+    //Kind is taken from socket: a slot can serve a socket of another listener that was taken over.
+    const bool local = c.socket.local_endpoint(ec).protocol().family() == AF_UNIX;
+    if (ec)
+    {
+        return false;
+    }
+
+    bool sent = false;
+    {
+        std::lock_guard<std::mutex> lock(handoff_mutex);
+        sent = handoff_peer >= 0 && handoff_send(handoff_peer,
+            {HandoffDescriptor{local ? HandoffKind::unix_client : HandoffKind::tcp_client, c.socket.native_handle()}});
+    }
+
+    if (!sent)
+    {
+        return false;
+    }
+
+    handed_over_connections.fetch_add(1, std::memory_order_relaxed);
+    log(client_index, LogLevel::info, "Client: %u is handed over to new process");
+
+    //The new process has its own descriptor of socket, the slot is not used anymore (see dispatch_async_accept()).
+    close_client(client_index);
+    return true;
+}
+
+void NetCalcCore::hand_over_held()
+{
+    std::lock_guard<std::mutex> lock(accept_mutex);
+    for (listener& l : listeners)
+    {
+        if (!l.held)
+        {
+            continue;
+        }
+
+        bool sent = false;
+        {
+            std::lock_guard<std::mutex> handoff_lock(handoff_mutex);
+            sent = handoff_peer >= 0 && handoff_send(handoff_peer,
+                {HandoffDescriptor{l.local ? HandoffKind::unix_client : HandoffKind::tcp_client, l.socket.native_handle()}});
+        }
+        if (sent)
+        {
+            handed_over_connections.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //The new process has its own descriptor of socket (otherwise the client connects again).
+        boost::system::error_code ec;
+        l.socket.close(ec);
+        l.held = false;
+    }
+}
+
+void NetCalcCore::cancel_listeners()
+{
+    service.post([&self = *this]()
+        {
+            std::lock_guard<std::mutex> lock(self.accept_mutex);
+            boost::system::error_code ec;
+            self.acceptor.cancel(ec);
+            self.unix_acceptor.cancel(ec);
+        });
+}
+
+bool NetCalcCore::adopt_client(unsigned int client_index)
+{
+    HandoffDescriptor d;
+    {
+        std::lock_guard<std::mutex> lock(handoff_mutex);
+        if (adopted.empty())
+        {
+            return false;
+        }
+        d = adopted.front();
+        adopted.pop_front();
+        adopted_size.store(static_cast<unsigned int>(adopted.size()));
+    }
+
+    client& c = clients[client_index];
+    boost::system::error_code ec;
+    if (d.kind == HandoffKind::unix_client)
+    {
+        c.socket.assign(boost::asio::generic::stream_protocol(AF_UNIX, 0), d.fd, ec);
+    }
+    else
+    {
+        const int family = socket_family(d.fd) == AF_INET6 ? AF_INET6 : AF_INET;
+        c.socket.assign(boost::asio::generic::stream_protocol(family, IPPROTO_TCP), d.fd, ec);
+    }
+
+    if (ec)
+    {
+        ::close(d.fd);
+        log(client_index, LogLevel::error, "Client: %u, error %lld on adoption of socket happens", ec.value());
+        return false;
+    }
+
+    adopted_connections.fetch_add(1, std::memory_order_relaxed);
+    get_service(c.service_index).post([client_index, &self = *this]()
+        {
+            self.handle_accept(client_index, boost::system::error_code());
+        });
+    return true;
+}
+
+void NetCalcCore::cancel_parked(unsigned int client_index)
+{
+    client_handoff& h = handoffs[client_index];
+    handoff_state state = handoff_state::parked;
+    if (h.state.compare_exchange_strong(state, handoff_state::cancelling))
+    {
+        //Handler can't close the socket meanwhile, it waits for 'parked' state (see leave_parked()).
+        boost::system::error_code ec;
+        clients[client_index].socket.cancel(ec);
+        h.state.store(handoff_state::parked);
+    }
+}
+
+void NetCalcCore::leave_parked(unsigned int client_index)
+{
+    client_handoff& h = handoffs[client_index];
+    handoff_state state = handoff_state::parked;
+    while (!h.state.compare_exchange_weak(state, handoff_state::active))
+    {
+        if (state == handoff_state::active)
+        {
+            return;
+        }
+
+        //Receive is being started or cancelled by another thread (arming, cancelling) or CAS failed spuriously (parked).
+        if (state != handoff_state::parked)
+        {
+            cpu_relax();
+        }
+        state = handoff_state::parked;
+    }
+}
+
+void NetCalcCore::arm_timeout(unsigned int client_index, bool sending)
+{
+    if (!timeouts_enabled())
+    {
+        return;
+    }
+
+    client& c = clients[client_index];
+    client_timeout& t = timeouts[client_index];
+    const std::uint64_t now = now_ms();
+    std::uint64_t deadline = 0;
+    c.reason = timeout_reason::none;
+
+    auto limit = [&deadline, &c](std::uint64_t value, timeout_reason reason)
+    {
+        if (!deadline || value < deadline)
+        {
+            deadline = value;
+            c.reason = reason;
+        }
+    };
+
+    if (cfg.idle_timeout)
+    {
+        limit(now + cfg.idle_timeout, timeout_reason::idle);
+    }
+
+    if (!sending && c.expression_bytes)
+    {
+        if (cfg.expression_timeout)
+        {
+            limit(c.expression_start + cfg.expression_timeout, timeout_reason::expression);
+        }
+
+        if (cfg.min_receive_rate)
+        {
+            //Received bytes are enough for 1 second plus expression_bytes / min_receive_rate seconds since expression start.
+            limit(c.expression_start + 1000 + c.expression_bytes * 1000 / cfg.min_receive_rate, timeout_reason::slow_receive);
+        }
+    }
+
+    t.deadline.store(deadline, std::memory_order_relaxed);
+    t.state.store(timeout_state::waiting);
+    if (!deadline)
+    {
+        return;
+    }
+
+    //Entry with earlier deadline re-inserts connection with the new deadline when it is visited (see check_timeouts()).
+    std::uint64_t wheel_deadline = t.wheel_deadline.load();
+    do
+    {
+        if (wheel_deadline && wheel_deadline <= deadline)
+        {
+            return;
+        }
+    }
+    while (!t.wheel_deadline.compare_exchange_weak(wheel_deadline, deadline));
+
+    timer_wheel.insert(client_index, deadline);
+}
+
+bool NetCalcCore::disarm_timeout(unsigned int client_index)
+{
+    if (!timeouts_enabled())
+    {
+        return false;
+    }
+
+    client_timeout& t = timeouts[client_index];
+    timeout_state state = timeout_state::waiting;
+    while (!t.state.compare_exchange_weak(state, timeout_state::active))
+    {
+        if (state == timeout_state::expired)
+        {
+            t.state.store(timeout_state::active);
+            return true;
+        }
+
+        //Timer thread is shutting down the socket (cancelling) or CAS failed spuriously (waiting).
+        if (state == timeout_state::cancelling)
+        {
+            cpu_relax();
+        }
+        state = timeout_state::waiting;
+    }
+
+    return false;
+}
+
+void NetCalcCore::on_timeout(unsigned int client_index)
+{
+    client& c = clients[client_index];
+    switch (c.reason)
+    {
+        case timeout_reason::expression:
+            expression_timeouts.fetch_add(1, std::memory_order_relaxed);
+            log(client_index, LogLevel::info, "Client: %u is closed, expression is not completed in time (%lld bytes)",
+                static_cast<long long>(c.expression_bytes));
+            break;
+        case timeout_reason::slow_receive:
+            slow_receives.fetch_add(1, std::memory_order_relaxed);
+            log(client_index, LogLevel::info, "Client: %u is closed, expression is received too slowly (%lld bytes)",
+                static_cast<long long>(c.expression_bytes));
+            break;
+        default:
+            idle_timeouts.fetch_add(1, std::memory_order_relaxed);
+            log(client_index, LogLevel::info, "Client: %u is closed by idle timeout");
+            break;
+    }
+
+    close_client(client_index);
+    dispatch_async_accept(client_index);
+}
+
+void NetCalcCore::dispatch_timeout_check()
+{
+    timeout_timer.expires_from_now(std::chrono::milliseconds(timer_wheel.get_tick()));
+    timeout_timer.async_wait([&self = *this](const boost::system::error_code& error)
+        {
+            if (!error)
+            {
+                self.check_timeouts(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - self.start_time).count()));
+                self.dispatch_timeout_check();
+            }
+        });
+}
+
+void NetCalcCore::check_timeouts(std::uint64_t now)
+{
+    coarse_now.store(now, std::memory_order_relaxed);
+
+    timer_wheel.advance(now, [this](unsigned int client_index, std::uint64_t entry_deadline, std::uint64_t now) -> std::uint64_t
+        {
+            client_timeout& t = timeouts[client_index];
+            if (t.wheel_deadline.load() != entry_deadline)
+            {
+                //arm_timeout() has inserted entry with earlier deadline.
+                return 0;
+            }
+
+            if (t.state.load() == timeout_state::waiting)
+            {
+                std::uint64_t deadline = t.deadline.load(std::memory_order_relaxed);
+                if (deadline > now)
+                {
+                    return t.wheel_deadline.compare_exchange_strong(entry_deadline, deadline) ? deadline : 0;
+                }
+
+                timeout_state state = timeout_state::waiting;
+                if (deadline && t.state.compare_exchange_strong(state, timeout_state::cancelling))
+                {
+                    //Pending receive/send (or the next step of async_write) completes with error at once.
+                    //Handler can't close the socket meanwhile, it waits for 'expired' state.
+                    boost::system::error_code ec;
+                    if (transport && !unit_test_mode)
+                    {
+                        transport->shutdown(client_index);
+                    }
+                    else if (!unit_test_mode)
+                    {
+                        clients[client_index].socket.shutdown(boost::asio::socket_base::shutdown_both, ec);
+                    }
+                    t.state.store(timeout_state::expired);
+                }
+            }
+
+            //Connection leaves wheel, arm_timeout() inserts it again.
+            //If arm_timeout() has run meanwhile and has seen this entry, connection is re-inserted here.
+            if (!t.wheel_deadline.compare_exchange_strong(entry_deadline, 0) || t.state.load() != timeout_state::waiting)
+            {
+                return 0;
+            }
+
+            std::uint64_t deadline = t.deadline.load(std::memory_order_relaxed);
+            std::uint64_t empty = 0;
+            return deadline && t.wheel_deadline.compare_exchange_strong(empty, deadline) ? deadline : 0;
+        });
 }
@@ -1,6 +1,8 @@
 #include <Config.h>
+#include "Batch.h"
 #include "NetCalcCore.h"
 
+#include <functional>
 #include <iostream>
 #include <boost/asio/signal_set.hpp>
 
@@ -11,6 +13,10 @@
  * Event loop waits SIGINT, SIGTERM signals.
  * When signal is received it stops NetCalcCore (stops its event loops).
  * User can break the application using Ctrl-C (SIGINT) keys or kill command (SIGTERM).
+ * SIGUSR1 dumps recorded trace (if tracing is enabled) and doesn't stop the application.
+ * SIGUSR2 prints counters of NetCalcCore (see NetCalcStats) and doesn't stop the application.
+ * If a new process has taken over listeners (see Config::handoff_socket), the application exits after draining.
+ * In batch mode it evaluates input file to output file, prints throughput and exits.
  */
 int main(int argc, const char *argv[])
 {
@@ -23,14 +29,68 @@ int main(int argc, const char *argv[])
         return 1;
     }
 
+    if (!config->batch_input.empty())
+    {
+        BatchStats stats;
+        if (!evaluate_batch(config->batch_input, config->batch_output, config->threads, config->type, config->modulus, stats))
+        {
+            std::cerr << stats.error << std::endl;
+            return 2;
+        }
+
+        std::cout << "Expressions: " << stats.expressions << ", errors: " << stats.errors
+                  << ", time: " << stats.seconds * 1000.0 << " milliseconds, throughput: "
+                  << (stats.seconds > 0.0 ? static_cast<double>(stats.expressions) / stats.seconds : 0.0)
+                  << " expressions/s" << std::endl;
+        return 0;
+    }
+
     try
     {
+        boost::asio::io_service service;
         NetCalcCore netCalcCore(config.get());
+        netCalcCore.set_handoff_handler([&netCalcCore, &service]()
+            {
+                service.post([&netCalcCore, &service](){ netCalcCore.stop(); service.stop(); });
+            });
         netCalcCore.start();
 
-        boost::asio::io_service service;
         boost::asio::signal_set sig(service, SIGINT, SIGTERM);
-        sig.async_wait([&netCalcCore](const boost::system::error_code&, int){ netCalcCore.stop(); });
+        sig.async_wait([&netCalcCore, &service](const boost::system::error_code&, int){ netCalcCore.stop(); service.stop(); });
+
+        boost::asio::signal_set dump_sig(service, SIGUSR1);
+        std::function<void(const boost::system::error_code&, int)> on_dump =
+            [&netCalcCore, &dump_sig, &on_dump](const boost::system::error_code& error, int)
+            {
+                if (!error)
+                {
+                    netCalcCore.dump_trace();
+                    dump_sig.async_wait(on_dump);
+                }
+            };
+        dump_sig.async_wait(on_dump);
+
+        boost::asio::signal_set stats_sig(service, SIGUSR2);
+        std::function<void(const boost::system::error_code&, int)> on_stats =
+            [&netCalcCore, &stats_sig, &on_stats](const boost::system::error_code& error, int)
+            {
+                if (!error)
+                {
+                    NetCalcStats stats = netCalcCore.get_stats();
+                    std::cout << "Closed connections: idle timeout " << stats.idle_timeouts
+                              << ", expression timeout " << stats.expression_timeouts
+                              << ", slow receive " << stats.slow_receives << std::endl;
+                    std::cout << "Throttles: " << stats.throttles << ", rejected expressions: " << stats.shed_expressions
+                              << ", event loop lag: " << stats.event_loop_lag << " microseconds" << std::endl;
+                    std::cout << "Slow expressions: " << stats.slow_expressions << std::endl;
+                    std::cout << "Resumed sessions: " << stats.resumed_sessions << std::endl;
+                    std::cout << "Hot restart: handed over connections " << stats.handed_over_connections
+                              << ", adopted connections " << stats.adopted_connections << std::endl;
+                    stats_sig.async_wait(on_stats);
+                }
+            };
+        stats_sig.async_wait(on_stats);
+
         service.run();
     }
     catch (const boost::system::system_error& e)
@@ -0,0 +1,191 @@
+#include "ShmClient.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace
+{
+//Sleeping client checks that server is alive at least so often.
+const unsigned int wait_timeout_ms = 100;
+} //nameless namespace
+
+ShmClient::ShmClient(unsigned int spin_ /*= 50*/)
+    : spin(spin_)
+{
+}
+
+ShmClient::~ShmClient()
+{
+    detach();
+}
+
+bool ShmClient::attach(const std::string& name, std::string& error)
+{
+    detach();
+
+    segment.reset(new ShmSegment());
+    if (!segment->open(name, error))
+    {
+        segment.reset();
+        return false;
+    }
+
+    //Claim a free session or a session of dead client.
+    const std::int32_t pid = static_cast<std::int32_t>(getpid());
+    ShmHeader& header = segment->get_header();
+    for (unsigned int i = 0; i < header.sessions && !session; ++i)
+    {
+        ShmSessionHeader& s = segment->get_session(i);
+        std::int32_t owner = s.owner.load(std::memory_order_relaxed);
+        if ((!owner || (owner != pid && !shm_is_alive(owner))) && s.owner.compare_exchange_strong(owner, pid))
+        {
+            session = &s;
+            session_index = i;
+        }
+    }
+
+    if (!session)
+    {
+        error = "There is no free session in shared memory '" + name + "'";
+        segment.reset();
+        return false;
+    }
+
+    //Server resets rings of session and acknowledges new generation.
+    std::uint32_t generation = session->generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+    header.server_doorbell.fetch_add(1, std::memory_order_release);
+    shm_futex_wake(header.server_doorbell);
+
+    if (!wait([this, generation]() { return session->acked_generation.load(std::memory_order_acquire) == generation; }))
+    {
+        error = "Server of shared memory '" + name + "' is stopped";
+        detach();
+        return false;
+    }
+
+    results.clear();
+    return true;
+}
+
+void ShmClient::detach()
+{
+    if (session)
+    {
+        session->owner.store(0, std::memory_order_release);
+        session = nullptr;
+    }
+
+    segment.reset();
+}
+
+bool ShmClient::write(const char* data, std::size_t size)
+{
+    if (!session)
+    {
+        return false;
+    }
+
+    ShmRing request = segment->get_request_ring(session_index);
+    ShmHeader& header = segment->get_header();
+    while (size)
+    {
+        std::size_t n = request.write(data, size);
+        data += n;
+        size -= n;
+        shm_notify(header.server_doorbell, header.server_waiting);
+
+        if (size && !wait([&request]() { return request.writable() != 0; }))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::size_t ShmClient::read(char* buffer, std::size_t size)
+{
+    if (!session)
+    {
+        return 0;
+    }
+
+    ShmRing response = segment->get_response_ring(session_index);
+    if (!wait([&response]() { return response.readable() != 0; }))
+    {
+        return 0;
+    }
+
+    std::size_t result = 0;
+    std::size_t available = 0;
+    const char* data = response.peek(available);
+    while (available && result < size)
+    {
+        std::size_t n = std::min(available, size - result);
+        std::memcpy(buffer + result, data, n);
+        response.consume(n);
+        result += n;
+        data = response.peek(available);
+    }
+
+    //Server can wait for free space in response ring.
+    ShmHeader& header = segment->get_header();
+    shm_notify(header.server_doorbell, header.server_waiting);
+    return result;
+}
+
+bool ShmClient::evaluate(const std::string& expression, std::string& result)
+{
+    std::string request = expression + "\n";
+    if (!write(request.data(), request.size()))
+    {
+        return false;
+    }
+
+    std::size_t end_of_result = results.find('\n');
+    while (end_of_result == std::string::npos)
+    {
+        char buffer[256];
+        std::size_t n = read(buffer, sizeof(buffer));
+        if (!n)
+        {
+            return false;
+        }
+
+        results.append(buffer, n);
+        end_of_result = results.find('\n');
+    }
+
+    result.assign(results, 0, end_of_result);
+    results.erase(0, end_of_result + 1);
+    return true;
+}
+
+template <class Ready>
+bool ShmClient::wait(Ready ready)
+{
+    //Spin first: server usually answers faster than futex wake-up.
+    auto start = std::chrono::steady_clock::now();
+    while (!ready())
+    {
+        if (std::chrono::steady_clock::now() - start >= std::chrono::microseconds(spin))
+        {
+            shm_wait(session->client_doorbell, session->client_waiting, ready, wait_timeout_ms);
+            if (!ready() && !is_server_ready())
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool ShmClient::is_server_ready()
+{
+    ShmHeader& header = segment->get_header();
+    return header.ready.load(std::memory_order_acquire) && shm_is_alive(header.server_pid);
+}
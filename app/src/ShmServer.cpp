@@ -0,0 +1,204 @@
+#include "ShmServer.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <boost/system/system_error.hpp>
+
+namespace
+{
+//Maximum size of one result ("Invalid expression\n" or a number of any type except bigint).
+const std::size_t max_result_size = 32;
+
+//Sleeping server checks the stop flag at least so often.
+const unsigned int wait_timeout_ms = 100;
+} //nameless namespace
+
+ShmServer::ShmServer(const std::string& name, unsigned int sessions, unsigned int ring_size, unsigned int turn_expressions_, unsigned int spin_,
+                     NumericType type /*= NumericType::int32*/, std::uint64_t modulus /*= 0*/)
+    : turn_expressions(turn_expressions_),
+      spin(spin_),
+      shunting_yards(sessions),
+      evaluators(sessions),
+      skipping(sessions, false)
+{
+    if (type != NumericType::int32)
+    {
+        for (auto& evaluator : evaluators)
+        {
+            evaluator = make_evaluator(type, modulus);
+        }
+    }
+
+    std::string error;
+    if (!segment.create(name, sessions, ring_size, error))
+    {
+        throw boost::system::system_error(errno, boost::system::system_category(), error);
+    }
+}
+
+ShmServer::~ShmServer()
+{
+    stop();
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+void ShmServer::start()
+{
+    worker = std::thread([this]() { run(); });
+}
+
+void ShmServer::stop()
+{
+    ShmHeader& header = segment.get_header();
+    stopped.store(true);
+    header.server_doorbell.fetch_add(1);
+    shm_futex_wake(header.server_doorbell);
+}
+
+void ShmServer::run()
+{
+    ShmHeader& header = segment.get_header();
+    const unsigned int sessions = header.sessions;
+    std::chrono::steady_clock::time_point idle_start = std::chrono::steady_clock::now();
+
+    while (!stopped.load(std::memory_order_relaxed))
+    {
+        bool progress = false;
+        for (unsigned int i = 0; i < sessions; ++i)
+        {
+            progress = serve(i) || progress;
+        }
+
+        if (progress)
+        {
+            idle_start = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() - idle_start < std::chrono::microseconds(spin))
+        {
+            continue;
+        }
+
+        shm_wait(header.server_doorbell, header.server_waiting, [this, sessions]()
+            {
+                for (unsigned int i = 0; i < sessions; ++i)
+                {
+                    if (has_work(i))
+                    {
+                        return true;
+                    }
+                }
+                return stopped.load(std::memory_order_relaxed);
+            }, wait_timeout_ms);
+        idle_start = std::chrono::steady_clock::now();
+    }
+
+    //Wake clients, they see that server is not ready.
+    header.ready.store(0, std::memory_order_release);
+    for (unsigned int i = 0; i < sessions; ++i)
+    {
+        ShmSessionHeader& session = segment.get_session(i);
+        session.client_doorbell.fetch_add(1);
+        shm_futex_wake(session.client_doorbell);
+    }
+}
+
+bool ShmServer::has_work(unsigned int index)
+{
+    ShmSessionHeader& session = segment.get_session(index);
+    if (session.generation.load(std::memory_order_acquire) != session.acked_generation.load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+
+    return session.owner.load(std::memory_order_relaxed) &&
+        segment.get_request_ring(index).readable() && segment.get_response_ring(index).writable() >= max_result_size;
+}
+
+bool ShmServer::serve(unsigned int index)
+{
+    ShmSessionHeader& session = segment.get_session(index);
+    ShmRing request = segment.get_request_ring(index);
+    ShmRing response = segment.get_response_ring(index);
+    ShuntingYardInt& shunting_yard = shunting_yards[index];
+    Evaluator* evaluator = evaluators[index].get();
+
+    std::uint32_t generation = session.generation.load(std::memory_order_acquire);
+    if (generation != session.acked_generation.load(std::memory_order_relaxed))
+    {
+        //New client waits for acknowledgement and doesn't use rings, so data of previous client is dropped.
+        request.reset();
+        response.reset();
+        shunting_yard.clear();
+        if (evaluator)
+        {
+            evaluator->clear();
+        }
+        skipping[index] = false;
+
+        session.acked_generation.store(generation, std::memory_order_release);
+        session.client_doorbell.fetch_add(1, std::memory_order_release);
+        shm_futex_wake(session.client_doorbell);
+        return true;
+    }
+
+    if (!session.owner.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    bool progress = false;
+    unsigned int expressions = 0;
+    while (!turn_expressions || expressions < turn_expressions)
+    {
+        //Result must fit into response ring, otherwise client has to read results first.
+        std::size_t size = 0;
+        const char* data = request.peek(size);
+        if (!size || response.writable() < max_result_size)
+        {
+            break;
+        }
+
+        //ShuntingYard gets at most one expression per call (as in NetCalcCore::parse_result()).
+        const char* end_of_expression = static_cast<const char*>(std::memchr(data, '\n', size));
+        if (end_of_expression)
+        {
+            size = static_cast<std::size_t>(end_of_expression - data) + 1;
+        }
+
+        progress = true;
+        if (skipping[index])
+        {
+            //The rest of line after processing error is not a new expression.
+            request.consume(size);
+            skipping[index] = !end_of_expression;
+            continue;
+        }
+
+        result.clear();
+        EvaluationStatus status = evaluator ? evaluator->parse(data, size, result) : append_result(shunting_yard.parse(data, size), result);
+        request.consume(size);
+        if (status == EvaluationStatus::Incomplete)
+        {
+            continue;
+        }
+
+        skipping[index] = status == EvaluationStatus::Error && !end_of_expression;
+        response.write(result.data(), result.size());
+        ++expressions;
+    }
+
+    if (progress)
+    {
+        //Client can wait for results or for free space in request ring.
+        shm_notify(session.client_doorbell, session.client_waiting);
+    }
+
+    return progress;
+}
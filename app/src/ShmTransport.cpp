@@ -0,0 +1,236 @@
+#include "ShmTransport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+const std::uint32_t shm_magic = 0x4E435348; //'NCSH'
+const std::uint32_t shm_version = 1;
+
+std::size_t align64(std::size_t size)
+{
+    return (size + 63) / 64 * 64;
+}
+
+std::size_t get_session_size(std::size_t ring_size)
+{
+    return align64(sizeof(ShmSessionHeader)) + 2 * ring_size;
+}
+
+std::size_t get_segment_size(unsigned int sessions, std::size_t ring_size)
+{
+    return align64(sizeof(ShmHeader)) + sessions * get_session_size(ring_size);
+}
+} //nameless namespace
+
+const char* ShmRing::peek(std::size_t& size) const
+{
+    std::uint64_t head = header.head.load(std::memory_order_relaxed);
+    std::size_t available = static_cast<std::size_t>(header.tail.load(std::memory_order_acquire) - head);
+    std::size_t offset = static_cast<std::size_t>(head) & mask;
+
+    size = std::min(available, mask + 1 - offset);
+    return data + offset;
+}
+
+std::size_t ShmRing::write(const char* s, std::size_t size)
+{
+    std::uint64_t tail = header.tail.load(std::memory_order_relaxed);
+    size = std::min(size, writable());
+
+    //Data can wrap around the end of ring.
+    std::size_t offset = static_cast<std::size_t>(tail) & mask;
+    std::size_t first = std::min(size, mask + 1 - offset);
+    std::memcpy(data + offset, s, first);
+    std::memcpy(data, s + first, size - first);
+
+    header.tail.store(tail + size, std::memory_order_release);
+    return size;
+}
+
+ShmSegment::~ShmSegment()
+{
+    if (address)
+    {
+        if (owner)
+        {
+            get_header().ready.store(0, std::memory_order_release);
+            shm_unlink(name.c_str());
+        }
+        munmap(address, size);
+    }
+}
+
+bool ShmSegment::create(const std::string& name_, unsigned int sessions, unsigned int ring_size, std::string& error)
+{
+    name = "/" + name_;
+    owner = true;
+
+    //Segment of previous run is replaced, its clients see that server is not ready.
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        error = "Could not create shared memory '" + name + "': " + std::strerror(errno);
+        return false;
+    }
+
+    std::size_t segment_size = get_segment_size(sessions, ring_size);
+    bool result = ftruncate(fd, static_cast<off_t>(segment_size)) == 0;
+    if (!result)
+    {
+        error = "Could not resize shared memory '" + name + "': " + std::strerror(errno);
+    }
+
+    result = result && map(fd, segment_size, error);
+    ::close(fd);
+    if (!result)
+    {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    //New segment is filled by zeros, atomic objects are constructed in place.
+    ShmHeader& header = *new (address) ShmHeader();
+    header.magic = shm_magic;
+    header.version = shm_version;
+    header.sessions = sessions;
+    header.ring_size = ring_size;
+    header.server_pid = static_cast<std::int32_t>(getpid());
+    for (unsigned int i = 0; i < sessions; ++i)
+    {
+        new (get_session_address(i)) ShmSessionHeader();
+    }
+
+    header.ready.store(1, std::memory_order_release);
+    return true;
+}
+
+bool ShmSegment::open(const std::string& name_, std::string& error)
+{
+    name = "/" + name_;
+    owner = false;
+
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        error = "Could not open shared memory '" + name + "': " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat st;
+    bool result = fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(ShmHeader);
+    if (!result)
+    {
+        error = "Shared memory '" + name + "' is not initialized";
+    }
+
+    result = result && map(fd, static_cast<std::size_t>(st.st_size), error);
+    ::close(fd);
+    if (!result)
+    {
+        return false;
+    }
+
+    ShmHeader& header = get_header();
+    if (header.magic != shm_magic || header.version != shm_version || !header.ready.load(std::memory_order_acquire) ||
+        size < get_segment_size(header.sessions, header.ring_size))
+    {
+        error = "Shared memory '" + name + "' is not ready";
+        return false;
+    }
+
+    return true;
+}
+
+ShmSessionHeader& ShmSegment::get_session(unsigned int index)
+{
+    return *reinterpret_cast<ShmSessionHeader*>(get_session_address(index));
+}
+
+ShmRing ShmSegment::get_request_ring(unsigned int index)
+{
+    std::size_t ring_size = get_header().ring_size;
+    return ShmRing(get_session(index).request, get_session_address(index) + align64(sizeof(ShmSessionHeader)), ring_size);
+}
+
+ShmRing ShmSegment::get_response_ring(unsigned int index)
+{
+    std::size_t ring_size = get_header().ring_size;
+    return ShmRing(get_session(index).response, get_session_address(index) + align64(sizeof(ShmSessionHeader)) + ring_size, ring_size);
+}
+
+char* ShmSegment::get_session_address(unsigned int index)
+{
+    return static_cast<char*>(address) + align64(sizeof(ShmHeader)) + index * get_session_size(get_header().ring_size);
+}
+
+bool ShmSegment::map(int fd, std::size_t size_, std::string& error)
+{
+    void* a = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (a == MAP_FAILED)
+    {
+        error = "Could not map shared memory '" + name + "': " + std::strerror(errno);
+        return false;
+    }
+
+    address = a;
+    size = size_;
+    return true;
+}
+
+void shm_notify(std::atomic<std::uint32_t>& doorbell, std::atomic<std::uint32_t>& waiting)
+{
+    //Pairs with the fence in shm_wait(): either the other side sees new data or we see its 'waiting' flag.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed))
+    {
+        doorbell.fetch_add(1, std::memory_order_relaxed);
+        shm_futex_wake(doorbell);
+    }
+}
+
+void shm_futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, unsigned int timeout_ms)
+{
+#ifdef __linux__
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000;
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#else
+    if (word.load(std::memory_order_relaxed) == expected)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout_ms, 1u)));
+    }
+#endif
+}
+
+void shm_futex_wake(std::atomic<std::uint32_t>& word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+bool shm_is_alive(std::int32_t pid)
+{
+    return pid > 0 && (kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH);
+}
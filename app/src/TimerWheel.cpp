@@ -0,0 +1,19 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+TimerWheel::TimerWheel(unsigned int slots_, std::uint64_t tick_)
+    : slots(slots_),
+      mask(slots_ - 1),
+      tick(tick_)
+{
+}
+
+void TimerWheel::insert(unsigned int id, std::uint64_t deadline)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    //Passed deadline goes to the next visited slot.
+    std::uint64_t index = std::max(deadline / tick, current);
+    slots[index & mask].push_back(entry{id, deadline});
+}
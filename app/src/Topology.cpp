@@ -0,0 +1,188 @@
+#include "Topology.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+namespace
+{
+/**
+ * This function reads one line from a sysfs file.
+ * @param filename[in] name of file.
+ * @return content of the first line or empty string.
+ */
+std::string read_line(const std::string& filename)
+{
+    std::ifstream f(filename);
+    std::string line;
+    std::getline(f, line);
+    return line;
+}
+
+/**
+ * This function parses unsigned number from s[pos] and moves pos to the first not a digit.
+ */
+bool parse_number(const std::string& s, std::size_t& pos, unsigned int& value)
+{
+    std::size_t begin = pos;
+    value = 0;
+    while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9' && pos - begin < 6)
+    {
+        value = value * 10 + static_cast<unsigned int>(s[pos++] - '0');
+    }
+
+    return pos != begin;
+}
+} //nameless namespace
+
+boost::optional<std::vector<unsigned int>> parse_cpu_list(const std::string& list)
+{
+    std::vector<unsigned int> cpus;
+    std::size_t pos = 0;
+
+    while (pos < list.size())
+    {
+        unsigned int first = 0;
+        unsigned int last = 0;
+        if (!parse_number(list, pos, first))
+        {
+            return boost::none;
+        }
+
+        last = first;
+        if (pos < list.size() && list[pos] == '-')
+        {
+            ++pos;
+            if (!parse_number(list, pos, last) || last < first)
+            {
+                return boost::none;
+            }
+        }
+
+        for (unsigned int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+
+        if (pos < list.size())
+        {
+            if (list[pos] != ',' || pos + 1 == list.size())
+            {
+                return boost::none;
+            }
+            ++pos;
+        }
+    }
+
+    if (cpus.empty())
+    {
+        return boost::none;
+    }
+
+    return cpus;
+}
+
+std::vector<unsigned int> get_default_cpus()
+{
+    boost::optional<std::vector<unsigned int>> online = parse_cpu_list(read_line("/sys/devices/system/cpu/online"));
+    if (!online)
+    {
+        unsigned int hwc = std::thread::hardware_concurrency();
+        online = std::vector<unsigned int>();
+        for (unsigned int cpu = 0; cpu < (hwc ? hwc : 1u); ++cpu)
+        {
+            online->push_back(cpu);
+        }
+    }
+
+    //Group CPUs by node and then interleave the groups.
+    std::map<unsigned int, std::vector<unsigned int>> nodes;
+    for (unsigned int cpu : online.get())
+    {
+        nodes[get_cpu_node(cpu)].push_back(cpu);
+    }
+
+    std::vector<unsigned int> cpus;
+    cpus.reserve(online->size());
+    for (std::size_t i = 0; cpus.size() < online->size(); ++i)
+    {
+        for (auto& node : nodes)
+        {
+            if (i < node.second.size())
+            {
+                cpus.push_back(node.second[i]);
+            }
+        }
+    }
+
+    return cpus;
+}
+
+unsigned int get_cpu_node(unsigned int cpu)
+{
+    //Each node directory contains its CPU list.
+    for (unsigned int node = 0; ; ++node)
+    {
+        std::string list = read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (list.empty())
+        {
+            break;
+        }
+
+        boost::optional<std::vector<unsigned int>> cpus = parse_cpu_list(list);
+        if (cpus && std::find(cpus->begin(), cpus->end(), cpu) != cpus->end())
+        {
+            return node;
+        }
+    }
+
+    return 0;
+}
+
+bool pin_current_thread(unsigned int cpu)
+{
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE)
+    {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+bool bind_memory(void* address, std::size_t size, unsigned int node)
+{
+#ifdef __linux__
+    const std::uintptr_t page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    std::uintptr_t begin = (reinterpret_cast<std::uintptr_t>(address) + page - 1) / page * page;
+    std::uintptr_t end = (reinterpret_cast<std::uintptr_t>(address) + size) / page * page;
+    if (begin >= end || node >= 63)
+    {
+        return false;
+    }
+
+    unsigned long node_mask = 1ul << node;
+    return syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED, &node_mask, 64ul, MPOL_MF_MOVE) == 0;
+#else
+    (void)address;
+    (void)size;
+    (void)node;
+    return false;
+#endif
+}
@@ -0,0 +1,107 @@
+#include "Tracer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+
+namespace
+{
+const char* const phase_names[] = {"accept", "receive", "parse", "send"};
+
+/** Chrome trace uses microseconds, so nanoseconds are written as fixed point number. */
+const char* to_microseconds(std::uint64_t nanoseconds, char (&buffer)[32])
+{
+    std::snprintf(buffer, sizeof(buffer), "%llu.%03llu",
+        static_cast<unsigned long long>(nanoseconds / 1000), static_cast<unsigned long long>(nanoseconds % 1000));
+    return buffer;
+}
+} //nameless namespace
+
+Tracer::Tracer(unsigned int sample_rate_)
+    : sample_rate(sample_rate_)
+{
+}
+
+std::uint64_t Tracer::now()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Tracer::record(TracePhase phase, unsigned int client_index, std::uint64_t start, std::uint64_t end, long long value /*= 0*/)
+{
+    RingBuffer& rb = ring_buffers.get();
+    std::uint64_t head = rb.head.load(std::memory_order_relaxed);
+    Span& span = rb.spans[head % RingBuffer::capacity];
+
+    //Odd sequence means that span is being written.
+    std::uint64_t sequence = span.sequence.load(std::memory_order_relaxed);
+    span.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    span.start.store(start, std::memory_order_relaxed);
+    span.end.store(end, std::memory_order_relaxed);
+    span.phase.store(static_cast<unsigned int>(phase), std::memory_order_relaxed);
+    span.client_index.store(client_index, std::memory_order_relaxed);
+    span.value.store(value, std::memory_order_relaxed);
+
+    span.sequence.store(sequence + 2, std::memory_order_release);
+    rb.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::dump(std::ostream& s)
+{
+    const std::vector<RingBuffer*> buffers = ring_buffers.snapshot();
+    bool first = true;
+
+    s << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (std::size_t tid = 1; tid <= buffers.size(); ++tid)
+    {
+        //Thread identifier in trace is the order of registration.
+        RingBuffer& rb = *buffers[tid - 1];
+        std::uint64_t head = rb.head.load(std::memory_order_acquire);
+        std::uint64_t begin = head > RingBuffer::capacity ? head - RingBuffer::capacity : 0;
+
+        for (std::uint64_t i = begin; i < head; ++i)
+        {
+            Span& span = rb.spans[i % RingBuffer::capacity];
+            std::uint64_t sequence = span.sequence.load(std::memory_order_acquire);
+            std::uint64_t start = span.start.load(std::memory_order_relaxed);
+            std::uint64_t end = span.end.load(std::memory_order_relaxed);
+            unsigned int phase = span.phase.load(std::memory_order_relaxed);
+            unsigned int client_index = span.client_index.load(std::memory_order_relaxed);
+            long long value = span.value.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if ((sequence & 1) || sequence != span.sequence.load(std::memory_order_relaxed) ||
+                phase >= sizeof(phase_names) / sizeof(phase_names[0]))
+            {
+                //Span is being overwritten.
+                continue;
+            }
+
+            char ts[32];
+            char dur[32];
+            s << (first ? "" : ",") << "\n{\"name\":\"" << phase_names[phase] << "\",\"cat\":\"client\",\"ph\":\"X\""
+              << ",\"ts\":" << to_microseconds(start, ts)
+              << ",\"dur\":" << to_microseconds(end >= start ? end - start : 0, dur)
+              << ",\"pid\":1,\"tid\":" << tid
+              << ",\"args\":{\"client\":" << client_index << ",\"value\":" << value << "}}";
+            first = false;
+        }
+    }
+    s << "\n]}\n";
+}
+
+bool Tracer::dump(const std::string& filename)
+{
+    std::ofstream f(filename, std::ios_base::out | std::ios_base::trunc);
+    if (!f)
+    {
+        return false;
+    }
+
+    dump(f);
+    return static_cast<bool>(f);
+}
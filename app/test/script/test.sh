@@ -4,10 +4,10 @@ if [ -z "$1" ]; then
     echo "Port is unset or set to the empty string"
     exit 1
 fi
-./app/NetCalculatorApp -p $1 -c 1 -t 1 &
+./app/NetCalculatorApp -p $1 -c 1 -t 1 --unix-socket ./NetCalculatorTest.sock &
 export NC_PID=$!
 sleep 1
-./app/test/NetCalculatorApp_SimpleTest 127.0.0.1 $1
+./app/test/NetCalculatorApp_SimpleTest 127.0.0.1 $1 && ./app/test/NetCalculatorApp_SimpleTest unix ./NetCalculatorTest.sock
 export TEST_CODE=$?
 kill $NC_PID
 exit $TEST_CODE
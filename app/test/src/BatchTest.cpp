@@ -0,0 +1,147 @@
+/**
+ * This file contains unit-tests for evaluate_batch() function.
+ * Tests write expressions to a temporary file, evaluate it and check the output file.
+ * main function returns 0 if all test passed.
+ * main function returns 1 if one of test failed.
+ */
+
+#include <Batch.h>
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+static const std::string input_filename = "BatchTest.in";
+static const std::string output_filename = "BatchTest.out";
+
+void write_file(const std::string& filename, const std::string& content)
+{
+    std::ofstream f(filename, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    f << content;
+}
+
+std::string read_file(const std::string& filename)
+{
+    std::ifstream f(filename, std::ios_base::in | std::ios_base::binary);
+    std::stringstream s;
+    s << f.rdbuf();
+    return s.str();
+}
+
+/**
+ * This function evaluates input by several threads with small chunks and compares output with expected one.
+ */
+bool check_batch(const std::string& name, const std::string& input, const std::string& expected,
+    unsigned long long expressions, unsigned long long errors, NumericType type = NumericType::int32, std::uint64_t modulus = 0)
+{
+    bool result = true;
+    write_file(input_filename, input);
+
+    for (unsigned int threads : {1u, 3u})
+    {
+        for (std::size_t chunk_size : {std::size_t{1}, std::size_t{7}, std::size_t{1024}})
+        {
+            BatchStats stats;
+            if (!evaluate_batch(input_filename, output_filename, threads, type, modulus, stats, chunk_size) ||
+                read_file(output_filename) != expected || stats.expressions != expressions || stats.errors != errors)
+            {
+                std::cerr << name << " failed (threads: " << threads << ", chunk size: " << chunk_size << ")" << std::endl;
+                result = false;
+            }
+        }
+    }
+
+    std::remove(input_filename.c_str());
+    std::remove(output_filename.c_str());
+
+    if (result)
+    {
+        std::cout << name << " passed" << std::endl;
+    }
+    return result;
+}
+
+bool batch_test_expressions()
+{
+    return check_batch("BatchTestExpressions",
+        "1 + 2\n(53/(17-(19+23))*11-(31+(37+83)))+113\n1741 * ((7079 / 367)  * 13) / 83\n2 * (3 + 4)\r\n",
+        "3\n-60\n5181\n14\n", 4, 0);
+}
+
+bool batch_test_errors()
+{
+    //Errors don't stop evaluation of next expressions, the last expression doesn't have '\n'.
+    return check_batch("BatchTestErrors",
+        "5/(2/7)\n1 + 2\n(1 + 2\n2147483647 + 1\n7 - 10",
+        "Division by zero\n3\nInvalid expression\nOverflow\n-3\n", 5, 3);
+}
+
+bool batch_test_empty()
+{
+    return check_batch("BatchTestEmpty", "", "", 0, 0);
+}
+
+bool batch_test_many()
+{
+    //Results of many chunks are written in input order.
+    std::string input;
+    std::string expected;
+    for (int i = 0; i < 10000; ++i)
+    {
+        input += std::to_string(i) + " * 2 - 1\n";
+        expected += std::to_string(i * 2 - 1) + "\n";
+    }
+
+    return check_batch("BatchTestMany", input, expected, 10000, 0);
+}
+
+bool batch_test_types()
+{
+    //Expressions are evaluated in numeric type of '--type', not in int32.
+    return check_batch("BatchTestTypes", "1 / 4\n1e308 * 10\n2147483647 + 1", "0.25\nOverflow\n2147483648\n", 3, 1,
+        NumericType::float64) &&
+        check_batch("BatchTestTypesMod", "5 * 3\n2 - 3\n1 / 0", "1\n6\nDivision by zero\n", 3, 1, NumericType::mod64, 7);
+}
+
+bool batch_test_missing_input()
+{
+    std::remove(input_filename.c_str());
+
+    BatchStats stats;
+    if (evaluate_batch(input_filename, output_filename, 2, NumericType::int32, 0, stats) || stats.error.empty())
+    {
+        std::cerr << "BatchTestMissingInput failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "BatchTestMissingInput passed" << std::endl;
+    return true;
+}
+
+const std::function<bool()> tests[] =
+{
+    batch_test_expressions,
+    batch_test_errors,
+    batch_test_empty,
+    batch_test_many,
+    batch_test_types,
+    batch_test_missing_input
+};
+
+int main()
+{
+    bool result{true};
+
+    for (auto& test: tests)
+    {
+        if (!test())
+        {
+            result = false;
+        }
+    }
+
+    return result ? 0 : 1;
+}
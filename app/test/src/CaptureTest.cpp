@@ -0,0 +1,184 @@
+/**
+ * This file contains unit-tests for Capture class.
+ * Tests write records to a temporary capture file and read them back.
+ * main function returns 0 if all test passed.
+ * main function returns 1 if one of test failed.
+ */
+
+#include <Capture.h>
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const std::string capture_filename = "CaptureTest.cap";
+
+bool capture_test_records()
+{
+    std::remove(capture_filename.c_str());
+    {
+        Capture capture(capture_filename);
+        std::uint64_t c1 = capture.open();
+        std::uint64_t c2 = capture.open();
+        capture.data(c1, "1 + 2\n", 6);
+        capture.data(c2, std::string(300, '1').c_str(), 300);
+        capture.data(c1, "", 0);
+        capture.close(c1);
+    }
+
+    std::vector<CaptureRecord> records;
+    std::string error;
+    bool result = Capture::read(capture_filename, records, error) && error.empty() && records.size() == 6 &&
+        records[0].kind == CaptureKind::open && records[0].connection == 1 &&
+        records[1].kind == CaptureKind::open && records[1].connection == 2 &&
+        records[2].kind == CaptureKind::data && records[2].connection == 1 && records[2].data == "1 + 2\n" &&
+        records[3].kind == CaptureKind::data && records[3].connection == 2 && records[3].data == std::string(300, '1') &&
+        records[4].kind == CaptureKind::data && records[4].data.empty() &&
+        records[5].kind == CaptureKind::close && records[5].connection == 1;
+
+    std::remove(capture_filename.c_str());
+    if (!result)
+    {
+        std::cerr << "CaptureTestRecords failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "CaptureTestRecords passed" << std::endl;
+    return true;
+}
+
+bool capture_test_threads()
+{
+    const unsigned int thread_count = 4;
+    const unsigned int chunk_count = 1000;
+
+    std::remove(capture_filename.c_str());
+    {
+        Capture capture(capture_filename);
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < thread_count; ++t)
+        {
+            threads.emplace_back([&capture]()
+            {
+                std::uint64_t connection = capture.open();
+                for (unsigned int i = 0; i < chunk_count; ++i)
+                {
+                    std::string chunk = std::to_string(i) + "\n";
+                    capture.data(connection, chunk.data(), chunk.size());
+                }
+                capture.close(connection);
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        capture.flush();
+    }
+
+    std::vector<CaptureRecord> records;
+    std::string error;
+    bool result = Capture::read(capture_filename, records, error) && error.empty() &&
+        records.size() == thread_count * (chunk_count + 2);
+
+    //Records of each connection keep their order after sorting by time.
+    std::vector<unsigned int> next(thread_count + 1, 0);
+    for (std::size_t i = 0; result && i < records.size(); ++i)
+    {
+        const CaptureRecord& record = records[i];
+        result = record.connection >= 1 && record.connection <= thread_count;
+        if (!result)
+        {
+            break;
+        }
+
+        unsigned int& n = next[record.connection];
+        if (record.kind == CaptureKind::open)
+        {
+            result = n == 0;
+        }
+        else if (record.kind == CaptureKind::data)
+        {
+            result = record.data == std::to_string(n) + "\n";
+            ++n;
+        }
+        else
+        {
+            result = record.kind == CaptureKind::close && n == chunk_count;
+        }
+    }
+
+    std::remove(capture_filename.c_str());
+    if (!result)
+    {
+        std::cerr << "CaptureTestThreads failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "CaptureTestThreads passed" << std::endl;
+    return true;
+}
+
+bool capture_test_truncated()
+{
+    std::remove(capture_filename.c_str());
+    {
+        Capture capture(capture_filename);
+        std::uint64_t c = capture.open();
+        capture.data(c, "2 * 3\n", 6);
+    }
+
+    //Server was killed in the middle of the last record.
+    {
+        std::ofstream f(capture_filename, std::ios::binary | std::ios::app);
+        f.write("\x01\x05\x01\x10" "12", 6);
+    }
+
+    std::vector<CaptureRecord> records;
+    std::string error;
+    bool truncated = Capture::read(capture_filename, records, error) && !error.empty() && records.size() == 2 &&
+        records[1].data == "2 * 3\n";
+
+    {
+        std::ofstream f(capture_filename, std::ios::binary | std::ios::trunc);
+        f << "1 + 2\n";
+    }
+    bool invalid = !Capture::read(capture_filename, records, error);
+
+    std::remove(capture_filename.c_str());
+    if (!truncated || !invalid || Capture(std::string()).is_enabled())
+    {
+        std::cerr << "CaptureTestTruncated failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "CaptureTestTruncated passed" << std::endl;
+    return true;
+}
+
+const std::function<bool()> tests[] =
+{
+    capture_test_records,
+    capture_test_threads,
+    capture_test_truncated
+};
+
+int main()
+{
+    bool result{true};
+
+    for (auto& test: tests)
+    {
+        if (!test())
+        {
+            result = false;
+        }
+    }
+
+    return result ? 0 : 1;
+}
@@ -15,7 +15,45 @@ bool operator==(const Config& lhs, const Config& rhs)
     return lhs.address == rhs.address &&
         lhs.port == rhs.port &&
         lhs.clients == rhs.clients &&
-        lhs.threads == rhs.threads;
+        lhs.threads == rhs.threads &&
+        lhs.log_level == rhs.log_level &&
+        lhs.log_sample == rhs.log_sample &&
+        lhs.log_file == rhs.log_file &&
+        lhs.trace_sample == rhs.trace_sample &&
+        lhs.trace_file == rhs.trace_file &&
+        lhs.cpus == rhs.cpus &&
+        lhs.busy_poll == rhs.busy_poll &&
+        lhs.so_busy_poll == rhs.so_busy_poll &&
+        lhs.bulk_threads == rhs.bulk_threads &&
+        lhs.heavy_bytes == rhs.heavy_bytes &&
+        lhs.heavy_parse_time == rhs.heavy_parse_time &&
+        lhs.bulk_budget == rhs.bulk_budget &&
+        lhs.turn_expressions == rhs.turn_expressions &&
+        lhs.turn_bytes == rhs.turn_bytes &&
+        lhs.unix_socket == rhs.unix_socket &&
+        lhs.shm_name == rhs.shm_name &&
+        lhs.shm_sessions == rhs.shm_sessions &&
+        lhs.shm_ring_size == rhs.shm_ring_size &&
+        lhs.idle_timeout == rhs.idle_timeout &&
+        lhs.expression_timeout == rhs.expression_timeout &&
+        lhs.min_receive_rate == rhs.min_receive_rate &&
+        lhs.rate_expressions == rhs.rate_expressions &&
+        lhs.rate_bytes == rhs.rate_bytes &&
+        lhs.shed_lag == rhs.shed_lag &&
+        lhs.parallel_threads == rhs.parallel_threads &&
+        lhs.parallel_chunk == rhs.parallel_chunk &&
+        lhs.pipelines == rhs.pipelines &&
+        lhs.type == rhs.type &&
+        lhs.modulus == rhs.modulus &&
+        lhs.slow_expression == rhs.slow_expression &&
+        lhs.slow_log_rate == rhs.slow_log_rate &&
+        lhs.capture_file == rhs.capture_file &&
+        lhs.sessions == rhs.sessions &&
+        lhs.session_timeout == rhs.session_timeout &&
+        lhs.handoff_socket == rhs.handoff_socket &&
+        lhs.drain_timeout == rhs.drain_timeout &&
+        lhs.batch_input == rhs.batch_input &&
+        lhs.batch_output == rhs.batch_output;
 }
 
 struct TestData
@@ -53,6 +91,30 @@ unsigned int get_hwc()
     return hwc ? hwc : 1;
 }
 
+/**
+ * Returns Config that get_config() makes of "-p 1024 -c 10 -t 2", other parameters have default values.
+ */
+Config default_expected()
+{
+    Config config;
+    config.address = "127.0.0.1";
+    config.port = 1024;
+    config.clients = 10;
+    config.threads = 2;
+    return config;
+}
+
+/**
+ * Returns default_expected() with parameters under test, they are assigned by name in 'set'.
+ */
+template <class Set>
+Config expected_with(Set set)
+{
+    Config config = default_expected();
+    set(config);
+    return config;
+}
+
 const TestData test_cases[] =
 {
     {false, Config{}, {"dummy"}},
@@ -66,16 +128,16 @@ const TestData test_cases[] =
     {false, Config{}, {"dummy", "-a", "0.0.0.0", "-p", "1024"}},
     {false, Config{}, {"dummy", "-a", "0.0.0.0", "-c", "10"}},
     {false, Config{}, {"dummy", "-a", "0.0.0.0", "-t", "2"}},
-    {true,  Config{"127.0.0.1", 1024, 10, get_hwc()},
+    {true,  expected_with([](Config& c) { c.threads = get_hwc(); }),
         {"dummy", "-p", "1024", "-c", "10"}},
     {false, Config{}, {"dummy", "-p", "1024", "-t", "2"}},
     {false, Config{}, {"dummy", "-c", "10", "-t", "2"}},
 
-    {true,  Config{"127.0.0.1", 1024, 10, 2},
+    {true,  default_expected(),
         {"dummy", "-p", "1024", "-c", "10", "-t",  "2"}},
     {false, Config{}, {"dummy", "-a", "0.0.0.0", "-c", "10", "-t",  "2"}},
     {false, Config{}, {"dummy", "-a", "0.0.0.0", "-p", "1024", "-t",  "2"}},
-    {true,  Config{"127.0.0.1", 1024, 10, get_hwc()},
+    {true,  expected_with([](Config& c) { c.threads = get_hwc(); }),
         {"dummy", "-a", "127.0.0.1", "-p", "1024", "-c", "10"}},
     {false, Config{}, {"dummy", "-a", "x.0.0.0", "-p", "1024", "-c", "10", "-t", "2"}},
     {false, Config{}, {"dummy", "-a", "0.0.0.0", "-p", "x", "-c", "10", "-t", "2"}},
@@ -88,8 +150,91 @@ const TestData test_cases[] =
     {false, Config{}, {"dummy", "-a", "0.0.0.0", "-p", "1024", "-c", "10", "-t",  "0"}},
     {false, Config{}, {"dummy", "-a", "0.0.0.0", "-p", "1024", "-c", "2", "-t",  "10"}},
 
-    {true,  Config{"12.34.56.78", 1024, 10, 2},
-        {"dummy", "-a", "12.34.56.78", "-p", "1024", "-c", "10", "-t",  "2"}}
+    {true,  expected_with([](Config& c) { c.address = "12.34.56.78"; }),
+        {"dummy", "-a", "12.34.56.78", "-p", "1024", "-c", "10", "-t",  "2"}},
+
+    {true,  expected_with([](Config& c) { c.log_level = LogLevel::debug; c.log_sample = 10; c.log_file = "log.txt"; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--log-level", "debug", "--log-sample", "10", "--log-file", "log.txt"}},
+    {true,  expected_with([](Config& c) { c.log_level = LogLevel::none; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--log-level", "none"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--log-level", "x"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--log-sample", "0"}},
+
+    {true,  expected_with([](Config& c) { c.trace_sample = 100; c.trace_file = "trace.json"; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--trace-sample", "100", "--trace-file", "trace.json"}},
+
+    {true,  expected_with([](Config& c) { c.cpus = "auto"; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--cpus", "auto"}},
+    {true,  expected_with([](Config& c) { c.cpus = "0-3,8"; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--cpus", "0-3,8"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--cpus", "3-1"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--cpus", "0,"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--cpus", "x"}},
+
+    {true,  expected_with([](Config& c) { c.busy_poll = 50; c.so_busy_poll = 20; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--busy-poll", "50", "--so-busy-poll", "20"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--busy-poll", "x"}},
+
+    {true,  expected_with([](Config& c) { c.bulk_threads = 2; c.heavy_bytes = 1000000; c.heavy_parse_time = 0; c.bulk_budget = 1024; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--bulk-threads", "2", "--heavy-bytes", "1000000",
+            "--heavy-parse-time", "0", "--bulk-budget", "1024"}},
+
+    {true,  expected_with([](Config& c) { c.turn_expressions = 0; c.turn_bytes = 512; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--turn-expressions", "0", "--turn-bytes", "512"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--turn-bytes", "x"}},
+
+    {true,  expected_with([](Config& c) { c.port = 0; c.unix_socket = "/tmp/nc.sock"; }),
+        {"dummy", "-c", "10", "-t",  "2", "--unix-socket", "/tmp/nc.sock"}},
+    {true,  expected_with([](Config& c) { c.unix_socket = "/tmp/nc.sock"; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--unix-socket", "/tmp/nc.sock"}},
+    {false, Config{}, {"dummy", "-p", "80", "-c", "10", "-t",  "2", "--unix-socket", "/tmp/nc.sock"}},
+    {true,  expected_with([](Config& c) { c.shm_name = "netcalc"; c.shm_sessions = 8; c.shm_ring_size = 4096; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--shm-name", "netcalc", "--shm-sessions", "8", "--shm-ring-size", "4096"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--shm-name", "net/calc"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--shm-name", "netcalc", "--shm-sessions", "0"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--shm-name", "netcalc", "--shm-ring-size", "5000"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--shm-name", "netcalc", "--shm-ring-size", "2048"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--shm-name", "netcalc", "--type", "bigint"}},
+    {true,  expected_with([](Config& c) { c.idle_timeout = 30000; c.expression_timeout = 5000; c.min_receive_rate = 100; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--idle-timeout", "30000", "--expression-timeout", "5000", "--min-receive-rate", "100"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--idle-timeout", "x"}},
+    {true,  expected_with([](Config& c) { c.rate_expressions = 1000; c.rate_bytes = 65536; c.shed_lag = 5000; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--rate-expressions", "1000", "--rate-bytes", "65536", "--shed-lag", "5000"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--shed-lag", "x"}},
+    {true,  expected_with([](Config& c) { c.parallel_threads = 4; c.parallel_chunk = 512; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--parallel-threads", "4", "--parallel-chunk", "512"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--parallel-threads", "4", "--parallel-chunk", "0"}},
+    {true,  expected_with([](Config& c) { c.pipelines = 2; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--pipelines", "2"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--pipelines", "x"}},
+    {true,  expected_with([](Config& c) { c.type = NumericType::bigint; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--type", "bigint"}},
+    {true,  expected_with([](Config& c) { c.type = NumericType::float64; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--type", "float64"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--type", "int"}},
+    {true,  expected_with([](Config& c) { c.type = NumericType::mod64; c.modulus = 1000000007; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--type", "mod64", "--modulus", "1000000007"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--type", "mod64", "--modulus", "1"}},
+    {true,  expected_with([](Config& c) { c.slow_expression = 2000; c.slow_log_rate = 5; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--slow-expression", "2000", "--slow-log-rate", "5"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--slow-expression", "2000", "--slow-log-rate", "0"}},
+    {true,  expected_with([](Config& c) { c.capture_file = "traffic.cap"; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--capture-file", "traffic.cap"}},
+    {true,  expected_with([](Config& c) { c.sessions = 8; c.session_timeout = 5000; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--sessions", "8", "--session-timeout", "5000"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--sessions", "8", "--session-timeout", "0"}},
+    {true,  expected_with([](Config& c) { c.handoff_socket = "/tmp/nc.handoff"; c.drain_timeout = 5000; }),
+        {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--handoff-socket", "/tmp/nc.handoff", "--drain-timeout", "5000"}},
+    {false, Config{}, {"dummy", "-p", "1024", "-c", "10", "-t",  "2", "--handoff-socket", "/tmp/nc.sock/0123456789/0123456789/0123456789/0123456789/0123456789/0123456789/0123456789/0123456789/0123456789"}},
+    {false, Config{}, {"dummy", "-c", "10", "-t",  "2", "--unix-socket", "/tmp/nc.sock/0123456789/0123456789/0123456789/0123456789/0123456789/0123456789/0123456789/0123456789/0123456789"}},
+
+    {true,  expected_with([](Config& c) { c.port = 0; c.clients = 0; c.threads = 4; c.batch_input = "in.txt"; c.batch_output = "out.txt"; }),
+        {"dummy", "--batch", "in.txt", "out.txt", "-t", "4"}},
+    {true,  expected_with([](Config& c) { c.clients = 1; c.threads = 4; c.batch_input = "in.txt"; c.batch_output = "out.txt"; }),
+        {"dummy", "-p", "1024", "-c", "1", "-t", "4", "--batch", "in.txt", "out.txt"}},
+    {false, Config{}, {"dummy", "--batch", "in.txt"}},
+    {false, Config{}, {"dummy", "--batch", "in.txt", "out.txt", "-p", "80"}},
+    {false, Config{}, {"dummy", "--batch", "in.txt", "out.txt", "-t", "0"}}
 };
 
 int main()
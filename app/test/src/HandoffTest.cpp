@@ -0,0 +1,197 @@
+/**
+ * This file contains unit-tests for hot restart (Handoff.h and NetCalcCore).
+ * Tests pass descriptors through a socket pair and hand over a NetCalcCore to another one in the same process.
+ * main function returns 0 if all test passed.
+ * main function returns 1 if one of test failed.
+ */
+
+#include <Handoff.h>
+#include <NetCalcCore.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const std::string unix_socket = "HandoffTest.sock";
+static const std::string handoff_socket = "HandoffTest.handoff";
+
+/** Connects to Unix domain socket of NetCalcCore, returns -1 on error. */
+int connect_client()
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, unix_socket.c_str(), sizeof(address.sun_path) - 1);
+
+    int s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    timeval timeout{5, 0};
+    if (s >= 0 && (::setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+                   ::connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0))
+    {
+        ::close(s);
+        return -1;
+    }
+    return s;
+}
+
+/** Sends request and returns response (one receive is enough for short responses). */
+std::string request(int s, const std::string& data)
+{
+    if (::send(s, data.data(), data.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(data.size()))
+    {
+        return "";
+    }
+
+    char buffer[256];
+    ssize_t n = ::recv(s, buffer, sizeof(buffer), 0);
+    return n > 0 ? std::string(buffer, static_cast<std::size_t>(n)) : "";
+}
+
+bool handoff_test_descriptors()
+{
+    int channel[2];
+    int pipe_fds[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET, 0, channel) != 0 || ::pipe(pipe_fds) != 0)
+    {
+        std::cerr << "HandoffTestDescriptors failed" << std::endl;
+        return false;
+    }
+
+    //Received descriptor is another descriptor of the same pipe.
+    std::vector<HandoffDescriptor> descriptors;
+    bool result = handoff_send(channel[0], {HandoffDescriptor{HandoffKind::tcp_client, pipe_fds[1]}}) &&
+        handoff_receive(channel[1], descriptors, 1000) && descriptors.size() == 1 &&
+        descriptors[0].kind == HandoffKind::tcp_client && descriptors[0].fd != pipe_fds[1];
+    char byte = 0;
+    result = result && ::write(descriptors[0].fd, "x", 1) == 1 && ::read(pipe_fds[0], &byte, 1) == 1 && byte == 'x';
+    for (const HandoffDescriptor& d : descriptors)
+    {
+        ::close(d.fd);
+    }
+
+    //Several descriptors and 'end' keep their order.
+    result = result && handoff_send(channel[0], {HandoffDescriptor{HandoffKind::tcp_listener, pipe_fds[0]},
+                                                 HandoffDescriptor{HandoffKind::unix_client, pipe_fds[1]},
+                                                 HandoffDescriptor{HandoffKind::end, -1}}) &&
+        handoff_receive(channel[1], descriptors, 1000) && descriptors.size() == 3 &&
+        descriptors[0].kind == HandoffKind::tcp_listener && descriptors[1].kind == HandoffKind::unix_client &&
+        descriptors[2].kind == HandoffKind::end && descriptors[2].fd == -1;
+    for (const HandoffDescriptor& d : descriptors)
+    {
+        if (d.fd >= 0)
+        {
+            ::close(d.fd);
+        }
+    }
+
+    //Unknown kind, timeout and end of connection.
+    result = result && ::send(channel[0], "?", 1, 0) == 1 && !handoff_receive(channel[1], descriptors, 1000) &&
+        descriptors.empty() && !handoff_receive(channel[1], descriptors, 10) && handoff_trusted(channel[1]);
+    ::close(channel[0]);
+    result = result && !handoff_receive(channel[1], descriptors, 1000);
+
+    ::close(channel[1]);
+    ::close(pipe_fds[0]);
+    ::close(pipe_fds[1]);
+    if (!result)
+    {
+        std::cerr << "HandoffTestDescriptors failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "HandoffTestDescriptors passed" << std::endl;
+    return true;
+}
+
+bool handoff_test_restart()
+{
+    //The third slot of the new core serves a new connection after two connections are taken over.
+    Config config;
+    config.address = "127.0.0.1";
+    config.port = 0;
+    config.clients = 3;
+    config.threads = 1;
+    config.unix_socket = unix_socket;
+    config.handoff_socket = handoff_socket;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool drained = false;
+
+    bool result = false;
+    {
+        NetCalcCore old_core(config);
+        old_core.set_handoff_handler([&mutex, &condition, &drained]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                drained = true;
+                condition.notify_all();
+            });
+        old_core.start();
+
+        //Idle connection and connection in the middle of expression.
+        int idle = connect_client();
+        int busy = connect_client();
+        result = idle >= 0 && busy >= 0 && request(idle, "1 + 2\n") == "3\n" &&
+            ::send(busy, "(1 + ", 5, MSG_NOSIGNAL) == 5;
+
+        //New core takes over listeners in its constructor, the idle connection is handed over at once,
+        //the other one is handed over after its expression, then the old core ends draining.
+        NetCalcCore new_core(config);
+        new_core.start();
+        result = result && request(idle, "2 * 3\n") == "6\n" && request(busy, "2)\n") == "3\n";
+
+        std::unique_lock<std::mutex> lock(mutex);
+        result = result && condition.wait_for(lock, std::chrono::seconds(5), [&drained]() { return drained; });
+        lock.unlock();
+        old_core.stop();
+
+        int fresh = connect_client();
+        result = result && request(busy, "4 - 1\n") == "3\n" && fresh >= 0 && request(fresh, "7 * 7\n") == "49\n" &&
+            old_core.get_stats().handed_over_connections == 2 && new_core.get_stats().adopted_connections == 2;
+
+        ::close(idle);
+        ::close(busy);
+        ::close(fresh);
+        new_core.stop();
+    }
+
+    if (!result)
+    {
+        std::cerr << "HandoffTestRestart failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "HandoffTestRestart passed" << std::endl;
+    return true;
+}
+
+const std::function<bool()> tests[] =
+{
+    handoff_test_descriptors,
+    handoff_test_restart
+};
+
+int main()
+{
+    bool result{true};
+
+    for (auto& test: tests)
+    {
+        if (!test())
+        {
+            result = false;
+        }
+    }
+
+    return result ? 0 : 1;
+}
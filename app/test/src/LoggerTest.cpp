@@ -0,0 +1,188 @@
+/**
+ * This file contains unit-tests for Logger class.
+ * Tests write records to a temporary file and check its content.
+ * main function returns 0 if all test passed.
+ * main function returns 1 if one of test failed.
+ */
+
+#include <Logger.h>
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const std::string log_filename = "LoggerTest.log";
+
+std::vector<std::string> read_lines()
+{
+    std::vector<std::string> lines;
+    std::ifstream f(log_filename);
+    std::string line;
+    while (std::getline(f, line))
+    {
+        lines.push_back(line);
+    }
+
+    std::remove(log_filename.c_str());
+    return lines;
+}
+
+bool ends_with(const std::string& s, const std::string& suffix)
+{
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool logger_test_levels()
+{
+    std::remove(log_filename.c_str());
+    {
+        Logger logger(LogLevel::info, 1, log_filename);
+        logger.write(LogLevel::error, "Client: %u, error %lld", 1, 104);
+        logger.write(LogLevel::info, "Client: %u accepted", 2);
+        logger.write(LogLevel::debug, "Client: %u, received: %lld bytes", 3, 10);
+    }
+
+    std::vector<std::string> lines = read_lines();
+    bool result = lines.size() == 2 &&
+        ends_with(lines[0], "error Client: 1, error 104") &&
+        ends_with(lines[1], "info  Client: 2 accepted");
+
+    if (!result)
+    {
+        std::cerr << "LoggerTestLevels failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "LoggerTestLevels passed" << std::endl;
+    return true;
+}
+
+bool logger_test_none()
+{
+    std::remove(log_filename.c_str());
+    {
+        Logger logger(LogLevel::none, 1, log_filename);
+        if (logger.is_enabled(LogLevel::error))
+        {
+            std::cerr << "LoggerTestNone failed" << std::endl;
+            return false;
+        }
+        logger.write(LogLevel::error, "Client: %u", 1);
+        logger.flush();
+    }
+
+    if (!read_lines().empty())
+    {
+        std::cerr << "LoggerTestNone failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "LoggerTestNone passed" << std::endl;
+    return true;
+}
+
+bool logger_test_sample()
+{
+    Logger logger(LogLevel::none, 4, "");
+    unsigned int sampled = 0;
+    for (unsigned int i = 0; i < 100; ++i)
+    {
+        sampled += logger.sample() ? 1 : 0;
+    }
+
+    if (sampled != 25)
+    {
+        std::cerr << "LoggerTestSample failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "LoggerTestSample passed" << std::endl;
+    return true;
+}
+
+bool logger_test_threads()
+{
+    //Each thread writes less records than capacity of ring buffer, so nothing is dropped.
+    const unsigned int thread_count = 4;
+    const unsigned int record_count = 1000;
+
+    std::remove(log_filename.c_str());
+    {
+        Logger logger(LogLevel::debug, 1, log_filename);
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < thread_count; ++t)
+        {
+            threads.push_back(std::thread([&logger, t, record_count]()
+            {
+                for (unsigned int i = 0; i < record_count; ++i)
+                {
+                    logger.write(LogLevel::debug, "Thread: %u, record: %lld", t, i);
+                }
+            }));
+        }
+
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        logger.flush();
+        if (read_lines().size() != thread_count * record_count)
+        {
+            std::cerr << "LoggerTestThreads failed" << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "LoggerTestThreads passed" << std::endl;
+    return true;
+}
+
+bool logger_test_text()
+{
+    std::remove(log_filename.c_str());
+    {
+        Logger logger(LogLevel::info, 1, log_filename);
+        logger.write_text(LogLevel::info, "Client: 1, slow expression: wall 1500 us, prefix '1 + 2'");
+        logger.write_text(LogLevel::debug, "Client: 2, skipped");
+    }
+
+    std::vector<std::string> lines = read_lines();
+    if (lines.size() != 1 || !ends_with(lines[0], "info  Client: 1, slow expression: wall 1500 us, prefix '1 + 2'"))
+    {
+        std::cerr << "LoggerTestText failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "LoggerTestText passed" << std::endl;
+    return true;
+}
+
+const std::function<bool()> tests[] =
+{
+    logger_test_levels,
+    logger_test_none,
+    logger_test_sample,
+    logger_test_threads,
+    logger_test_text
+};
+
+int main()
+{
+    bool result{true};
+
+    for (auto& test: tests)
+    {
+        if (!test())
+        {
+            result = false;
+        }
+    }
+
+    return result ? 0 : 1;
+}
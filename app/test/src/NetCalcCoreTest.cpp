@@ -5,9 +5,19 @@
  * main function returns 1 if one of test failed.
  */
 
+#include <LoopbackTransport.h>
 #include <NetCalcCore.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
 #include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
 
 class NetCalcCoreTest
 {
@@ -27,12 +37,47 @@ private:
     bool send(const std::string& expected_outgoind_data, bool processing_error = false);
     bool send_failed();
 
+    bool check_bulk_parse_mode();
+    bool bulk_parse();
+
     bool net_calc_core_testcase_1();
     bool net_calc_core_testcase_2();
     bool net_calc_core_testcase_3();
     bool net_calc_core_testcase_4();
     bool net_calc_core_testcase_5();
     bool net_calc_core_testcase_6();
+    bool net_calc_core_testcase_7();
+    bool net_calc_core_testcase_8();
+    bool net_calc_core_testcase_9();
+    bool net_calc_core_testcase_10();
+    bool net_calc_core_testcase_11();
+    bool net_calc_core_testcase_12();
+    bool net_calc_core_testcase_13();
+    bool net_calc_core_testcase_14();
+    bool net_calc_core_testcase_15();
+    bool net_calc_core_testcase_16();
+    bool net_calc_core_testcase_17();
+    bool net_calc_core_testcase_18();
+    bool net_calc_core_testcase_19();
+    bool net_calc_core_testcase_20();
+
+    static Config make_config(unsigned int turn_expressions = 4);
+
+    /**
+     * Client of NetCalcCore that is created by testcase with its own config.
+     */
+    struct test_client
+    {
+        NetCalcCore& core;
+        NetCalcCore::client& c;
+
+        /** Is client in mode m? */
+        bool mode(NetCalcCore::client_unit_test_mode m) const;
+        /** Passes data to handle_receive() as received data. */
+        void receive(const std::string& data);
+        /** Calls parse_result() while expression is parsed by bulk threads. */
+        void bulk_parse();
+    };
 
 private:
     Config cfg;
@@ -45,8 +90,48 @@ static const boost::system::error_code error{boost::system::errc::connection_abo
 static const std::string div_by_zero = "Division by zero\n";
 static const std::string invalid_expr = "Invalid expression\n";
 
+Config NetCalcCoreTest::make_config(unsigned int turn_expressions /*= 4*/)
+{
+    Config config;
+    config.address = "127.0.0.1";
+    config.port = 0;
+    config.clients = 2;
+    config.threads = 0;
+
+    //Expression that is longer than 64 bytes makes connection heavy, it is parsed by 16 bytes per turn.
+    config.bulk_threads = 1;
+    config.heavy_bytes = 64;
+    config.heavy_parse_time = 0;
+    config.bulk_budget = 16;
+
+    //Connection evaluates at most 4 (by default) pipelined expressions or 32 bytes per turn.
+    config.turn_expressions = turn_expressions;
+    config.turn_bytes = 32;
+
+    return config;
+}
+
+bool NetCalcCoreTest::test_client::mode(NetCalcCore::client_unit_test_mode m) const
+{
+    return c.unit_test_mode == m;
+}
+
+void NetCalcCoreTest::test_client::receive(const std::string& data)
+{
+    memcpy(c.buffer, data.data(), data.size());
+    core.handle_receive(ci, success, data.size());
+}
+
+void NetCalcCoreTest::test_client::bulk_parse()
+{
+    while (mode(NetCalcCore::client_unit_test_mode::bulk_parse))
+    {
+        core.parse_result(ci);
+    }
+}
+
 NetCalcCoreTest::NetCalcCoreTest()
-    : cfg{"127.0.0.1", 0, 1, 0}, core(cfg)
+    : cfg(make_config(1)), core(cfg)
 {
     core.unit_test_mode = true;
     core.start();
@@ -60,7 +145,21 @@ bool NetCalcCoreTest::test()
         net_calc_core_testcase_3() &&
         net_calc_core_testcase_4() &&
         net_calc_core_testcase_5() &&
-        net_calc_core_testcase_6();
+        net_calc_core_testcase_6() &&
+        net_calc_core_testcase_7() &&
+        net_calc_core_testcase_8() &&
+        net_calc_core_testcase_9() &&
+        net_calc_core_testcase_10() &&
+        net_calc_core_testcase_11() &&
+        net_calc_core_testcase_12() &&
+        net_calc_core_testcase_13() &&
+        net_calc_core_testcase_14() &&
+        net_calc_core_testcase_15() &&
+        net_calc_core_testcase_16() &&
+        net_calc_core_testcase_17() &&
+        net_calc_core_testcase_18() &&
+        net_calc_core_testcase_19() &&
+        net_calc_core_testcase_20();
 }
 
 bool NetCalcCoreTest::check_accept_mode()
@@ -121,8 +220,7 @@ bool NetCalcCoreTest::send(const std::string& expected_outgoind_data, bool proce
         return false;
     }
 
-    std::string data(core.clients[ci].buffer, expected_outgoind_data.size());
-    if (expected_outgoind_data != data)
+    if (expected_outgoind_data != core.clients[ci].response)
     {
         return false;
     }
@@ -143,6 +241,23 @@ bool NetCalcCoreTest::send_failed()
 
 }
 
+bool NetCalcCoreTest::check_bulk_parse_mode()
+{
+    return core.clients[ci].unit_test_mode == NetCalcCore::client_unit_test_mode::bulk_parse;
+}
+
+bool NetCalcCoreTest::bulk_parse()
+{
+    if (!check_bulk_parse_mode())
+    {
+        return false;
+    }
+
+    //Bulk thread calls parse_result.
+    core.parse_result(ci);
+    return true;
+}
+
 bool NetCalcCoreTest::net_calc_core_testcase_1()
 {
     //Test usual expression.
@@ -212,6 +327,648 @@ bool NetCalcCoreTest::net_calc_core_testcase_6()
     return true;
 }
 
+bool NetCalcCoreTest::net_calc_core_testcase_7()
+{
+    //Test heavy connection: after 64 bytes its expression is parsed by bulk threads by 16 bytes per turn.
+    std::string part = "(1 + 2 + 3 + 4 + 5 + 6 + 7 + 8 + 9 + 10) * 2 - ";  //48 bytes
+    if (!accept())                      { return false; }
+    if (!receive(part))                 { return false; }
+    if (!receive(part))                 { return false; } //96 bytes, connection becomes heavy
+    if (core.clients[ci].heavy != true) { return false; }
+    if (!receive(part))                 { return false; }
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        if (!bulk_parse())              { return false; }
+    }
+    if (!check_receive_mode())          { return false; }
+    if (!receive("7\n1 + 2\n"))         { return false; }
+    if (!bulk_parse())                  { return false; }
+    if (!send("-117\n"))                { return false; } //connection is not heavy after the end of expression
+    if (core.clients[ci].heavy)         { return false; }
+    if (!send("3\n"))                   { return false; }
+    if (!receive_failed())              { return false; } //set accept mode for the next test
+    return true;
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_8()
+{
+    //Test fair scheduling: pipelining client evaluates 1 expression per turn, another client is served between turns.
+    const unsigned int other = 1;
+    std::string expr;
+    for (unsigned int i = 0; i < 100; ++i)
+    {
+        expr += "1+1\n";
+    }
+
+    if (!accept())                  { return false; }
+    if (!receive(expr))             { return false; }
+    for (unsigned int turn = 0; turn < 100; ++turn)
+    {
+        //Another client gets its result after one turn of pipelining client.
+        if (core.clients[other].unit_test_mode != NetCalcCore::client_unit_test_mode::async_accept) { return false; }
+        core.handle_accept(other, success);
+        memcpy(core.clients[other].buffer, "2*3\n", 4);
+        core.handle_receive(other, success, 4);
+        if (core.clients[other].response != "6\n") { return false; }
+        core.handle_send(other, false, success, 2);
+        core.handle_receive(other, error, 0);
+
+        if (!send("2\n"))               { return false; }
+    }
+    if (!receive_failed())          { return false; } //set accept mode for the next test
+    return true;
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_9()
+{
+    //Test Unix domain socket listener: without TCP port all clients are accepted by it, socket file is removed at the end.
+    const std::string path = "NetCalcCoreTest.sock";
+    struct stat st;
+    {
+        Config config;
+        config.address = "127.0.0.1";
+        config.port = 0;
+        config.clients = 3;
+        config.threads = 1;
+        config.unix_socket = path;
+        NetCalcCore unix_core(config);
+
+        if (unix_core.acceptor.is_open() || !unix_core.unix_acceptor.is_open()) { return false; }
+        if (unix_core.listeners.size() != 1 || !unix_core.listeners[0].local)   { return false; }
+        if (::stat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) { return false; }
+    }
+    if (::stat(path.c_str(), &st) == 0)                                         { return false; }
+
+    //Both listeners share free slots: the only slot serves connections of both of them in turn.
+    boost::asio::io_service io;
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0);
+    {
+        boost::asio::ip::tcp::acceptor probe(io, endpoint);
+        endpoint.port(probe.local_endpoint().port());
+    }
+
+    Config config;
+    config.address = "127.0.0.1";
+    config.port = endpoint.port();
+    config.clients = 1;
+    config.threads = 1;
+    config.unix_socket = path;
+    NetCalcCore shared_core(config);
+    shared_core.start();
+
+    auto request = [](boost::asio::generic::stream_protocol::socket& s, const std::string& data)
+    {
+        boost::system::error_code ec;
+        boost::asio::streambuf response;
+        boost::asio::write(s, boost::asio::buffer(data), ec);
+        boost::asio::read_until(s, response, '\n', ec);
+        return ec ? std::string() : std::string(boost::asio::buffers_begin(response.data()), boost::asio::buffers_end(response.data()));
+    };
+    auto connect = [](boost::asio::generic::stream_protocol::socket& s, const boost::asio::generic::stream_protocol::endpoint& e)
+    {
+        boost::system::error_code ec;
+        s.connect(e, ec);
+        timeval timeout{5, 0};
+        return !ec && ::setsockopt(s.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0;
+    };
+
+    boost::asio::generic::stream_protocol::socket local(io);
+    boost::asio::generic::stream_protocol::socket tcp(io);
+    bool result = connect(local, boost::asio::local::stream_protocol::endpoint(path)) && request(local, "1 + 2\n") == "3\n";
+
+    //TCP connection waits for the slot until Unix domain socket connection is closed.
+    result = result && connect(tcp, endpoint) && boost::asio::write(tcp, boost::asio::buffer("2 * 3\n", 6)) == 6;
+    local.close();
+    result = result && request(tcp, "4 - 1\n").substr(0, 2) == "6\n";
+    tcp.close();
+
+    result = result && connect(local, boost::asio::local::stream_protocol::endpoint(path)) && request(local, "7 * 7\n") == "49\n";
+    local.close();
+    shared_core.stop();
+    return result;
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_10()
+{
+    //Test timeouts: idle 2000 ms, expression 4000 ms, receive rate 1000 bytes/s. Time is set by check_timeouts().
+    Config config;
+    config.address = "127.0.0.1";
+    config.port = 0;
+    config.clients = 1;
+    config.threads = 1;
+    config.idle_timeout = 2000;
+    config.expression_timeout = 4000;
+    config.min_receive_rate = 1000;
+    config.bulk_threads = 0;
+    NetCalcCore timeout_core(config);
+    timeout_core.unit_test_mode = true;
+    timeout_core.start();
+
+    NetCalcCore::client& c = timeout_core.clients[ci];
+    test_client t{timeout_core, c};
+
+    //Idle connection is closed, its pending receive completes with error after shutdown of socket.
+    timeout_core.handle_accept(ci, success);
+    timeout_core.check_timeouts(1990);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_receive)) { return false; }
+    timeout_core.check_timeouts(2010);
+    timeout_core.handle_receive(ci, error, 0);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_accept))  { return false; }
+
+    //4 bytes are received, so rate deadline is 1004 ms after the first byte (earlier than idle one).
+    timeout_core.handle_accept(ci, success);
+    t.receive("1 + ");
+    timeout_core.check_timeouts(3020);
+    timeout_core.handle_receive(ci, error, 0);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_accept))  { return false; }
+
+    //Client sends data often enough and fast enough, but doesn't complete expression in 4000 ms.
+    timeout_core.handle_accept(ci, success);
+    t.receive(std::string(8000, ' '));
+    timeout_core.check_timeouts(4500);
+    t.receive("1 +");
+    timeout_core.check_timeouts(6000);
+    t.receive(" 2");
+    timeout_core.check_timeouts(7000);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_receive)) { return false; }
+    timeout_core.check_timeouts(7030);
+    timeout_core.handle_receive(ci, error, 0);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_accept))  { return false; }
+
+    //Active client is not closed, but client that doesn't read results is closed by idle timeout.
+    timeout_core.handle_accept(ci, success);
+    t.receive("1+2\n");
+    timeout_core.handle_send(ci, false, success, 2);
+    timeout_core.check_timeouts(9000);
+    t.receive("1+2\n");
+    timeout_core.check_timeouts(10990);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_send))    { return false; }
+    timeout_core.check_timeouts(11010);
+    timeout_core.handle_send(ci, false, error, 0);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_accept))  { return false; }
+
+    NetCalcStats stats = timeout_core.get_stats();
+    return stats.idle_timeouts == 2 && stats.expression_timeouts == 1 && stats.slow_receives == 1;
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_11()
+{
+    //Test rate limit (2 expressions per second) and load shedding (lag is set by test).
+    Config config;
+    config.address = "127.0.0.1";
+    config.port = 0;
+    config.clients = 1;
+    config.threads = 1;
+    config.rate_expressions = 2;
+    config.shed_lag = 1000;
+    NetCalcCore limited_core(config);
+    limited_core.unit_test_mode = true;
+    limited_core.start();
+
+    NetCalcCore::client& c = limited_core.clients[ci];
+    test_client t{limited_core, c};
+
+    //Bucket has 2 tokens, the third expression waits for a token.
+    limited_core.handle_accept(ci, success);
+    t.receive("1+1\n2+2\n3+3\n");
+    if (c.response != "2\n4\n")                                    { return false; }
+    limited_core.handle_send(ci, false, success, 4);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::throttle))      { return false; }
+
+    //Timer of throttled connection expires when the token is refilled.
+    c.expression_tokens = 1.0;
+    limited_core.dispatch_continue(ci);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_send) || c.response != "6\n") { return false; }
+    c.expression_tokens = 2.0;
+    limited_core.handle_send(ci, false, success, 2);
+
+    //Overloaded event loop rejects new expressions, incomplete expression is rejected up to its end.
+    limited_core.lag_probes[0].lag = 5000;
+    t.receive("1+2\n3*4\n5");
+    if (c.response != "Server busy\nServer busy\n")                { return false; }
+    limited_core.handle_send(ci, false, success, 24);
+    limited_core.lag_probes[0].lag = 0;
+    t.receive("+1\n2*2\n");
+    if (c.response != "Server busy\n4\n")                          { return false; }
+    limited_core.handle_send(ci, false, success, 14);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_receive)) { return false; }
+
+    NetCalcStats stats = limited_core.get_stats();
+    return stats.throttles == 1 && stats.shed_expressions == 3;
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_12()
+{
+    //Test parallel evaluation: 24 bytes of complete lines are split into 3 chunks of 8 bytes.
+    Config config;
+    config.address = "127.0.0.1";
+    config.port = 0;
+    config.clients = 1;
+    config.threads = 1;
+    config.parallel_threads = 3;
+    config.parallel_chunk = 8;
+    NetCalcCore parallel_core(config);
+    parallel_core.unit_test_mode = true;
+    parallel_core.start();
+
+    NetCalcCore::client& c = parallel_core.clients[ci];
+    test_client t{parallel_core, c};
+
+    //Chunks are evaluated in any order, results are sent in request order, incomplete expression is parsed after send.
+    parallel_core.handle_accept(ci, success);
+    t.receive("1+1\n2+2\n3+3\n4+4\n5+5\n6+6\n7");
+    if (!t.mode(NetCalcCore::client_unit_test_mode::parallel_parse) || c.parallel->chunks.size() != 3) { return false; }
+    parallel_core.parallel_parse(ci, 2);
+    parallel_core.parallel_parse(ci, 0);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::parallel_parse))  { return false; }
+    parallel_core.parallel_parse(ci, 1);
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_send) || c.response != "2\n4\n6\n8\n10\n12\n") { return false; }
+    parallel_core.handle_send(ci, false, success, 16);
+    t.receive("\n");
+    if (c.response != "7\n")                                        { return false; }
+    parallel_core.handle_send(ci, false, success, 2);
+
+    //Results after the first processing error are not sent, connection is closed.
+    t.receive("1+1\n5/0\n3+3\n4+4\n5+5\n6+6\n");
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        parallel_core.parallel_parse(ci, i);
+    }
+    if (c.response != "2\n" + div_by_zero)                          { return false; }
+    parallel_core.handle_send(ci, true, success, 19);
+    return t.mode(NetCalcCore::client_unit_test_mode::async_accept);
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_13()
+{
+    //Test pipeline: expression of heavy connection continues in pipeline, pipeline is free after the end of expression.
+    Config config = make_config();
+    config.clients = 1;
+    config.pipelines = 1;
+    NetCalcCore pipeline_core(config);
+    pipeline_core.unit_test_mode = true;
+    pipeline_core.start();
+
+    NetCalcCore::client& c = pipeline_core.clients[ci];
+    test_client t{pipeline_core, c};
+
+    std::string part = "(1 + 2 + 3 + 4 + 5 + 6 + 7 + 8 + 9 + 10) * 2 - ";  //48 bytes
+    pipeline_core.handle_accept(ci, success);
+    t.receive(part);
+    t.receive(part);                                                //96 bytes, connection becomes heavy
+    if (!c.heavy || !c.pipeline || !pipeline_core.free_pipelines.empty()) { return false; }
+    t.receive(part);
+    t.bulk_parse();
+    t.receive("7\n1 + 2\n");
+    t.bulk_parse();
+    if (c.heavy || c.pipeline || pipeline_core.free_pipelines.size() != 1) { return false; }
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_send) || c.response != "-117\n3\n") { return false; }
+    pipeline_core.handle_send(ci, false, success, c.response.size());
+
+    //Division by zero in heavy expression closes connection and frees pipeline (evaluator can find it later).
+    t.receive(part + part);
+    if (!c.pipeline)                                                { return false; }
+    t.receive("1 / 0 + ");
+    t.bulk_parse();
+    if (t.mode(NetCalcCore::client_unit_test_mode::async_receive))
+    {
+        t.receive("1\n");
+        t.bulk_parse();
+    }
+    if (c.response != div_by_zero || c.pipeline || pipeline_core.free_pipelines.size() != 1) { return false; }
+    pipeline_core.handle_send(ci, true, success, c.response.size());
+    return t.mode(NetCalcCore::client_unit_test_mode::async_accept);
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_14()
+{
+    //Test bigint type: results don't overflow, heavy connection doesn't take pipeline, lines are not evaluated in parallel.
+    Config config = make_config();
+    config.clients = 1;
+    config.pipelines = 1;
+    config.parallel_threads = 2;
+    config.parallel_chunk = 4;
+    config.type = NumericType::bigint;
+    NetCalcCore bigint_core(config);
+    bigint_core.unit_test_mode = true;
+    bigint_core.start();
+
+    NetCalcCore::client& c = bigint_core.clients[ci];
+    test_client t{bigint_core, c};
+
+    bigint_core.handle_accept(ci, success);
+    t.receive("2147483647 + 1\n-65536 * 65536\n");
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_send) || c.response != "2147483648\n-4294967296\n") { return false; }
+    bigint_core.handle_send(ci, false, success, c.response.size());
+
+    std::string part = "(12345678901234567890 - 12345678901234567889) * ";   //48 bytes
+    t.receive(part);
+    t.receive(part);                                                //96 bytes, connection becomes heavy
+    if (!c.heavy || c.pipeline || bigint_core.free_pipelines.size() != 1) { return false; }
+    t.receive("99999999999 * 99999999999\n");
+    while (t.mode(NetCalcCore::client_unit_test_mode::bulk_parse))
+    {
+        bigint_core.parse_result(ci);
+    }
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_send) || c.response != "9999999999800000000001\n") { return false; }
+    bigint_core.handle_send(ci, false, success, c.response.size());
+
+    t.receive("1 / (5 - 5)\n");
+    if (c.response != div_by_zero)                                  { return false; }
+    bigint_core.handle_send(ci, true, success, c.response.size());
+    return t.mode(NetCalcCore::client_unit_test_mode::async_accept);
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_15()
+{
+    //Test mod64 type: results are reduced, long literal of heavy connection is split between parts (bulk threads
+    //parse it), number without inverse is division by zero.
+    Config config = make_config();
+    config.clients = 1;
+    config.type = NumericType::mod64;
+    config.modulus = 1000000007;
+    NetCalcCore mod_core(config);
+    mod_core.unit_test_mode = true;
+    mod_core.start();
+
+    NetCalcCore::client& c = mod_core.clients[ci];
+    test_client t{mod_core, c};
+
+    mod_core.handle_accept(ci, success);
+    t.receive("1000000006 + 2\n0 - 1\n1 / 2 * 4\n");
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_send) || c.response != "1\n1000000006\n2\n") { return false; }
+    mod_core.handle_send(ci, false, success, c.response.size());
+
+    t.receive("(123456789012345678901234567890123456789012345");      //46 bytes
+    t.receive("678901234567890123456789012345678901234567890");       //91 bytes, connection becomes heavy
+    t.receive(" + 1) * 1\n");
+    while (t.mode(NetCalcCore::client_unit_test_mode::bulk_parse))
+    {
+        mod_core.parse_result(ci);
+    }
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_send) || c.response != "909021942\n") { return false; }
+    mod_core.handle_send(ci, false, success, c.response.size());
+
+    t.receive("1 / (1000000007 * 5)\n");
+    if (c.response != div_by_zero)                                  { return false; }
+    mod_core.handle_send(ci, true, success, c.response.size());
+    return t.mode(NetCalcCore::client_unit_test_mode::async_accept);
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_16()
+{
+    //Test '#type' command: type is selected per connection (command can be split between receives),
+    //default type is restored for the next connection, invalid command closes connection.
+    Config config = make_config();
+    config.clients = 1;
+    NetCalcCore type_core(config);
+    type_core.unit_test_mode = true;
+    type_core.start();
+
+    NetCalcCore::client& c = type_core.clients[ci];
+    test_client t{type_core, c};
+
+    type_core.handle_accept(ci, success);
+    t.receive("#type int64\n9223372036854775807 + 1\n");
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_send) || c.response != "OK\n9223372036854775807\n") { return false; }
+    type_core.handle_send(ci, false, success, c.response.size());
+
+    t.receive("#type ch");
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_receive)) { return false; }
+    t.receive("ecked_int64\n-9223372036854775807 - 2\n");
+    if (c.response != "OK\nOverflow\n")                            { return false; }
+    type_core.handle_send(ci, true, success, c.response.size());
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_accept))  { return false; }
+
+    type_core.handle_accept(ci, success);
+    t.receive("2147483647 + 1\n");
+    if (c.response != "Overflow\n")                                 { return false; }
+    type_core.handle_send(ci, true, success, c.response.size());
+
+    type_core.handle_accept(ci, success);
+    t.receive("#type mod64 7\n10 * 3\n");
+    if (c.response != "OK\n2\n")                                   { return false; }
+    type_core.handle_send(ci, false, success, c.response.size());
+    t.receive("#type bigint\n99999999999 * 99999999999\n");
+    if (c.response != "OK\n9999999999800000000001\n")              { return false; }
+    type_core.handle_send(ci, false, success, c.response.size());
+
+    t.receive("#type mod64 1\n");
+    if (c.response != "Invalid command\n")                          { return false; }
+    type_core.handle_send(ci, true, success, c.response.size());
+    return t.mode(NetCalcCore::client_unit_test_mode::async_accept);
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_17()
+{
+    //Test slow-expression log: short expression of one receive is not measured, split expressions are measured
+    //(1 microsecond threshold), only one record per second is written.
+    const std::string log_filename = "NetCalcCoreTest.log";
+    std::remove(log_filename.c_str());
+    unsigned long long slow_expressions = 0;
+    {
+        Config config = make_config();
+        config.clients = 1;
+        config.log_level = LogLevel::info;
+        config.log_file = log_filename;
+        config.slow_expression = 1;
+        config.slow_log_rate = 1;
+        NetCalcCore slow_core(config);
+        slow_core.unit_test_mode = true;
+        slow_core.start();
+
+        NetCalcCore::client& c = slow_core.clients[ci];
+        test_client t{slow_core, c};
+
+        slow_core.handle_accept(ci, success);
+        t.receive("1 + 2\n");
+        if (c.response != "3\n")                                      { return false; }
+        slow_core.handle_send(ci, false, success, c.response.size());
+
+        for (unsigned int i = 0; i < 2; ++i)
+        {
+            t.receive("(1 + (2");
+            t.receive(" * 3))\n");
+            if (c.response != "7\n")                                  { return false; }
+            slow_core.handle_send(ci, false, success, c.response.size());
+        }
+        slow_expressions = slow_core.get_stats().slow_expressions;
+    }
+
+    std::vector<std::string> lines;
+    std::ifstream f(log_filename);
+    for (std::string line; std::getline(f, line);)
+    {
+        if (line.find("slow expression") != std::string::npos)
+        {
+            lines.push_back(line);
+        }
+    }
+    std::remove(log_filename.c_str());
+
+    const std::string expected = "14 bytes, 5 tokens, depth 2, prefix '(1 + (2...'";
+    return slow_expressions == 2 && lines.size() == 1 && lines[0].size() > expected.size() &&
+        lines[0].compare(lines[0].size() - expected.size(), expected.size(), expected) == 0;
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_18()
+{
+    //Test in-process transport: real event loop thread gets split and pipelined expressions, closes connection after
+    //processing error, and the third connection waits in backlog until a client slot is free.
+    Config config = make_config();
+    config.clients = 2;
+    config.threads = 1;
+    LoopbackTransport transport(config.clients);
+    NetCalcCore loopback_core(config, &transport);
+    loopback_core.start();
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::string> responses(3);
+    std::vector<bool> closed(3, false);
+    std::vector<std::shared_ptr<LoopbackTransport::Connection>> connections;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        connections.push_back(transport.connect([&mutex, &condition, &responses, &closed, i](
+            LoopbackTransport::Connection&, const char* data, std::size_t size)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (size)
+                {
+                    responses[i].append(data, size);
+                }
+                else
+                {
+                    closed[i] = true;
+                }
+                condition.notify_all();
+            }));
+    }
+
+    auto wait = [&mutex, &condition](const std::function<bool()>& predicate)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::seconds(5), predicate);
+    };
+
+    connections[0]->write("(1 + 2", 6);
+    connections[0]->write(") * 3\n4 - 5\n6 * 7\n8 / 4\n9 + 9\n", 30);
+    connections[2]->write("2 * 2\n", 6);
+    bool result = wait([&responses]() { return responses[0] == "9\n-1\n42\n2\n18\n"; });
+
+    //Third connection is accepted after the first one is closed.
+    connections[0]->write("1 / 0\n", 6);
+    result = result && wait([&responses, &closed]() { return closed[0] && responses[2] == "4\n"; }) &&
+        responses[0] == "9\n-1\n42\n2\n18\nDivision by zero\n" && connections[0]->is_closed() &&
+        !connections[0]->write("1\n", 2);
+
+    //Connection is closed after end of its data.
+    connections[1]->write("3 - 1\n", 6);
+    connections[1]->shutdown();
+    result = result && wait([&responses, &closed]() { return closed[1] && responses[1] == "2\n"; });
+
+    loopback_core.stop();
+    return result;
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_19()
+{
+    //Test resumable sessions: state of parser survives disconnect in the middle of expression, resume replies with
+    //offset and number of results, processing error ends session.
+    Config config = make_config();
+    config.clients = 1;
+    config.sessions = 2;
+    NetCalcCore session_core(config);
+    session_core.unit_test_mode = true;
+    session_core.start();
+
+    NetCalcCore::client& c = session_core.clients[ci];
+    test_client t{session_core, c};
+
+    session_core.handle_accept(ci, success);
+    t.receive("#session\n");
+    if (c.response.size() != 20 || c.response.compare(0, 3, "OK ") != 0) { return false; }
+    const std::string token = c.response.substr(3, 16);
+    session_core.handle_send(ci, false, success, c.response.size());
+
+    t.receive("1 + 2\n(10 - (3");
+    if (c.response != "3\n")                                          { return false; }
+    session_core.handle_send(ci, false, success, c.response.size());
+    session_core.handle_receive(ci, error, 0);
+    if (c.unit_test_mode != NetCalcCore::client_unit_test_mode::async_accept) { return false; }
+
+    //Unknown token is rejected and connection is closed.
+    session_core.handle_accept(ci, success);
+    t.receive("#resume 0000000000000001\n");
+    if (c.response != "Invalid command\n")                            { return false; }
+    session_core.handle_send(ci, true, success, c.response.size());
+
+    session_core.handle_accept(ci, success);
+    t.receive("#resume " + token + "\n");
+    if (c.response != "OK 14 1\n")                                    { return false; }
+    session_core.handle_send(ci, false, success, c.response.size());
+    t.receive(" + 1)) * 2\n");
+    if (c.response != "12\n")                                         { return false; }
+    session_core.handle_send(ci, false, success, c.response.size());
+
+    //The second '#resume' of connection is a processing error, it ends session.
+    t.receive("#resume " + token + "\n");
+    if (c.response != "Invalid command\n")                            { return false; }
+    session_core.handle_send(ci, true, success, c.response.size());
+    session_core.handle_accept(ci, success);
+    t.receive("#resume " + token + "\n");
+    if (c.response != "Invalid command\n")                            { return false; }
+    session_core.handle_send(ci, true, success, c.response.size());
+
+    //Detached session is dropped by session timer without session commands.
+    session_core.handle_accept(ci, success);
+    t.receive("#session\n");
+    session_core.handle_send(ci, false, success, c.response.size());
+    session_core.handle_receive(ci, error, 0);
+    if (session_core.sessions.size() != 1)                            { return false; }
+    session_core.drop_expired_sessions(session_core.sessions.begin()->second.detach_time + config.session_timeout - 1);
+    if (session_core.sessions.size() != 1)                            { return false; }
+    session_core.drop_expired_sessions(session_core.sessions.begin()->second.detach_time + config.session_timeout);
+    if (!session_core.sessions.empty())                               { return false; }
+
+    return session_core.get_stats().resumed_sessions == 1;
+}
+
+bool NetCalcCoreTest::net_calc_core_testcase_20()
+{
+    //Test merged responses: results of one turn (4 expressions or 32 bytes) are sent by one write,
+    //processing error ends the turn and closes connection after results of previous expressions.
+    Config config = make_config();
+    config.clients = 1;
+    NetCalcCore merged_core(config);
+    merged_core.unit_test_mode = true;
+    merged_core.start();
+
+    NetCalcCore::client& c = merged_core.clients[ci];
+    test_client t{merged_core, c};
+
+    //The first two expressions exhaust 32 bytes budget of turn.
+    merged_core.handle_accept(ci, success);
+    t.receive("1741 + 7079 * 367  / 13 - 83\n1741 * ((7079 / 367)  * 13) / 83\n2861 + (1931 * 3271 - (3511 + 3631) / 419)\n");
+    if (c.response != "201503\n5181\n")                                { return false; }
+    merged_core.handle_send(ci, false, success, c.response.size());
+    if (c.response != "6319145\n")                                     { return false; }
+    merged_core.handle_send(ci, false, success, c.response.size());
+
+    //Short expressions exhaust 4 expressions budget of turn.
+    t.receive("1+1\n2+2\n3+3\n4+4\n5+5\n");
+    if (c.response != "2\n4\n6\n8\n")                                 { return false; }
+    merged_core.handle_send(ci, false, success, c.response.size());
+    if (c.response != "10\n")                                          { return false; }
+    merged_core.handle_send(ci, false, success, c.response.size());
+    if (!t.mode(NetCalcCore::client_unit_test_mode::async_receive))     { return false; }
+
+    t.receive("1 + 2\n5/(2/7)\n");
+    if (c.response != "3\n" + div_by_zero)                              { return false; }
+    merged_core.handle_send(ci, true, success, c.response.size());
+    return t.mode(NetCalcCore::client_unit_test_mode::async_accept);
+}
+
 int main()
 {
     NetCalcCoreTest obj;
@@ -1,6 +1,7 @@
 /**
  * This file contains unit-tests for whole NetCalculator application.
  * Start NetCalculator application for this test.
+ * Arguments: <address> <port> for TCP or 'unix' <path> for Unix domain socket.
  * main function returns 0 if all test passed.
  * main function returns 1 if one of test failed.
  */
@@ -24,11 +25,13 @@ const TestCase test_cases[] =
     {false, false, "3 + 4\n", "7\n"},
     {false, true,  "(1 + 2\n", "Invalid expression\n"},
     {true,  true,  "5/(3/7)\n", "Division by zero\n"},
+    {true,  true,  "-2147483648 / -1\n", "Overflow\n"},
     {true,  true,  "(2 + 3) * 7 / 11\n(109 - 53) * 17 / 19\n103/((67 - 43) / 7)\n", "3\n50\n34\n"}
 };
 
 template <typename SyncReadStream, typename MutableBufferSequence>
-size_t readWithTimeout(SyncReadStream& s,
+size_t readWithTimeout(boost::asio::io_service& service,
+    SyncReadStream& s,
     const MutableBufferSequence& buffers,
     boost::asio::deadline_timer& timer,
     boost::system::error_code& error)
@@ -40,8 +43,8 @@ size_t readWithTimeout(SyncReadStream& s,
     boost::optional<boost::system::error_code> read_result;
     boost::asio::async_read(s, buffers, [&read_result, &readed] (const boost::system::error_code& error, size_t bytes_received) { read_result.reset(error); readed = bytes_received; });
 
-    s.get_io_service().reset();
-    while (s.get_io_service().run_one())
+    service.reset();
+    while (service.run_one())
     {
         if (read_result)
             timer.cancel();
@@ -72,21 +75,26 @@ public:
     void disconnect() { if (socket.is_open()) socket.close();}
 
 private:
-    static boost::asio::ip::tcp::endpoint make_endpoint(int argc, const char* const* argv);
+    static boost::asio::generic::stream_protocol::endpoint make_endpoint(int argc, const char* const* argv);
 
 private:
     boost::asio::io_service service;
-    boost::asio::ip::tcp::endpoint endpoint;
-    boost::asio::ip::tcp::socket socket;
+    boost::asio::generic::stream_protocol::endpoint endpoint;
+    boost::asio::generic::stream_protocol::socket socket;
 };
 
-boost::asio::ip::tcp::endpoint NetCalculatorAppTest::make_endpoint(int argc, const char* const* argv)
+boost::asio::generic::stream_protocol::endpoint NetCalculatorAppTest::make_endpoint(int argc, const char* const* argv)
 {
     if (argc != 3)
     {
         throw std::runtime_error("Invalid arguments.");
     }
 
+    if (std::string(argv[1]) == "unix")
+    {
+        return boost::asio::local::stream_protocol::endpoint(argv[2]);
+    }
+
     boost::system::error_code ec;
     boost::asio::ip::address address = boost::asio::ip::address::from_string(argv[1], ec);
     if (ec)
@@ -128,7 +136,7 @@ bool NetCalculatorAppTest::exchange(const std::string& request, std::string& res
     timer.expires_from_now(boost::posix_time::seconds(5));
     while (!ec && (need_to_read - readed))
     {
-        size_t n = readWithTimeout(socket, boost::asio::buffer(&response_buffer[readed], need_to_read - readed), timer, ec);
+        size_t n = readWithTimeout(service, socket, boost::asio::buffer(&response_buffer[readed], need_to_read - readed), timer, ec);
         if (!ec)
         {
             readed += n;
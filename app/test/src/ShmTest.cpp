@@ -0,0 +1,210 @@
+/**
+ * This file contains unit-tests for shared-memory transport (ShmServer and ShmClient classes).
+ * main function returns 0 if all test passed.
+ * main function returns 1 if one of test failed.
+ */
+
+#include <ShmClient.h>
+#include <ShmServer.h>
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+static const std::string shm_name = "NetCalculatorShmTest" + std::to_string(getpid());
+
+bool shm_test_evaluate()
+{
+    //Server doesn't spin, so each request wakes it up through futex.
+    ShmServer server(shm_name, 2, 4096, 16, 0);
+    server.start();
+
+    ShmClient client;
+    std::string error;
+    std::string result;
+    bool ok = client.attach(shm_name, error) &&
+        client.evaluate("1 + 2", result) && result == "3" &&
+        client.evaluate("53/(17-(19+23))*11-(31+(37+83))+113", result) && result == "-60" &&
+        client.evaluate("5/(3/7)", result) && result == "Division by zero" &&
+        client.evaluate("(1 + 2", result) && result == "Invalid expression" &&
+        client.evaluate("65536 * (2 * 16384)", result) && result == "Overflow" &&
+        client.evaluate("2 * (3 + 4)", result) && result == "14";
+
+    if (!ok)
+    {
+        std::cerr << "ShmTestEvaluate failed " << error << std::endl;
+        return false;
+    }
+
+    std::cout << "ShmTestEvaluate passed" << std::endl;
+    return true;
+}
+
+bool shm_test_errors()
+{
+    //The rest of line after processing error is skipped, sessions use numeric type of server.
+    ShmServer server(shm_name, 1, 4096, 16, 0, NumericType::float64);
+    server.start();
+
+    ShmClient client;
+    std::string error;
+    std::string results;
+    char buffer[100];
+    bool ok = client.attach(shm_name, error) && client.write("1/0 + 7", 7);
+    while (ok && results.find('\n') == std::string::npos)
+    {
+        std::size_t n = client.read(buffer, sizeof(buffer));
+        ok = n != 0;
+        results.append(buffer, n);
+    }
+
+    std::string result;
+    ok = ok && results == "Division by zero\n" && client.write(" + 1\n", 5) &&
+        client.evaluate("0.5 + 0.25", result) && result == "0.75" &&
+        client.evaluate("1e308 * 10", result) && result == "Overflow" &&
+        client.evaluate("2e308", result) && result == "Overflow";
+
+    if (!ok)
+    {
+        std::cerr << "ShmTestErrors failed " << error << std::endl;
+        return false;
+    }
+
+    std::cout << "ShmTestErrors passed" << std::endl;
+    return true;
+}
+
+bool shm_test_pipeline()
+{
+    //Requests and results are 10 times larger than rings.
+    const unsigned int count = 10000;
+    ShmServer server(shm_name, 1, 4096, 16, 50);
+    server.start();
+
+    ShmClient client;
+    std::string error;
+    if (!client.attach(shm_name, error))
+    {
+        std::cerr << "ShmTestPipeline failed " << error << std::endl;
+        return false;
+    }
+
+    std::string request;
+    std::string expected;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        request += std::to_string(i) + " + 1\n";
+        expected += std::to_string(i + 1) + "\n";
+    }
+
+    bool written = false;
+    std::thread writer([&client, &request, &written]() { written = client.write(request.data(), request.size()); });
+
+    std::string results;
+    char buffer[1000];
+    while (results.size() < expected.size())
+    {
+        std::size_t n = client.read(buffer, sizeof(buffer));
+        if (!n)
+        {
+            break;
+        }
+        results.append(buffer, n);
+    }
+    writer.join();
+
+    if (!written || results != expected)
+    {
+        std::cerr << "ShmTestPipeline failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "ShmTestPipeline passed" << std::endl;
+    return true;
+}
+
+bool shm_test_sessions()
+{
+    ShmServer server(shm_name, 2, 4096, 16, 0);
+    server.start();
+
+    ShmClient client1;
+    ShmClient client2;
+    ShmClient client3;
+    std::string error;
+    std::string result;
+
+    //The third client doesn't get a session until one of sessions is released.
+    bool ok = client1.attach(shm_name, error) && client2.attach(shm_name, error) &&
+        !client3.attach(shm_name, error);
+
+    //Unfinished expression of the previous client doesn't affect the next one.
+    ok = ok && client1.write("(1 + ", 5);
+    client1.detach();
+    ok = ok && client3.attach(shm_name, error) &&
+        client3.evaluate("2 * 3", result) && result == "6" &&
+        client2.evaluate("7 - 10", result) && result == "-3";
+
+    if (!ok)
+    {
+        std::cerr << "ShmTestSessions failed " << error << std::endl;
+        return false;
+    }
+
+    std::cout << "ShmTestSessions passed" << std::endl;
+    return true;
+}
+
+bool shm_test_stopped_server()
+{
+    ShmClient client;
+    std::string error;
+    std::string result;
+    {
+        ShmServer server(shm_name, 1, 4096, 16, 0);
+        server.start();
+        if (!client.attach(shm_name, error))
+        {
+            std::cerr << "ShmTestStoppedServer failed " << error << std::endl;
+            return false;
+        }
+    }
+
+    //Client doesn't hang when server is stopped, segment can't be opened anymore.
+    ShmClient another_client;
+    if (client.evaluate("1 + 2", result) || another_client.attach(shm_name, error))
+    {
+        std::cerr << "ShmTestStoppedServer failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "ShmTestStoppedServer passed" << std::endl;
+    return true;
+}
+
+const std::function<bool()> tests[] =
+{
+    shm_test_evaluate,
+    shm_test_errors,
+    shm_test_pipeline,
+    shm_test_sessions,
+    shm_test_stopped_server
+};
+
+int main()
+{
+    bool result{true};
+
+    for (auto& test: tests)
+    {
+        if (!test())
+        {
+            result = false;
+        }
+    }
+
+    return result ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+/**
+ * This file contains unit-tests for TimerWheel class.
+ * main function returns 0 if all test passed.
+ * main function returns 1 if one of test failed.
+ */
+
+#include <TimerWheel.h>
+
+#include <functional>
+#include <iostream>
+#include <vector>
+
+bool timer_wheel_test_expire()
+{
+    //8 slots by 10 milliseconds, deadlines of ids 0, 1 and 2 are 25, 70 and 300 (later than one round).
+    TimerWheel wheel(8, 10);
+    std::vector<std::uint64_t> deadlines{25, 70, 300};
+    std::vector<std::uint64_t> expired(deadlines.size(), 0);
+    unsigned int visits = 0;
+
+    auto visit = [&deadlines, &expired, &visits](unsigned int id, std::uint64_t, std::uint64_t now) -> std::uint64_t
+    {
+        ++visits;
+        if (deadlines[id] > now)
+        {
+            return deadlines[id];
+        }
+
+        expired[id] = now;
+        return 0;
+    };
+
+    for (unsigned int id = 0; id < deadlines.size(); ++id)
+    {
+        wheel.insert(id, deadlines[id]);
+    }
+
+    for (std::uint64_t now = 0; now <= 400; now += 5)
+    {
+        wheel.advance(now, visit);
+    }
+
+    //Each id expires within one tick after its deadline, id 2 is visited once per round before that.
+    bool result = expired[0] == 30 && expired[1] == 70 && expired[2] == 300 && visits == 7;
+    if (!result)
+    {
+        std::cerr << "TimerWheelTestExpire failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "TimerWheelTestExpire passed" << std::endl;
+    return true;
+}
+
+bool timer_wheel_test_lazy()
+{
+    //Owner moves deadline forward without touching the wheel, passed deadline is visited by the next advance.
+    TimerWheel wheel(16, 10);
+    std::uint64_t deadline = 50;
+    std::uint64_t expired = 0;
+
+    auto visit = [&deadline, &expired](unsigned int, std::uint64_t, std::uint64_t now) -> std::uint64_t
+    {
+        if (deadline > now)
+        {
+            return deadline;
+        }
+
+        expired = now;
+        return 0;
+    };
+
+    wheel.insert(0, deadline);
+    wheel.advance(40, visit);
+    deadline = 120;
+    wheel.advance(60, visit);
+    wheel.advance(110, visit);
+    bool result = !expired;
+
+    //Long pause: advance visits each slot once.
+    wheel.advance(5000, visit);
+    result = result && expired == 5000;
+
+    wheel.insert(0, 10);
+    deadline = 10;
+    wheel.advance(5010, visit);
+    result = result && expired == 5010;
+
+    if (!result)
+    {
+        std::cerr << "TimerWheelTestLazy failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "TimerWheelTestLazy passed" << std::endl;
+    return true;
+}
+
+const std::function<bool()> tests[] =
+{
+    timer_wheel_test_expire,
+    timer_wheel_test_lazy
+};
+
+int main()
+{
+    bool result{true};
+
+    for (auto& test: tests)
+    {
+        if (!test())
+        {
+            result = false;
+        }
+    }
+
+    return result ? 0 : 1;
+}
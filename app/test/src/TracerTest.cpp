@@ -0,0 +1,145 @@
+/**
+ * This file contains unit-tests for Tracer class.
+ * main function returns 0 if all test passed.
+ * main function returns 1 if one of test failed.
+ */
+
+#include <Tracer.h>
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::size_t count_substrings(const std::string& s, const std::string& substring)
+{
+    std::size_t n = 0;
+    for (std::size_t pos = s.find(substring); pos != std::string::npos; pos = s.find(substring, pos + 1))
+    {
+        ++n;
+    }
+
+    return n;
+}
+
+bool tracer_test_sample()
+{
+    Tracer disabled(0);
+    Tracer tracer(10);
+    unsigned int sampled = 0;
+
+    for (unsigned int i = 0; i < 100; ++i)
+    {
+        sampled += tracer.sample() ? 1 : 0;
+        if (disabled.sample() || disabled.is_enabled())
+        {
+            std::cerr << "TracerTestSample failed" << std::endl;
+            return false;
+        }
+    }
+
+    if (sampled != 10)
+    {
+        std::cerr << "TracerTestSample failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "TracerTestSample passed" << std::endl;
+    return true;
+}
+
+bool tracer_test_dump()
+{
+    Tracer tracer(1);
+    tracer.record(TracePhase::accept, 3, 1000, 2500);
+    tracer.record(TracePhase::parse, 3, 3000, 4001, 42);
+
+    std::ostringstream s;
+    tracer.dump(s);
+    std::string json = s.str();
+
+    bool result =
+        json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0 &&
+        json.find("{\"name\":\"accept\",\"cat\":\"client\",\"ph\":\"X\",\"ts\":1.000,\"dur\":1.500,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"client\":3,\"value\":0}}") != std::string::npos &&
+        json.find("{\"name\":\"parse\",\"cat\":\"client\",\"ph\":\"X\",\"ts\":3.000,\"dur\":1.001,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"client\":3,\"value\":42}}") != std::string::npos &&
+        json.find("\n]}\n") == json.size() - 4;
+
+    if (!result)
+    {
+        std::cerr << "TracerTestDump failed: " << json << std::endl;
+        return false;
+    }
+
+    std::cout << "TracerTestDump passed" << std::endl;
+    return true;
+}
+
+bool tracer_test_threads()
+{
+    //Each thread writes more spans than capacity of ring buffer, so only the newest spans are dumped.
+    const unsigned int thread_count = 3;
+    const unsigned int span_count = 10000;
+
+    Tracer tracer(1);
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < thread_count; ++t)
+    {
+        threads.push_back(std::thread([&tracer, t, span_count]()
+        {
+            for (unsigned int i = 0; i < span_count; ++i)
+            {
+                tracer.record(TracePhase::receive, t, i, i + 1, i);
+            }
+        }));
+    }
+
+    //Dump while spans are recorded must not break anything.
+    std::ostringstream s1;
+    tracer.dump(s1);
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    std::ostringstream s2;
+    tracer.dump(s2);
+    std::string json = s2.str();
+
+    if (count_substrings(json, "\"name\":\"receive\"") != thread_count * 8192 ||
+        json.find("\"value\":" + std::to_string(span_count - 1) + "}") == std::string::npos ||
+        json.find("\"value\":0}") != std::string::npos)
+    {
+        std::cerr << "TracerTestThreads failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "TracerTestThreads passed" << std::endl;
+    return true;
+}
+
+const std::function<bool()> tests[] =
+{
+    tracer_test_sample,
+    tracer_test_dump,
+    tracer_test_threads
+};
+
+int main()
+{
+    bool result{true};
+
+    for (auto& test: tests)
+    {
+        if (!test())
+        {
+            result = false;
+        }
+    }
+
+    return result ? 0 : 1;
+}
@@ -1,10 +1,13 @@
 /**
  * This file contains program that generates long arithmetical infix expressions.
+ * Numbers are from the whole int range or (if number of digits is provided) long literals for ShuntingYard<BigInt>
+ * or (if 'float' is provided) decimal literals with point and exponent for ShuntingYard<double>.
  */
 
 #include <iostream>
 #include <limits>
 #include <random>
+#include <string>
 
 inline unsigned int number_of_digits(int value)
 {
@@ -31,12 +34,74 @@ char get_operator(int index)
     return ' ';
 }
 
-void generate_random_expr(std::ostream& stream, unsigned int length)
+/**
+ * Writes number of exactly 'digits' digits (with random sign) to stream and returns its length.
+ */
+template <class Engine>
+unsigned int generate_long_number(std::ostream& stream, Engine& random_engine, unsigned int digits)
+{
+    std::uniform_int_distribution<> digit_distr(0, 9);
+    std::uniform_int_distribution<> first_digit_distr(1, 9);
+    std::uniform_int_distribution<> distr_0_1(0, 1);
+    bool negative = distr_0_1(random_engine) != 0;
+
+    std::string number(negative ? "-" : "");
+    number += static_cast<char>('0' + first_digit_distr(random_engine));
+    for (unsigned int i = 1; i < digits; ++i)
+    {
+        number += static_cast<char>('0' + digit_distr(random_engine));
+    }
+    stream << number;
+
+    return static_cast<unsigned int>(number.size());
+}
+
+/**
+ * Writes decimal literal like -1.234567e-3 (with random sign and exponent from -3 to 3) to stream and returns its length.
+ */
+template <class Engine>
+unsigned int generate_float_number(std::ostream& stream, Engine& random_engine)
+{
+    std::uniform_int_distribution<> mantissa_distr(1000000, 9999999);
+    std::uniform_int_distribution<> exponent_distr(-3, 3);
+    std::uniform_int_distribution<> distr_0_1(0, 1);
+
+    std::string number(distr_0_1(random_engine) ? "-" : "");
+    number += std::to_string(mantissa_distr(random_engine));
+    number.insert(number.size() - 6, ".");
+    number += 'e';
+    number += std::to_string(exponent_distr(random_engine));
+    stream << number;
+
+    return static_cast<unsigned int>(number.size());
+}
+
+/**
+ * Writes number of expression: int, long literal (digits > 0) or decimal literal (floating) and returns its length.
+ */
+template <class Engine>
+unsigned int generate_number(std::ostream& stream, Engine& random_engine, unsigned int digits, bool floating)
+{
+    if (floating)
+    {
+        return generate_float_number(stream, random_engine);
+    }
+    if (digits)
+    {
+        return generate_long_number(stream, random_engine, digits);
+    }
+
+    std::uniform_int_distribution<> number_distr(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    int rnd = number_distr(random_engine);
+    stream << rnd;
+    return number_of_digits(rnd);
+}
+
+void generate_random_expr(std::ostream& stream, unsigned int length, unsigned int digits, bool floating)
 {
     unsigned int open_brackets(0);
     std::default_random_engine random_engine(std::random_device{}());
     std::uniform_int_distribution<> distr_0_1(0, 1);
-    std::uniform_int_distribution<> number_distr(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
     std::uniform_int_distribution<> operation_distr(0, 2);
     unsigned int i = 0;
 
@@ -51,9 +116,7 @@ void generate_random_expr(std::ostream& stream, unsigned int length)
         }
 
         //2. Generate number
-        int rnd = number_distr(random_engine);
-        i += number_of_digits(rnd);
-        stream << rnd;
+        i += generate_number(stream, random_engine, digits, floating);
 
         //3. Which entity will be generated close bracket or operator?
         while (open_brackets && !distr_0_1(random_engine))
@@ -69,7 +132,7 @@ void generate_random_expr(std::ostream& stream, unsigned int length)
     }
 
     //Finalize
-    stream << number_distr(random_engine);
+    generate_number(stream, random_engine, digits, floating);
     for (i = 0; i < open_brackets; ++i) { stream << ')'; }
     stream << '\n';
 }
@@ -79,14 +142,18 @@ int main(int argc, const char *argv[])
     if (argc == 1)
     {
         std::cout << "Random arithmetic expression generator. " << std::endl <<
-            "Please provide size of expression in MB." << std::endl;
+            "Please provide size of expression in MB (and number of digits of numbers for long literals " <<
+            "or 'float' for decimal literals)." << std::endl;
         return 1;
     }
 
     int n = 0;
+    int digits = 0;
+    const bool floating = argc > 2 && std::string(argv[2]) == "float";
     try
     {
         n = std::stoi(argv[1]);
+        digits = argc > 2 && !floating ? std::stoi(argv[2]) : 0;
     }
     catch (...)
     {
@@ -100,7 +167,13 @@ int main(int argc, const char *argv[])
         return 1;
     }
 
-    generate_random_expr(std::cout, n * 1024 * 1024);
+    if (digits < 0)
+    {
+        std::cerr << "Invalid number of digits." << std::endl;
+        return 1;
+    }
+
+    generate_random_expr(std::cout, n * 1024 * 1024, static_cast<unsigned int>(digits), floating);
 
     return 0;
 }
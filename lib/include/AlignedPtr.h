@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <utility>
+
+/**
+ * Deleter of objects that are allocated by make_aligned() (it calls destructor and frees aligned storage).
+ */
+template <class T>
+struct AlignedDelete
+{
+    void operator()(T* p) const
+    {
+        p->~T();
+        std::free(p);
+    }
+};
+
+/** Owner of object that is allocated by make_aligned(). */
+template <class T>
+using AlignedPtr = std::unique_ptr<T, AlignedDelete<T>>;
+
+/**
+ * @brief Constructs object in storage aligned to alignof(T).
+ * C++14 operator new guarantees only alignof(std::max_align_t), so types with alignas(64) members
+ * (e.g. SpscRing, whose head and tail are in different cache lines) must be allocated by this function.
+ * @param args[in] arguments of constructor of T.
+ * @return owner of object, it throws std::bad_alloc if memory can't be allocated.
+ */
+template <class T, class... Args>
+AlignedPtr<T> make_aligned(Args&&... args)
+{
+    const std::size_t alignment = alignof(T) < sizeof(void*) ? sizeof(void*) : alignof(T);
+    void* p = nullptr;
+    if (::posix_memalign(&p, alignment, sizeof(T)) != 0)
+    {
+        throw std::bad_alloc();
+    }
+
+    try
+    {
+        return AlignedPtr<T>(new (p) T(std::forward<Args>(args)...));
+    }
+    catch (...)
+    {
+        std::free(p);
+        throw;
+    }
+}
@@ -0,0 +1,547 @@
+#pragma once
+
+#include "ShuntingYardArithmetic.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * This class implements arbitrary-precision signed integer for ShuntingYard<BigInt>.
+ *
+ * This class:
+ *  - keeps magnitude in limbs of base 10^9 (little-endian) and sign separately;
+ *  - parses and formats decimal text in linear time (9 digits per limb, no division of the whole number);
+ *  - has in-place operators +=, -=, *=, /= (ShuntingYard moves operands and calculates in place, so limbs
+ *    are not copied per operation);
+ *  - multiplies by schoolbook algorithm for short numbers and by Karatsuba algorithm if both numbers
+ *    have at least karatsuba_threshold limbs;
+ *  - divides like int: quotient is truncated toward zero.
+ *
+ * How to use it?
+ * ShuntingYard<BigInt> shunting_yard;
+ * ShuntingYard<BigInt>::Result r = shunting_yard.parse("99999999999999999999 * 99999999999999999999\n", 44);
+ * assert(r.second.to_string() == "9999999999999999999800000000000000000001");
+ */
+class BigInt
+{
+public:
+    using Limb = std::uint32_t;
+    using Limbs = std::vector<Limb>;
+
+    static const Limb base = 1000000000;
+    static const unsigned int base_digits = 9;
+
+    /** Both numbers must have at least karatsuba_threshold limbs (9 * 32 digits) for Karatsuba multiplication. */
+    static const std::size_t karatsuba_threshold = 32;
+
+    BigInt() : negative(false) {}
+    BigInt(long long value);
+
+    /**
+     * @brief Parses decimal number.
+     * @param s[in] optional '-' and digits.
+     * @param len[in] length of s.
+     * @param value[out] number.
+     * @return false if s is not a number.
+     */
+    static bool from_decimal(const char* s, std::size_t len, BigInt& value);
+
+    /** Appends decimal representation to out. */
+    void append_decimal(std::string& out) const;
+
+    /** Returns decimal representation. */
+    std::string to_string() const;
+
+    BigInt& operator+=(const BigInt& other);
+    BigInt& operator-=(const BigInt& other);
+    BigInt& operator*=(const BigInt& other);
+    BigInt& operator/=(const BigInt& other);
+
+    /** Is number not zero? */
+    explicit operator bool() const { return !limbs.empty(); }
+
+    bool operator==(const BigInt& other) const { return negative == other.negative && limbs == other.limbs; }
+    bool operator!=(const BigInt& other) const { return !(*this == other); }
+
+    /** Number of limbs of magnitude. */
+    std::size_t size() const { return limbs.size(); }
+
+private:
+    /** Adds other with sign other_negative. */
+    void add(const BigInt& other, bool other_negative);
+
+    /** Compares magnitudes: -1, 0 or 1. */
+    static int compare(const Limbs& a, const Limbs& b);
+
+    /** Removes leading zero limbs. */
+    static void trim(Limbs& a);
+
+    /** r += a * base^shift (r is long enough for the result). */
+    static void add_shifted(Limbs& r, const Limbs& a, std::size_t shift);
+
+    /** r -= a (r >= a). */
+    static void subtract(Limbs& r, const Limbs& a);
+
+    /** Returns magnitude a * b, it chooses schoolbook or Karatsuba multiplication. */
+    static Limbs multiply(const Limb* a, std::size_t na, const Limb* b, std::size_t nb);
+
+    /** Returns magnitude a * b by schoolbook multiplication. */
+    static Limbs multiply_schoolbook(const Limb* a, std::size_t na, const Limb* b, std::size_t nb);
+
+    /** Returns magnitude a * b by Karatsuba multiplication (a and b have n limbs). */
+    static Limbs multiply_karatsuba(const Limb* a, const Limb* b, std::size_t n);
+
+    /** a /= b for one limb b, returns remainder. */
+    static Limb divide_small(Limbs& a, Limb b);
+
+    /** Returns magnitude a / b (b has at least two limbs) by Knuth's algorithm D. */
+    static Limbs divide(const Limbs& a, const Limbs& b);
+
+private:
+    //Magnitude, the most significant limb is not zero (zero has no limbs).
+    Limbs limbs;
+
+    //Zero is not negative.
+    bool negative;
+};
+
+/** ShuntingYard parses BigInt literals by BigInt::from_decimal instead of boost::lexical_cast. */
+template <>
+struct ShuntingYardConverter<BigInt>
+{
+    static bool convert(const char* s, std::size_t len, BigInt& value)
+    {
+        return BigInt::from_decimal(s, len, value);
+    }
+};
+
+inline BigInt::BigInt(long long value) : negative(value < 0)
+{
+    unsigned long long magnitude = negative ? 0ull - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+    while (magnitude)
+    {
+        limbs.push_back(static_cast<Limb>(magnitude % base));
+        magnitude /= base;
+    }
+}
+
+inline bool BigInt::from_decimal(const char* s, std::size_t len, BigInt& value)
+{
+    const char* end = s + len;
+    const bool negative = s != end && *s == '-';
+    const char* begin = negative ? s + 1 : s;
+    if (begin == end)
+    {
+        return false;
+    }
+
+    for (const char* it = begin; it != end; ++it)
+    {
+        if (*it < '0' || *it > '9')
+        {
+            return false;
+        }
+    }
+
+    while (begin != end && *begin == '0')
+    {
+        ++begin;
+    }
+
+    //Groups of 9 digits from the end are limbs.
+    Limbs& limbs = value.limbs;
+    limbs.clear();
+    limbs.reserve(static_cast<std::size_t>(end - begin) / base_digits + 1);
+    while (end != begin)
+    {
+        const char* group = end - std::min<std::size_t>(base_digits, static_cast<std::size_t>(end - begin));
+        Limb limb = 0;
+        for (const char* it = group; it != end; ++it)
+        {
+            limb = limb * 10 + static_cast<Limb>(*it - '0');
+        }
+        limbs.push_back(limb);
+        end = group;
+    }
+
+    value.negative = negative && !limbs.empty();
+    return true;
+}
+
+inline void BigInt::append_decimal(std::string& out) const
+{
+    if (limbs.empty())
+    {
+        out += '0';
+        return;
+    }
+
+    if (negative)
+    {
+        out += '-';
+    }
+    out += std::to_string(limbs.back());
+
+    //Lower limbs have exactly 9 digits, they are written from the end of each group.
+    std::size_t position = out.size();
+    out.resize(position + (limbs.size() - 1) * base_digits);
+    for (std::size_t i = limbs.size() - 1; i-- > 0; )
+    {
+        Limb limb = limbs[i];
+        position += base_digits;
+        for (unsigned int d = 1; d <= base_digits; ++d)
+        {
+            out[position - d] = static_cast<char>('0' + limb % 10);
+            limb /= 10;
+        }
+    }
+}
+
+inline std::string BigInt::to_string() const
+{
+    std::string s;
+    append_decimal(s);
+    return s;
+}
+
+inline BigInt& BigInt::operator+=(const BigInt& other)
+{
+    add(other, other.negative);
+    return *this;
+}
+
+inline BigInt& BigInt::operator-=(const BigInt& other)
+{
+    add(other, !other.negative && !other.limbs.empty());
+    return *this;
+}
+
+inline BigInt& BigInt::operator*=(const BigInt& other)
+{
+    if (limbs.empty() || other.limbs.empty())
+    {
+        limbs.clear();
+        negative = false;
+        return *this;
+    }
+
+    Limbs r = multiply(limbs.data(), limbs.size(), other.limbs.data(), other.limbs.size());
+    trim(r);
+    limbs.swap(r);
+    negative = negative != other.negative;
+    return *this;
+}
+
+inline BigInt& BigInt::operator/=(const BigInt& other)
+{
+    if (compare(limbs, other.limbs) < 0)
+    {
+        limbs.clear();
+        negative = false;
+        return *this;
+    }
+
+    const bool quotient_negative = negative != other.negative;
+    if (other.limbs.size() == 1)
+    {
+        divide_small(limbs, other.limbs[0]);
+    }
+    else
+    {
+        Limbs q = divide(limbs, other.limbs);
+        limbs.swap(q);
+    }
+    trim(limbs);
+    negative = quotient_negative && !limbs.empty();
+    return *this;
+}
+
+inline void BigInt::add(const BigInt& other, bool other_negative)
+{
+    if (&other == this)
+    {
+        BigInt copy(other);
+        add(copy, other_negative);
+        return;
+    }
+
+    const Limbs& b = other.limbs;
+    if (negative == other_negative || limbs.empty())
+    {
+        //Magnitudes are added.
+        negative = other_negative;
+        if (limbs.size() < b.size())
+        {
+            limbs.resize(b.size(), 0);
+        }
+        Limb carry = 0;
+        for (std::size_t i = 0; i < limbs.size() && (i < b.size() || carry); ++i)
+        {
+            Limb sum = limbs[i] + carry + (i < b.size() ? b[i] : 0);
+            carry = sum >= base ? 1 : 0;
+            limbs[i] = carry ? sum - base : sum;
+        }
+        if (carry)
+        {
+            limbs.push_back(carry);
+        }
+        return;
+    }
+
+    int c = compare(limbs, b);
+    if (!c)
+    {
+        limbs.clear();
+        negative = false;
+        return;
+    }
+
+    if (c > 0)
+    {
+        //|this| - |other|, sign of this.
+        subtract(limbs, b);
+    }
+    else
+    {
+        //|other| - |this|, sign of other.
+        limbs.resize(b.size(), 0);
+        Limb borrow = 0;
+        for (std::size_t i = 0; i < b.size(); ++i)
+        {
+            Limb subtrahend = limbs[i] + borrow;
+            borrow = b[i] < subtrahend ? 1 : 0;
+            limbs[i] = borrow ? b[i] + base - subtrahend : b[i] - subtrahend;
+        }
+        negative = other_negative;
+    }
+    trim(limbs);
+}
+
+inline int BigInt::compare(const Limbs& a, const Limbs& b)
+{
+    if (a.size() != b.size())
+    {
+        return a.size() < b.size() ? -1 : 1;
+    }
+
+    for (std::size_t i = a.size(); i-- > 0; )
+    {
+        if (a[i] != b[i])
+        {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+inline void BigInt::trim(Limbs& a)
+{
+    while (!a.empty() && !a.back())
+    {
+        a.pop_back();
+    }
+}
+
+inline void BigInt::add_shifted(Limbs& r, const Limbs& a, std::size_t shift)
+{
+    Limb carry = 0;
+    std::size_t i = 0;
+    for (; i < a.size(); ++i)
+    {
+        Limb sum = r[i + shift] + a[i] + carry;
+        carry = sum >= base ? 1 : 0;
+        r[i + shift] = carry ? sum - base : sum;
+    }
+    for (i += shift; carry; ++i)
+    {
+        Limb sum = r[i] + carry;
+        carry = sum >= base ? 1 : 0;
+        r[i] = carry ? sum - base : sum;
+    }
+}
+
+inline void BigInt::subtract(Limbs& r, const Limbs& a)
+{
+    Limb borrow = 0;
+    for (std::size_t i = 0; i < r.size() && (i < a.size() || borrow); ++i)
+    {
+        Limb subtrahend = (i < a.size() ? a[i] : 0) + borrow;
+        borrow = r[i] < subtrahend ? 1 : 0;
+        r[i] = borrow ? r[i] + base - subtrahend : r[i] - subtrahend;
+    }
+}
+
+inline BigInt::Limbs BigInt::multiply(const Limb* a, std::size_t na, const Limb* b, std::size_t nb)
+{
+    if (na < nb)
+    {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+
+    if (nb < karatsuba_threshold)
+    {
+        return multiply_schoolbook(a, na, b, nb);
+    }
+
+    if (na == nb)
+    {
+        return multiply_karatsuba(a, b, na);
+    }
+
+    //Long number is split into parts of the length of short one, each part is multiplied by Karatsuba.
+    Limbs r(na + nb, 0);
+    for (std::size_t i = 0; i < na; i += nb)
+    {
+        Limbs part = multiply(a + i, std::min(nb, na - i), b, nb);
+        trim(part);
+        add_shifted(r, part, i);
+    }
+    return r;
+}
+
+inline BigInt::Limbs BigInt::multiply_schoolbook(const Limb* a, std::size_t na, const Limb* b, std::size_t nb)
+{
+    //Each row is normalized by carry, so sum of limb, product and carry fits 64 bits.
+    Limbs r(na + nb, 0);
+    for (std::size_t i = 0; i < na; ++i)
+    {
+        const std::uint64_t ai = a[i];
+        if (!ai)
+        {
+            continue;
+        }
+        std::uint64_t carry = 0;
+        for (std::size_t j = 0; j < nb; ++j)
+        {
+            std::uint64_t t = r[i + j] + ai * b[j] + carry;
+            r[i + j] = static_cast<Limb>(t % base);
+            carry = t / base;
+        }
+        r[i + nb] = static_cast<Limb>(carry);
+    }
+    return r;
+}
+
+inline BigInt::Limbs BigInt::multiply_karatsuba(const Limb* a, const Limb* b, std::size_t n)
+{
+    //a = a1 * base^m + a0, b = b1 * base^m + b0:
+    //a * b = z2 * base^2m + ((a0 + a1) * (b0 + b1) - z0 - z2) * base^m + z0, where z0 = a0 * b0, z2 = a1 * b1.
+    const std::size_t m = n / 2;
+
+    Limbs z0 = multiply(a, m, b, m);
+    Limbs z2 = multiply(a + m, n - m, b + m, n - m);
+
+    Limbs sa(a + m, a + n);
+    Limbs sb(b + m, b + n);
+    sa.push_back(0);
+    sb.push_back(0);
+    add_shifted(sa, Limbs(a, a + m), 0);
+    add_shifted(sb, Limbs(b, b + m), 0);
+    trim(sa);
+    trim(sb);
+
+    Limbs z1 = multiply(sa.data(), sa.size(), sb.data(), sb.size());
+    subtract(z1, z0);
+    subtract(z1, z2);
+    trim(z0);
+    trim(z1);
+    trim(z2);
+
+    Limbs r(2 * n, 0);
+    add_shifted(r, z0, 0);
+    add_shifted(r, z1, m);
+    add_shifted(r, z2, 2 * m);
+    return r;
+}
+
+inline BigInt::Limb BigInt::divide_small(Limbs& a, Limb b)
+{
+    std::uint64_t remainder = 0;
+    for (std::size_t i = a.size(); i-- > 0; )
+    {
+        std::uint64_t t = remainder * base + a[i];
+        a[i] = static_cast<Limb>(t / b);
+        remainder = t % b;
+    }
+    return static_cast<Limb>(remainder);
+}
+
+inline BigInt::Limbs BigInt::divide(const Limbs& a, const Limbs& b)
+{
+    //Normalization: the most significant limb of divisor becomes >= base / 2, so estimated quotient digit
+    //is at most 2 greater than the real one.
+    const std::size_t n = b.size();
+    const Limb d = static_cast<Limb>(base / (static_cast<std::uint64_t>(b.back()) + 1));
+    Limbs u(a);
+    Limbs v(b);
+    u.push_back(0);
+    if (d > 1)
+    {
+        for (Limbs* x : {&u, &v})
+        {
+            std::uint64_t carry = 0;
+            for (Limb& limb : *x)
+            {
+                std::uint64_t t = static_cast<std::uint64_t>(limb) * d + carry;
+                limb = static_cast<Limb>(t % base);
+                carry = t / base;
+            }
+        }
+    }
+
+    const std::uint64_t v1 = v[n - 1];
+    const std::uint64_t v2 = v[n - 2];
+    Limbs q(a.size() - n + 1, 0);
+    for (std::size_t j = a.size() - n + 1; j-- > 0; )
+    {
+        std::uint64_t numerator = static_cast<std::uint64_t>(u[j + n]) * base + u[j + n - 1];
+        std::uint64_t qhat = numerator / v1;
+        std::uint64_t rhat = numerator % v1;
+        while (qhat >= base || qhat * v2 > rhat * base + u[j + n - 2])
+        {
+            --qhat;
+            rhat += v1;
+            if (rhat >= base)
+            {
+                break;
+            }
+        }
+
+        //u[j..j+n] -= qhat * v.
+        std::int64_t borrow = 0;
+        std::uint64_t carry = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            std::uint64_t p = qhat * v[i] + carry;
+            carry = p / base;
+            std::int64_t t = static_cast<std::int64_t>(u[i + j]) - static_cast<std::int64_t>(p % base) - borrow;
+            borrow = t < 0 ? 1 : 0;
+            u[i + j] = static_cast<Limb>(t < 0 ? t + base : t);
+        }
+        std::int64_t top = static_cast<std::int64_t>(u[j + n]) - static_cast<std::int64_t>(carry) - borrow;
+
+        if (top < 0)
+        {
+            //qhat was 1 greater than the real digit: v is added back.
+            --qhat;
+            Limb add_carry = 0;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                Limb sum = u[i + j] + v[i] + add_carry;
+                add_carry = sum >= base ? 1 : 0;
+                u[i + j] = add_carry ? sum - base : sum;
+            }
+            top += add_carry;
+        }
+        u[j + n] = static_cast<Limb>(top);
+        q[j] = static_cast<Limb>(qhat);
+    }
+
+    return q;
+}
@@ -0,0 +1,427 @@
+#pragma once
+
+#include "DecimalFloatPowers.h"
+#include "ShuntingYardArithmetic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+/**
+ * This class converts decimal text to double and back for ShuntingYard<double, ShuntingYardFloatSyntax>.
+ *
+ * This class:
+ *  - parses number (optional '-', digits, optional '.' and digits, optional exponent) by Clinger's fast path
+ *    (exact mantissa and power of ten), then by Eisel-Lemire algorithm (one 64x128-bit multiplication by
+ *    a power of ten from table), the rare numbers that can't be rounded by it are parsed by strtod();
+ *  - formats the shortest decimal that is parsed back to the same double by Schubfach algorithm
+ *    (Ryu-class algorithm with the same table of powers), result looks like in JavaScript:
+ *    '2.5', '1e+21', '1.5e-7', '-0.001'.
+ *
+ * How to use it?
+ * double value;
+ * bool ok = DecimalFloat::parse("6.02e23", 7, value);
+ * std::string s;
+ * DecimalFloat::append(s, 0.1 + 0.2);   //s is "0.30000000000000004".
+ */
+class DecimalFloat
+{
+public:
+    /**
+     * @brief Parses decimal number.
+     * @param s[in] number text.
+     * @param len[in] length of s.
+     * @param value[out] the nearest double (ties to even).
+     * @return false if s is not a number or number doesn't fit double.
+     */
+    static bool parse(const char* s, std::size_t len, double& value);
+
+    /** Appends the shortest decimal representation of value to out ('inf', '-inf' and 'nan' for special values). */
+    static void append(std::string& out, double value);
+
+private:
+    using UInt128 = unsigned __int128;
+
+    /**
+     * @brief Eisel-Lemire algorithm: w * 10^q rounded to double.
+     * @return false if the result is ambiguous (it is too close to halfway), subnormal or out of range.
+     */
+    static bool eisel_lemire(std::uint64_t w, int q, double& value);
+
+    /** Schubfach algorithm: positive finite value = f * 10^e with the shortest f. */
+    static void to_decimal(double value, std::uint64_t& f, int& e);
+    static void to_decimal(int q, std::uint64_t c, std::uint64_t& f, int& e);
+
+    /** Returns round-to-odd of g * cp / 2^126 (g = g1 * 2^63 + g0). */
+    static std::uint64_t round_to_odd(std::uint64_t g1, std::uint64_t g0, std::uint64_t cp);
+
+    /** floor(log2(10^e)), floor(log10(2^q)) and floor(log10(3/4 * 2^q)). */
+    static int floor_log2_pow10(int e) { return static_cast<int>((static_cast<long long>(e) * 913124641741LL) >> 38); }
+    static int floor_log10_pow2(int q) { return static_cast<int>((static_cast<long long>(q) * 661971961083LL) >> 41); }
+    static int floor_log10_three_quarters_pow2(int q)
+    {
+        return static_cast<int>((static_cast<long long>(q) * 661971961083LL - 274743187321LL) >> 41);
+    }
+
+    static const int significand_bits = 52;
+    static const int exponent_bias = 1023;
+    static const int min_binary_exponent = -1074;
+};
+
+inline bool DecimalFloat::parse(const char* s, std::size_t len, double& value)
+{
+    const char* it = s;
+    const char* end = s + len;
+    const bool negative = it != end && *it == '-';
+    if (negative)
+    {
+        ++it;
+    }
+
+    //Mantissa keeps at most 19 significant digits, w * 10^q is the value.
+    std::uint64_t w = 0;
+    int digits = 0;
+    int q = 0;
+    bool truncated = false;
+    bool has_digits = false;
+
+    for (; it != end && *it >= '0' && *it <= '9'; ++it)
+    {
+        has_digits = true;
+        if (digits < 19)
+        {
+            w = w * 10 + static_cast<unsigned int>(*it - '0');
+            digits += w != 0;
+        }
+        else
+        {
+            ++q;
+            truncated = truncated || *it != '0';
+        }
+    }
+
+    if (it != end && *it == '.')
+    {
+        for (++it; it != end && *it >= '0' && *it <= '9'; ++it)
+        {
+            if (digits < 19)
+            {
+                w = w * 10 + static_cast<unsigned int>(*it - '0');
+                digits += w != 0;
+                --q;
+            }
+            else
+            {
+                truncated = truncated || *it != '0';
+            }
+        }
+    }
+
+    if (it != end && (*it == 'e' || *it == 'E'))
+    {
+        ++it;
+        const bool negative_exponent = it != end && *it == '-';
+        if (it != end && (*it == '-' || *it == '+'))
+        {
+            ++it;
+        }
+
+        if (it == end)
+        {
+            return false;
+        }
+
+        //Huge exponent is limited, it makes zero or infinity anyway.
+        int exponent = 0;
+        for (; it != end && *it >= '0' && *it <= '9'; ++it)
+        {
+            exponent = std::min(exponent * 10 + (*it - '0'), 100000);
+        }
+        q += negative_exponent ? -exponent : exponent;
+    }
+
+    if (!has_digits || it != end)
+    {
+        return false;
+    }
+
+    double result = 0.0;
+    if (!w)
+    {
+        result = 0.0;
+    }
+    else if (!truncated && w <= (1ull << 53) && q >= -22 && q <= 22)
+    {
+        //Clinger's fast path: mantissa and power of ten are exact doubles, so one operation rounds correctly.
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        result = q < 0 ? static_cast<double>(w) / powers[-q] : static_cast<double>(w) * powers[q];
+    }
+    else if (truncated || !eisel_lemire(w, q, result))
+    {
+        std::string text(s + negative, len - negative);
+        result = std::strtod(text.c_str(), nullptr);
+    }
+
+    value = negative ? -result : result;
+    return std::isfinite(value);
+}
+
+inline bool DecimalFloat::eisel_lemire(std::uint64_t w, int q, double& value)
+{
+    if (q < decimal_float_min_power || q > decimal_float_max_power)
+    {
+        return false;
+    }
+
+    //w is normalized, then w * 10^q = (w * T) * 2^(floor(log2(10^q)) - 127 - lz), T is significand of 10^q.
+    const int lz = __builtin_clzll(w);
+    w <<= lz;
+
+    const std::uint64_t* t = decimal_float_power(q);
+    const UInt128 low = static_cast<UInt128>(w) * t[1];
+    const UInt128 high = static_cast<UInt128>(w) * t[0];
+    const UInt128 middle = (low >> 64) + static_cast<std::uint64_t>(high);
+    const std::uint64_t p0 = static_cast<std::uint64_t>(low);
+    const std::uint64_t p1 = static_cast<std::uint64_t>(middle);
+    const std::uint64_t p2 = static_cast<std::uint64_t>(high >> 64) + static_cast<std::uint64_t>(middle >> 64);
+
+    //T is truncated, so the exact product is in [P, P + w). Both bounds must have the same 53 bits and round bit.
+    const std::uint64_t u0 = p0 + w;
+    const std::uint64_t u1 = p1 + (u0 < p0);
+    const std::uint64_t u2 = p2 + (u1 < p1);
+    if (u2 < p2 || (u2 >> 63) != (p2 >> 63))
+    {
+        return false;
+    }
+
+    const int top = static_cast<int>(p2 >> 63);
+    const std::uint64_t bits = p2 >> (9 + top);
+    if (bits != u2 >> (9 + top))
+    {
+        return false;
+    }
+
+    //10^q is exact for q in [0, 55], so the product is exact too and halfway case rounds to even.
+    //Otherwise the exact product is greater than P and it is never a halfway case.
+    bool round_up = (bits & 1) != 0;
+    if (q >= 0 && q <= 55 && round_up)
+    {
+        const bool sticky = (p2 & ((1ull << (9 + top)) - 1)) || p1 || p0;
+        round_up = sticky || (bits & 2);
+    }
+
+    std::uint64_t mantissa = (bits >> 1) + round_up;
+    int exponent = 11 + top + ((q * 217706) >> 16) - lz;
+    if (mantissa == (1ull << 53))
+    {
+        mantissa >>= 1;
+        ++exponent;
+    }
+
+    //Subnormal and infinite results are left to strtod().
+    const int biased = exponent + significand_bits + exponent_bias;
+    if (biased <= 0 || biased >= 2047)
+    {
+        return false;
+    }
+
+    const std::uint64_t ieee = (static_cast<std::uint64_t>(biased) << significand_bits) | (mantissa & ((1ull << significand_bits) - 1));
+    std::memcpy(&value, &ieee, sizeof(value));
+    return true;
+}
+
+inline void DecimalFloat::append(std::string& out, double value)
+{
+    if (std::isnan(value))
+    {
+        out += "nan";
+        return;
+    }
+
+    if (value < 0.0)
+    {
+        out += '-';
+        value = -value;
+    }
+
+    if (std::isinf(value))
+    {
+        out += "inf";
+        return;
+    }
+
+    if (value == 0.0)
+    {
+        out += '0';
+        return;
+    }
+
+    std::uint64_t f;
+    int e;
+    to_decimal(value, f, e);
+    while (f % 10 == 0)
+    {
+        f /= 10;
+        ++e;
+    }
+
+    char digits[20];
+    int n = 0;
+    for (std::uint64_t x = f; x; x /= 10)
+    {
+        digits[19 - n++] = static_cast<char>('0' + x % 10);
+    }
+    const char* d = digits + 20 - n;
+
+    //value = 0.d * 10^k
+    const int k = e + n;
+    if (k >= n && k <= 21)
+    {
+        out.append(d, static_cast<std::size_t>(n));
+        out.append(static_cast<std::size_t>(k - n), '0');
+    }
+    else if (k > 0 && k <= 21)
+    {
+        out.append(d, static_cast<std::size_t>(k));
+        out += '.';
+        out.append(d + k, static_cast<std::size_t>(n - k));
+    }
+    else if (k > -6 && k <= 0)
+    {
+        out += "0.";
+        out.append(static_cast<std::size_t>(-k), '0');
+        out.append(d, static_cast<std::size_t>(n));
+    }
+    else
+    {
+        out += d[0];
+        if (n > 1)
+        {
+            out += '.';
+            out.append(d + 1, static_cast<std::size_t>(n - 1));
+        }
+        out += k - 1 < 0 ? "e-" : "e+";
+        out += std::to_string(k - 1 < 0 ? 1 - k : k - 1);
+    }
+}
+
+inline void DecimalFloat::to_decimal(double value, std::uint64_t& f, int& e)
+{
+    std::uint64_t ieee;
+    std::memcpy(&ieee, &value, sizeof(ieee));
+    const std::uint64_t t = ieee & ((1ull << significand_bits) - 1);
+    const int bq = static_cast<int>(ieee >> significand_bits) & 0x7ff;
+
+    if (bq)
+    {
+        //value = c * 2^-mq
+        const int mq = -min_binary_exponent + 1 - bq;
+        const std::uint64_t c = (1ull << significand_bits) | t;
+        if (mq > 0 && mq < significand_bits + 1 && !(c & ((1ull << mq) - 1)))
+        {
+            //Integer value.
+            f = c >> mq;
+            e = 0;
+            return;
+        }
+        to_decimal(-mq, c, f, e);
+    }
+    else
+    {
+        //Subnormal value.
+        to_decimal(min_binary_exponent, t, f, e);
+    }
+}
+
+inline void DecimalFloat::to_decimal(int q, std::uint64_t c, std::uint64_t& f, int& e)
+{
+    //Rounding interval of c * 2^q is [cbl, cbr] * 2^(q - 2), its bounds belong to it if c is even.
+    const std::uint64_t out = c & 1;
+    const std::uint64_t cb = c << 2;
+    const std::uint64_t cbr = cb + 2;
+    std::uint64_t cbl;
+    int k;
+    if (c != (1ull << significand_bits) || q == min_binary_exponent)
+    {
+        cbl = cb - 2;
+        k = floor_log10_pow2(q);
+    }
+    else
+    {
+        //The lower neighbour is closer for powers of two.
+        cbl = cb - 1;
+        k = floor_log10_three_quarters_pow2(q);
+    }
+    const int h = q + floor_log2_pow10(-k) + 2;
+
+    //g = floor(10^-k * 2^(125 - floor(log2(10^-k)))) + 1 is split into 63-bit halves.
+    const std::uint64_t* t = decimal_float_power(-k);
+    const UInt128 g = ((static_cast<UInt128>(t[0]) << 64 | t[1]) >> 2) + 1;
+    const std::uint64_t g1 = static_cast<std::uint64_t>(g >> 63);
+    const std::uint64_t g0 = static_cast<std::uint64_t>(g) & ((1ull << 63) - 1);
+
+    const std::uint64_t vb = round_to_odd(g1, g0, cb << h);
+    const std::uint64_t vbl = round_to_odd(g1, g0, cbl << h);
+    const std::uint64_t vbr = round_to_odd(g1, g0, cbr << h);
+
+    //Shorter candidates: one digit less (s' * 10^(k + 1)), then s or s + 1, then the closest one.
+    const std::uint64_t s = vb >> 2;
+    if (s >= 10)
+    {
+        const std::uint64_t sp10 = s / 10 * 10;
+        const std::uint64_t tp10 = sp10 + 10;
+        const bool upin = vbl + out <= sp10 << 2;
+        const bool wpin = (tp10 << 2) + out <= vbr;
+        if (upin != wpin)
+        {
+            f = upin ? sp10 : tp10;
+            e = k;
+            return;
+        }
+    }
+
+    const std::uint64_t sp = s + 1;
+    const bool uin = vbl + out <= s << 2;
+    const bool win = (sp << 2) + out <= vbr;
+    e = k;
+    if (uin != win)
+    {
+        f = uin ? s : sp;
+        return;
+    }
+
+    const std::uint64_t middle = (s + sp) << 1;
+    f = vb < middle || (vb == middle && !(s & 1)) ? s : sp;
+}
+
+inline std::uint64_t DecimalFloat::round_to_odd(std::uint64_t g1, std::uint64_t g0, std::uint64_t cp)
+{
+    const std::uint64_t x1 = static_cast<std::uint64_t>((static_cast<UInt128>(g0) * cp) >> 64);
+    const UInt128 y = static_cast<UInt128>(g1) * cp;
+    const std::uint64_t z = (static_cast<std::uint64_t>(y) >> 1) + x1;
+    const std::uint64_t vbp = static_cast<std::uint64_t>(y >> 64) + (z >> 63);
+    return vbp | (((z & ((1ull << 63) - 1)) + ((1ull << 63) - 1)) >> 63);
+}
+
+/**
+ * Conversion of floating-point number text for ShuntingYard<double, ShuntingYardFloatSyntax>.
+ */
+template <>
+struct ShuntingYardConverter<double>
+{
+    static bool convert(const char* s, std::size_t len, double& value)
+    {
+        return DecimalFloat::parse(s, len, value);
+    }
+};
+
+/** Literal out of the range of double (1e400) is reported as 'Overflow' like a result that isn't finite. */
+template <>
+struct ShuntingYardLiteralOverflow<double> : std::true_type
+{
+};
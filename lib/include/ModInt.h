@@ -0,0 +1,456 @@
+#pragma once
+
+#include "ShuntingYardArithmetic.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Reduction of product of ModInt numbers.
+ */
+enum class ModReduction
+{
+    automatic,    //Montgomery reduction for odd modulus, Barrett reduction for even modulus;
+    montgomery,   //numbers are kept in Montgomery form (a * 2^64 mod m), product is reduced by REDC (modulus must be odd);
+    barrett,      //quotient of product is found by multiplication with precomputed (2^128 - 1) / m;
+    naive         //product is reduced by '%' of 128-bit integer (it is used by benchmarks).
+};
+
+/**
+ * This class keeps modulus of ModInt numbers and constants of its reduction.
+ * Constants are calculated once, so a context is made per modulus (e.g. per connection) and not per number.
+ */
+class ModContext
+{
+public:
+    /**
+     * @brief Makes context of modulus.
+     * @param modulus[in] modulus of numbers, it must be >= 2.
+     * @param reduction[in] reduction of products, Montgomery reduction of even modulus is replaced by Barrett reduction.
+     */
+    explicit ModContext(std::uint64_t modulus, ModReduction reduction = ModReduction::automatic);
+
+    std::uint64_t modulus() const { return m; }
+    ModReduction reduction() const { return kind; }
+
+    /** Is modulus prime? Every non-zero number has inverse then. */
+    bool is_prime() const { return prime; }
+
+private:
+    friend class ModInt;
+
+    /** Returns a * b mod modulus (naive 128-bit division, it is used by construction only). */
+    static std::uint64_t mul_mod(std::uint64_t a, std::uint64_t b, std::uint64_t modulus);
+
+    /** Deterministic Miller-Rabin test of 64-bit number. */
+    static bool check_prime(std::uint64_t n);
+
+private:
+    std::uint64_t m;
+    ModReduction kind;
+    bool prime;
+
+    //m^-1 mod 2^64 and 2^128 mod m for Montgomery reduction.
+    std::uint64_t m_inverse = 0;
+    std::uint64_t r2 = 0;
+
+    //(2^128 - 1) / m for Barrett reduction.
+    unsigned __int128 mu = 0;
+
+    //10^19 mod m in representation of numbers, long literals are reduced by 19 digits.
+    std::uint64_t power19 = 0;
+};
+
+/**
+ * This class implements integer modulo 64-bit modulus for ShuntingYard<ModInt>.
+ *
+ * This class:
+ *  - keeps number less than modulus (in Montgomery form if context uses Montgomery reduction);
+ *  - reduces literals while parsing them (a literal of any length is reduced by 19 digits per step, '-5' is m - 5);
+ *  - has in-place operators +=, -=, *=, /= (they never overflow, so ShuntingYardUnchecked is used);
+ *  - divides by multiplication with modular inverse (extended Euclid algorithm), a number without inverse
+ *    (zero or a number with common divisor with modulus) is reported by operator! as a zero divisor,
+ *    so ShuntingYard returns 'DivisionByZero'.
+ *
+ * Numbers take modulus from context of current thread (see ModInt::Scope), so one ShuntingYard<ModInt> is used
+ * by one thread (ShuntingYardPipeline converts literals in another thread and is not used with ModInt).
+ *
+ * How to use it?
+ * ModContext context(1000000007);
+ * ModInt::Scope scope(context);
+ * ShuntingYard<ModInt> shunting_yard;
+ * ShuntingYard<ModInt>::Result r = shunting_yard.parse("1 / 2 * 4\n", 10);
+ * assert(r.second.to_string() == "2");
+ */
+class ModInt
+{
+public:
+    ModInt() : value(0) {}
+    ModInt(std::uint64_t number);
+
+    /** Context of numbers of current thread. */
+    static const ModContext*& context()
+    {
+        static thread_local const ModContext* current = nullptr;
+        return current;
+    }
+
+    /** Sets context of current thread for lifetime of object (previous context is restored). */
+    class Scope
+    {
+    public:
+        explicit Scope(const ModContext& context) : previous(ModInt::context()) { ModInt::context() = &context; }
+        ~Scope() { ModInt::context() = previous; }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const ModContext* previous;
+    };
+
+    /**
+     * @brief Parses decimal number and reduces it.
+     * @param s[in] optional '-' and digits.
+     * @param len[in] length of s.
+     * @param value[out] number.
+     * @return false if s is not a number.
+     */
+    static bool from_decimal(const char* s, std::size_t len, ModInt& value);
+
+    /** Returns number from 0 to modulus - 1. */
+    std::uint64_t to_uint64() const;
+
+    /** Appends decimal representation to out. */
+    void append_decimal(std::string& out) const;
+
+    /** Returns decimal representation. */
+    std::string to_string() const;
+
+    ModInt& operator+=(const ModInt& other);
+    ModInt& operator-=(const ModInt& other);
+    ModInt& operator*=(const ModInt& other);
+
+    /** Divisor must have inverse (see operator!). */
+    ModInt& operator/=(const ModInt& other);
+
+    /** Is number not a divisor (zero or not invertible)? ShuntingYard returns 'DivisionByZero' for it. */
+    bool operator!() const;
+
+    bool operator==(const ModInt& other) const { return value == other.value; }
+    bool operator!=(const ModInt& other) const { return value != other.value; }
+
+private:
+    friend class ModContext;
+
+    /** Returns representation of number less than 2^64. */
+    static std::uint64_t represent(std::uint64_t number, const ModContext& context);
+
+    /** Returns sum of representations. */
+    static std::uint64_t add(std::uint64_t a, std::uint64_t b, const ModContext& context);
+
+    /** Returns product of representations. */
+    static std::uint64_t multiply(std::uint64_t a, std::uint64_t b, const ModContext& context);
+
+    /** Returns t * 2^-64 mod m (t < m * 2^64, m is odd). */
+    static std::uint64_t redc(unsigned __int128 t, const ModContext& context);
+
+    /** Returns t mod m by Barrett reduction. */
+    static std::uint64_t barrett(unsigned __int128 t, const ModContext& context);
+
+    /** Returns greatest common divisor. */
+    static std::uint64_t gcd(std::uint64_t a, std::uint64_t b);
+
+    /** Finds inverse of a modulo m, returns false if a has no inverse. */
+    static bool invert(std::uint64_t a, std::uint64_t m, std::uint64_t& inverse);
+
+private:
+    //Number less than modulus in representation of context.
+    std::uint64_t value;
+};
+
+/** ShuntingYard parses ModInt literals by ModInt::from_decimal instead of boost::lexical_cast. */
+template <>
+struct ShuntingYardConverter<ModInt>
+{
+    static bool convert(const char* s, std::size_t len, ModInt& value)
+    {
+        return ModInt::from_decimal(s, len, value);
+    }
+};
+
+inline ModContext::ModContext(std::uint64_t modulus, ModReduction reduction)
+    : m(modulus), kind(reduction), prime(check_prime(modulus))
+{
+    if (kind == ModReduction::automatic || (kind == ModReduction::montgomery && !(m & 1)))
+    {
+        kind = m & 1 ? ModReduction::montgomery : ModReduction::barrett;
+    }
+
+    if (kind == ModReduction::montgomery)
+    {
+        //Newton's iteration doubles number of correct low bits: 3 (m * m = 1 mod 8 for odd m), 6, 12, 24, 48, 96.
+        m_inverse = m;
+        for (int i = 0; i < 5; ++i)
+        {
+            m_inverse *= 2 - m * m_inverse;
+        }
+
+        const std::uint64_t r1 = static_cast<std::uint64_t>((static_cast<unsigned __int128>(1) << 64) % m);
+        r2 = mul_mod(r1, r1, m);
+    }
+    mu = ~static_cast<unsigned __int128>(0) / m;
+
+    power19 = ModInt::represent(10000000000000000000ull, *this);
+}
+
+inline std::uint64_t ModContext::mul_mod(std::uint64_t a, std::uint64_t b, std::uint64_t modulus)
+{
+    return static_cast<std::uint64_t>(static_cast<unsigned __int128>(a) * b % modulus);
+}
+
+inline bool ModContext::check_prime(std::uint64_t n)
+{
+    if (n < 2)
+    {
+        return false;
+    }
+
+    //These bases are enough for all numbers below 3.3 * 10^24.
+    static const std::uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    for (std::uint64_t p : bases)
+    {
+        if (n % p == 0)
+        {
+            return n == p;
+        }
+    }
+
+    std::uint64_t d = n - 1;
+    unsigned int s = 0;
+    for (; !(d & 1); d >>= 1)
+    {
+        ++s;
+    }
+
+    for (std::uint64_t a : bases)
+    {
+        std::uint64_t x = 1;
+        for (std::uint64_t base = a, e = d; e; e >>= 1, base = mul_mod(base, base, n))
+        {
+            if (e & 1)
+            {
+                x = mul_mod(x, base, n);
+            }
+        }
+
+        unsigned int r = 0;
+        for (; r < s && x != 1 && x != n - 1; ++r)
+        {
+            x = mul_mod(x, x, n);
+        }
+        if (r == s || (r > 0 && x == 1) || (r == 0 && x != 1 && x != n - 1))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+inline ModInt::ModInt(std::uint64_t number) : value(number ? represent(number, *context()) : 0)
+{
+}
+
+inline std::uint64_t ModInt::redc(unsigned __int128 t, const ModContext& context)
+{
+    //u * m has the same low 64 bits as t, so (t - u * m) / 2^64 is difference of high parts.
+    const std::uint64_t u = static_cast<std::uint64_t>(t) * context.m_inverse;
+    const std::uint64_t high = static_cast<std::uint64_t>(t >> 64);
+    const std::uint64_t subtrahend = static_cast<std::uint64_t>((static_cast<unsigned __int128>(u) * context.m) >> 64);
+    return high >= subtrahend ? high - subtrahend : high - subtrahend + context.m;
+}
+
+inline std::uint64_t ModInt::barrett(unsigned __int128 t, const ModContext& context)
+{
+    //Quotient is high 128 bits of t * mu, it is less than exact quotient by at most 2.
+    const std::uint64_t t0 = static_cast<std::uint64_t>(t);
+    const std::uint64_t t1 = static_cast<std::uint64_t>(t >> 64);
+    const std::uint64_t mu0 = static_cast<std::uint64_t>(context.mu);
+    const std::uint64_t mu1 = static_cast<std::uint64_t>(context.mu >> 64);
+
+    const unsigned __int128 a = static_cast<unsigned __int128>(t1) * mu0 + ((static_cast<unsigned __int128>(t0) * mu0) >> 64);
+    const unsigned __int128 b = static_cast<unsigned __int128>(t0) * mu1 + static_cast<std::uint64_t>(a);
+    const unsigned __int128 q = static_cast<unsigned __int128>(t1) * mu1 + (a >> 64) + (b >> 64);
+
+    unsigned __int128 r = t - q * context.m;
+    while (r >= context.m)
+    {
+        r -= context.m;
+    }
+
+    return static_cast<std::uint64_t>(r);
+}
+
+inline std::uint64_t ModInt::represent(std::uint64_t number, const ModContext& context)
+{
+    switch (context.kind)
+    {
+        case ModReduction::montgomery:
+            //number * r2 < 2^64 * m, so one REDC gives number * 2^64 mod m.
+            return redc(static_cast<unsigned __int128>(number) * context.r2, context);
+        case ModReduction::barrett:
+            return barrett(number, context);
+        default:
+            return number % context.m;
+    }
+}
+
+inline std::uint64_t ModInt::multiply(std::uint64_t a, std::uint64_t b, const ModContext& context)
+{
+    const unsigned __int128 t = static_cast<unsigned __int128>(a) * b;
+    switch (context.kind)
+    {
+        case ModReduction::montgomery:
+            return redc(t, context);
+        case ModReduction::barrett:
+            return barrett(t, context);
+        default:
+            return static_cast<std::uint64_t>(t % context.m);
+    }
+}
+
+inline std::uint64_t ModInt::add(std::uint64_t a, std::uint64_t b, const ModContext& context)
+{
+    //Sum can exceed 2^64 if modulus is greater than 2^63.
+    const std::uint64_t sum = a + b;
+    return sum < a || sum >= context.m ? sum - context.m : sum;
+}
+
+inline bool ModInt::from_decimal(const char* s, std::size_t len, ModInt& value)
+{
+    const bool negative = len && *s == '-';
+    const char* it = s + (negative ? 1 : 0);
+    const char* end = s + len;
+    if (it == end)
+    {
+        return false;
+    }
+
+    const ModContext& context = *ModInt::context();
+    std::uint64_t number = 0;
+    while (it != end)
+    {
+        //Digits are read by groups of 19 digits (10^19 < 2^64), the number is reduced once per group.
+        const char* group_end = end - it > 19 ? it + 19 : end;
+        std::uint64_t group = 0;
+        std::uint64_t scale = 1;
+        for (; it != group_end; ++it)
+        {
+            if (*it < '0' || *it > '9')
+            {
+                return false;
+            }
+            group = group * 10 + static_cast<std::uint64_t>(*it - '0');
+            scale *= 10;
+        }
+
+        if (number)
+        {
+            number = multiply(number, scale == 10000000000000000000ull ? context.power19 : represent(scale, context), context);
+        }
+        number = add(number, represent(group, context), context);
+    }
+
+    value.value = negative && number ? context.m - number : number;
+    return true;
+}
+
+inline std::uint64_t ModInt::to_uint64() const
+{
+    return value && context()->kind == ModReduction::montgomery ? redc(value, *context()) : value;
+}
+
+inline void ModInt::append_decimal(std::string& out) const
+{
+    out += std::to_string(to_uint64());
+}
+
+inline std::string ModInt::to_string() const
+{
+    return std::to_string(to_uint64());
+}
+
+inline ModInt& ModInt::operator+=(const ModInt& other)
+{
+    value = add(value, other.value, *context());
+    return *this;
+}
+
+inline ModInt& ModInt::operator-=(const ModInt& other)
+{
+    value = value >= other.value ? value - other.value : value - other.value + context()->m;
+    return *this;
+}
+
+inline ModInt& ModInt::operator*=(const ModInt& other)
+{
+    value = multiply(value, other.value, *context());
+    return *this;
+}
+
+inline ModInt& ModInt::operator/=(const ModInt& other)
+{
+    const ModContext& context = *ModInt::context();
+    std::uint64_t inverse = 0;
+    invert(other.to_uint64(), context.m, inverse);
+    value = multiply(value, represent(inverse, context), context);
+    return *this;
+}
+
+inline bool ModInt::operator!() const
+{
+    //Montgomery form a * 2^64 has the same common divisors with odd modulus as a.
+    const ModContext& context = *ModInt::context();
+    return !value || (!context.prime && gcd(value, context.m) != 1);
+}
+
+inline std::uint64_t ModInt::gcd(std::uint64_t a, std::uint64_t b)
+{
+    while (b)
+    {
+        const std::uint64_t r = a % b;
+        a = b;
+        b = r;
+    }
+
+    return a;
+}
+
+inline bool ModInt::invert(std::uint64_t a, std::uint64_t m, std::uint64_t& inverse)
+{
+    //Extended Euclid algorithm keeps r = t * a (mod m), coefficients are less than m by absolute value.
+    __int128 t = 0;
+    __int128 new_t = 1;
+    std::uint64_t r = m;
+    std::uint64_t new_r = a;
+    while (new_r)
+    {
+        const std::uint64_t q = r / new_r;
+        const __int128 next_t = t - static_cast<__int128>(q) * new_t;
+        t = new_t;
+        new_t = next_t;
+        const std::uint64_t next_r = r - q * new_r;
+        r = new_r;
+        new_r = next_r;
+    }
+
+    if (r != 1)
+    {
+        return false;
+    }
+
+    inverse = static_cast<std::uint64_t>(t < 0 ? t + m : t);
+    return true;
+}
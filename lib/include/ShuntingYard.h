@@ -1,9 +1,12 @@
 #pragma once
 
+#include "ShuntingYardArithmetic.h"
+#include "ShuntingYardLexer.h"
+
+#include <deque>
 #include <stack>
 #include <vector>
 #include <string>
-#include <functional>
 
 /**
  * This template class implements 2-stack modification of Shunting-yard Dijkstra's algorithm.
@@ -15,7 +18,14 @@
  *  - supports '(' and ')';
  *  - can avaluate an expression for several parse() calls;
  *  - considers '\n' as end of en expession;
- *  - skips symbols '\t', '\r' , ' '.
+ *  - skips symbols '\t', '\r' , ' ';
+ *  - reads characters by table-driven lexer (see ShuntingYardLexer), Syntax can add skip symbols
+ *    or aliases of operators at compile time;
+ *  - evaluates expression without brackets by registers (running sum and pending product) instead of stacks,
+ *    expression falls back to stacks at the first '('. Both ways make the same operations in the same order,
+ *    so results (DivisionByZero and InvalidExpression as well) are the same;
+ *  - calculates operators by Arithmetic policy (see ShuntingYardArithmetic.h): unchecked by default,
+ *    ShuntingYardChecked returns 'Overflow', ShuntingYardSaturating clamps result to limits of Type.
  *
  * How to use it?
  * using ShuntingYardInt = ShuntingYard<int>;
@@ -52,9 +62,16 @@
  * assert(r.first == ShuntingYardInt::ParseResult::DivisionByZero);
  * r = shanting_yard.parse("(1 + 2\n", 7);
  * assert(r.first == ShuntingYardInt::ParseResult::InvalidExpression);
+ *
+ * ShuntingYard<int, ShuntingYardSyntax, ShuntingYardChecked> returns 'Overflow' as well:
+ * r = checked.parse("-2147483648 / -1\n", 17);
+ * assert(r.first == ParseResult::Overflow);
  */
 
-template <class Type>
+template <class Type, class Syntax, class Arithmetic>
+class ShuntingYardPipeline;
+
+template <class Type, class Syntax = ShuntingYardSyntax, class Arithmetic = ShuntingYardUnchecked>
 class ShuntingYard
 {
 public:
@@ -63,12 +80,13 @@ public:
         Success,
         Incomplete,
         DivisionByZero,
-        InvalidExpression
+        InvalidExpression,
+        Overflow
     };
 
     using Result = std::pair<ParseResult, Type>;
 
-    ShuntingYard() : step(0), level(0) {}
+    ShuntingYard() = default;
 
     /**
     * This method parses partial expression.
@@ -80,6 +98,7 @@ public:
     * @retval <ShuntingYard::Incomplete, Type()> if end of expression was not met and there were no any mistakes in expression.
     * @retval <ShuntingYard::DivisionByZero, Type()> if division by zero in expression happens.
     * @retval <ShuntingYard::InvalidExpression, Type()> if there is mistake in expression.
+    * @retval <ShuntingYard::Overflow, Type()> if result of operation doesn't fit Type (ShuntingYardChecked only).
     */
     Result parse(const char* s, size_t len);
 
@@ -89,6 +108,12 @@ public:
     /** Does ShuntingYard contain unprocessed data?*/
     bool is_empty() const;
 
+    /** Statistics (tokens and depth of brackets) of the last finished expression. */
+    const ShuntingYardStatistics& statistics() const
+    {
+        return lexer.statistics();
+    }
+
 private:
     enum class BaseOperatorsEnum
     {
@@ -102,7 +127,6 @@ private:
     struct BaseOperators
     {
         unsigned int base_priority;
-        std::function<Type(Type, Type)> calculator;
     };
 
     struct Operator
@@ -111,43 +135,80 @@ private:
         BaseOperatorsEnum base_operator;
     };
 
+    /**
+     * Registers of expression without brackets: sum additive product multiplicative operand.
+     * Operators are calculated in place and registers are swapped, so storage of Type (e.g. limbs of BigInt) is reused.
+     * They are the stacks of the same expression: operators are not calculated until an operator
+     * with the same or lower priority (or end of expression) is met.
+     */
+    struct Accumulator
+    {
+        Type sum{};
+        Type product{};
+        Type operand{};
+        BaseOperatorsEnum additive = BaseOperatorsEnum::Invalid;
+        BaseOperatorsEnum multiplicative = BaseOperatorsEnum::Invalid;
+        //Operand was read after the last operator.
+        bool has_operand = false;
+
+        /** Registers are free (their storage is kept for the next expression). */
+        void reset()
+        {
+            additive = BaseOperatorsEnum::Invalid;
+            multiplicative = BaseOperatorsEnum::Invalid;
+            has_operand = false;
+        }
+    };
+
 private:
-    using LocalParseResult = std::pair<ParseResult, bool>;
+    using Lexer = ShuntingYardLexer<Syntax>;
 
     template <class T>
     using Stack = std::stack<T, std::deque<T>>;
 
     /** Calculate partial result using members operands and operators. */
-    bool calculate();
-
-    /** Methods of state machine */
-    static LocalParseResult step_level_up_and_skip(ShuntingYard* self, std::string::const_iterator& it, std::string::const_iterator it_end);
-    static LocalParseResult step_get_number(ShuntingYard* self, std::string::const_iterator& it, std::string::const_iterator it_end);
-    static LocalParseResult step_level_down_and_skip(ShuntingYard* self, std::string::const_iterator& it, std::string::const_iterator it_end);
-    static LocalParseResult step_check_end_of_expression(ShuntingYard* self, std::string::const_iterator& it, std::string::const_iterator it_end);
-    static LocalParseResult step_process_operator(ShuntingYard* self, std::string::const_iterator& it, std::string::const_iterator it_end);
-
-    /** Auxiliary functions to fill ShuntingYard::base_operators. */
-    static Type plus  (Type a, Type b) { return a + b; }
-    static Type minus (Type a, Type b) { return a - b; }
-    static Type mult  (Type a, Type b) { return a * b; }
-    static Type divide(Type a, Type b) { return a / b; }
-
-    static std::string::const_iterator get_first_not_a_digit(std::string::const_iterator begin, std::string::const_iterator it_end);
-    static bool is_skip_symbol(char op);
-    static BaseOperatorsEnum get_base_operator(char op);
+    ParseResult calculate();
+
+    /** Converts number and pushes it to operands. */
+    ParseResult push_operand(const char* s, std::size_t len);
+
+    /** Result of number that converter rejects (see ShuntingYardLiteralOverflow). */
+    static ParseResult literal_error();
+
+    /** Calculates operators with the same or higher priority and pushes operator. */
+    ParseResult push_operator(BaseOperatorsEnum base_operator, unsigned int level);
+
+    /** Converts number and puts it to accumulator. */
+    ParseResult accumulate_operand(const char* s, std::size_t len);
+
+    /** Calculates pending operators of accumulator with the same or higher priority and puts operator. */
+    ParseResult accumulate_operator(BaseOperatorsEnum base_operator);
+
+    /** Calculates pending operators of accumulator, result is left in sum. */
+    ParseResult accumulate_end();
+
+    /** Calculates pending '*' or '/' of accumulator, the current term is left in product. */
+    ParseResult term();
+
+    /** Calculates pending '+' or '-' of accumulator with product, the current sum is left in sum. */
+    ParseResult sum();
+
+    /** Moves registers of accumulator to stacks, the rest of expression is evaluated by stacks. */
+    void spill();
+
+    /** Calculates a = a (base_operator) b by Arithmetic policy, returns DivisionByZero, Overflow or Success. */
+    static ParseResult apply(BaseOperatorsEnum base_operator, Type& a, const Type& b);
+
+    template <class Iterator>
+    static Iterator get_first_not_a_digit(Iterator begin, Iterator it_end);
     static std::pair<Type, bool> convert(const std::string& value);
+    static std::pair<Type, bool> convert(const char* s, std::size_t len);
 
 private:
-    static const std::function<LocalParseResult(ShuntingYard*, std::string::const_iterator&, std::string::const_iterator)> steps[5];
     static const BaseOperators base_operators[4];
-    static const unsigned int order;
-
-    /** Next step of state machine. */
-    unsigned int step;
 
-    /** Current level of brackets */
-    unsigned int level;
+    /** Lexer keeps step of expression, level of brackets and first part of incomplete number. */
+    Lexer lexer;
 
     /** Stack of operands in Polish notation. */
     Stack<Type> operands;
@@ -155,11 +216,23 @@ private:
     /** Stack of operators in Polish notation. */
     Stack<Operator> operators;
 
-    /** First part of incomplete number. */
+    /** Data after the end of expression. */
     std::string remainder;
 
+    /** Registers of expression while it has no brackets. */
+    Accumulator accumulator;
+
+    /** Expression is evaluated by stacks. */
+    bool stacked = false;
+
+    /** Expressions without brackets are evaluated by accumulator (unit-tests disable it to compare both ways). */
+    bool fast_path = true;
+
     //Friend for unit-tests.
     friend class ShuntingYardTest;
+
+    //Pipeline reuses syntax of ShuntingYard and continues its expressions.
+    friend class ShuntingYardPipeline<Type, Syntax, Arithmetic>;
 };
 
 #include "ShuntingYard.tpp"
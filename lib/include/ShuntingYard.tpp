@@ -1,255 +1,284 @@
-#include <boost/lexical_cast.hpp>
+template<class Type, class Syntax, class Arithmetic>
+const typename ShuntingYard<Type, Syntax, Arithmetic>::BaseOperators ShuntingYard<Type, Syntax, Arithmetic>::base_operators[4] = { { 1 }, { 1 }, { 2 }, { 2 } };
 
-template<class Type>
-const std::function<typename ShuntingYard<Type>::LocalParseResult(ShuntingYard<Type>* self, std::string::const_iterator&, std::string::const_iterator)> ShuntingYard<Type>::steps[5] =
-{
-    ShuntingYard::step_level_up_and_skip,
-    ShuntingYard::step_get_number,
-    ShuntingYard::step_level_down_and_skip,
-    ShuntingYard::step_check_end_of_expression,
-    ShuntingYard::step_process_operator
-};
-
-template<class Type>
-const typename ShuntingYard<Type>::BaseOperators ShuntingYard<Type>::base_operators[4] = { { 1, plus }, { 1, minus }, { 2, mult }, { 2, divide } };
-
-template<class Type>
-const unsigned int ShuntingYard<Type>::order = 2;
-
-template<class Type>
-typename ShuntingYard<Type>::Result ShuntingYard<Type>::parse(const char* s, size_t len)
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::Result ShuntingYard<Type, Syntax, Arithmetic>::parse(const char* s, size_t len)
 {
     if (len == 1 && s[0] == '\n' && is_empty())
     {	//Only '\n' in source data.
         return std::make_pair(ParseResult::Success, Type{});
     }
 
-    //Make string to parse.
+    //Rest of data after the previous expression is parsed first.
     std::string str;
-    str.reserve(len + remainder.size());
-    str = remainder;
-    remainder.clear();
-    str.append(s, len);
+    if (!remainder.empty())
+    {
+        str.reserve(len + remainder.size());
+        str.swap(remainder);
+        str.append(s, len);
+        s = str.data();
+        len = str.size();
+    }
 
-    LocalParseResult rc{ ParseResult::Success, false };
-    std::string::const_iterator it = str.begin();
-    std::string::const_iterator it_end = str.end();
+    const char* it = s;
+    const char* it_end = s + len;
 
-    //Process data in state machine.
-    while (!rc.second)
+    //Process tokens of lexer.
+    for (;;)
     {
-        rc = steps[step](this, it, it_end);
-        if (rc.first != ParseResult::Success)
+        const typename Lexer::Token token = lexer.next(it, it_end);
+        ParseResult rc = ParseResult::Success;
+
+        if (token.level && !stacked)
+        {   //The first '(' of expression.
+            spill();
+        }
+
+        switch (token.kind)
         {
-            if (rc.first != ParseResult::Incomplete)
-            {
-                clear();
-            }
-            return std::make_pair(rc.first, Type{});
+            case Lexer::TokenKind::Number:
+                rc = stacked ? push_operand(token.begin, token.size) : accumulate_operand(token.begin, token.size);
+                break;
+            case Lexer::TokenKind::Operator:
+                rc = stacked ? push_operator(static_cast<BaseOperatorsEnum>(token.operator_class), token.level)
+                             : accumulate_operator(static_cast<BaseOperatorsEnum>(token.operator_class));
+                break;
+            case Lexer::TokenKind::End:
+                if (!stacked)
+                {
+                    rc = accumulate_end();
+                }
+                while (rc == ParseResult::Success && !operators.empty())
+                {
+                    rc = calculate();
+                }
+                break;
+            case Lexer::TokenKind::Incomplete:
+                return std::make_pair(ParseResult::Incomplete, Type{});
+            case Lexer::TokenKind::Invalid:
+                rc = ParseResult::InvalidExpression;
+                break;
+        }
+
+        if (rc != ParseResult::Success)
+        {
+            clear();
+            return std::make_pair(rc, Type{});
+        }
+
+        if (token.kind == Lexer::TokenKind::End)
+        {
+            break;
         }
     }
 
     //Make result.
-    Type value = operands.top();
-    operands.pop();
-    step = 0;
+    remainder.assign(it, it_end);
+    Type value{};
+    if (stacked)
+    {
+        value = std::move(operands.top());
+        operands.pop();
+    }
+    else
+    {
+        value = std::move(accumulator.sum);
+    }
+    accumulator.reset();
+    stacked = !fast_path;
 
     return std::make_pair(ParseResult::Success, value);
 };
 
-template<class Type>
-void ShuntingYard<Type>::clear()
+template<class Type, class Syntax, class Arithmetic>
+void ShuntingYard<Type, Syntax, Arithmetic>::clear()
 {
-    step = 0;
-    level = 0;
+    lexer.clear();
     Stack<Type> operands_;
     operands.swap(operands_);
     Stack<Operator> operators_;
     operators.swap(operators_);
     remainder.clear();
+    accumulator.reset();
+    stacked = !fast_path;
 }
 
-template<class Type>
-bool ShuntingYard<Type>::is_empty() const
+template<class Type, class Syntax, class Arithmetic>
+bool ShuntingYard<Type, Syntax, Arithmetic>::is_empty() const
 {
-    return !step && !level && operands.empty() && operators.empty() && remainder.empty();
+    return lexer.is_empty() && operands.empty() && operators.empty() && remainder.empty() &&
+        !accumulator.has_operand && accumulator.additive == BaseOperatorsEnum::Invalid &&
+        accumulator.multiplicative == BaseOperatorsEnum::Invalid;
 }
 
-template<class Type>
-bool ShuntingYard<Type>::calculate()
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::ParseResult ShuntingYard<Type, Syntax, Arithmetic>::calculate()
 {
-    Type arg = operands.top();
+    Type arg = std::move(operands.top());
     operands.pop();
-    BaseOperatorsEnum base_operator = operators.top().base_operator;
-    if (base_operator == BaseOperatorsEnum::Divide && !arg)
-    {
-        return false;
-    }
-    operands.top() = base_operators[static_cast<int>(base_operator)].calculator(operands.top(), arg);
+    ParseResult rc = apply(operators.top().base_operator, operands.top(), arg);
     operators.pop();
 
-    return true;
+    return rc;
+}
+
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::ParseResult ShuntingYard<Type, Syntax, Arithmetic>::push_operand(const char* s, std::size_t len)
+{
+    operands.emplace();
+    return ShuntingYardConverter<Type>::convert(s, len, operands.top()) ? ParseResult::Success : literal_error();
+}
+
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::ParseResult ShuntingYard<Type, Syntax, Arithmetic>::literal_error()
+{
+    return ShuntingYardLiteralOverflow<Type>::value ? ParseResult::Overflow : ParseResult::InvalidExpression;
 }
 
-template<class Type>
-typename ShuntingYard<Type>::LocalParseResult ShuntingYard<Type>::step_level_up_and_skip(ShuntingYard* self, std::string::const_iterator& it, std::string::const_iterator it_end)
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::ParseResult ShuntingYard<Type, Syntax, Arithmetic>::push_operator(BaseOperatorsEnum base_operator, unsigned int level)
 {
-    while (it != it_end && (*it == '(' || is_skip_symbol(*it)))
+    unsigned int priority = base_operators[static_cast<int>(base_operator)].base_priority + level;
+
+    while (!operators.empty() && operators.top().priority >= priority)
     {
-        if (*it == '(')
+        ParseResult rc = calculate();
+        if (rc != ParseResult::Success)
         {
-            self->level += ShuntingYard::order;
+            return rc;
         }
-        ++it;
-    }
-
-    if (it == it_end)
-    {
-        return std::make_pair(ParseResult::Incomplete, false);
     }
 
-    ++(self->step);
-    return std::make_pair(ParseResult::Success, false);
+    operators.push(Operator{ priority, base_operator });
+    return ParseResult::Success;
 }
 
-template<class Type>
-typename ShuntingYard<Type>::LocalParseResult ShuntingYard<Type>::step_get_number(ShuntingYard* self, std::string::const_iterator& it, std::string::const_iterator it_end)
-{   //Assume that 'it' can not be equal to 'it_end' at the beginnig. Skip symbols are absent at the beginnig.
-    bool negative = (*it == '-');
-    if (negative)
-    {
-        ++it;
-    }
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::ParseResult ShuntingYard<Type, Syntax, Arithmetic>::accumulate_operand(const char* s, std::size_t len)
+{
+    accumulator.has_operand = true;
+    return ShuntingYardConverter<Type>::convert(s, len, accumulator.operand) ? ParseResult::Success : literal_error();
+}
 
-    if (it == it_end)
-    {
-        self->remainder = '-';
-        return std::make_pair(ParseResult::Incomplete, false);
-    }
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::ParseResult ShuntingYard<Type, Syntax, Arithmetic>::accumulate_operator(BaseOperatorsEnum base_operator)
+{
+    Accumulator& a = accumulator;
+    a.has_operand = false;
 
-    std::string::const_iterator it2 = get_first_not_a_digit(it, it_end);
-    if (it2 == it_end)
-    {
-        self->remainder.assign(negative ? it - 1 : it, it_end);
-        return std::make_pair(ParseResult::Incomplete, false);
-    }
-    else if (it == it2)
+    //Pending '*' or '/' has the same or higher priority than any operator, product becomes the current term.
+    ParseResult rc = term();
+    if (rc != ParseResult::Success)
     {
-        return std::make_pair(ParseResult::InvalidExpression, false);
+        return rc;
     }
 
-    std::pair<Type, bool> n{convert(std::string(negative ? it - 1 : it, it2))};
-    if (!n.second)
+    if (base_operator == BaseOperatorsEnum::Mult || base_operator == BaseOperatorsEnum::Divide)
     {
-        return std::make_pair(ParseResult::InvalidExpression, false);
+        a.multiplicative = base_operator;
+        return ParseResult::Success;
     }
 
-    self->operands.push(n.first);
-    it = it2;
-
-    ++(self->step);
-    return std::make_pair(ParseResult::Success, false);
+    //Pending '+' or '-' has the same priority as '+' and '-', sum becomes the current sum.
+    rc = sum();
+    a.additive = base_operator;
+    a.multiplicative = BaseOperatorsEnum::Invalid;
+    return rc;
 }
 
-template<class Type>
-typename ShuntingYard<Type>::LocalParseResult ShuntingYard<Type>::step_level_down_and_skip(ShuntingYard* self, std::string::const_iterator& it, std::string::const_iterator it_end)
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::ParseResult ShuntingYard<Type, Syntax, Arithmetic>::accumulate_end()
 {
-    while (it != it_end && (*it == ')' || is_skip_symbol(*it)))
-    {
-        if (*it == ')')
-        {
-            if (!self->level)
-            {
-                return std::make_pair(ParseResult::InvalidExpression, false);
-            }
-
-            self->level -= ShuntingYard::order;
-        }
-        ++it;
-    }
+    ParseResult rc = term();
+    return rc == ParseResult::Success ? sum() : rc;
+}
 
-    if (it == it_end)
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::ParseResult ShuntingYard<Type, Syntax, Arithmetic>::term()
+{
+    Accumulator& a = accumulator;
+    if (a.multiplicative == BaseOperatorsEnum::Invalid)
     {
-        return std::make_pair(ParseResult::Incomplete, false);
+        //Swap keeps storage of both registers.
+        std::swap(a.product, a.operand);
+        return ParseResult::Success;
     }
 
-    ++(self->step);
-    return std::make_pair(ParseResult::Success, false);
+    return apply(a.multiplicative, a.product, a.operand);
 }
 
-template<class Type>
-typename ShuntingYard<Type>::LocalParseResult ShuntingYard<Type>::step_check_end_of_expression(ShuntingYard* self, std::string::const_iterator& it, std::string::const_iterator it_end)
-{   //Assume that 'it' can not be equal to 'it_end' at the beginnig. Skip symbols are absent at the beginnig.
-    bool found = false;
-
-    if (*it == '\n')
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::ParseResult ShuntingYard<Type, Syntax, Arithmetic>::sum()
+{
+    Accumulator& a = accumulator;
+    if (a.additive == BaseOperatorsEnum::Invalid)
     {
-        if (self->level)
-        {
-            return std::make_pair(ParseResult::InvalidExpression, false);
-        }
-
-        while (!self->operators.empty())
-        {
-            if (!self->calculate())
-            {
-                return std::make_pair(ParseResult::DivisionByZero, false);
-            }
-        }
-
-        if (++it != it_end)
-        {
-            self->remainder.assign(it, it_end);
-        }
-
-        found = true;
+        std::swap(a.sum, a.product);
+        return ParseResult::Success;
     }
 
-    ++(self->step);
-    return std::make_pair(ParseResult::Success, found);
+    return apply(a.additive, a.sum, a.product);
 }
 
-template<class Type>
-typename ShuntingYard<Type>::LocalParseResult ShuntingYard<Type>::step_process_operator(ShuntingYard* self, std::string::const_iterator& it, std::string::const_iterator it_end)
+template<class Type, class Syntax, class Arithmetic>
+void ShuntingYard<Type, Syntax, Arithmetic>::spill()
 {
-    while (it != it_end && is_skip_symbol(*it)) { ++it; }
-
-    if (it == it_end)
+    Accumulator& a = accumulator;
+    if (a.additive != BaseOperatorsEnum::Invalid)
     {
-        return std::make_pair(ParseResult::Incomplete, false);
+        operands.push(std::move(a.sum));
+        operators.push(Operator{base_operators[static_cast<int>(a.additive)].base_priority, a.additive});
     }
-
-    BaseOperatorsEnum base_operator{get_base_operator(*it++)};
-    if (base_operator == BaseOperatorsEnum::Invalid)
+    if (a.multiplicative != BaseOperatorsEnum::Invalid)
+    {
+        operands.push(std::move(a.product));
+        operators.push(Operator{base_operators[static_cast<int>(a.multiplicative)].base_priority, a.multiplicative});
+    }
+    if (a.has_operand)
     {
-        return std::make_pair(ParseResult::InvalidExpression, false);
+        operands.push(std::move(a.operand));
     }
 
-    unsigned int priority = base_operators[static_cast<int>(base_operator)].base_priority + self->level;
+    a.reset();
+    stacked = true;
+}
 
-    while (!self->operators.empty() && self->operators.top().priority >= priority)
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYard<Type, Syntax, Arithmetic>::ParseResult ShuntingYard<Type, Syntax, Arithmetic>::apply(BaseOperatorsEnum base_operator, Type& a, const Type& b)
+{
+    bool fits = true;
+    switch (base_operator)
     {
-        if (!self->calculate())
-        {
-            return std::make_pair(ParseResult::DivisionByZero, false);
-        }
+        case BaseOperatorsEnum::Plus:
+            fits = Arithmetic::plus(a, b);
+            break;
+        case BaseOperatorsEnum::Minus:
+            fits = Arithmetic::minus(a, b);
+            break;
+        case BaseOperatorsEnum::Mult:
+            fits = Arithmetic::mult(a, b);
+            break;
+        default:
+            if (!b)
+            {
+                return ParseResult::DivisionByZero;
+            }
+            fits = Arithmetic::divide(a, b);
+            break;
     }
 
-    self->operators.push(Operator{ priority, base_operator });
-    self->step = 0;
-
-    return std::make_pair(ParseResult::Success, false);
+    return fits ? ParseResult::Success : ParseResult::Overflow;
 }
 
-template<class Type>
-std::string::const_iterator ShuntingYard<Type>::get_first_not_a_digit(std::string::const_iterator begin, std::string::const_iterator it_end)
+template<class Type, class Syntax, class Arithmetic>
+template<class Iterator>
+Iterator ShuntingYard<Type, Syntax, Arithmetic>::get_first_not_a_digit(Iterator begin, Iterator it_end)
 {
     //Return iterator to first not a digit or it_end.
-	//Note: std::string::find_first_not_of has complexity O(str1.size() * str2.size()) at worst.
-    std::string::const_iterator it = begin;
+    Iterator it = begin;
     for (; it != it_end; ++it)
     {
-        if (!isdigit(*it))
+        if (!Lexer::is_digit(*it))
         {
             break;
         }
@@ -258,40 +287,16 @@ std::string::const_iterator ShuntingYard<Type>::get_first_not_a_digit(std::strin
     return it;
 }
 
-template<class Type>
-bool ShuntingYard<Type>::is_skip_symbol(char op)
+template<class Type, class Syntax, class Arithmetic>
+std::pair<Type, bool> ShuntingYard<Type, Syntax, Arithmetic>::convert(const std::string& value)
 {
-    return op == ' ' || op == '\t' || op == '\r';
+    return convert(value.data(), value.size());
 }
 
-template<class Type>
-typename ShuntingYard<Type>::BaseOperatorsEnum ShuntingYard<Type>::get_base_operator(char op)
-{
-    switch (op)
-    {
-        case '+': return BaseOperatorsEnum::Plus;
-        case '-': return BaseOperatorsEnum::Minus;
-        case '*': return BaseOperatorsEnum::Mult;
-        case '/': return BaseOperatorsEnum::Divide;
-    }
-
-    return BaseOperatorsEnum::Invalid;
-}
-
-template<class Type>
-std::pair<Type, bool> ShuntingYard<Type>::convert(const std::string& value)
+template<class Type, class Syntax, class Arithmetic>
+std::pair<Type, bool> ShuntingYard<Type, Syntax, Arithmetic>::convert(const char* s, std::size_t len)
 {
     std::pair<Type, bool> result{Type{}, true};
-
-    try
-    {
-        result.first = boost::lexical_cast<Type>(value);
-    }
-    catch (const boost::bad_lexical_cast&)
-    {
-        result.second = false;
-        return result;
-    }
-
-    return  result;
+    result.second = ShuntingYardConverter<Type>::convert(s, len, result.first);
+    return result;
 }
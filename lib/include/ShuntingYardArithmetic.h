@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#include <boost/lexical_cast.hpp>
+
+/**
+ * Conversion of number text (optional '-' and digits, see ShuntingYardLexer) to Type.
+ * Primary template uses boost::lexical_cast, a numeric type can specialize it with faster parser (see BigInt.h).
+ */
+template <class Type>
+struct ShuntingYardConverter
+{
+    /** Returns false if text is not a number of Type. */
+    static bool convert(const char* s, std::size_t len, Type& value)
+    {
+        try
+        {
+            value = boost::lexical_cast<Type>(s, len);
+        }
+        catch (const boost::bad_lexical_cast&)
+        {
+            return false;
+        }
+
+        return true;
+    }
+};
+
+/**
+ * Lexer checks syntax of numbers, so convert() rejects only literals out of the range of Type.
+ * ShuntingYard reports them as 'Overflow' if this trait is true for Type, otherwise as invalid expression.
+ */
+template <class Type>
+struct ShuntingYardLiteralOverflow : std::false_type
+{
+};
+
+/**
+ * Arithmetic policies of ShuntingYard.
+ *
+ * A policy calculates a = a (operator) b in place (so operands with heap storage like BigInt are not copied)
+ * and returns false if the result doesn't fit Type.
+ * ShuntingYard checks division by zero itself, so divide() is never called with b == 0.
+ *
+ *  - ShuntingYardUnchecked: plain operators +=, -=, *=, /= of Type, overflow is not checked (it is undefined
+ *    behavior for signed integers, e.g. INT_MIN / -1);
+ *  - ShuntingYardChecked: overflow is detected by compiler builtins (one flag check per operation),
+ *    ShuntingYard returns 'Overflow'; result of floating-point type overflows if it is not finite;
+ *  - ShuntingYardSaturating: overflowed result is replaced by the nearest limit of Type.
+ *
+ * How to use it?
+ * ShuntingYard<int, ShuntingYardSyntax, ShuntingYardChecked> shunting_yard;
+ * ShuntingYard<int, ShuntingYardSyntax, ShuntingYardChecked>::Result r = shunting_yard.parse("2147483647 + 1\n", 15);
+ * assert(r.first == ShuntingYard<int, ShuntingYardSyntax, ShuntingYardChecked>::ParseResult::Overflow);
+ *
+ * Saturating policy is for integer types.
+ */
+struct ShuntingYardUnchecked
+{
+    template <class Type> static bool plus  (Type& a, const Type& b) { a += b; return true; }
+    template <class Type> static bool minus (Type& a, const Type& b) { a -= b; return true; }
+    template <class Type> static bool mult  (Type& a, const Type& b) { a *= b; return true; }
+    template <class Type> static bool divide(Type& a, const Type& b) { a /= b; return true; }
+};
+
+struct ShuntingYardChecked
+{
+    template <class Type> static bool plus  (Type& a, const Type& b) { return plus  (a, b, std::is_floating_point<Type>()); }
+    template <class Type> static bool minus (Type& a, const Type& b) { return minus (a, b, std::is_floating_point<Type>()); }
+    template <class Type> static bool mult  (Type& a, const Type& b) { return mult  (a, b, std::is_floating_point<Type>()); }
+    template <class Type> static bool divide(Type& a, const Type& b) { return divide(a, b, std::is_floating_point<Type>()); }
+
+private:
+    template <class Type> static bool plus  (Type& a, const Type& b, std::false_type) { return !__builtin_add_overflow(a, b, &a); }
+    template <class Type> static bool minus (Type& a, const Type& b, std::false_type) { return !__builtin_sub_overflow(a, b, &a); }
+    template <class Type> static bool mult  (Type& a, const Type& b, std::false_type) { return !__builtin_mul_overflow(a, b, &a); }
+
+    template <class Type> static bool divide(Type& a, const Type& b, std::false_type)
+    {
+        //The only overflow of division: minimal value / -1.
+        if (std::numeric_limits<Type>::is_signed && b == static_cast<Type>(-1) && a == std::numeric_limits<Type>::min())
+        {
+            return false;
+        }
+        a /= b;
+        return true;
+    }
+
+    template <class Type> static bool plus  (Type& a, const Type& b, std::true_type) { a += b; return std::isfinite(a); }
+    template <class Type> static bool minus (Type& a, const Type& b, std::true_type) { a -= b; return std::isfinite(a); }
+    template <class Type> static bool mult  (Type& a, const Type& b, std::true_type) { a *= b; return std::isfinite(a); }
+    template <class Type> static bool divide(Type& a, const Type& b, std::true_type) { a /= b; return std::isfinite(a); }
+};
+
+struct ShuntingYardSaturating
+{
+    template <class Type> static bool plus(Type& a, const Type& b)
+    {
+        if (__builtin_add_overflow(a, b, &a))
+        {
+            a = b < Type{} ? std::numeric_limits<Type>::min() : std::numeric_limits<Type>::max();
+        }
+        return true;
+    }
+
+    template <class Type> static bool minus(Type& a, const Type& b)
+    {
+        if (__builtin_sub_overflow(a, b, &a))
+        {
+            a = b > Type{} ? std::numeric_limits<Type>::min() : std::numeric_limits<Type>::max();
+        }
+        return true;
+    }
+
+    template <class Type> static bool mult(Type& a, const Type& b)
+    {
+        const bool negative = (a < Type{}) != (b < Type{});
+        if (__builtin_mul_overflow(a, b, &a))
+        {
+            a = negative ? std::numeric_limits<Type>::min() : std::numeric_limits<Type>::max();
+        }
+        return true;
+    }
+
+    template <class Type> static bool divide(Type& a, const Type& b)
+    {
+        if (std::numeric_limits<Type>::is_signed && b == static_cast<Type>(-1) && a == std::numeric_limits<Type>::min())
+        {
+            a = std::numeric_limits<Type>::max();
+            return true;
+        }
+        a /= b;
+        return true;
+    }
+};
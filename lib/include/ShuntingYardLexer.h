@@ -0,0 +1,449 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Classes of characters of expression.
+ * Classes of operators have the same order as ShuntingYard operators (+, -, *, /).
+ */
+enum class ShuntingYardCharClass : unsigned char
+{
+    Plus,
+    Minus,
+    Mult,
+    Divide,
+    Digit,
+    Point,
+    Exponent,
+    Open,
+    Close,
+    Skip,
+    End,
+    Other,
+    Count
+};
+
+/**
+ * Default syntax of expression: digits, '+', '-', '*', '/', '(', ')', '\n' and skip symbols ' ', '\t', '\r'.
+ *
+ * Another syntax is a struct with the same constexpr 'classify' function, e.g. to skip '_' as well:
+ * struct MySyntax
+ * {
+ *     static constexpr ShuntingYardCharClass classify(char c)
+ *     {
+ *         return c == '_' ? ShuntingYardCharClass::Skip : ShuntingYardSyntax::classify(c);
+ *     }
+ * };
+ * ShuntingYard<int, MySyntax> shunting_yard;
+ */
+struct ShuntingYardSyntax
+{
+    static constexpr ShuntingYardCharClass classify(char c)
+    {
+        switch (c)
+        {
+            case '+': return ShuntingYardCharClass::Plus;
+            case '-': return ShuntingYardCharClass::Minus;
+            case '*': return ShuntingYardCharClass::Mult;
+            case '/': return ShuntingYardCharClass::Divide;
+            case '(': return ShuntingYardCharClass::Open;
+            case ')': return ShuntingYardCharClass::Close;
+            case '\n': return ShuntingYardCharClass::End;
+            case ' ':
+            case '\t':
+            case '\r': return ShuntingYardCharClass::Skip;
+        }
+
+        return c >= '0' && c <= '9' ? ShuntingYardCharClass::Digit : ShuntingYardCharClass::Other;
+    }
+};
+
+/**
+ * Syntax of floating-point expressions: default syntax and numbers with decimal point and exponent
+ * like '1.5', '2.', '6.02e23', '1E-9' (see ShuntingYard<double, ShuntingYardFloatSyntax>).
+ */
+struct ShuntingYardFloatSyntax
+{
+    static constexpr ShuntingYardCharClass classify(char c)
+    {
+        return c == '.' ? ShuntingYardCharClass::Point :
+            (c == 'e' || c == 'E') ? ShuntingYardCharClass::Exponent : ShuntingYardSyntax::classify(c);
+    }
+};
+
+/**
+ * Statistics of expression that were counted by ShuntingYardLexer.
+ */
+struct ShuntingYardStatistics
+{
+    //Numbers and operators of expression.
+    std::size_t tokens = 0;
+    //The deepest level of brackets.
+    unsigned int depth = 0;
+};
+
+/**
+ * This template class implements table-driven lexer of ShuntingYard.
+ *
+ * Lexer is a DFA: table of 256 character classes and table of transitions (state, class) -> (state, action)
+ * are generated at compile time from Syntax::classify(), so the lexer loop makes two table lookups per character
+ * and branches only on action.
+ *
+ * States of lexer:
+ *  - Operand: skips '(' and skip symbols, waits for the first character of number;
+ *  - Sign: '-' of negative number was met, waits for digit;
+ *  - Number: digits of number;
+ *  - Fraction, ExponentStart, ExponentSign, ExponentDigits: the rest of floating-point number (Syntax classifies
+ *    characters as Point and Exponent only if it accepts floating-point numbers, see ShuntingYardFloatSyntax);
+ *  - Closing: skips ')' and skip symbols, waits for operator or '\n'.
+ *
+ * Lexer keeps its state between calls, so expression can be split at any character.
+ * It counts tokens and depth of brackets of expression, they are available after its end (see statistics()).
+ *
+ * How to use it?
+ * ShuntingYardLexer<> lexer;
+ * const char* it = "12 * (3";
+ * ShuntingYardLexer<>::Token t = lexer.next(it, it + 7);   //Number "12".
+ * t = lexer.next(it, it_end);                              //Operator Mult with level 0.
+ * t = lexer.next(it, it_end);                              //Incomplete: "3" is kept by lexer.
+ */
+template <class Syntax = ShuntingYardSyntax>
+class ShuntingYardLexer
+{
+public:
+    enum class TokenKind
+    {
+        Number,
+        Operator,
+        End,
+        Incomplete,
+        Invalid
+    };
+
+    struct Token
+    {
+        TokenKind kind;
+        //Class of operator (Plus, Minus, Mult or Divide).
+        ShuntingYardCharClass operator_class;
+        //Bracket level of operator.
+        unsigned int level;
+        //Text of number.
+        const char* begin;
+        std::size_t size;
+    };
+
+    /** Bracket level is incremented by 'order' for each '(' (it is added to priority of operators). */
+    static const unsigned int order = 2;
+
+    ShuntingYardLexer() : state(State::Operand), level(0), pending_used(false), tokens(0), max_level(0) {}
+
+    /**
+     * @brief Reads the next token.
+     * @param it[in,out] data, it points to the rest of data after the call.
+     * @param end[in] end of data.
+     * @return token; text of number is valid until the next call.
+     */
+    Token next(const char*& it, const char* end);
+
+    /** Clear lexer to further processing. */
+    void clear()
+    {
+        state = State::Operand;
+        level = 0;
+        pending.clear();
+        pending_used = false;
+        finish();
+    }
+
+    /** Does lexer contain a part of expression? */
+    bool is_empty() const
+    {
+        return state == State::Operand && !level && (pending.empty() || pending_used);
+    }
+
+    /** Statistics of the last expression that was finished by '\n' (or of its beginning if it was cleared). */
+    const ShuntingYardStatistics& statistics() const
+    {
+        return last;
+    }
+
+    /** Is character a digit? */
+    static bool is_digit(char c)
+    {
+        return char_classes.classes[static_cast<unsigned char>(c)] == ShuntingYardCharClass::Digit;
+    }
+
+private:
+    enum class State : unsigned char
+    {
+        Operand,
+        Sign,
+        Number,
+        Fraction,
+        ExponentStart,
+        ExponentSign,
+        ExponentDigits,
+        Closing,
+        Count
+    };
+
+    enum class Action : unsigned char
+    {
+        Skip,
+        Open,
+        Close,
+        Sign,
+        Number,
+        Digits,
+        NumberChar,
+        EmitNumber,
+        Operator,
+        End,
+        Error
+    };
+
+    struct Transition
+    {
+        State next;
+        Action action;
+    };
+
+    struct CharClasses
+    {
+        ShuntingYardCharClass classes[256];
+    };
+
+    struct Transitions
+    {
+        Transition transitions[static_cast<int>(State::Count)][static_cast<int>(ShuntingYardCharClass::Count)];
+    };
+
+    static constexpr Transition transition(State state, ShuntingYardCharClass c);
+    static constexpr CharClasses make_char_classes();
+    static constexpr Transitions make_transitions();
+
+    static constexpr CharClasses char_classes = make_char_classes();
+    static constexpr Transitions transitions = make_transitions();
+
+    /** Moves counters of expression to statistics of the last expression. */
+    void finish()
+    {
+        last.tokens = tokens;
+        last.depth = max_level / order;
+        tokens = 0;
+        max_level = 0;
+    }
+
+private:
+    State state;
+
+    /** Current level of brackets */
+    unsigned int level;
+
+    /** First part of number that was split between calls. */
+    std::string pending;
+
+    /** Token refers to pending, it is cleared by the next call. */
+    bool pending_used;
+
+    /** Counters of the current expression. */
+    std::size_t tokens;
+    unsigned int max_level;
+
+    ShuntingYardStatistics last;
+};
+
+template<class Syntax>
+constexpr typename ShuntingYardLexer<Syntax>::Transition ShuntingYardLexer<Syntax>::transition(State state, ShuntingYardCharClass c)
+{
+    using C = ShuntingYardCharClass;
+
+    switch (state)
+    {
+        case State::Operand:
+            switch (c)
+            {
+                case C::Skip:  return Transition{State::Operand, Action::Skip};
+                case C::Open:  return Transition{State::Operand, Action::Open};
+                case C::Minus: return Transition{State::Sign, Action::Sign};
+                case C::Digit: return Transition{State::Number, Action::Number};
+                default:       return Transition{State::Operand, Action::Error};
+            }
+
+        case State::Sign:
+            return c == C::Digit ? Transition{State::Number, Action::Digits} : Transition{State::Operand, Action::Error};
+
+        case State::Number:
+            switch (c)
+            {
+                case C::Digit:    return Transition{State::Number, Action::Digits};
+                case C::Point:    return Transition{State::Fraction, Action::NumberChar};
+                case C::Exponent: return Transition{State::ExponentStart, Action::NumberChar};
+                default:          return Transition{State::Closing, Action::EmitNumber};
+            }
+
+        case State::Fraction:
+            switch (c)
+            {
+                case C::Digit:    return Transition{State::Fraction, Action::Digits};
+                case C::Exponent: return Transition{State::ExponentStart, Action::NumberChar};
+                default:          return Transition{State::Closing, Action::EmitNumber};
+            }
+
+        case State::ExponentStart:
+            switch (c)
+            {
+                case C::Digit: return Transition{State::ExponentDigits, Action::Digits};
+                case C::Plus:
+                case C::Minus: return Transition{State::ExponentSign, Action::NumberChar};
+                default:       return Transition{State::Operand, Action::Error};
+            }
+
+        case State::ExponentSign:
+            return c == C::Digit ? Transition{State::ExponentDigits, Action::Digits} : Transition{State::Operand, Action::Error};
+
+        case State::ExponentDigits:
+            return c == C::Digit ? Transition{State::ExponentDigits, Action::Digits} : Transition{State::Closing, Action::EmitNumber};
+
+        case State::Closing:
+            switch (c)
+            {
+                case C::Skip:   return Transition{State::Closing, Action::Skip};
+                case C::Close:  return Transition{State::Closing, Action::Close};
+                case C::End:    return Transition{State::Operand, Action::End};
+                case C::Plus:
+                case C::Minus:
+                case C::Mult:
+                case C::Divide: return Transition{State::Operand, Action::Operator};
+                default:        return Transition{State::Operand, Action::Error};
+            }
+
+        default:
+            return Transition{State::Operand, Action::Error};
+    }
+}
+
+template<class Syntax>
+constexpr typename ShuntingYardLexer<Syntax>::CharClasses ShuntingYardLexer<Syntax>::make_char_classes()
+{
+    CharClasses t{};
+    for (unsigned int c = 0; c < 256; ++c)
+    {
+        t.classes[c] = Syntax::classify(static_cast<char>(c));
+    }
+    return t;
+}
+
+template<class Syntax>
+constexpr typename ShuntingYardLexer<Syntax>::Transitions ShuntingYardLexer<Syntax>::make_transitions()
+{
+    Transitions t{};
+    for (int s = 0; s < static_cast<int>(State::Count); ++s)
+    {
+        for (int c = 0; c < static_cast<int>(ShuntingYardCharClass::Count); ++c)
+        {
+            t.transitions[s][c] = transition(static_cast<State>(s), static_cast<ShuntingYardCharClass>(c));
+        }
+    }
+    return t;
+}
+
+template<class Syntax>
+constexpr typename ShuntingYardLexer<Syntax>::CharClasses ShuntingYardLexer<Syntax>::char_classes;
+
+template<class Syntax>
+constexpr typename ShuntingYardLexer<Syntax>::Transitions ShuntingYardLexer<Syntax>::transitions;
+
+template<class Syntax>
+typename ShuntingYardLexer<Syntax>::Token ShuntingYardLexer<Syntax>::next(const char*& it, const char* end)
+{
+    if (pending_used)
+    {
+        pending.clear();
+        pending_used = false;
+    }
+
+    //Number that is continued from the previous call starts at the beginning of data.
+    const char* number_begin = it;
+
+    while (it != end)
+    {
+        const ShuntingYardCharClass c = char_classes.classes[static_cast<unsigned char>(*it)];
+        const Transition t = transitions.transitions[static_cast<int>(state)][static_cast<int>(c)];
+        state = t.next;
+
+        switch (t.action)
+        {
+            case Action::Skip:
+                ++it;
+                break;
+
+            case Action::Open:
+                level += order;
+                max_level = level > max_level ? level : max_level;
+                ++it;
+                break;
+
+            case Action::Close:
+                if (!level)
+                {
+                    return Token{TokenKind::Invalid, c, level, nullptr, 0};
+                }
+                level -= order;
+                ++it;
+                break;
+
+            case Action::Sign:
+                number_begin = it;
+                ++it;
+                break;
+
+            case Action::Number:
+                number_begin = it;
+                //fall through
+            case Action::Digits:
+                //Digits are skipped by tight loop, state stays Number (Fraction or ExponentDigits).
+                while (++it != end && is_digit(*it)) {}
+                break;
+
+            case Action::NumberChar:
+                ++it;
+                break;
+
+            case Action::EmitNumber:
+                ++tokens;
+                if (pending.empty())
+                {
+                    return Token{TokenKind::Number, c, level, number_begin, static_cast<std::size_t>(it - number_begin)};
+                }
+                pending.append(number_begin, it);
+                pending_used = true;
+                return Token{TokenKind::Number, c, level, pending.data(), pending.size()};
+
+            case Action::Operator:
+                ++tokens;
+                ++it;
+                return Token{TokenKind::Operator, c, level, nullptr, 0};
+
+            case Action::End:
+                if (level)
+                {
+                    return Token{TokenKind::Invalid, c, level, nullptr, 0};
+                }
+                ++it;
+                finish();
+                return Token{TokenKind::End, c, level, nullptr, 0};
+
+            case Action::Error:
+                return Token{TokenKind::Invalid, c, level, nullptr, 0};
+        }
+    }
+
+    if (state != State::Operand && state != State::Closing)
+    {
+        pending.append(number_begin, end);
+    }
+
+    return Token{TokenKind::Incomplete, ShuntingYardCharClass::Other, level, nullptr, 0};
+}
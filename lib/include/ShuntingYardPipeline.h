@@ -0,0 +1,176 @@
+#pragma once
+
+#include "ShuntingYard.h"
+#include "SpscRing.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * This template class evaluates expressions like ShuntingYard, but splits the work between two threads:
+ *  - tokenizer (thread that calls parse()) reads lexemes (see ShuntingYardLexer), converts numbers and computes
+ *    priorities of operators (bracket depth is added to priority), tokens are written to lock-free ring;
+ *  - evaluator (own thread of object) reads tokens and evaluates them by stacks of operands and operators.
+ *
+ * parse() returns 'Incomplete' as soon as its data is tokenized, so scanning of the next part of a huge expression
+ * (and receiving of it) overlaps evaluation of the previous part. parse() waits for evaluator only at the end of expression.
+ * Results are the same as results of ShuntingYard, but DivisionByZero (and Overflow) can be returned by a later call
+ * of parse() than ShuntingYard returns it (evaluator finds it asynchronously).
+ *
+ * How to use it?
+ * using ShuntingYardPipelineInt = ShuntingYardPipeline<int>;
+ * ShuntingYardPipelineInt pipeline;
+ * ShuntingYardPipelineInt::Result r = pipeline.parse("(7 + 2", 6);
+ * assert(r.first == ShuntingYardPipelineInt::ParseResult::Incomplete);
+ * r = pipeline.parse(") / 3 + 5 * 6\n", 14);
+ * assert(r.first == ShuntingYardPipelineInt::ParseResult::Success && r.second == 33);
+ *
+ * Pipeline can continue expression that was started by ShuntingYard (e.g. when the expression turned out to be huge):
+ * pipeline.resume(shunting_yard);
+ */
+template <class Type, class Syntax = ShuntingYardSyntax, class Arithmetic = ShuntingYardUnchecked>
+class ShuntingYardPipeline
+{
+public:
+    using Parser = ShuntingYard<Type, Syntax, Arithmetic>;
+    using ParseResult = typename Parser::ParseResult;
+    using Result = typename Parser::Result;
+
+    /**
+     * @brief This method constructs empty pipeline and starts evaluator thread.
+     * @param ring_size[in] maximal number of tokens between tokenizer and evaluator.
+     */
+    explicit ShuntingYardPipeline(std::size_t ring_size = 16 * 1024);
+
+    /**
+     * @brief This method stops evaluator thread.
+     */
+    ~ShuntingYardPipeline();
+
+    ShuntingYardPipeline(const ShuntingYardPipeline&) = delete;
+    ShuntingYardPipeline& operator=(const ShuntingYardPipeline&) = delete;
+
+    /**
+    * This method parses partial expression (see ShuntingYard::parse()).
+    * @param s[in] partial expression.
+    * @param len[len] length of partial expression.
+    * @retval <ShuntingYard::Success, value> if end of expression was met and there were no any mistakes in expression.
+    * @retval <ShuntingYard::Incomplete, Type()> if end of expression was not met and no mistakes were found yet.
+    * @retval <ShuntingYard::DivisionByZero, Type()> if division by zero in expression happens.
+    * @retval <ShuntingYard::InvalidExpression, Type()> if there is mistake in expression.
+    * @retval <ShuntingYard::Overflow, Type()> if result of operation doesn't fit Type (ShuntingYardChecked only).
+    */
+    Result parse(const char* s, size_t len);
+
+    /** Clear pipeline to further processing (it waits for evaluator). */
+    void clear();
+
+    /** Does pipeline contain unprocessed data?*/
+    bool is_empty() const;
+
+    /** Statistics (tokens and depth of brackets) of the last finished expression. */
+    const ShuntingYardStatistics& statistics() const
+    {
+        return lexer.statistics();
+    }
+
+    /**
+     * @brief Continues incomplete expression of parser, parser becomes empty.
+     * Pipeline must be empty.
+     * @param parser[in] parser that has parsed beginning of expression.
+     */
+    void resume(Parser& parser);
+
+private:
+    using BaseOperatorsEnum = typename Parser::BaseOperatorsEnum;
+    using Operator = typename Parser::Operator;
+    using Lexer = ShuntingYardLexer<Syntax>;
+
+    enum class TokenKind : unsigned char
+    {
+        Number,
+        Operator,
+        End,
+        Abort
+    };
+
+    struct Token
+    {
+        TokenKind kind;
+        BaseOperatorsEnum base_operator;
+        unsigned int priority;
+        Type value;
+    };
+
+private:
+    /**
+     * @brief Tokenizes data up to the end of expression.
+     * @param it[in,out] data to tokenize, it points to the rest of data after the call.
+     * @param end[in] end of data.
+     * @return Success if end of expression was met, Incomplete if all data was tokenized or InvalidExpression.
+     */
+    ParseResult tokenize(const char*& it, const char* end);
+
+    /** Adds token to batch, full batch is written to ring. */
+    void add(TokenKind kind, BaseOperatorsEnum base_operator, unsigned int priority, Type value);
+
+    /** Writes batch to ring (it waits for free space if it is needed). */
+    void flush();
+
+    /** Finishes expression by End or Abort token and waits for its result. */
+    Result finish(TokenKind kind);
+
+    /** Resets tokenizer state. */
+    void reset();
+
+    /** Main function of evaluator thread. */
+    void evaluate();
+
+    /** Spins and then sleeps until ready() is true. */
+    template <class Ready>
+    void wait(std::atomic<bool>& waiting, std::condition_variable& cv, Ready ready);
+
+    /** Wakes the other thread if it sleeps. */
+    void notify(std::atomic<bool>& waiting, std::condition_variable& cv);
+
+private:
+    static const std::size_t batch_size = 256;
+    static const unsigned int spin = 64;
+
+    //State of tokenizer.
+    Lexer lexer;
+    std::string remainder;
+    std::vector<Token> batch;
+
+    //Tokens of current expression were written.
+    bool started;
+
+    //Number of expressions that were finished by tokenizer.
+    unsigned long long finished;
+
+    //Stacks of evaluator (they are used by evaluator thread only while expression is evaluated).
+    Parser evaluator;
+
+    SpscRing<Token> tokens;
+
+    //Evaluator found division by zero (or overflow) in current expression.
+    std::atomic<bool> failed;
+
+    //Number of expressions that were evaluated and result of the last one.
+    std::atomic<unsigned long long> completed;
+    Result result;
+
+    std::mutex mutex;
+    std::condition_variable tokenizer_cv;
+    std::condition_variable evaluator_cv;
+    std::atomic<bool> tokenizer_waiting;
+    std::atomic<bool> evaluator_waiting;
+    std::atomic<bool> running;
+    std::thread thread;
+};
+
+#include "ShuntingYardPipeline.tpp"
@@ -0,0 +1,316 @@
+template<class Type, class Syntax, class Arithmetic>
+ShuntingYardPipeline<Type, Syntax, Arithmetic>::ShuntingYardPipeline(std::size_t ring_size)
+    : started(false),
+      finished(0),
+      tokens(ring_size),
+      failed(false),
+      completed(0),
+      tokenizer_waiting(false),
+      evaluator_waiting(false),
+      running(true)
+{
+    batch.reserve(batch_size);
+    thread = std::thread([this]() { evaluate(); });
+}
+
+template<class Type, class Syntax, class Arithmetic>
+ShuntingYardPipeline<Type, Syntax, Arithmetic>::~ShuntingYardPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running.store(false);
+        evaluator_cv.notify_one();
+    }
+    thread.join();
+}
+
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYardPipeline<Type, Syntax, Arithmetic>::Result ShuntingYardPipeline<Type, Syntax, Arithmetic>::parse(const char* s, size_t len)
+{
+    if (len == 1 && s[0] == '\n' && is_empty())
+    {	//Only '\n' in source data.
+        return std::make_pair(ParseResult::Success, Type{});
+    }
+
+    //Rest of data after the previous expression is parsed first.
+    std::string str;
+    if (!remainder.empty())
+    {
+        str.reserve(len + remainder.size());
+        str.swap(remainder);
+        str.append(s, len);
+        s = str.data();
+        len = str.size();
+    }
+
+    const char* it = s;
+    const char* end = s + len;
+    ParseResult rc = tokenize(it, end);
+
+    switch (rc)
+    {
+        case ParseResult::Success:
+            remainder.assign(it, end);
+            return finish(TokenKind::End);
+        case ParseResult::Incomplete:
+            if (!failed.load(std::memory_order_acquire))
+            {
+                flush();
+                return std::make_pair(ParseResult::Incomplete, Type{});
+            }
+            break;
+        default:
+            if (!started)
+            {
+                reset();
+                return std::make_pair(rc, Type{});
+            }
+            break;
+    }
+
+    //Evaluator reports division by zero (or overflow) if it finds it in tokens before the mistake.
+    return finish(TokenKind::Abort);
+}
+
+template<class Type, class Syntax, class Arithmetic>
+void ShuntingYardPipeline<Type, Syntax, Arithmetic>::clear()
+{
+    if (started)
+    {
+        batch.clear();
+        finish(TokenKind::Abort);
+    }
+    reset();
+}
+
+template<class Type, class Syntax, class Arithmetic>
+bool ShuntingYardPipeline<Type, Syntax, Arithmetic>::is_empty() const
+{
+    return lexer.is_empty() && !started && remainder.empty();
+}
+
+template<class Type, class Syntax, class Arithmetic>
+void ShuntingYardPipeline<Type, Syntax, Arithmetic>::resume(Parser& parser)
+{
+    lexer = parser.lexer;
+    remainder.swap(parser.remainder);
+
+    //Evaluator is idle: it takes stacks with the first token of expression.
+    if (!parser.stacked)
+    {
+        parser.spill();
+    }
+    started = !parser.operands.empty() || !parser.operators.empty();
+    evaluator.operands.swap(parser.operands);
+    evaluator.operators.swap(parser.operators);
+    parser.clear();
+}
+
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYardPipeline<Type, Syntax, Arithmetic>::ParseResult ShuntingYardPipeline<Type, Syntax, Arithmetic>::tokenize(const char*& it, const char* end)
+{
+    for (;;)
+    {
+        const typename Lexer::Token token = lexer.next(it, end);
+        switch (token.kind)
+        {
+            case Lexer::TokenKind::Number:
+            {
+                std::pair<Type, bool> n = Parser::convert(token.begin, token.size);
+                if (!n.second)
+                {
+                    return Parser::literal_error();
+                }
+                add(TokenKind::Number, BaseOperatorsEnum::Invalid, 0, n.first);
+                break;
+            }
+            case Lexer::TokenKind::Operator:
+            {
+                BaseOperatorsEnum base_operator = static_cast<BaseOperatorsEnum>(token.operator_class);
+                unsigned int priority = Parser::base_operators[static_cast<int>(base_operator)].base_priority + token.level;
+                add(TokenKind::Operator, base_operator, priority, Type{});
+                break;
+            }
+            case Lexer::TokenKind::End:
+                add(TokenKind::End, BaseOperatorsEnum::Invalid, 0, Type{});
+                return ParseResult::Success;
+            case Lexer::TokenKind::Incomplete:
+                return ParseResult::Incomplete;
+            case Lexer::TokenKind::Invalid:
+                return ParseResult::InvalidExpression;
+        }
+    }
+}
+
+template<class Type, class Syntax, class Arithmetic>
+void ShuntingYardPipeline<Type, Syntax, Arithmetic>::add(TokenKind kind, BaseOperatorsEnum base_operator, unsigned int priority, Type value)
+{
+    batch.push_back(Token{kind, base_operator, priority, value});
+    started = true;
+    if (batch.size() == batch_size)
+    {
+        flush();
+    }
+}
+
+template<class Type, class Syntax, class Arithmetic>
+void ShuntingYardPipeline<Type, Syntax, Arithmetic>::flush()
+{
+    std::size_t pushed = 0;
+    while (pushed != batch.size())
+    {
+        pushed += tokens.push(batch.data() + pushed, batch.size() - pushed);
+        notify(evaluator_waiting, evaluator_cv);
+        if (pushed != batch.size())
+        {
+            wait(tokenizer_waiting, tokenizer_cv, [this]() { return !tokens.full(); });
+        }
+    }
+    batch.clear();
+}
+
+template<class Type, class Syntax, class Arithmetic>
+typename ShuntingYardPipeline<Type, Syntax, Arithmetic>::Result ShuntingYardPipeline<Type, Syntax, Arithmetic>::finish(TokenKind kind)
+{
+    if (kind == TokenKind::Abort)
+    {
+        add(TokenKind::Abort, BaseOperatorsEnum::Invalid, 0, Type{});
+    }
+    flush();
+
+    ++finished;
+    wait(tokenizer_waiting, tokenizer_cv, [this]() { return completed.load(std::memory_order_acquire) == finished; });
+
+    Result r = result;
+    if (r.first == ParseResult::Success)
+    {
+        started = false;
+    }
+    else
+    {
+        reset();
+    }
+
+    return r;
+}
+
+template<class Type, class Syntax, class Arithmetic>
+void ShuntingYardPipeline<Type, Syntax, Arithmetic>::reset()
+{
+    lexer.clear();
+    started = false;
+    remainder.clear();
+    batch.clear();
+}
+
+template<class Type, class Syntax, class Arithmetic>
+void ShuntingYardPipeline<Type, Syntax, Arithmetic>::evaluate()
+{
+    std::vector<Token> local(batch_size);
+    ParseResult failure = ParseResult::Success;
+
+    for (;;)
+    {
+        std::size_t n = tokens.pop(local.data(), local.size());
+        if (!n)
+        {
+            if (!running.load())
+            {
+                break;
+            }
+            wait(evaluator_waiting, evaluator_cv, [this]() { return !tokens.empty() || !running.load(); });
+            continue;
+        }
+        notify(tokenizer_waiting, tokenizer_cv);
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            Token& token = local[i];
+            switch (token.kind)
+            {
+                case TokenKind::Number:
+                    if (failure == ParseResult::Success)
+                    {
+                        evaluator.operands.push(std::move(token.value));
+                    }
+                    break;
+
+                case TokenKind::Operator:
+                    while (failure == ParseResult::Success && !evaluator.operators.empty() &&
+                           evaluator.operators.top().priority >= token.priority)
+                    {
+                        failure = evaluator.calculate();
+                    }
+                    if (failure == ParseResult::Success)
+                    {
+                        evaluator.operators.push(Operator{token.priority, token.base_operator});
+                    }
+                    else
+                    {
+                        failed.store(true, std::memory_order_release);
+                    }
+                    break;
+
+                case TokenKind::End:
+                case TokenKind::Abort:
+                    while (failure == ParseResult::Success && token.kind == TokenKind::End && !evaluator.operators.empty())
+                    {
+                        failure = evaluator.calculate();
+                    }
+
+                    if (failure != ParseResult::Success)
+                    {
+                        result = std::make_pair(failure, Type{});
+                    }
+                    else if (token.kind == TokenKind::Abort)
+                    {
+                        result = std::make_pair(ParseResult::InvalidExpression, Type{});
+                    }
+                    else
+                    {
+                        result = std::make_pair(ParseResult::Success, evaluator.operands.top());
+                    }
+
+                    evaluator.clear();
+                    failure = ParseResult::Success;
+                    failed.store(false, std::memory_order_relaxed);
+                    completed.fetch_add(1, std::memory_order_release);
+                    notify(tokenizer_waiting, tokenizer_cv);
+                    break;
+            }
+        }
+    }
+}
+
+template<class Type, class Syntax, class Arithmetic>
+template<class Ready>
+void ShuntingYardPipeline<Type, Syntax, Arithmetic>::wait(std::atomic<bool>& waiting, std::condition_variable& cv, Ready ready)
+{
+    for (unsigned int i = 0; i < spin; ++i)
+    {
+        if (ready())
+        {
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    waiting.store(true);
+
+    //The other thread could make ready() true before it saw 'waiting' flag.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cv.wait(lock, ready);
+    waiting.store(false, std::memory_order_relaxed);
+}
+
+template<class Type, class Syntax, class Arithmetic>
+void ShuntingYardPipeline<Type, Syntax, Arithmetic>::notify(std::atomic<bool>& waiting, std::condition_variable& cv)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_one();
+    }
+}
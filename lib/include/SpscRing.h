@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * This template class implements bounded lock-free ring for one producer thread and one consumer thread.
+ *
+ * Head and tail are monotonic counters of popped and pushed items, they are placed in different cache lines,
+ * so producer and consumer don't share a cache line while ring is neither empty nor full.
+ *
+ * How to use it?
+ * SpscRing<int> ring(1024);                     //Capacity is rounded up to power of two.
+ * int items[] = {1, 2, 3};
+ * std::size_t pushed = ring.push(items, 3);     //Producer thread: pushed <= 3.
+ * int out[16];
+ * std::size_t popped = ring.pop(out, 16);       //Consumer thread: popped <= pushed.
+ */
+template <class T>
+class SpscRing
+{
+public:
+    /**
+     * @brief This method constructs empty ring.
+     * @param capacity[in] minimal number of items.
+     */
+    explicit SpscRing(std::size_t capacity)
+        : items(round_up(capacity)), mask(items.size() - 1), head(0), tail(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief Pushes as many items as fit into ring (producer thread).
+     * @return number of pushed items.
+     */
+    std::size_t push(const T* data, std::size_t n)
+    {
+        const std::uint64_t t = tail.load(std::memory_order_relaxed);
+        const std::size_t free = items.size() - static_cast<std::size_t>(t - head.load(std::memory_order_acquire));
+        n = n < free ? n : free;
+
+        //Items are copied in two parts if they wrap around the end of ring.
+        const std::size_t offset = static_cast<std::size_t>(t & mask);
+        const std::size_t first = std::min(n, items.size() - offset);
+        std::copy(data, data + first, items.begin() + offset);
+        std::copy(data + first, data + n, items.begin());
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * @brief Pops at most n items (consumer thread).
+     * @return number of popped items.
+     */
+    std::size_t pop(T* data, std::size_t n)
+    {
+        const std::uint64_t h = head.load(std::memory_order_relaxed);
+        const std::size_t size = static_cast<std::size_t>(tail.load(std::memory_order_acquire) - h);
+        n = n < size ? n : size;
+
+        const std::size_t offset = static_cast<std::size_t>(h & mask);
+        const std::size_t first = std::min(n, items.size() - offset);
+        std::copy(items.begin() + offset, items.begin() + offset + first, data);
+        std::copy(items.begin(), items.begin() + (n - first), data + first);
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    /** Is ring empty? (consumer thread) */
+    bool empty() const
+    {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_relaxed);
+    }
+
+    /** Number of items that can be pushed now (producer thread). */
+    std::size_t free_space() const
+    {
+        return items.size() - static_cast<std::size_t>(tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+    }
+
+    /** Is ring full? (producer thread) */
+    bool full() const
+    {
+        return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire) == items.size();
+    }
+
+private:
+    static std::size_t round_up(std::size_t capacity)
+    {
+        std::size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+
+private:
+    std::vector<T> items;
+    const std::size_t mask;
+
+    //Popped items (consumer changes it).
+    alignas(64) std::atomic<std::uint64_t> head;
+
+    //Pushed items (producer changes it).
+    alignas(64) std::atomic<std::uint64_t> tail;
+};
@@ -1,15 +1,60 @@
 /**
  * This file contains program that measures time of expression evaluation.
+ * Option --pipeline evaluates expression by ShuntingYardPipeline (tokenizer and evaluator threads).
+ * Options --checked and --saturating evaluate expression by ShuntingYardChecked and ShuntingYardSaturating
+ * arithmetic policies (ShuntingYardUnchecked is used by default).
+ * Option --bigint evaluates expression by ShuntingYard<BigInt> (e.g. expression of ExpressionGenerator with long literals),
+ * number of digits of result is printed instead of result.
+ * Option --double evaluates expression by ShuntingYard<double> (e.g. expression of ExpressionGenerator with 'float').
+ * Option --mod evaluates expression by ShuntingYard<ModInt> modulo 18446744073709551557 (the greatest 64-bit prime)
+ * with Montgomery reduction, --barrett and --naive replace it with Barrett reduction and '%' of 128-bit integer
+ * (10^7 dependent multiplications are measured as well, parsing of literals takes most time of expression).
+ * Option --float-conversion measures DecimalFloat against strtod(), boost::lexical_cast and snprintf() on numbers
+ * of the file (the file is the expression of ExpressionGenerator with 'float').
  */
 
+#include "BigInt.h"
+#include "DecimalFloat.h"
+#include "ModInt.h"
 #include "ShuntingYard.h"
+#include "ShuntingYardPipeline.h"
 
 #include <iostream>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iterator>
+#include <vector>
 
-using ShuntingYardInt = ShuntingYard<int>;
+#include <boost/lexical_cast.hpp>
 
+template <class Type>
+Type printable(const Type& value)
+{
+    return value;
+}
+
+std::string printable(const BigInt& value)
+{
+    std::string s = value.to_string();
+    return s.size() > 40 ? std::to_string(s.size()) + " digits" : s;
+}
+
+std::string printable(double value)
+{
+    std::string s;
+    DecimalFloat::append(s, value);
+    return s;
+}
+
+std::string printable(const ModInt& value)
+{
+    return value.to_string();
+}
+
+template <class Parser>
 bool shunting_yard_perf(const char* filename)
 {
     std::ifstream f(filename);
@@ -19,11 +64,13 @@ bool shunting_yard_perf(const char* filename)
         return false;
     }
 
-    ShuntingYardInt shunting_yard;
-    ShuntingYardInt::Result rc{ ShuntingYardInt::ParseResult::Incomplete, 0 };
+    using ParseResult = typename Parser::ParseResult;
+
+    Parser shunting_yard;
+    typename Parser::Result rc{ ParseResult::Incomplete, 0 };
     std::chrono::time_point<std::chrono::system_clock> start_point{ std::chrono::system_clock::now() };
 
-    while (rc.first == ShuntingYardInt::ParseResult::Incomplete)
+    while (rc.first == ParseResult::Incomplete)
     {
         char buffer[8192];
         f.read(buffer, sizeof(buffer));
@@ -42,18 +89,118 @@ bool shunting_yard_perf(const char* filename)
         }
     }
 
-    if (rc.first == ShuntingYardInt::ParseResult::Success)
+    if (rc.first == ParseResult::Success)
     {
         std::chrono::time_point<std::chrono::system_clock> end_point{ std::chrono::system_clock::now() };
         auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(end_point - start_point);
-        std::cout << "Result of expression is: " << rc.second << ", spend time: " << milliseconds.count() << " milliseconds.";
+        std::cout << "Result of expression is: " << printable(rc.second) << ", spend time: " << milliseconds.count() << " milliseconds.";
     }
     else
     {
-        std::cerr << "Could not compute an expression. " << std::endl;
+        std::cerr << "Could not compute an expression" << (rc.first == ParseResult::Overflow ? " (overflow). " : ". ") << std::endl;
+    }
+
+    return rc.first == ParseResult::Success;
+}
+
+template <class Arithmetic, class Type = int, class Syntax = ShuntingYardSyntax>
+int run(const char* filename, bool pipeline)
+{
+    bool result = pipeline ? shunting_yard_perf<ShuntingYardPipeline<Type, Syntax, Arithmetic>>(filename)
+                           : shunting_yard_perf<ShuntingYard<Type, Syntax, Arithmetic>>(filename);
+    return result ? 0 : 1;
+}
+
+/**
+ * Measures time of function for each number, sum of numbers is printed to keep the work.
+ */
+template <class Function>
+void measure(const char* name, const std::vector<std::string>& numbers, Function function)
+{
+    std::chrono::time_point<std::chrono::system_clock> start_point{ std::chrono::system_clock::now() };
+    double sum = 0.0;
+    for (const std::string& number : numbers)
+    {
+        sum += function(number);
     }
+    std::chrono::time_point<std::chrono::system_clock> end_point{ std::chrono::system_clock::now() };
+    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(end_point - start_point);
+    std::cout << name << ": " << milliseconds.count() << " milliseconds (" << sum << ")." << std::endl;
+}
 
-    return rc.first == ShuntingYardInt::ParseResult::Success;
+void mod_multiplication_perf()
+{
+    const unsigned int count = 10000000;
+    ModInt a(1234567890123456789ull);
+    ModInt b(987654321987654321ull);
+    std::chrono::time_point<std::chrono::system_clock> start_point{ std::chrono::system_clock::now() };
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        a *= b;
+        b += a;
+    }
+    std::chrono::time_point<std::chrono::system_clock> end_point{ std::chrono::system_clock::now() };
+    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(end_point - start_point);
+    std::cout << std::endl << count << " multiplications: " << milliseconds.count() << " milliseconds (" << a.to_string() << ").";
+}
+
+int float_conversion_perf(const char* filename)
+{
+    std::ifstream f(filename);
+    if (!f)
+    {
+        std::cerr << "File " << filename << " not found" << std::endl;
+        return 1;
+    }
+
+    //Numbers are taken as they are written by ExpressionGenerator (signs are binary operators, they are skipped).
+    std::string text{std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+    std::vector<std::string> numbers;
+    std::vector<double> values;
+    for (std::size_t i = 0; i < text.size(); )
+    {
+        std::size_t end = text.find_first_not_of("0123456789.eE", i);
+        end = end == std::string::npos ? text.size() : end;
+        //Exponent sign is a part of number.
+        while (end < text.size() && (text[end] == '-' || text[end] == '+') && (text[end - 1] == 'e' || text[end - 1] == 'E'))
+        {
+            end = text.find_first_not_of("0123456789", end + 1);
+            end = end == std::string::npos ? text.size() : end;
+        }
+        if (end > i)
+        {
+            numbers.emplace_back(text, i, end - i);
+            values.push_back(std::strtod(numbers.back().c_str(), nullptr));
+        }
+        i = end + (end == i);
+    }
+    std::cout << numbers.size() << " numbers." << std::endl;
+
+    measure("DecimalFloat::parse", numbers, [](const std::string& s) {
+        double value = 0.0;
+        DecimalFloat::parse(s.data(), s.size(), value);
+        return value;
+    });
+    measure("strtod", numbers, [](const std::string& s) { return std::strtod(s.c_str(), nullptr); });
+    measure("boost::lexical_cast", numbers, [](const std::string& s) { return boost::lexical_cast<double>(s); });
+
+    std::vector<std::string> dummy(values.size());
+    std::size_t index = 0;
+    std::string out;
+    measure("DecimalFloat::append", dummy, [&](const std::string&) {
+        out.clear();
+        DecimalFloat::append(out, values[index++ % values.size()]);
+        return static_cast<double>(out.size());
+    });
+    measure("snprintf %.17g", dummy, [&](const std::string&) {
+        char buffer[32];
+        return static_cast<double>(std::snprintf(buffer, sizeof(buffer), "%.17g", values[index++ % values.size()]));
+    });
+    measure("std::to_string", dummy, [&](const std::string&) {
+        return static_cast<double>(std::to_string(values[index++ % values.size()]).size());
+    });
+
+    return 0;
 }
 
 int main(int argc, const char *argv[])
@@ -61,9 +208,65 @@ int main(int argc, const char *argv[])
     if (argc == 1)
     {
         std::cout << "Check performance of Shunting Yard algorithm. " << std::endl <<
-            "Please provide filename with expression." << std::endl;
+            "Please provide filename with expression (and --pipeline to use ShuntingYardPipeline, " <<
+            "--checked or --saturating to use arithmetic policy, --bigint to use BigInt, --double to use double, " <<
+            "--mod to use ModInt (with --barrett or --naive reduction), --float-conversion to measure conversions of floating-point numbers)." << std::endl;
         return 1;
     }
 
-    return shunting_yard_perf(argv[1]) ? 0 : 1;
+    bool pipeline = false;
+    bool checked = false;
+    bool saturating = false;
+    bool bigint = false;
+    bool floating = false;
+    bool float_conversion = false;
+    bool mod = false;
+    ModReduction reduction = ModReduction::montgomery;
+    for (int i = 2; i < argc; ++i)
+    {
+        pipeline = pipeline || !std::strcmp(argv[i], "--pipeline");
+        checked = checked || !std::strcmp(argv[i], "--checked");
+        saturating = saturating || !std::strcmp(argv[i], "--saturating");
+        bigint = bigint || !std::strcmp(argv[i], "--bigint");
+        floating = floating || !std::strcmp(argv[i], "--double");
+        float_conversion = float_conversion || !std::strcmp(argv[i], "--float-conversion");
+        mod = mod || !std::strcmp(argv[i], "--mod");
+        reduction = !std::strcmp(argv[i], "--barrett") ? ModReduction::barrett :
+                    !std::strcmp(argv[i], "--naive") ? ModReduction::naive : reduction;
+    }
+
+    if (mod)
+    {
+        //Literals are converted by the thread of context, so ShuntingYardPipeline is not used.
+        ModContext context(18446744073709551557ull, reduction);
+        ModInt::Scope scope(context);
+        const bool result = shunting_yard_perf<ShuntingYard<ModInt>>(argv[1]);
+        mod_multiplication_perf();
+        return result ? 0 : 1;
+    }
+
+    if (float_conversion)
+    {
+        return float_conversion_perf(argv[1]);
+    }
+    if (floating)
+    {
+        return checked ? run<ShuntingYardChecked, double, ShuntingYardFloatSyntax>(argv[1], pipeline)
+                       : run<ShuntingYardUnchecked, double, ShuntingYardFloatSyntax>(argv[1], pipeline);
+    }
+
+    if (bigint)
+    {
+        return run<ShuntingYardUnchecked, BigInt>(argv[1], pipeline);
+    }
+    if (checked)
+    {
+        return run<ShuntingYardChecked>(argv[1], pipeline);
+    }
+    if (saturating)
+    {
+        return run<ShuntingYardSaturating>(argv[1], pipeline);
+    }
+
+    return run<ShuntingYardUnchecked>(argv[1], pipeline);
 }
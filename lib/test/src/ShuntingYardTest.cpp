@@ -8,16 +8,35 @@
  * - test with several simple cases;
  * - test that calls parse() method several times for one expression;
  * - test that calls parse() method one time for several expressions expression;
+ * - test of syntax that is configured at compile time;
+ * - test of checked and saturating arithmetic policies;
+ * - test of BigInt type: differential test with int and identities of long numbers (Karatsuba multiplication, division);
+ * - test of floating-point mode: syntax of numbers, parsing compared with strtod() and the shortest round-trip formatting;
+ * - test of ModInt type: differential test with BigInt for Montgomery, Barrett and naive reductions, modular division;
+ * - test of statistics of expression (tokens and depth of brackets) for expressions split at each character;
+ * - differential test of evaluation without brackets by accumulator and evaluation by stacks;
+ * - tests of ShuntingYardPipeline: the same cases, random expressions in random parts compared with ShuntingYard,
+ *   continuation of expression that was started by ShuntingYard and huge expression.
  */
 
+#include "BigInt.h"
+#include "DecimalFloat.h"
+#include "ModInt.h"
 #include "ShuntingYard.h"
+#include "ShuntingYardPipeline.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <functional>
+#include <random>
 #include <string>
 #include <tuple>
+#include <vector>
 
 using ShuntingYardInt = ShuntingYard<int>;
+using ShuntingYardPipelineInt = ShuntingYardPipeline<int>;
 
 /**
  * @brief The ShuntingYardTest class tests internal functions of ShuntingYard template class.
@@ -32,6 +51,7 @@ public:
 private:
     bool test_get_first_not_a_digit();
     bool test_convert();
+    bool test_fast_path();
 
 private:
     using ConvertTestCase = std::tuple<std::string, bool, int>;
@@ -40,7 +60,7 @@ private:
 
 bool ShuntingYardTest::test()
 {
-    return test_get_first_not_a_digit() && test_convert();
+    return test_get_first_not_a_digit() && test_convert() && test_fast_path();
 }
 
 bool ShuntingYardTest::test_get_first_not_a_digit()
@@ -294,12 +314,627 @@ bool shunting_yard_test3()
     return true;
 }
 
+/**
+ * Syntax with extra skip symbol '_' and alias 'x' of multiplication.
+ */
+struct ShuntingYardTestSyntax
+{
+    static constexpr ShuntingYardCharClass classify(char c)
+    {
+        return c == '_' ? ShuntingYardCharClass::Skip :
+               c == 'x' ? ShuntingYardCharClass::Mult : ShuntingYardSyntax::classify(c);
+    }
+};
+
+static_assert(ShuntingYardTestSyntax::classify('x') == ShuntingYardCharClass::Mult, "Syntax is classified at compile time");
+
+bool shunting_yard_test4()
+{
+    ShuntingYard<int, ShuntingYardTestSyntax> shunting_yard;
+    std::string s = "_12 x (3 +_4)__\n";
+    auto result = shunting_yard.parse(s.data(), s.length());
+    bool passed = result.first == decltype(result.first)::Success && result.second == 84;
+
+    //Default syntax doesn't know these symbols.
+    ShuntingYardInt default_shunting_yard;
+    ShuntingYardInt::Result default_result = default_shunting_yard.parse(s.data(), s.length());
+    passed = passed && default_result.first == ShuntingYardInt::ParseResult::InvalidExpression;
+
+    //Skip symbol ends number.
+    result = shunting_yard.parse("1_2\n", 4);
+    passed = passed && result.first == decltype(result.first)::InvalidExpression;
+
+    if (!passed)
+    {
+        std::cerr << "ShuntingYardTest4 failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "ShuntingYardTest4 passed" << std::endl;
+    return true;
+}
+
+using ShuntingYardChecked32 = ShuntingYard<int, ShuntingYardSyntax, ShuntingYardChecked>;
+using ShuntingYardSaturating32 = ShuntingYard<int, ShuntingYardSyntax, ShuntingYardSaturating>;
+
+struct ShuntingYardTest5Case
+{
+    std::string expr;
+    ShuntingYardChecked32::Result checked;
+    ShuntingYardSaturating32::Result saturating;
+};
+
+const ShuntingYardTest5Case shunting_yard_test5_array[] =
+{
+    {"2147483647 + 1\n",         {ShuntingYardChecked32::ParseResult::Overflow, 0},         {ShuntingYardSaturating32::ParseResult::Success, 2147483647}},
+    {"-2147483648 - 1\n",        {ShuntingYardChecked32::ParseResult::Overflow, 0},         {ShuntingYardSaturating32::ParseResult::Success, -2147483647 - 1}},
+    {"65536 * 32768\n",          {ShuntingYardChecked32::ParseResult::Overflow, 0},         {ShuntingYardSaturating32::ParseResult::Success, 2147483647}},
+    {"-65536 * 32768\n",         {ShuntingYardChecked32::ParseResult::Success, -2147483647 - 1}, {ShuntingYardSaturating32::ParseResult::Success, -2147483647 - 1}},
+    {"-65536 * 32769\n",         {ShuntingYardChecked32::ParseResult::Overflow, 0},         {ShuntingYardSaturating32::ParseResult::Success, -2147483647 - 1}},
+    {"-2147483648 / -1\n",       {ShuntingYardChecked32::ParseResult::Overflow, 0},         {ShuntingYardSaturating32::ParseResult::Success, 2147483647}},
+    {"-2147483648 / 1\n",        {ShuntingYardChecked32::ParseResult::Success, -2147483647 - 1}, {ShuntingYardSaturating32::ParseResult::Success, -2147483647 - 1}},
+    {"2147483647 + 1 - 5\n",     {ShuntingYardChecked32::ParseResult::Overflow, 0},         {ShuntingYardSaturating32::ParseResult::Success, 2147483642}},
+    {"1 / 0 * 2147483647 * 2\n", {ShuntingYardChecked32::ParseResult::DivisionByZero, 0},   {ShuntingYardSaturating32::ParseResult::DivisionByZero, 0}},
+    {"(2147483647 + 1) / 0\n",   {ShuntingYardChecked32::ParseResult::Overflow, 0},         {ShuntingYardSaturating32::ParseResult::DivisionByZero, 0}},
+    {"2147483647 * 2 x\n",       {ShuntingYardChecked32::ParseResult::InvalidExpression, 0}, {ShuntingYardSaturating32::ParseResult::InvalidExpression, 0}},
+    {"2147483647 * 2 * 0\n",     {ShuntingYardChecked32::ParseResult::Overflow, 0},         {ShuntingYardSaturating32::ParseResult::Success, 0}}
+};
+
+bool shunting_yard_test5()
+{
+    //Each case is evaluated without brackets (accumulator) and in brackets (stacks), the checked one by pipeline as well.
+    bool result = true;
+    ShuntingYardChecked32 checked;
+    ShuntingYardSaturating32 saturating;
+    ShuntingYardPipeline<int, ShuntingYardSyntax, ShuntingYardChecked> pipeline(4);
+
+    for (auto& test : shunting_yard_test5_array)
+    {
+        for (const std::string& expr : {test.expr, "(" + test.expr.substr(0, test.expr.size() - 1) + ")\n"})
+        {
+            if (checked.parse(expr.data(), expr.size()) != test.checked ||
+                saturating.parse(expr.data(), expr.size()) != test.saturating ||
+                pipeline.parse(expr.data(), expr.size()) != test.checked)
+            {
+                std::cerr << "ShuntingYardTest5 for expression '" << expr << "' failed." << std::endl;
+                result = false;
+            }
+        }
+    }
+
+    if (result)
+    {
+        std::cout << "ShuntingYardTest5 passed" << std::endl;
+    }
+
+    return result;
+}
+
+bool shunting_yard_pipeline_test1()
+{
+    //Small ring makes tokenizer wait for evaluator.
+    bool result = true;
+    ShuntingYardPipelineInt pipeline(4);
+
+    for (auto& test : shunting_yard_test1_array)
+    {
+        ShuntingYardInt::Result parse_result = pipeline.parse(test.expr.data(), test.expr.length());
+        if (parse_result.first != test.parse_result ||
+            (parse_result.first == ShuntingYardInt::ParseResult::Success && parse_result.second != test.result))
+        {
+            std::cerr << "ShuntingYardPipelineTest1 for expression '" << test.expr << "' failed." << std::endl;
+            result = false;
+        }
+        if (test.parse_result == ShuntingYardInt::ParseResult::Incomplete)
+        {
+            pipeline.clear();
+        }
+    }
+
+    if (result)
+    {
+        std::cout << "ShuntingYardPipelineTest1 passed" << std::endl;
+    }
+
+    return result;
+}
+
+std::string make_random_expression(std::mt19937& random, unsigned int depth, unsigned int max_terms = 3)
+{
+    //Numbers are from 0 to 9, at most 9 of them don't overflow int.
+    static const char operators[] = "+-*/";
+    static const char* spaces[] = {"", "", " ", "\t", " \r "};
+    std::string expr;
+    unsigned int terms = 1 + random() % max_terms;
+
+    for (unsigned int i = 0; i < terms; ++i)
+    {
+        if (i)
+        {
+            expr += spaces[random() % 5];
+            expr += operators[random() % 4];
+            expr += spaces[random() % 5];
+        }
+
+        if (depth && random() % 3 == 0)
+        {
+            expr += "(" + make_random_expression(random, depth - 1) + ")";
+        }
+        else
+        {
+            expr += (random() % 4 == 0 ? "-" : "") + std::to_string(random() % 10);
+        }
+    }
+
+    return expr;
+}
+
+std::string make_random_number(std::mt19937& random, unsigned int digits)
+{
+    std::string number(1, static_cast<char>('1' + random() % 9));
+    for (unsigned int i = 1; i < digits; ++i)
+    {
+        number += static_cast<char>('0' + random() % 10);
+    }
+
+    return number;
+}
+
+bool shunting_yard_test6()
+{
+    //Random expressions are compared with checked int (if they don't overflow it), identities check long numbers.
+    using ShuntingYardBigInt = ShuntingYard<BigInt>;
+    bool result = true;
+    std::mt19937 random(42);
+    ShuntingYardBigInt shunting_yard;
+    ShuntingYardChecked32 checked;
+
+    auto evaluate = [&shunting_yard](const std::string& expr) -> std::string
+    {
+        ShuntingYardBigInt::Result r = shunting_yard.parse(expr.data(), expr.size());
+        return r.first == ShuntingYardBigInt::ParseResult::Success ? r.second.to_string() : "error";
+    };
+
+    for (unsigned int n = 0; n < 10000 && result; ++n)
+    {
+        std::string expr = make_random_expression(random, 2) + "\n";
+        ShuntingYardChecked32::Result expected = checked.parse(expr.data(), expr.size());
+        if (expected.first == ShuntingYardChecked32::ParseResult::Overflow)
+        {
+            continue;
+        }
+
+        ShuntingYardBigInt::Result r = shunting_yard.parse(expr.data(), expr.size());
+        if (static_cast<int>(r.first) != static_cast<int>(expected.first) ||
+            (r.first == ShuntingYardBigInt::ParseResult::Success && r.second.to_string() != std::to_string(expected.second)))
+        {
+            std::cerr << "ShuntingYardTest6 for expression '" << expr << "' failed." << std::endl;
+            result = false;
+        }
+    }
+
+    result = result && evaluate("99999999999999999999 * 99999999999999999999\n") == "9999999999999999999800000000000000000001";
+    result = result && evaluate("-2147483648 / -1 - 1000000000 * 1000000000\n") == "-999999997852516352";
+
+    //Numbers of 20..1000 digits: schoolbook, Karatsuba and unbalanced multiplication, long division.
+    for (unsigned int digits : {20u, 300u, 301u, 1000u})
+    {
+        std::string a = make_random_number(random, digits);
+        std::string b = make_random_number(random, digits / 3 + 1);
+        std::string c = make_random_number(random, digits);
+        result = result &&
+            evaluate("(" + a + " + 1) * (" + a + " - 1) - " + a + " * " + a + "\n") == "-1" &&
+            evaluate("(" + a + " * " + c + " + " + b + ") / " + c + " - " + a + "\n") == "0" &&
+            evaluate(a + " * " + b + " / " + b + " - " + a + "\n") == "0" &&
+            evaluate("-" + a + " * " + c + " / -" + a + "\n") == c &&
+            evaluate("(" + a + " + " + b + ") * " + c + " - " + a + " * " + c + " - " + b + " * " + c + "\n") == "0";
+        if (!result)
+        {
+            std::cerr << "ShuntingYardTest6 for numbers of " << digits << " digits failed." << std::endl;
+        }
+    }
+
+    if (result)
+    {
+        std::cout << "ShuntingYardTest6 passed" << std::endl;
+    }
+
+    return result;
+}
+
+using ShuntingYardFloat = ShuntingYard<double, ShuntingYardFloatSyntax, ShuntingYardChecked>;
+
+struct ShuntingYardTest7Case
+{
+    std::string expr;
+    ShuntingYardFloat::ParseResult parse_result;
+    std::string result;
+};
+
+const ShuntingYardTest7Case shunting_yard_test7_array[] =
+{
+    {"5 / 2\n",                       ShuntingYardFloat::ParseResult::Success,           "2.5"},
+    {"7 / 3\n",                       ShuntingYardFloat::ParseResult::Success,           "2.3333333333333335"},
+    {"0.1 + 0.2\n",                   ShuntingYardFloat::ParseResult::Success,           "0.30000000000000004"},
+    {"1.5e3 * 2\n",                   ShuntingYardFloat::ParseResult::Success,           "3000"},
+    {"-1.25E-2 * (4 - 2.)\n",         ShuntingYardFloat::ParseResult::Success,           "-0.025"},
+    {"1e21 + 1\n",                    ShuntingYardFloat::ParseResult::Success,           "1e+21"},
+    {"1e-7 - 0 * 5e+3\n",             ShuntingYardFloat::ParseResult::Success,           "1e-7"},
+    {"-0.000001 * 1\n",               ShuntingYardFloat::ParseResult::Success,           "-0.000001"},
+    {"123456789012345678901234567890\n", ShuntingYardFloat::ParseResult::Success,        "1.2345678901234568e+29"},
+    {"4.9e-324 / 2 * 2\n",            ShuntingYardFloat::ParseResult::Success,           "0"},
+    {"1e308 * 10\n",                  ShuntingYardFloat::ParseResult::Overflow,          ""},
+    {"1 / (0.5 - 0.5)\n",             ShuntingYardFloat::ParseResult::DivisionByZero,    ""},
+    {"1e400 - 1\n",                   ShuntingYardFloat::ParseResult::Overflow,          ""},
+    {"1.2.3\n",                       ShuntingYardFloat::ParseResult::InvalidExpression, ""},
+    {"1e + 2\n",                      ShuntingYardFloat::ParseResult::InvalidExpression, ""},
+    {"1e-\n",                         ShuntingYardFloat::ParseResult::InvalidExpression, ""},
+    {".5\n",                          ShuntingYardFloat::ParseResult::InvalidExpression, ""},
+    {"2 e3\n",                        ShuntingYardFloat::ParseResult::InvalidExpression, ""}
+};
+
+bool shunting_yard_test7()
+{
+    //Each case is parsed at once and by one character, numbers are split between calls.
+    bool result = true;
+    ShuntingYardFloat shunting_yard;
+
+    for (auto& test : shunting_yard_test7_array)
+    {
+        ShuntingYardFloat::Result whole = shunting_yard.parse(test.expr.data(), test.expr.size());
+        ShuntingYardFloat::Result split{ShuntingYardFloat::ParseResult::Incomplete, 0.0};
+        for (std::size_t i = 0; i < test.expr.size() && split.first == ShuntingYardFloat::ParseResult::Incomplete; ++i)
+        {
+            split = shunting_yard.parse(test.expr.data() + i, 1);
+        }
+        shunting_yard.clear();
+
+        std::string text;
+        if (whole.first == ShuntingYardFloat::ParseResult::Success)
+        {
+            DecimalFloat::append(text, whole.second);
+        }
+        if (whole.first != test.parse_result || split.first != test.parse_result || text != test.result ||
+            (whole.first == ShuntingYardFloat::ParseResult::Success && whole.second != split.second))
+        {
+            std::cerr << "ShuntingYardTest7 for expression '" << test.expr << "' failed." << std::endl;
+            result = false;
+        }
+    }
+
+    //Random numbers are parsed like strtod() does, random doubles are formatted by the shortest text that is parsed back.
+    std::mt19937_64 random(43);
+    for (unsigned int n = 0; n < 200000 && result; ++n)
+    {
+        std::string number = std::to_string(random() % 100000000000000000ull);
+        number.insert(1 + random() % number.size(), ".");
+        number += "e" + std::to_string(static_cast<int>(random() % 700) - 350);
+
+        double parsed = 0.0;
+        double expected = std::strtod(number.c_str(), nullptr);
+        if (DecimalFloat::parse(number.data(), number.size(), parsed) != std::isfinite(expected) ||
+            (std::isfinite(expected) && parsed != expected))
+        {
+            std::cerr << "ShuntingYardTest7 for number '" << number << "' failed." << std::endl;
+            result = false;
+        }
+
+        std::uint64_t bits = random();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        std::string text;
+        DecimalFloat::append(text, value);
+        if (std::isfinite(value) && (std::strtod(text.c_str(), nullptr) != value || text.size() > 25))
+        {
+            std::cerr << "ShuntingYardTest7 for formatting of '" << text << "' failed." << std::endl;
+            result = false;
+        }
+    }
+
+    if (result)
+    {
+        std::cout << "ShuntingYardTest7 passed" << std::endl;
+    }
+
+    return result;
+}
+
+bool shunting_yard_test8()
+{
+    //Random expressions with long literals are compared with BigInt result reduced by modulus,
+    //a / b * b must be a if b has inverse and division by zero otherwise.
+    using ShuntingYardMod = ShuntingYard<ModInt>;
+    using ShuntingYardBigInt = ShuntingYard<BigInt>;
+    bool result = true;
+    std::mt19937 random(44);
+    ShuntingYardMod shunting_yard;
+    ShuntingYardBigInt big;
+
+    const std::uint64_t moduli[] = {2, 7, 10, 1000000007, 4294967296ull, 9223372036854775808ull,
+                                    18446744073709551557ull, 18446744073709551615ull};
+    for (std::uint64_t modulus : moduli)
+    {
+        for (ModReduction reduction : {ModReduction::montgomery, ModReduction::barrett, ModReduction::naive})
+        {
+            ModContext context(modulus, reduction);
+            ModInt::Scope scope(context);
+            const std::string m = std::to_string(modulus);
+
+            for (unsigned int n = 0; n < 300 && result; ++n)
+            {
+                std::string expr = make_random_expression(random, 2);
+                std::replace(expr.begin(), expr.end(), '/', '*');
+                expr += " - " + make_random_number(random, 1 + random() % 40) + " * (" + make_random_number(random, 1 + random() % 40) + ")\n";
+
+                //Remainder of BigInt is not negative.
+                const std::string reduce = "((" + expr.substr(0, expr.size() - 1) + ") - (" + expr.substr(0, expr.size() - 1) + ") / " + m + " * " + m + " + " + m + ")";
+                const std::string expected_expr = reduce + " - (" + reduce + ") / " + m + " * " + m + "\n";
+                ShuntingYardBigInt::Result expected = big.parse(expected_expr.data(), expected_expr.size());
+                ShuntingYardMod::Result r = shunting_yard.parse(expr.data(), expr.size());
+                if (r.first != ShuntingYardMod::ParseResult::Success || r.second.to_string() != expected.second.to_string())
+                {
+                    std::cerr << "ShuntingYardTest8 for expression '" << expr << "' modulo " << m << " failed." << std::endl;
+                    result = false;
+                }
+            }
+
+            for (unsigned int n = 0; n < 100 && result; ++n)
+            {
+                const std::string a = make_random_number(random, 1 + random() % 25);
+                const std::string b = make_random_number(random, 1 + random() % 25);
+                const std::string expr = a + " / " + b + " * " + b + " - " + a + "\n";
+                ShuntingYardMod::Result r = shunting_yard.parse(expr.data(), expr.size());
+                ModInt divisor;
+                ModInt::from_decimal(b.data(), b.size(), divisor);
+                const bool invertible = !!divisor;
+                if (invertible ? r.first != ShuntingYardMod::ParseResult::Success || r.second.to_string() != "0"
+                               : r.first != ShuntingYardMod::ParseResult::DivisionByZero)
+                {
+                    std::cerr << "ShuntingYardTest8 for expression '" << expr << "' modulo " << m << " failed." << std::endl;
+                    result = false;
+                }
+            }
+        }
+    }
+
+    ModContext context(10);
+    ModInt::Scope scope(context);
+    auto evaluate = [&shunting_yard](const std::string& expr) -> std::string
+    {
+        ShuntingYardMod::Result r = shunting_yard.parse(expr.data(), expr.size());
+        return r.first == ShuntingYardMod::ParseResult::Success ? r.second.to_string() :
+            r.first == ShuntingYardMod::ParseResult::DivisionByZero ? "division by zero" : "error";
+    };
+    result = result && evaluate("1 / 3\n") == "7" && evaluate("-3\n") == "7" && evaluate("6 / 4\n") == "division by zero" &&
+        evaluate("12345678901234567890123\n") == "3" && evaluate("1 - -\n") == "error";
+
+    if (result)
+    {
+        std::cout << "ShuntingYardTest8 passed" << std::endl;
+    }
+
+    return result;
+}
+
+bool ShuntingYardTest::test_fast_path()
+{
+    //Expressions without brackets and with them (some of them are broken) are sent by random parts to ShuntingYard
+    //and to ShuntingYard that evaluates everything by stacks. Results of each parse() call must be the same.
+    std::mt19937 random(40);
+    ShuntingYardInt fast;
+    ShuntingYardInt general;
+    general.fast_path = false;
+    general.clear();
+    static const char broken[] = "()+x\n";
+
+    for (unsigned int n = 0; n < 20000; ++n)
+    {
+        //Several expressions in one data, so the rest of data after expression is parsed as well.
+        std::string data;
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            std::string expr = n % 2 ? make_random_expression(random, 0, 9) : make_random_expression(random, 2);
+            if (random() % 8 == 0)
+            {
+                expr.insert(random() % (expr.size() + 1), 1, broken[random() % 5]);
+            }
+            data += expr + '\n';
+        }
+
+        auto evaluate = [&data, n](ShuntingYardInt& parser)
+        {
+            std::mt19937 parts(n);
+            std::vector<std::pair<ShuntingYardInt::Result, bool>> results;
+            for (std::size_t begin = 0; begin < data.size(); )
+            {
+                std::size_t size = std::min<std::size_t>(1 + parts() % 8, data.size() - begin);
+                ShuntingYardInt::Result r = parser.parse(data.data() + begin, size);
+                results.emplace_back(r, parser.is_empty());
+                while (r.first != ShuntingYardInt::ParseResult::Incomplete)
+                {
+                    r = parser.parse(nullptr, 0);
+                    results.emplace_back(r, parser.is_empty());
+                }
+                begin += size;
+            }
+            parser.clear();
+            return results;
+        };
+
+        if (evaluate(fast) != evaluate(general))
+        {
+            std::cerr << "ShuntingYardTest::test_fast_path test failed for data: '" << data << "'" << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "Test ShuntingYardTest::fast_path passed" << std::endl;
+    return true;
+}
+
+bool shunting_yard_pipeline_test2()
+{
+    //Random expressions (some of them are broken) are sent by random parts to ShuntingYard and to pipeline.
+    std::mt19937 random(2024);
+    ShuntingYardInt shunting_yard;
+    ShuntingYardPipelineInt pipeline(16);
+    static const char broken[] = "()+x\n";
+
+    for (unsigned int n = 0; n < 20000; ++n)
+    {
+        std::string expr = make_random_expression(random, 2);
+        if (random() % 8 == 0)
+        {
+            expr.insert(random() % (expr.size() + 1), 1, broken[random() % 5]);
+        }
+        expr += '\n';
+
+        //Result of expression is the first result that is not Incomplete (the rest of data is dropped).
+        auto evaluate = [&expr, n](auto& parser)
+        {
+            std::mt19937 parts(n);
+            ShuntingYardInt::Result r{ShuntingYardInt::ParseResult::Incomplete, 0};
+            for (std::size_t begin = 0; begin < expr.size() && r.first == ShuntingYardInt::ParseResult::Incomplete; )
+            {
+                std::size_t size = std::min<std::size_t>(1 + parts() % 8, expr.size() - begin);
+                r = parser.parse(expr.data() + begin, size);
+                begin += size;
+            }
+            parser.clear();
+            return r;
+        };
+
+        ShuntingYardInt::Result expected = evaluate(shunting_yard);
+        ShuntingYardInt::Result actual = evaluate(pipeline);
+        if (expected != actual)
+        {
+            std::cerr << "ShuntingYardPipelineTest2 for expression '" << expr << "' failed." << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "ShuntingYardPipelineTest2 passed" << std::endl;
+    return true;
+}
+
+bool shunting_yard_test9()
+{
+    //Statistics don't depend on split of expression, they are kept until the end of the next expression.
+    const std::tuple<std::string, std::size_t, unsigned int> cases[] = {
+        std::make_tuple("((12 + 34) * 5 - 678) / -9\n", 9, 2), std::make_tuple("12 + 34 * 5 - 678 / -9\n", 9, 0),
+        std::make_tuple("(((1)))\n", 1, 3), std::make_tuple("(1 + (2 * (3 - 4)) + (5))\n", 9, 3)};
+    ShuntingYardInt shunting_yard;
+    for (auto& c : cases)
+    {
+        const std::string& s = std::get<0>(c);
+        for (std::size_t split = 0; split < s.size(); ++split)
+        {
+            ShuntingYardInt::Result r = shunting_yard.parse(s.data(), split);
+            ShuntingYardInt::Result r2 = shunting_yard.parse(s.data() + split, s.size() - split);
+            if (r.first != ShuntingYardInt::ParseResult::Incomplete || r2.first != ShuntingYardInt::ParseResult::Success ||
+                shunting_yard.statistics().tokens != std::get<1>(c) || shunting_yard.statistics().depth != std::get<2>(c))
+            {
+                std::cerr << "ShuntingYardTest9 for '" << s << "' split " << split << " failed." << std::endl;
+                return false;
+            }
+        }
+    }
+
+    //Expression with mistake is cleared, its statistics are counted up to the mistake.
+    ShuntingYardInt::Result r = shunting_yard.parse("(1 + 2) * x\n", 12);
+    if (r.first != ShuntingYardInt::ParseResult::InvalidExpression || shunting_yard.statistics().tokens != 4 ||
+        shunting_yard.statistics().depth != 1)
+    {
+        std::cerr << "ShuntingYardTest9 for invalid expression failed." << std::endl;
+        return false;
+    }
+
+    std::cout << "ShuntingYardTest9 passed" << std::endl;
+    return true;
+}
+
+bool shunting_yard_pipeline_test3()
+{
+    //Pipeline continues expressions that were started by ShuntingYard at each step of its state machine
+    //(expression without brackets is continued from registers of accumulator).
+    const std::pair<std::string, int> cases[] = {{"((12 + 34) * 5 - 678) / -9\n", 49}, {"12 + 34 * 5 - 678 / -9\n", 257}};
+    for (auto& c : cases)
+    {
+        const std::string& s = c.first;
+        for (std::size_t split = 0; split + 1 < s.size(); ++split)
+        {
+            ShuntingYardInt shunting_yard;
+            ShuntingYardPipelineInt pipeline;
+            ShuntingYardInt::Result r = shunting_yard.parse(s.data(), split);
+            pipeline.resume(shunting_yard);
+            ShuntingYardInt::Result r2 = pipeline.parse(s.data() + split, s.size() - split);
+            if (r.first != ShuntingYardInt::ParseResult::Incomplete || !shunting_yard.is_empty() ||
+                r2.first != ShuntingYardInt::ParseResult::Success || r2.second != c.second || !pipeline.is_empty() ||
+                pipeline.statistics().tokens != 9)
+            {
+                std::cerr << "ShuntingYardPipelineTest3 for '" << s << "' split " << split << " failed." << std::endl;
+                return false;
+            }
+        }
+    }
+
+    std::cout << "ShuntingYardPipelineTest3 passed" << std::endl;
+    return true;
+}
+
+bool shunting_yard_pipeline_test4()
+{
+    //Huge expression in several parts, the next expression after it and division by zero in the middle of huge expression.
+    ShuntingYardPipelineInt pipeline(64);
+    std::string huge = "0";
+    for (unsigned int i = 0; i < 100000; ++i)
+    {
+        huge += i % 2 ? " - (3 * 2)" : " + 7";
+    }
+
+    ShuntingYardInt::Result r1 = pipeline.parse(huge.data(), huge.size());
+    ShuntingYardInt::Result r2 = pipeline.parse("\n2 * 3\n", 7);
+    ShuntingYardInt::Result r3 = pipeline.parse(nullptr, 0);
+    ShuntingYardInt::Result r4 = pipeline.parse(huge.data(), huge.size());
+    ShuntingYardInt::Result r5 = pipeline.parse(" / 0 + 1", 8);
+    if (r5.first == ShuntingYardInt::ParseResult::Incomplete)
+    {
+        //Evaluator has not reached division yet.
+        r5 = pipeline.parse(" + 1\n", 5);
+    }
+
+    bool result = r1.first == ShuntingYardInt::ParseResult::Incomplete &&
+        r2.first == ShuntingYardInt::ParseResult::Success && r2.second == 50000 &&
+        r3.first == ShuntingYardInt::ParseResult::Success && r3.second == 6 &&
+        r4.first == ShuntingYardInt::ParseResult::Incomplete &&
+        r5.first == ShuntingYardInt::ParseResult::DivisionByZero &&
+        pipeline.is_empty();
+    if (!result)
+    {
+        std::cerr << "ShuntingYardPipelineTest4 failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "ShuntingYardPipelineTest4 passed" << std::endl;
+    return true;
+}
+
 const std::function<bool()> tests[] =
 {
     []() { ShuntingYardTest test; return test.test(); },
     shunting_yard_test1,
     shunting_yard_test2,
-    shunting_yard_test3
+    shunting_yard_test3,
+    shunting_yard_test4,
+    shunting_yard_test5,
+    shunting_yard_test6,
+    shunting_yard_test7,
+    shunting_yard_test8,
+    shunting_yard_test9,
+    shunting_yard_pipeline_test1,
+    shunting_yard_pipeline_test2,
+    shunting_yard_pipeline_test3,
+    shunting_yard_pipeline_test4
 };
 
 int main()